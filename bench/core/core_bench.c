@@ -0,0 +1,168 @@
+
+/**
+ * @file /magma.bench/core/core_bench.c
+ *
+ * @brief String, hash and encoding benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_bench.h"
+
+// Keeps the compiler from discarding the hash results.
+static volatile uint64_t bench_sink;
+
+static bool_t bench_string_alloc(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = st_alloc(*(size_t *)data))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_string_dupe(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = st_dupe(data))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_string_print(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = st_aprint("%.*s = %lu", (int)st_length_int(data), st_char_get(data), st_length_get(data)))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_hash_murmur32(void *data) {
+	bench_sink = hash_murmur32(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_hash_murmur64(void *data) {
+	bench_sink = hash_murmur64(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_hash_crc32(void *data) {
+	bench_sink = hash_crc32(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_hash_crc64(void *data) {
+	bench_sink = hash_crc64(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_hash_adler32(void *data) {
+	bench_sink = hash_adler32(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_hash_fletcher32(void *data) {
+	bench_sink = hash_fletcher32(st_data_get(data), st_length_get(data));
+	return true;
+}
+
+static bool_t bench_encode_base64(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = base64_encode(data, NULL))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_decode_base64(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = base64_decode(data, NULL))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_encode_qp(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = qp_encode(data))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+static bool_t bench_decode_qp(void *data) {
+
+	stringer_t *s;
+
+	if (!(s = qp_decode(data))) {
+		return false;
+	}
+
+	st_free(s);
+	return true;
+}
+
+void bench_core(void) {
+
+	size_t small = BENCH_BLOCK_SMALL, large = BENCH_BLOCK_LARGE;
+	stringer_t *binary = NULL, *text = NULL, *base64 = NULL, *qp = NULL;
+
+	if (!(binary = bench_data(BENCH_BLOCK_LARGE, false)) || !(text = bench_data(BENCH_BLOCK_LARGE, true)) ||
+		!(base64 = base64_encode(binary, NULL)) || !(qp = qp_encode(binary))) {
+		log_bench("%-64.64s%10.10s\n", "core", "FAILED");
+		st_cleanup(binary);
+		st_cleanup(text);
+		st_cleanup(base64);
+		return;
+	}
+
+	bench_run("core.strings.alloc.64", &bench_string_alloc, &small);
+	bench_run("core.strings.alloc.4096", &bench_string_alloc, &large);
+	bench_run("core.strings.dupe.4096", &bench_string_dupe, text);
+	bench_run("core.strings.print.4096", &bench_string_print, text);
+
+	bench_run("core.hash.murmur32.4096", &bench_hash_murmur32, binary);
+	bench_run("core.hash.murmur64.4096", &bench_hash_murmur64, binary);
+	bench_run("core.hash.crc32.4096", &bench_hash_crc32, binary);
+	bench_run("core.hash.crc64.4096", &bench_hash_crc64, binary);
+	bench_run("core.hash.adler32.4096", &bench_hash_adler32, binary);
+	bench_run("core.hash.fletcher32.4096", &bench_hash_fletcher32, binary);
+
+	bench_run("core.encodings.base64.encode.4096", &bench_encode_base64, binary);
+	bench_run("core.encodings.base64.decode.4096", &bench_decode_base64, base64);
+	bench_run("core.encodings.qp.encode.4096", &bench_encode_qp, binary);
+	bench_run("core.encodings.qp.decode.4096", &bench_decode_qp, qp);
+
+	st_free(binary);
+	st_free(text);
+	st_free(base64);
+	st_free(qp);
+	return;
+}
@@ -0,0 +1,28 @@
+
+/**
+ * @file /magma.bench/core/core_bench.h
+ *
+ * @brief The entry point for the core module benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#ifndef CORE_BENCH_H
+#define CORE_BENCH_H
+
+typedef struct {
+	inx_t *inx;
+	multi_t *keys;
+	uint64_t type, position;
+} bench_inx_opt_t;
+
+/// core_bench.c
+void   bench_core(void);
+
+/// inx_bench.c
+void   bench_inx(void);
+
+#endif
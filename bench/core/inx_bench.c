@@ -0,0 +1,120 @@
+
+/**
+ * @file /magma.bench/core/inx_bench.c
+ *
+ * @brief Index benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_bench.h"
+
+static bool_t bench_inx_insert(bench_inx_opt_t *opts) {
+
+	inx_t *inx;
+
+	if (!(inx = inx_alloc(opts->type | M_INX_LOCK_MANUAL, NULL))) {
+		return false;
+	}
+
+	inx_lock_write(inx);
+
+	for (uint64_t i = 0; i < BENCH_INX_OBJECTS; i++) {
+		if (!inx_insert(inx, opts->keys[i], opts->keys + i)) {
+			inx_unlock(inx);
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	inx_unlock(inx);
+	inx_free(inx);
+
+	return true;
+}
+
+static bool_t bench_inx_find(bench_inx_opt_t *opts) {
+
+	uint64_t position = opts->position++ % BENCH_INX_OBJECTS;
+
+	return inx_find(opts->inx, opts->keys[position]) == opts->keys + position;
+}
+
+static bool_t bench_inx_cursor(bench_inx_opt_t *opts) {
+
+	uint64_t count = 0;
+	inx_cursor_t *cursor;
+
+	if (!(cursor = inx_cursor_alloc(opts->inx))) {
+		return false;
+	}
+
+	while (inx_cursor_value_next(cursor)) {
+		count++;
+	}
+
+	inx_cursor_free(cursor);
+
+	return count == BENCH_INX_OBJECTS;
+}
+
+void bench_inx(void) {
+
+	multi_t *keys;
+	chr_t name[128];
+	bench_inx_opt_t opts;
+	struct {
+		uint64_t type;
+		chr_t *name;
+	} types[] = {
+		{ M_INX_TREE, "tree" },
+		{ M_INX_HASHED, "hashed" },
+		{ M_INX_LINKED, "linked" },
+		{ M_INX_PROBED, "probed" },
+		{ M_INX_BPLUS, "bplus" }
+	};
+
+	if (!(keys = mm_alloc(sizeof(multi_t) * BENCH_INX_OBJECTS))) {
+		log_bench("%-64.64s%10.10s\n", "core.indexes", "FAILED");
+		return;
+	}
+
+	// The keys are unique, since the generator never repeats a value before cycling through its entire period.
+	for (uint64_t i = 0; i < BENCH_INX_OBJECTS; i++) {
+		keys[i].type = M_TYPE_UINT64;
+		keys[i].val.u64 = bench_random();
+	}
+
+	for (uint64_t i = 0; i < sizeof(types) / sizeof(*types); i++) {
+
+		mm_wipe(&opts, sizeof(bench_inx_opt_t));
+		opts.type = types[i].type;
+		opts.keys = keys;
+
+		snprintf(name, sizeof(name), "core.indexes.%s.insert.%u", types[i].name, BENCH_INX_OBJECTS);
+		bench_run(name, (bool_t (*)(void *))&bench_inx_insert, &opts);
+
+		// Build the index used by the find and cursor benchmarks.
+		if (!(opts.inx = inx_alloc(opts.type, NULL))) {
+			continue;
+		}
+
+		for (uint64_t j = 0; j < BENCH_INX_OBJECTS; j++) {
+			inx_insert(opts.inx, keys[j], keys + j);
+		}
+
+		snprintf(name, sizeof(name), "core.indexes.%s.find.%u", types[i].name, BENCH_INX_OBJECTS);
+		bench_run(name, (bool_t (*)(void *))&bench_inx_find, &opts);
+
+		snprintf(name, sizeof(name), "core.indexes.%s.cursor.%u", types[i].name, BENCH_INX_OBJECTS);
+		bench_run(name, (bool_t (*)(void *))&bench_inx_cursor, &opts);
+
+		inx_free(opts.inx);
+	}
+
+	mm_free(keys);
+	return;
+}
@@ -0,0 +1,387 @@
+
+/**
+ * @file /magma.bench/magma_bench.c
+ *
+ * @brief	The micro-benchmark executable entry point.
+ *
+ * @note	Every benchmark is calibrated so a sample lasts long enough to be measured accurately, warmed up, and then timed repeatedly.
+ * 			The results are written as tab separated lines, one per benchmark, holding the minimum, median, 90th percentile, 99th percentile
+ * 			and maximum number of nanoseconds per operation. A previous run can be supplied as a baseline, in which case any benchmark
+ * 			whose median grew by more than the tolerance is flagged as a regression, and the process exits with a failure status.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_bench.h"
+
+struct {
+	FILE *output;
+	chr_t *baseline, *filter;
+	uint64_t samples, warmup, tolerance, count, failed, seed;
+	bench_result_t results[BENCH_RESULTS_MAX];
+} bench = {
+		.output = NULL,
+		.baseline = NULL,
+		.filter = NULL,
+		.samples = BENCH_SAMPLES,
+		.warmup = BENCH_WARMUP,
+		.tolerance = BENCH_TOLERANCE,
+		.count = 0,
+		.failed = 0,
+		.seed = 0x9E3779B97F4A7C15UL
+};
+
+/**
+ * @brief	Get the value of the monotonic clock.
+ * @return	the current time in nanoseconds.
+ */
+static uint64_t bench_time(void) {
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000UL) + now.tv_nsec;
+}
+
+/**
+ * @brief	Compare two samples, for use with qsort().
+ */
+static int bench_compare(const void *a, const void *b) {
+
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief	Generate a pseudo random number.
+ * @note	The benchmarks need the same input on every run, so this uses a fixed seed instead of the random number generator.
+ * @return	the next number in the sequence.
+ */
+uint64_t bench_random(void) {
+
+	bench.seed ^= bench.seed << 13;
+	bench.seed ^= bench.seed >> 7;
+	bench.seed ^= bench.seed << 17;
+
+	return bench.seed;
+}
+
+/**
+ * @brief	Generate a block of benchmark input.
+ * @param	length	the number of bytes to generate.
+ * @param	text	if true, the block is filled with lines of lowercase words, which resembles message content and compresses
+ * 					realistically; otherwise the block is filled with random binary data.
+ * @return	NULL on failure, or a managed string holding the generated data.
+ */
+stringer_t * bench_data(size_t length, bool_t text) {
+
+	uchr_t *data;
+	stringer_t *result;
+
+	if (!(result = st_alloc(length))) {
+		return NULL;
+	}
+
+	data = st_data_get(result);
+
+	for (size_t i = 0; i < length; i++) {
+
+		if (!text) {
+			data[i] = bench_random() & 0xFF;
+		}
+		else if ((i % 72) == 71) {
+			data[i] = '\n';
+		}
+		else {
+			data[i] = (bench_random() % 6) ? 'a' + (bench_random() % 16) : ' ';
+		}
+
+	}
+
+	st_length_set(result, length);
+	return result;
+}
+
+/**
+ * @brief	Time an operation, and record the result.
+ * @note	The number of operations per sample is doubled until a sample lasts at least BENCH_SAMPLE_NS nanoseconds. The operation is
+ * 			then executed for the configured number of warmup samples before the timed samples are collected.
+ * @param	name	the name of the benchmark, which is skipped if it doesn't begin with the filter supplied on the command line.
+ * @param	op		the operation being measured, which should return false if an error occurs.
+ * @param	data	an opaque pointer passed to the operation.
+ * @return	false if the operation failed, or true on success or if the benchmark was skipped.
+ */
+bool_t bench_run(chr_t *name, bool_t (*op)(void *data), void *data) {
+
+	double *samples;
+	bench_result_t *result;
+	uint64_t batch = 1, start, elapsed;
+
+	if (bench.filter && st_cmp_cs_starts(NULLER(name), NULLER(bench.filter))) {
+		return true;
+	}
+	else if (bench.count == BENCH_RESULTS_MAX || !(samples = mm_alloc(sizeof(double) * bench.samples))) {
+		log_bench("%-64.64s%10.10s\n", name, "SKIPPED");
+		bench.failed++;
+		return false;
+	}
+
+	// Calibrate the number of operations per sample.
+	do {
+
+		start = bench_time();
+
+		for (uint64_t i = 0; i < batch; i++) {
+			if (!op(data)) {
+				log_bench("%-64.64s%10.10s\n", name, "FAILED");
+				mm_free(samples);
+				bench.failed++;
+				return false;
+			}
+		}
+
+		elapsed = bench_time() - start;
+
+	} while (elapsed < BENCH_SAMPLE_NS && batch < BENCH_BATCH_MAX && (batch <<= 1));
+
+	// Warm up.
+	for (uint64_t i = 0; i < bench.warmup * batch; i++) {
+		op(data);
+	}
+
+	// Collect the samples.
+	for (uint64_t i = 0; i < bench.samples; i++) {
+
+		start = bench_time();
+
+		for (uint64_t j = 0; j < batch; j++) {
+			op(data);
+		}
+
+		samples[i] = (double)(bench_time() - start) / batch;
+	}
+
+	qsort(samples, bench.samples, sizeof(double), &bench_compare);
+
+	result = bench.results + bench.count++;
+	snprintf(result->name, sizeof(result->name), "%s", name);
+	result->samples = bench.samples;
+	result->batch = batch;
+	result->min = samples[0];
+	result->p50 = samples[(bench.samples * 50) / 100];
+	result->p90 = samples[(bench.samples * 90) / 100];
+	result->p99 = samples[(bench.samples * 99) / 100];
+	result->max = samples[bench.samples - 1];
+
+	mm_free(samples);
+	return true;
+}
+
+/**
+ * @brief	Write the recorded results.
+ * @return	This function returns no value.
+ */
+void bench_output(void) {
+
+	bench_result_t *result;
+
+	fprintf(bench.output, "# name\tsamples\tbatch\tmin\tp50\tp90\tp99\tmax\n");
+
+	for (uint64_t i = 0; i < bench.count; i++) {
+		result = bench.results + i;
+		fprintf(bench.output, "%s\t%lu\t%lu\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\n", result->name, result->samples, result->batch, result->min,
+			result->p50, result->p90, result->p99, result->max);
+	}
+
+	fflush(bench.output);
+	return;
+}
+
+/**
+ * @brief	Compare the recorded results against a baseline produced by a previous run.
+ * @note	The comparison is written after the results, as tab separated lines holding the benchmark name, the baseline median, the
+ * 			current median, the change as a percentage, and a verdict of OK, REGRESSION, or MISSING if the benchmark wasn't in the baseline.
+ * @return	-1 if the baseline couldn't be read, or the number of regressions found.
+ */
+int_t bench_compare_baseline(void) {
+
+	FILE *file;
+	int_t regressions = 0;
+	bench_result_t *result;
+	chr_t line[1024], name[128];
+	double p50, change, *baseline;
+
+	if (!(file = fopen(bench.baseline, "r"))) {
+		log_bench("Unable to open the baseline file. { file = %s }\n", bench.baseline);
+		return -1;
+	}
+	else if (!(baseline = mm_alloc(sizeof(double) * BENCH_RESULTS_MAX))) {
+		fclose(file);
+		return -1;
+	}
+
+	// A negative median marks a benchmark that wasn't found in the baseline.
+	for (uint64_t i = 0; i < bench.count; i++) {
+		baseline[i] = -1;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+
+		if (*line == '#' || sscanf(line, "%127[^\t]\t%*u\t%*u\t%*f\t%lf", name, &p50) != 2) {
+			continue;
+		}
+
+		for (uint64_t i = 0; i < bench.count; i++) {
+			if (!st_cmp_cs_eq(NULLER(name), NULLER(bench.results[i].name))) {
+				baseline[i] = p50;
+			}
+		}
+	}
+
+	fclose(file);
+
+	fprintf(bench.output, "# name\tbaseline\tcurrent\tchange\tverdict\n");
+
+	for (uint64_t i = 0; i < bench.count; i++) {
+
+		result = bench.results + i;
+
+		if (baseline[i] < 0) {
+			fprintf(bench.output, "%s\t-\t%.2f\t-\tMISSING\n", result->name, result->p50);
+			continue;
+		}
+
+		change = baseline[i] > 0 ? ((result->p50 - baseline[i]) / baseline[i]) * 100 : 0;
+
+		if (change > bench.tolerance) {
+			regressions++;
+		}
+
+		fprintf(bench.output, "%s\t%.2f\t%.2f\t%+.1f%%\t%s\n", result->name, baseline[i], result->p50, change,
+			change > bench.tolerance ? "REGRESSION" : "OK");
+	}
+
+	fflush(bench.output);
+	mm_free(baseline);
+
+	return regressions;
+}
+
+/* modeled closely after check_display_usage() */
+void bench_display_usage(char *progname) {
+
+	log_bench("\n"
+			"\t%s [options] [config_file]\n\n"
+			"\t%-25.25s\t\t%s\n\t%-25.25s\t\t%s\n\t%-25.25s\t\t%s\n\t%-25.25s\t\t%s\n\t%-25.25s\t\t%s\n\t%-25.25s\t\t%s\n\n",
+			progname,
+			"-s samples", "the number of timed samples collected for each benchmark.",
+			"-w warmup", "the number of untimed samples executed before timing begins.",
+			"-f prefix", "only run the benchmarks whose names begin with the prefix.",
+			"-o output_file", "write the results to a file instead of standard output.",
+			"-b baseline_file", "compare the results against the output of a previous run.",
+			"-t tolerance", "the percentage a median may grow before it's reported as a regression.");
+	exit(EXIT_FAILURE);
+}
+
+/* modeled closely after check_args_parse() */
+void bench_args_parse(int argc, char *argv[]) {
+
+	int_t i = 1;
+	chr_t *output = NULL;
+
+	while (i < argc) {
+
+		// Every option requires a value.
+		if (!mm_cmp_cs_eq(argv[i], "-", 1) && (i + 1 >= argc || ns_length_get(argv[i]) != 2)) {
+			bench_display_usage(argv[0]);
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-s", 2))) {
+			if (!uint64_conv_ns(argv[i + 1], &bench.samples) || !bench.samples) bench_display_usage(argv[0]);
+			i += 2;
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-w", 2))) {
+			if (!uint64_conv_ns(argv[i + 1], &bench.warmup)) bench_display_usage(argv[0]);
+			i += 2;
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-t", 2))) {
+			if (!uint64_conv_ns(argv[i + 1], &bench.tolerance)) bench_display_usage(argv[0]);
+			i += 2;
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-f", 2))) {
+			bench.filter = argv[i + 1];
+			i += 2;
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-o", 2))) {
+			output = argv[i + 1];
+			i += 2;
+		}
+		else if (!st_cmp_cs_eq(NULLER(argv[i]), PLACER("-b", 2))) {
+			bench.baseline = argv[i + 1];
+			i += 2;
+		}
+		// See if it's an illegal parameter beginning with "-"
+		else if (!mm_cmp_cs_eq(argv[i], "-", 1)) {
+			bench_display_usage(argv[0]);
+		}
+		// Otherwise it's the config file
+		else if (i == (argc-1)) {
+			snprintf(magma.config.file, MAGMA_FILEPATH_MAX, "%s", argv[i]);
+			i++;
+		}
+		else {
+			bench_display_usage(argv[0]);
+		}
+
+	}
+
+	if (output && !(bench.output = fopen(output, "w"))) {
+		log_bench("Unable to open the output file. { file = %s }\n", output);
+		exit(EXIT_FAILURE);
+	}
+	else if (!output) {
+		bench.output = stdout;
+	}
+
+	return;
+}
+
+int main(int argc, char *argv[]) {
+
+	int_t regressions = 0;
+
+	// Updates the location of the config file if it was specified on the command line.
+	bench_args_parse(argc, argv);
+
+	// The benchmarks only need the configuration and the shared library, so the rest of the daemon isn't started.
+	if ((magma.page_length = getpagesize()) <= 0 || !config_load_defaults() || !config_load_file_settings() || !lib_load()) {
+		log_bench("Initialization error. Exiting.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	bench_core();
+	bench_inx();
+	bench_compress();
+
+	bench_output();
+
+	if (bench.baseline && (regressions = bench_compare_baseline()) < 0) {
+		bench.failed++;
+	}
+
+	if (bench.output != stdout) {
+		fclose(bench.output);
+	}
+
+	lib_unload();
+	config_free();
+
+	if (regressions > 0) {
+		log_bench("%i benchmark%s regressed by more than %lu%%.\n", regressions, regressions == 1 ? "" : "s", bench.tolerance);
+	}
+
+	exit((bench.failed || regressions) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,57 @@
+
+/**
+ * @file /magma.bench/magma_bench.h
+ *
+ * @brief The entry point for accessing the modules involved with executing the micro-benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#ifndef MAGMA_BENCH_H
+#define MAGMA_BENCH_H
+
+#include <magma.h>
+
+#include "core/core_bench.h"
+#include "providers/provide_bench.h"
+
+#define log_bench(...) log_internal (__FILE__, __FUNCTION__, __LINE__, M_LOG_LINE_FEED_DISABLE | M_LOG_TIME_DISABLE | M_LOG_FILE_DISABLE | M_LOG_LINE_DISABLE | M_LOG_FUNCTION_DISABLE | M_LOG_STACK_TRACE_DISABLE, __VA_ARGS__)
+
+// The number of timed samples collected for every benchmark, and the number of untimed samples used to warm up the caches.
+#define BENCH_SAMPLES 1000
+#define BENCH_WARMUP 100
+
+// Fast operations are repeated inside each sample until the sample takes at least this many nanoseconds, so the clock overhead
+// doesn't dominate the result. The repeat count is capped to keep slow machines from running forever.
+#define BENCH_SAMPLE_NS 20000
+#define BENCH_BATCH_MAX 65536
+
+// The percentage by which the median of a benchmark may exceed its baseline before it's flagged as a regression.
+#define BENCH_TOLERANCE 10
+
+// The maximum number of benchmarks that can be recorded by a single run.
+#define BENCH_RESULTS_MAX 256
+
+// The size of the data blocks used by the string, hash, encoding and compression benchmarks.
+#define BENCH_BLOCK_SMALL 64
+#define BENCH_BLOCK_LARGE 4096
+#define BENCH_BLOCK_COMPRESS (64 * 1024)
+
+// The number of records loaded into the indexes.
+#define BENCH_INX_OBJECTS 1024
+
+typedef struct {
+	chr_t name[128];
+	uint64_t samples, batch;
+	double min, p50, p90, p99, max;
+} bench_result_t;
+
+/// magma_bench.c
+bool_t        bench_run(chr_t *name, bool_t (*op)(void *data), void *data);
+stringer_t *  bench_data(size_t length, bool_t text);
+uint64_t      bench_random(void);
+
+#endif
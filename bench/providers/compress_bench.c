@@ -0,0 +1,89 @@
+
+/**
+ * @file /magma.bench/providers/compress_bench.c
+ *
+ * @brief Compression engine benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_bench.h"
+
+typedef struct {
+	stringer_t *input;
+	compress_t *compressed;
+	compress_t * (*compress)(stringer_t *input);
+	stringer_t * (*decompress)(compress_t *compressed);
+} bench_compress_opt_t;
+
+static bool_t bench_compress_op(bench_compress_opt_t *opts) {
+
+	compress_t *compressed;
+
+	if (!(compressed = opts->compress(opts->input))) {
+		return false;
+	}
+
+	compress_free(compressed);
+	return true;
+}
+
+static bool_t bench_decompress_op(bench_compress_opt_t *opts) {
+
+	stringer_t *output;
+
+	if (!(output = opts->decompress(opts->compressed))) {
+		return false;
+	}
+
+	st_free(output);
+	return true;
+}
+
+void bench_compress(void) {
+
+	chr_t name[128];
+	stringer_t *input;
+	bench_compress_opt_t opts;
+	struct {
+		chr_t *name;
+		compress_t * (*compress)(stringer_t *input);
+		stringer_t * (*decompress)(compress_t *compressed);
+	} engines[] = {
+		{ "lzo", &compress_lzo, &decompress_lzo },
+		{ "zlib", &compress_zlib, &decompress_zlib },
+		{ "bzip", &compress_bzip, &decompress_bzip }
+	};
+
+	if (!(input = bench_data(BENCH_BLOCK_COMPRESS, true))) {
+		log_bench("%-64.64s%10.10s\n", "providers.compress", "FAILED");
+		return;
+	}
+
+	for (uint64_t i = 0; i < sizeof(engines) / sizeof(*engines); i++) {
+
+		mm_wipe(&opts, sizeof(bench_compress_opt_t));
+		opts.input = input;
+		opts.compress = engines[i].compress;
+		opts.decompress = engines[i].decompress;
+
+		snprintf(name, sizeof(name), "providers.compress.%s.compress.%u", engines[i].name, BENCH_BLOCK_COMPRESS);
+		bench_run(name, (bool_t (*)(void *))&bench_compress_op, &opts);
+
+		if (!(opts.compressed = opts.compress(input))) {
+			log_bench("%-64.64s%10.10s\n", name, "FAILED");
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "providers.compress.%s.decompress.%u", engines[i].name, BENCH_BLOCK_COMPRESS);
+		bench_run(name, (bool_t (*)(void *))&bench_decompress_op, &opts);
+
+		compress_free(opts.compressed);
+	}
+
+	st_free(input);
+	return;
+}
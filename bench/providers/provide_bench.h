@@ -0,0 +1,19 @@
+
+/**
+ * @file /magma.bench/providers/provide_bench.h
+ *
+ * @brief The entry point for the provider module benchmarks.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#ifndef PROVIDE_BENCH_H
+#define PROVIDE_BENCH_H
+
+/// compress_bench.c
+void   bench_compress(void);
+
+#endif
@@ -5,11 +5,13 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../core/base64_check.c \
+../core/bplus_check.c \
 ../core/core_check.c \
 ../core/hashed_check.c \
 ../core/hex_check.c \
 ../core/inx_check.c \
 ../core/linked_check.c \
+../core/probed_check.c \
 ../core/qp_check.c \
 ../core/qsort_check.c \
 ../core/string_check.c \
@@ -20,11 +22,13 @@ C_SRCS += \
 
 OBJS += \
 ./core/base64_check.o \
+./core/bplus_check.o \
 ./core/core_check.o \
 ./core/hashed_check.o \
 ./core/hex_check.o \
 ./core/inx_check.o \
 ./core/linked_check.o \
+./core/probed_check.o \
 ./core/qp_check.o \
 ./core/qsort_check.o \
 ./core/string_check.o \
@@ -35,11 +39,13 @@ OBJS += \
 
 C_DEPS += \
 ./core/base64_check.d \
+./core/bplus_check.d \
 ./core/core_check.d \
 ./core/hashed_check.d \
 ./core/hex_check.d \
 ./core/inx_check.d \
 ./core/linked_check.d \
+./core/probed_check.d \
 ./core/qp_check.d \
 ./core/qsort_check.d \
 ./core/string_check.d \
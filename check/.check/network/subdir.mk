@@ -5,15 +5,21 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../network/address_check.c \
-../network/network_check.c 
+../network/network_check.c \
+../network/resolver_check.c \
+../network/templates_check.c 
 
 OBJS += \
 ./network/address_check.o \
-./network/network_check.o 
+./network/network_check.o \
+./network/resolver_check.o \
+./network/templates_check.o 
 
 C_DEPS += \
 ./network/address_check.d \
-./network/network_check.d 
+./network/network_check.d \
+./network/resolver_check.d \
+./network/templates_check.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -8,6 +8,7 @@ C_SRCS += \
 ../providers/digest_check.c \
 ../providers/dspam_check.c \
 ../providers/ecies_check.c \
+../providers/fulltext_check.c \
 ../providers/provide_check.c \
 ../providers/rand_check.c \
 ../providers/scramble_check.c \
@@ -20,6 +21,7 @@ OBJS += \
 ./providers/digest_check.o \
 ./providers/dspam_check.o \
 ./providers/ecies_check.o \
+./providers/fulltext_check.o \
 ./providers/provide_check.o \
 ./providers/rand_check.o \
 ./providers/scramble_check.o \
@@ -32,6 +34,7 @@ C_DEPS += \
 ./providers/digest_check.d \
 ./providers/dspam_check.d \
 ./providers/ecies_check.d \
+./providers/fulltext_check.d \
 ./providers/provide_check.d \
 ./providers/rand_check.d \
 ./providers/scramble_check.d \
@@ -0,0 +1,208 @@
+
+/**
+ * @file /magma.check/core/bplus_check.c
+ *
+ * @brief Unit tests for B+tree indexes.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_check.h"
+
+bool_t check_indexes_bplus_cursor(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	inx_cursor_t *cursor;
+	uint64_t count, number;
+
+	if (!(inx = inx_alloc(M_INX_BPLUS, mm_free))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	// Insert the keys in a shuffled order, so the cursor has to rely on the tree to return them sorted. Since the multiplier is an odd prime
+	// and the record count is a power of two, every key is used exactly once.
+	for (uint64_t i = 0; status() && i < BPLUS_CURSORS_CHECK; i++) {
+
+		number = (i * 7919) % BPLUS_CURSORS_CHECK;
+
+		if (!(val = mm_alloc(sizeof(uint64_t)))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		mm_copy(val, &number, sizeof(uint64_t));
+		mm_wipe(&key, sizeof(multi_t));
+		key.type = M_TYPE_UINT64;
+		key.val.u64 = number;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(val);
+			return false;
+		}
+	}
+
+	if (!(cursor = inx_cursor_alloc(inx))) {
+		*errmsg = "cursor allocation failed";
+		inx_free(inx);
+		return false;
+	}
+
+	for (count = 0; status() && !mt_is_empty(key = inx_cursor_key_next(cursor)); count++) {
+
+		val = inx_cursor_value_active(cursor);
+
+		if (key.val.u64 != count || !val || *((uint64_t *)val) != count) {
+			*errmsg = "cursor returned the keys out of order";
+			inx_cursor_free(cursor);
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	if (status() && count != BPLUS_CURSORS_CHECK) {
+		*errmsg = "cursor validation failed";
+		inx_cursor_free(cursor);
+		inx_free(inx);
+		return false;
+	}
+
+	// Seek into the middle of the range, and delete every record as it's returned.
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+	key.val.u64 = BPLUS_CURSORS_CHECK / 2;
+
+	if (!inx_cursor_seek(cursor, key)) {
+		*errmsg = "cursor seek failed";
+		inx_cursor_free(cursor);
+		inx_free(inx);
+		return false;
+	}
+
+	for (count = BPLUS_CURSORS_CHECK / 2; status() && !mt_is_empty(key = inx_cursor_key_next(cursor)); count++) {
+
+		if (key.val.u64 != count || !inx_delete(inx, key)) {
+			*errmsg = "cursor failed to continue after a delete";
+			inx_cursor_free(cursor);
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	if (status() && (count != BPLUS_CURSORS_CHECK || inx_count(inx) != BPLUS_CURSORS_CHECK / 2)) {
+		*errmsg = "cursor validation failed";
+		inx_cursor_free(cursor);
+		inx_free(inx);
+		return false;
+	}
+
+	inx_cursor_free(cursor);
+	inx_free(inx);
+
+	return true;
+}
+
+bool_t check_indexes_bplus_simple(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	char snum[1024];
+	uint64_t rnum = 0, position = 0;
+
+	// Use NULL strings for the search key, and store the number in binary form.
+	if (!(inx = inx_alloc(M_INX_BPLUS, mm_free))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	for (uint64_t i = rnum = 0; status() && i < BPLUS_INSERTS_CHECK; i++) {
+
+		rnum += (rand_get_uint64() % 16536) + 1;
+		snprintf(snum, 1024, "%lu", rnum);
+
+		if (!(val = mm_alloc(sizeof(uint64_t)))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		mm_copy(val, &rnum, sizeof(uint64_t));
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.ns = &snum[0];
+		key.type = M_TYPE_NULLER;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(val);
+			return false;
+		}
+
+		if (rnum % 2 == 0 && !inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	inx_free(inx);
+
+	// This time use binary numbers for the search keys, and check the position of every record as it's added.
+	if (!(inx = inx_alloc(M_INX_BPLUS, ns_free))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	for (uint64_t i = rnum = 0; status() && i < BPLUS_INSERTS_CHECK; i++) {
+
+		rnum += (rand_get_uint64() % 16536) + 1;
+		snprintf(snum, 1024, "%lu", rnum);
+
+		if (!(val = ns_dupe(snum))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.u64 = rnum;
+		key.type = M_TYPE_UINT64;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			ns_free(val);
+			return false;
+		}
+
+		// The keys only increase, so every new record should land at the end of the tree.
+		else if (inx_rank(inx, key) != ++position || inx_select(inx, position) != val) {
+			*errmsg = "rank and select operations failed";
+			inx_free(inx);
+			return false;
+		}
+
+		if (rnum % 2 == 0) {
+
+			if (!inx_delete(inx, key) || inx_rank(inx, key)) {
+				*errmsg = "delete operation failed";
+				inx_free(inx);
+				return false;
+			}
+
+			position--;
+		}
+	}
+
+	inx_free(inx);
+	return true;
+}
@@ -236,6 +236,80 @@ START_TEST (check_inx_hashed_m)
 	}
 END_TEST
 
+START_TEST (check_inx_probed_s)
+	{
+		bool_t outcome = true;
+		char *errmsg = NULL;
+		log_unit("%-64.64s", "CORE / INDEX / PROBED / SINGLE THREADED:");
+		if (status()) {
+			outcome = check_indexes_probed_simple(&errmsg);
+		}
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, errmsg);
+	}
+END_TEST
+
+START_TEST (check_inx_probed_m)
+	{
+		bool_t outcome = true;
+		check_inx_opt_t *opts = NULL;
+
+		log_unit("%-64.64s", "CORE / INDEX / PROBED / MULTITHREADED:");
+
+		if (status() && (!(opts = mm_alloc(sizeof(check_inx_opt_t))) || !(opts->inx = inx_alloc(M_INX_PROBED, &mm_free)))) {
+			outcome = false;
+		}
+		else if (status()) {
+			outcome = check_inx_mthread(opts);
+		}
+
+		if (opts) {
+			inx_cleanup(opts->inx);
+			mm_free(opts);
+		}
+
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, "check_inx_probed_m failed");
+	}
+END_TEST
+
+START_TEST (check_inx_bplus_s)
+	{
+		bool_t outcome = true;
+		char *errmsg = NULL;
+		log_unit("%-64.64s", "CORE / INDEX / B+TREE / SINGLE THREADED:");
+		if (status()) {
+			outcome = check_indexes_bplus_simple(&errmsg);
+		}
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, errmsg);
+	}
+END_TEST
+
+START_TEST (check_inx_bplus_m)
+	{
+		bool_t outcome = true;
+		check_inx_opt_t *opts = NULL;
+
+		log_unit("%-64.64s", "CORE / INDEX / B+TREE / MULTITHREADED:");
+
+		if (status() && (!(opts = mm_alloc(sizeof(check_inx_opt_t))) || !(opts->inx = inx_alloc(M_INX_BPLUS, &mm_free)))) {
+			outcome = false;
+		}
+		else if (status()) {
+			outcome = check_inx_mthread(opts);
+		}
+
+		if (opts) {
+			inx_cleanup(opts->inx);
+			mm_free(opts);
+		}
+
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, "check_inx_bplus_m failed");
+	}
+END_TEST
+
 START_TEST (check_inx_linked_cursor_s)
 	{
 		bool_t outcome = true;
@@ -347,6 +421,80 @@ START_TEST (check_inx_hashed_cursor_m)
 	}
 END_TEST
 
+START_TEST (check_inx_probed_cursor_s)
+	{
+		bool_t outcome = true;
+		char *errmsg = NULL;
+		log_unit("%-64.64s", "CORE / INDEX / PROBED CURSOR / SINGLE THREADED:");
+		if (status()) {
+			outcome = check_indexes_probed_cursor(&errmsg);
+		}
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, errmsg);
+	}
+END_TEST
+
+START_TEST (check_inx_probed_cursor_m)
+	{
+		bool_t outcome = true;
+		check_inx_opt_t *opts = NULL;
+
+		log_unit("%-64.64s", "CORE / INDEX / PROBED CURSOR / MULTITHREADED:");
+
+		if (status() && (!(opts = mm_alloc(sizeof(check_inx_opt_t))) || !(opts->inx = inx_alloc(M_INX_PROBED, &mm_free)) || !check_inx_mthread(opts))) {
+			outcome = false;
+		}
+		else if (status()) {
+			outcome = check_inx_cursor_mthread(opts);
+		}
+
+		if (opts) {
+			inx_cleanup(opts->inx);
+			mm_free(opts);
+		}
+
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, "check_inx_probed_cursor_m failed");
+	}
+END_TEST
+
+START_TEST (check_inx_bplus_cursor_s)
+	{
+		bool_t outcome = true;
+		char *errmsg = NULL;
+		log_unit("%-64.64s", "CORE / INDEX / B+TREE CURSOR / SINGLE THREADED:");
+		if (status()) {
+			outcome = check_indexes_bplus_cursor(&errmsg);
+		}
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, errmsg);
+	}
+END_TEST
+
+START_TEST (check_inx_bplus_cursor_m)
+	{
+		bool_t outcome = true;
+		check_inx_opt_t *opts = NULL;
+
+		log_unit("%-64.64s", "CORE / INDEX / B+TREE CURSOR / MULTITHREADED:");
+
+		if (status() && (!(opts = mm_alloc(sizeof(check_inx_opt_t))) || !(opts->inx = inx_alloc(M_INX_BPLUS, &mm_free)) || !check_inx_mthread(opts))) {
+			outcome = false;
+		}
+		else if (status()) {
+			outcome = check_inx_cursor_mthread(opts);
+		}
+
+		if (opts) {
+			inx_cleanup(opts->inx);
+			mm_free(opts);
+		}
+
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, "check_inx_bplus_cursor_m failed");
+	}
+END_TEST
+
 START_TEST (check_constants)
 	{
 
@@ -797,6 +945,85 @@ START_TEST (check_errnames_s)
 	}
 END_TEST
 
+static uint32_t check_pool_reaped = 0;
+
+static void check_pool_reap(uint32_t item, void *object) {
+	check_pool_reaped++;
+	return;
+}
+
+START_TEST (check_pool_s)
+	{
+		pool_t *pool;
+		uint32_t item, other;
+		char *errmsg = NULL;
+
+		log_unit("%-64.64s", "CORE / BUCKETS / POOL / SINGLE THREADED:");
+
+		if (!(pool = pool_alloc(100, 1))) {
+			errmsg = "Unable to allocate the pool.";
+		}
+		else {
+
+			// Only the odd slots hold an object, so they should be handed out before any of the vacant slots.
+			for (uint32_t i = 1; i < 100; i += 2) {
+				pool_set_obj(pool, i, pool);
+			}
+
+			if (pool_get_live(pool) != 50 || pool_get_available(pool) != 100) {
+				errmsg = "The pool counts are wrong.";
+			}
+			else if (pool_pull(pool, &item) != PL_RESERVED || !pool_get_obj(pool, item) || pool_get_status(pool, item) != PL_RESERVED) {
+				errmsg = "The pool didn't hand out a slot holding an object.";
+			}
+			else if (pool_release(pool, item), pool_pull(pool, &other) != PL_RESERVED || other != item) {
+				errmsg = "The pool didn't hand the thread the slot it used last.";
+			}
+			else if (pool_release(pool, other), pool_get_status(pool, other) != PL_AVAILABLE) {
+				errmsg = "The released slot wasn't made available.";
+			}
+			// A reap without an idle allowance should destroy the objects above the minimum, and leave their slots vacant.
+			else if (pool_reap(pool, 10, 0, &check_pool_reap) != 40 || check_pool_reaped != 40 || pool_get_live(pool) != 10 ||
+				pool_get_available(pool) != 100) {
+				errmsg = "The pool wasn't reaped correctly.";
+			}
+
+			pool_free(pool);
+		}
+
+		log_unit("%10.10s\n", (!errmsg ? "PASSED" : "FAILED"));
+		fail_unless(!errmsg, errmsg);
+	}
+END_TEST
+
+START_TEST (check_spool_mapped_s)
+	{
+		char *errmsg = NULL;
+		stringer_t *mapped, *holder;
+
+		log_unit("%-64.64s", "CORE / HOST / SPOOL MAPPING / SINGLE THREADED:");
+
+		if (!(mapped = spool_mapped(MAGMA_SPOOL_DATA, "check", 1024)) || st_avail_get(mapped) < 1024) {
+			errmsg = "Unable to create a spool mapped string.";
+		}
+		else if (mm_set(st_data_get(mapped), 'x', 1024) && st_length_set(mapped, 1024) != 1024) {
+			errmsg = "Unable to write into the spool mapped string.";
+		}
+		// Growing the mapping should extend the spool file without disturbing the existing data.
+		else if (!(holder = st_realloc(mapped, 1024 * 1024)) || st_avail_get((mapped = holder)) < 1024 * 1024) {
+			errmsg = "Unable to resize the spool mapped string.";
+		}
+		else if (*(st_char_get(mapped) + 1023) != 'x' || *(st_char_get(mapped) + 1024) != '\0') {
+			errmsg = "The spool mapped string was corrupted during the resize.";
+		}
+
+		st_cleanup(mapped);
+
+		log_unit("%10.10s\n", (!errmsg ? "PASSED" : "FAILED"));
+		fail_unless(!errmsg, errmsg);
+	}
+END_TEST
+
 Suite * suite_check_core(void) {
 
 	TCase *tc;
@@ -816,6 +1043,8 @@ Suite * suite_check_core(void) {
 	testcase(s, tc, "Memory / Secure Address Range", check_secmem);
 	testcase(s, tc, "System / Signal Names", check_signames_s);
 	testcase(s, tc, "System / Error Names", check_errnames_s);
+	testcase(s, tc, "System / Spool Mapping", check_spool_mapped_s);
+	testcase(s, tc, "Buckets / Pool", check_pool_s);
 	testcase(s, tc, "Encoding / Quoted Printable", check_qp);
 	testcase(s, tc, "Encoding / Hex", check_hex);
 	testcase(s, tc, "Encoding / URL", check_url);
@@ -826,12 +1055,20 @@ Suite * suite_check_core(void) {
 	testcase(s, tc, "Indexes / Linked/M", check_inx_linked_m);
 	testcase(s, tc, "Indexes / Hashed/S", check_inx_hashed_s);
 	testcase(s, tc, "Indexes / Hashed/M", check_inx_hashed_m);
+	testcase(s, tc, "Indexes / Probed/S", check_inx_probed_s);
+	testcase(s, tc, "Indexes / Probed/M", check_inx_probed_m);
+	testcase(s, tc, "Indexes / B+Tree/S", check_inx_bplus_s);
+	testcase(s, tc, "Indexes / B+Tree/M", check_inx_bplus_m);
 	testcase(s, tc, "Indexes / Tree/S", check_inx_tree_s);
 	testcase(s, tc, "Indexes / Tree/M", check_inx_tree_m);
 	testcase(s, tc, "Indexes / Linked Cursor/S", check_inx_linked_cursor_s);
 	testcase(s, tc, "Indexes / Linked Cursor/M", check_inx_linked_cursor_m);
 	testcase(s, tc, "Indexes / Hashed Cursor/S", check_inx_hashed_cursor_s);
 	testcase(s, tc, "Indexes / Hashed Cursor/M", check_inx_hashed_cursor_m);
+	testcase(s, tc, "Indexes / Probed Cursor/S", check_inx_probed_cursor_s);
+	testcase(s, tc, "Indexes / Probed Cursor/M", check_inx_probed_cursor_m);
+	testcase(s, tc, "Indexes / B+Tree Cursor/S", check_inx_bplus_cursor_s);
+	testcase(s, tc, "Indexes / B+Tree Cursor/M", check_inx_bplus_cursor_m);
 	testcase(s, tc, "Indexes / Tree Cursor/S", check_inx_tree_cursor_s);
 	testcase(s, tc, "Indexes / Tree Cursor/M", check_inx_tree_cursor_m);
 
@@ -55,6 +55,10 @@ bool_t   check_encoding_hex(void);
 /// url_check.c
 bool_t   check_encoding_url(void);
 
+/// bplus_check.c
+bool_t   check_indexes_bplus_cursor(char **errmsg);
+bool_t   check_indexes_bplus_simple(char **errmsg);
+
 /// core_check.c
 Suite *                    suite_check_core(void);
 
@@ -67,6 +71,11 @@ bool_t   check_indexes_hashed_cursor(char **errmsg);
 bool_t   check_indexes_hashed_cursor_compare(uint64_t values[], inx_cursor_t *cursor);
 bool_t   check_indexes_hashed_simple(char **errmsg);
 
+/// probed_check.c
+bool_t   check_indexes_probed_cursor(char **errmsg);
+bool_t   check_indexes_probed_cursor_compare(uint64_t values[], inx_cursor_t *cursor);
+bool_t   check_indexes_probed_simple(char **errmsg);
+
 /// system_check.c
 bool_t   check_system_errnonames(void);
 bool_t   check_system_signames(void);
@@ -0,0 +1,288 @@
+
+/**
+ * @file /magma.check/core/probed_check.c
+ *
+ * @brief Unit tests for probed indexes.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_check.h"
+
+bool_t check_indexes_probed_cursor_compare(uint64_t values[], inx_cursor_t *cursor) {
+
+	void *val;
+	multi_t key;
+	uint64_t count = 0;
+	bool_t found[] =	{	[0 ... PROBED_CURSORS_CHECK] = false };
+
+	while (status() && (val = inx_cursor_value_next(cursor))) {
+
+		key = inx_cursor_key_active(cursor);
+		if (values[key.val.u64] != *((uint64_t *)val)) {
+			return false;
+		}
+
+		found[key.val.u64] = true;
+		count++;
+	}
+
+	if (count != PROBED_CURSORS_CHECK) {
+		return false;
+	}
+
+	for (uint_t i = 0; i < PROBED_CURSORS_CHECK; i++) {
+		if (found[i] != true) {
+			return false;
+		}
+
+		found[i] = false;
+	}
+
+	count = 0;
+	inx_cursor_reset(cursor);
+
+	while (!mt_is_empty(key = inx_cursor_key_next(cursor))) {
+
+		val = inx_cursor_value_active(cursor);
+		if (values[key.val.u64] != *((uint64_t *)val)) {
+			return false;
+		}
+
+		found[key.val.u64] = true;
+		count++;
+	}
+
+	if (count != PROBED_CURSORS_CHECK) {
+		return false;
+	}
+
+	for (uint_t i = 0; i < PROBED_CURSORS_CHECK; i++) {
+		if (found[i] != true) {
+			return false;
+		}
+		found[i] = false;
+	}
+
+	return true;
+
+}
+
+bool_t check_indexes_probed_cursor(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	inx_cursor_t *cursor;
+	uint64_t values[PROBED_CURSORS_CHECK];
+
+	for (uint64_t i = 0; i < PROBED_CURSORS_CHECK; i++) {
+		values[i] = rand_get_uint64();
+	}
+
+	if (!(inx = inx_alloc(M_INX_PROBED, mm_free))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	for (uint64_t i = 0; status() && i < PROBED_CURSORS_CHECK; i++) {
+
+		if (!(val = mm_alloc(sizeof(uint64_t)))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		mm_copy(val, &values[i], sizeof(uint64_t));
+		mm_wipe(&key, sizeof(multi_t));
+		key.type = M_TYPE_UINT64;
+		key.val.u64 = i;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(val);
+			return false;
+		}
+	}
+
+	if (!(cursor = inx_cursor_alloc(inx))) {
+		*errmsg = "cursor allocation failed";
+		inx_free(inx);
+		return false;
+	}
+
+	if (!check_indexes_probed_cursor_compare(values, cursor)) {
+		*errmsg = "cursor validation failed";
+		inx_cursor_free(cursor);
+		inx_free(inx);
+		return false;
+	}
+
+	inx_cursor_free(cursor);
+	inx_free(inx);
+
+	return true;
+}
+
+bool_t check_indexes_probed_simple(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	char snum[1024];
+	uint64_t rnum = 0, *numbers;
+
+	if (!(numbers = mm_alloc(sizeof(uint64_t) * PROBED_INSERTS_CHECK))) {
+		*errmsg = "number buffer allocation failed";
+		return false;
+	}
+
+	// Use NULL strings for the search key, and store the number in binary form. The table starts small, so it will be rebuilt several times.
+	if (!(inx = inx_alloc(M_INX_PROBED, mm_free))) {
+		*errmsg = "index allocation failed";
+		mm_free(numbers);
+		return false;
+	}
+
+	for (uint64_t i = 0; status() && i < PROBED_INSERTS_CHECK; i++) {
+
+		rnum += (rand_get_uint64() % 16536) + 1;
+		snprintf(snum, 1024, "%lu", rnum);
+		numbers[i] = rnum;
+
+		if (!(val = mm_alloc(sizeof(uint64_t)))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+
+		mm_copy(val, &rnum, sizeof(uint64_t));
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.ns = &snum[0];
+		key.type = M_TYPE_NULLER;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			mm_free(val);
+			return false;
+		}
+
+		// A second insert using the same key should be rejected.
+		else if (inx_insert(inx, key, val)) {
+			*errmsg = "duplicate key was accepted";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+	}
+
+	// Delete the even numbers, which leaves deleted slots scattered across the table.
+	for (uint64_t i = 0; status() && i < PROBED_INSERTS_CHECK; i++) {
+
+		snprintf(snum, 1024, "%lu", numbers[i]);
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.ns = &snum[0];
+		key.type = M_TYPE_NULLER;
+
+		if (numbers[i] % 2 == 0 && !inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+	}
+
+	// Every odd number should still be found, and every even number should be gone.
+	for (uint64_t i = 0; status() && i < PROBED_INSERTS_CHECK; i++) {
+
+		snprintf(snum, 1024, "%lu", numbers[i]);
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.ns = &snum[0];
+		key.type = M_TYPE_NULLER;
+
+		val = inx_find(inx, key);
+
+		if ((numbers[i] % 2 == 0 && val) || (numbers[i] % 2 == 1 && (!val || *((uint64_t *)val) != numbers[i]))) {
+			*errmsg = "find operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+	}
+
+	inx_truncate(inx);
+
+	if (inx_count(inx) || inx_find(inx, key)) {
+		*errmsg = "truncate operation failed";
+		inx_free(inx);
+		mm_free(numbers);
+		return false;
+	}
+
+	inx_free(inx);
+
+	// This time use binary numbers for the search keys, and store the value as a string.
+	if (!(inx = inx_alloc(M_INX_PROBED, ns_free))) {
+		*errmsg = "index allocation failed";
+		mm_free(numbers);
+		return false;
+	}
+
+	for (uint64_t i = 0; status() && i < PROBED_INSERTS_CHECK; i++) {
+
+		snprintf(snum, 1024, "%lu", numbers[i]);
+
+		if (!(val = ns_dupe(snum))) {
+			*errmsg = "value buffer allocation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.u64 = numbers[i];
+		key.type = M_TYPE_UINT64;
+
+		if (!inx_insert(inx, key, val)) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			ns_free(val);
+			return false;
+		}
+
+		if (numbers[i] % 2 == 0 && !inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; status() && i < PROBED_INSERTS_CHECK; i++) {
+
+		mm_wipe(&key, sizeof(multi_t));
+		key.val.u64 = numbers[i];
+		key.type = M_TYPE_UINT64;
+
+		val = inx_find(inx, key);
+
+		if ((numbers[i] % 2 == 0 && val) || (numbers[i] % 2 == 1 && (!val || strtoull(val, NULL, 10) != numbers[i]))) {
+			*errmsg = "find operation failed";
+			inx_free(inx);
+			mm_free(numbers);
+			return false;
+		}
+	}
+
+	inx_free(inx);
+	mm_free(numbers);
+	return true;
+}
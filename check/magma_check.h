@@ -47,6 +47,10 @@ extern int case_timeout;
 #define LINKED_CURSORS_CHECK 128
 #define HASHED_INSERTS_CHECK 128
 #define HASHED_CURSORS_CHECK 128
+#define PROBED_INSERTS_CHECK 128
+#define PROBED_CURSORS_CHECK 128
+#define BPLUS_INSERTS_CHECK 128
+#define BPLUS_CURSORS_CHECK 128
 
 #define QP_CHECK_SIZE 1024
 #define URL_CHECK_SIZE 1024
@@ -66,6 +70,8 @@ extern int case_timeout;
 #define TANK_CHECK_DATA_CLEANUP true
 #define TANK_CHECK_DATA_PATH "res/corpus/"
 
+#define FULLTEXT_CHECK_USERNUM 1l
+
 #define DSPAM_CHECK_SIZE_MIN 1024
 #define DSPAM_CHECK_SIZE_MAX (2 * 1024)
 #define DSPAM_CHECK_DATA_UNUM 1l
@@ -118,6 +124,10 @@ extern int case_timeout;
 #define LINKED_CURSORS_CHECK 8192
 #define HASHED_INSERTS_CHECK 8192
 #define HASHED_CURSORS_CHECK 8192
+#define PROBED_INSERTS_CHECK 8192
+#define PROBED_CURSORS_CHECK 8192
+#define BPLUS_INSERTS_CHECK 8192
+#define BPLUS_CURSORS_CHECK 8192
 
 #define QP_CHECK_SIZE 8192
 #define URL_CHECK_SIZE 8192
@@ -137,6 +147,8 @@ extern int case_timeout;
 #define TANK_CHECK_DATA_CLEANUP true
 #define TANK_CHECK_DATA_PATH "res/corpus"
 
+#define FULLTEXT_CHECK_USERNUM 1l
+
 #define DSPAM_CHECK_DATA_UNUM 1l
 #define DSPAM_CHECK_ITERATIONS 8192
 #define DSPAM_CHECK_SIZE_MIN 1024
@@ -201,3 +201,69 @@ void check_address_octet_s (int _i CK_ATTRIBUTE_UNUSED) {
 	fail_unless(!errmsg, errmsg);
 
 }
+
+void check_address_trie_s (int _i CK_ATTRIBUTE_UNUSED) {
+
+	tcase_fn_start ("check_address_trie_s", __FILE__, __LINE__);
+
+	ip_t ip;
+	ip_list_t *list;
+	ip_trie_t *trie;
+	bool_t expected;
+	chr_t *errmsg = NULL;
+	subnet_t subnets[8];
+	chr_t *strings[8] = { "10.0.0.0/8", "10.1.2.0/24", "192.168.1.7", "172.16.0.0/12", "0.0.0.0/1", "fe80::/10", "2001:db8::/32", "::1" };
+
+	log_unit("%-64.64s", "NETWORK / ADDRESSES / TRIE / SINGLE THREADED:");
+
+	if (status() && (list = ip_list_alloc())) {
+
+		for (int_t i = 0; i < 8 && !errmsg; i++) {
+			if (!ip_str_subnet(strings[i], &subnets[i]) || !ip_list_add(list, &subnets[i])) {
+				errmsg = "Unable to add a subnet to the list.";
+			}
+		}
+
+		// The trie should agree with a linear scan using ip_matches_subnet() for random addresses, and for addresses near each subnet.
+		for (int_t i = 0; i < 4096 && !errmsg; i++) {
+
+			if (i % 2) {
+				ip_copy(&ip, &(subnets[i % 8].address));
+				((uchr_t *)&(ip.ip))[(ip.family == AF_INET ? 3 : 15) - (i % 3)] ^= rand_get_uint8();
+			}
+			else {
+				ip.family = (i % 4) ? AF_INET : AF_INET6;
+				rand_write(PLACER(&(ip.ip6), sizeof(struct in6_addr)));
+			}
+
+			expected = false;
+			for (int_t j = 0; j < 8 && !expected; j++) {
+				expected = ip_matches_subnet(&subnets[j], &ip);
+			}
+
+			if (ip_list_match(list, &ip) != expected) {
+				errmsg = "The subnet list and the linear scan disagree.";
+			}
+		}
+
+		// Replace the list contents, and make sure only the new subnet matches.
+		if (!errmsg && (!(trie = ip_trie_alloc()) || !ip_trie_insert(trie, &subnets[1]))) {
+			errmsg = "Unable to build a replacement trie.";
+			ip_trie_free(trie);
+		}
+		else if (!errmsg) {
+
+			ip_list_swap(list, trie);
+
+			if (!ip_list_match(list, &(subnets[1].address)) || ip_list_match(list, &(subnets[2].address)) || list->trie->count != 1) {
+				errmsg = "The replacement trie wasn't published.";
+			}
+		}
+
+		ip_list_free(list);
+	}
+
+	log_unit("%10.10s\n", (!errmsg ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+	fail_unless(!errmsg, errmsg);
+
+}
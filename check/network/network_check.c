@@ -23,6 +23,9 @@ Suite * suite_check_network(void) {
 	testcase(s, tc, "Network / Address / Subnet / S", check_address_subnet_s);
 	testcase(s, tc, "Network / Address / Segment / S", check_address_segment_s);
 	testcase(s, tc, "Network / Address / Octet / S", check_address_octet_s);
+	testcase(s, tc, "Network / Address / Trie / S", check_address_trie_s);
+	testcase(s, tc, "Network / Resolver / Lookups / S", check_resolver_lookups_s);
+	testcase(s, tc, "Network / HTTP / Templates / S", check_templates_render_s);
 
 
 	return s;
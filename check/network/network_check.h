@@ -20,6 +20,17 @@ void check_address_reversed_s (int _i CK_ATTRIBUTE_UNUSED);
 void check_address_segment_s (int _i CK_ATTRIBUTE_UNUSED);
 void check_address_standard_s (int _i CK_ATTRIBUTE_UNUSED);
 void check_address_subnet_s (int _i CK_ATTRIBUTE_UNUSED);
+void check_address_trie_s (int _i CK_ATTRIBUTE_UNUSED);
+
+/// resolver_check.c
+size_t check_resolver_answer(uchr_t *query, size_t length, uchr_t *packet, bool_t stream);
+void check_resolver_lookups_s (int _i CK_ATTRIBUTE_UNUSED);
+size_t check_resolver_record(uchr_t *packet, uint16_t type, uint32_t ttl, uchr_t *data, uint16_t length);
+void check_resolver_stub(void);
+
+/// templates_check.c
+bool_t check_templates_compare(http_page_t *page, chr_t *expected);
+void check_templates_render_s (int _i CK_ATTRIBUTE_UNUSED);
 
 Suite * suite_check_network(void);
 
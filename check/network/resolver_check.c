@@ -0,0 +1,204 @@
+/**
+ * @file /magma.check/network/resolver_check.c
+ *
+ * @brief Resolver unit tests, which point the resolver at a stub DNS server running inside the test process.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_check.h"
+
+struct {
+	int udp, tcp;
+	uint32_t queries;
+	uint32_t stopping;
+} stub = {
+		.udp = -1,
+		.tcp = -1,
+		.queries = 0,
+		.stopping = 0
+};
+
+/**
+ * @brief	Append a resource record, whose owner name is the question, to a stub DNS answer.
+ */
+size_t check_resolver_record(uchr_t *packet, uint16_t type, uint32_t ttl, uchr_t *data, uint16_t length) {
+
+	uchr_t record[12] = { 0xc0, HFIXEDSZ, type >> 8, type & 0xff, 0, ns_c_in, ttl >> 24, (ttl >> 16) & 0xff, (ttl >> 8) & 0xff, ttl & 0xff,
+		length >> 8, length & 0xff };
+
+	mm_copy(packet, record, 12);
+	mm_copy(packet + 12, data, length);
+
+	return length + 12;
+}
+
+/**
+ * @brief	Build the stub server's answer to a query.
+ * @note	The stub knows three names. The first has a single address, the second doesn't exist, and the third has too many
+ * 			addresses to fit in a UDP answer, so it's marked as truncated unless the query arrived over TCP.
+ */
+size_t check_resolver_answer(uchr_t *query, size_t length, uchr_t *packet, bool_t stream) {
+
+	size_t next, offset;
+	chr_t name[NS_MAXDNAME];
+	uchr_t address[4] = { 127, 0, 0, 2 }, soa[22] = { [21] = 30 };
+
+	if (dns_name_read(query, length, HFIXEDSZ, name, &next) < 0 || next + 4 > length) {
+		return 0;
+	}
+
+	__sync_add_and_fetch(&(stub.queries), 1);
+
+	mm_copy(packet, query, (offset = next + 4));
+	mm_wipe(packet + 6, 6);
+	packet[2] = 0x81;
+	packet[3] = 0x80;
+
+	if (!st_cmp_ci_eq(NULLER(name), CONSTANT("2.0.0.127.rbl.magma.check"))) {
+		offset += check_resolver_record(packet + offset, ns_t_a, 300, address, 4);
+		packet[7] = 1;
+	}
+	else if (!st_cmp_ci_eq(NULLER(name), CONSTANT("truncated.magma.check")) && !stream) {
+		packet[2] |= 0x02;
+	}
+	else if (!st_cmp_ci_eq(NULLER(name), CONSTANT("truncated.magma.check"))) {
+		for (uchr_t i = 0; i < 64; i++) {
+			address[3] = i;
+			offset += check_resolver_record(packet + offset, ns_t_a, 300, address, 4);
+		}
+		packet[7] = 64;
+	}
+	// Everything else doesn't exist, and the SOA record makes the negative answer cacheable for 30 seconds.
+	else {
+		packet[3] = 0x83;
+		offset += check_resolver_record(packet + offset, ns_t_soa, 300, soa, sizeof(soa));
+		packet[9] = 1;
+	}
+
+	return offset;
+}
+
+void check_resolver_stub(void) {
+
+	int sockd;
+	ssize_t length;
+	socklen_t addrlen;
+	struct sockaddr_storage address;
+	uchr_t query[NS_PACKETSZ + 2], packet[NS_MAXMSG];
+
+	while (!__sync_fetch_and_add(&(stub.stopping), 0)) {
+
+		addrlen = sizeof(struct sockaddr_storage);
+
+		if ((length = recvfrom(stub.udp, query, NS_PACKETSZ, MSG_DONTWAIT, (struct sockaddr *)&address, &addrlen)) > 0 &&
+			(length = check_resolver_answer(query, length, packet, false))) {
+			sendto(stub.udp, packet, length, 0, (struct sockaddr *)&address, addrlen);
+		}
+
+		if ((sockd = accept4(stub.tcp, NULL, NULL, 0)) >= 0) {
+
+			if ((length = recv(sockd, query, NS_PACKETSZ + 2, 0)) > 2 && (length = check_resolver_answer(query + 2, length - 2, packet + 2, true))) {
+				packet[0] = length >> 8;
+				packet[1] = length & 0xff;
+				send(sockd, packet, length + 2, 0);
+			}
+
+			close(sockd);
+		}
+
+		usleep(1000);
+	}
+
+	return;
+}
+
+void check_resolver_lookups_s (int _i CK_ATTRIBUTE_UNUSED) {
+
+	tcase_fn_start ("check_resolver_lookups_s", __FILE__, __LINE__);
+
+	pthread_t thread;
+	uint32_t queries;
+	chr_t *errmsg = NULL, *server = magma.dns.server;
+	uint32_t port = magma.dns.port;
+	dns_answer_t answers[3];
+	socklen_t length = sizeof(struct sockaddr_in);
+	struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	chr_t *names[3] = { "2.0.0.127.rbl.magma.check", "1.0.0.127.rbl.magma.check", "truncated.magma.check" };
+
+	log_unit("%-64.64s", "NETWORK / RESOLVER / LOOKUPS / SINGLE THREADED:");
+
+	if (!status()) {
+		log_unit("%10.10s\n", "SKIPPED");
+		return;
+	}
+
+	stub.stopping = 0;
+
+	// The stub answers UDP and TCP queries on the same port.
+	if ((stub.udp = socket(AF_INET, SOCK_DGRAM, 0)) == -1 || bind(stub.udp, (struct sockaddr *)&address, length) ||
+		getsockname(stub.udp, (struct sockaddr *)&address, &length) || (stub.tcp = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1 ||
+		bind(stub.tcp, (struct sockaddr *)&address, length) || listen(stub.tcp, 8) || thread_launch(&thread, &check_resolver_stub, NULL)) {
+		errmsg = "Unable to start the stub DNS server.";
+	}
+	else {
+
+		dns_stop();
+		magma.dns.server = "127.0.0.1";
+		magma.dns.port = ntohs(address.sin_port);
+
+		if (!dns_start()) {
+			errmsg = "Unable to start the resolver using the stub DNS server.";
+		}
+		else {
+
+			dns_resolve(3, names, ns_t_a, answers);
+
+			if (answers[0].status != DNS_SUCCESS || answers[0].count != 1 || st_cmp_cs_eq(answers[0].records[0], CONSTANT("127.0.0.2"))) {
+				errmsg = "The resolver returned the wrong answer for a listed address.";
+			}
+			else if (answers[1].status != DNS_NOTFOUND || answers[1].ttl != 30) {
+				errmsg = "The resolver returned the wrong answer for a name which doesn't exist.";
+			}
+			else if (answers[2].status != DNS_SUCCESS || answers[2].count != MAGMA_DNS_RECORDS) {
+				errmsg = "The resolver didn't retry a truncated answer over TCP.";
+			}
+
+			for (int_t i = 0; i < 3; i++) {
+				dns_answer_clear(&answers[i]);
+			}
+
+			// Both the positive and the negative answer should now be served from the cache.
+			queries = stub.queries;
+			dns_resolve(2, names, ns_t_a, answers);
+
+			if (!errmsg && (answers[0].status != DNS_SUCCESS || answers[1].status != DNS_NOTFOUND || queries != stub.queries)) {
+				errmsg = "The resolver didn't cache the answers.";
+			}
+
+			for (int_t i = 0; i < 2; i++) {
+				dns_answer_clear(&answers[i]);
+			}
+		}
+
+		dns_stop();
+		magma.dns.server = server;
+		magma.dns.port = port;
+
+		if (!dns_start() && !errmsg) {
+			errmsg = "Unable to restart the resolver.";
+		}
+
+		__sync_lock_test_and_set(&(stub.stopping), 1);
+		thread_join(thread);
+	}
+
+	if (stub.udp != -1) close(stub.udp);
+	if (stub.tcp != -1) close(stub.tcp);
+
+	log_unit("%10.10s\n", (!errmsg ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+	fail_unless(!errmsg, errmsg);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file /magma.check/network/templates_check.c
+ *
+ * @brief HTTP template unit tests, which compile a template and render pages from it.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_check.h"
+
+chr_t *check_templates_text = "<html><body>\n"
+	"<p id=\"greeting\" class=\"plain\">Hello</p>\n"
+	"<input id=\"field\" disabled   type=\"text\"/>\n"
+	"<span id=\"counter\"/>\n"
+	"<div id=\"list\"><b id=\"nested\">x</b></div>\n"
+	"</body></html>\n";
+
+chr_t *check_templates_rendered = "<html><body>\n"
+	"<p id=\"greeting\" class=\"fancy\">Hi &amp; bye</p>\n"
+	"<input id=\"field\" disabled type=\"text\" value=\"a&quot;b\"/>\n"
+	"<span id=\"counter\">42</span>\n"
+	"<div id=\"list\"><b id=\"nested\">x</b><i id=\"extra\">&lt;more&gt;</i></div>\n"
+	"</body></html>\n";
+
+/**
+ * @brief	Render a page and compare the result against the expected text.
+ */
+bool_t check_templates_compare(http_page_t *page, chr_t *expected) {
+
+	bool_t result;
+	stringer_t *output;
+
+	if (!(output = http_page_render(page))) {
+		return false;
+	}
+
+	result = !st_cmp_cs_eq(output, NULLER(expected));
+	st_free(output);
+
+	return result;
+}
+
+void check_templates_render_s (int _i CK_ATTRIBUTE_UNUSED) {
+
+	tcase_fn_start ("check_templates_render_s", __FILE__, __LINE__);
+
+	http_page_t *page;
+	chr_t *errmsg = NULL;
+	stringer_t *output;
+	http_content_t content = { .location = NULLER("check/templates"), .resource = NULLER(check_templates_text) };
+
+	log_unit("%-64.64s", "NETWORK / HTTP / TEMPLATES / SINGLE THREADED:");
+
+	if (status()) {
+
+		if (http_template_compile(NULLER("<div id=\"open\"><p>text</div>")) || http_template_compile(NULLER("<p id=\"open\">text"))) {
+			errmsg = "A malformed template was compiled.";
+		}
+		else if (!(content.compiled = http_template_compile(content.resource)) || content.compiled->count != 5) {
+			errmsg = "The template could not be compiled.";
+		}
+		else if (!(page = mm_alloc(sizeof(http_page_t)))) {
+			errmsg = "Unable to allocate the page.";
+		}
+		else {
+
+			page->content = &content;
+
+			if (!check_templates_compare(page, check_templates_text)) {
+				errmsg = "An unmodified page did not render as the template.";
+			}
+			else if (!http_page_set_content(page, "greeting", "Hi & bye") || !http_page_set_property(page, "greeting", "class", "fancy") ||
+				!http_page_set_property(page, "field", "value", "a\"b") || !http_page_set_uint64(page, "counter", 42) ||
+				!http_page_add_sibling(page, "nested", "i", "extra", "<more>")) {
+				errmsg = "Unable to apply the page changes.";
+			}
+			else if (http_page_set_content(page, "missing", "value")) {
+				errmsg = "A change to a missing element succeeded.";
+			}
+			else if (!check_templates_compare(page, check_templates_rendered)) {
+				errmsg = "The modified page did not render as expected.";
+			}
+			// A render that doesn't fit the estimated length must fail instead of overflowing the output buffer.
+			else if ((page->length = 0) || (output = http_page_render(page))) {
+				st_cleanup(output);
+				errmsg = "A page larger than its estimated length was rendered.";
+			}
+
+			http_page_free(page);
+		}
+
+		http_template_free(content.compiled);
+	}
+
+	log_unit("%10.10s\n", (!errmsg ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+	fail_unless(!errmsg, errmsg);
+
+}
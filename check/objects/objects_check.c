@@ -425,6 +425,86 @@ START_TEST (check_credential_auth_creation_s) {
 	fail_unless(!errmsg, errmsg);
 } END_TEST
 
+START_TEST (check_mail_cache_s) {
+
+	char *errmsg = NULL;
+	server_t *server = NULL, *other = NULL;
+	stringer_t *text = NULL, *large = NULL, *buffer = NULL;
+	mail_cache_t *entry = NULL, *hit = NULL, *mapped = NULL, *whole = NULL;
+	size_t length = (magma.iface.cache.messages / MAIL_CACHE_SHARDS) + 1;
+	uint64_t messagenum = (UINT64_MAX >> 8) - rand_get_uint16();
+
+	log_unit("%-64.64s", "OBJECTS / MAIL / CACHE / SINGLE THREADED:");
+
+	// The parsed form of a message is cached for a specific server instance, so find the first two configured instances.
+	for (uint32_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
+		if (magma.servers[i] && !server) server = magma.servers[i];
+		else if (magma.servers[i] && !other) other = magma.servers[i];
+	}
+
+	if (!magma.iface.cache.messages || !server) {
+		log_unit("%10.10s\n", "SKIPPED");
+		return;
+	}
+
+	if (!(text = st_import("Subject: Cache\r\n\r\nThe message body.\r\n", 37))) {
+		errmsg = "Unable to allocate the message text.";
+	}
+	else if (!(entry = mail_cache_set(messagenum, server, true, 0, text))) {
+		errmsg = "The message text wasn't accepted by the cache.";
+		st_free(text);
+	}
+	// A hit should hand back the same entry, and the same text, without making a copy.
+	else if ((hit = mail_cache_get(messagenum, server, true, 0)) != entry || entry->text != text) {
+		errmsg = "The cached message text wasn't found.";
+	}
+	else if (mail_cache_get(messagenum, server, false, 0)) {
+		errmsg = "The raw and parsed forms of the message weren't kept separate.";
+	}
+	// The parsed text embeds links to the server it was loaded for, so it must not be handed to another server instance.
+	else if (other && mail_cache_get(messagenum, other, true, 0)) {
+		errmsg = "The parsed form of the message was shared between server instances.";
+	}
+	// A change in the marks should evict the entry, but leave it intact while a reference is still held.
+	else if (mail_cache_get(messagenum, server, true, MAIL_MARK_JUNK) || mail_cache_get(messagenum, server, true, 0)) {
+		errmsg = "A stale message was returned by the cache.";
+	}
+	else if (st_cmp_cs_eq(entry->text, PLACER("Subject: Cache\r\n\r\nThe message body.\r\n", 37))) {
+		errmsg = "The evicted message text was freed while it was still referenced.";
+	}
+	else if (!(large = st_alloc(MAIL_CACHE_MAPPED_LENGTH)) || st_length_set(large, MAIL_CACHE_MAPPED_LENGTH) != MAIL_CACHE_MAPPED_LENGTH) {
+		errmsg = "Unable to allocate the large message text.";
+		st_cleanup(large);
+	}
+	else if (!(mapped = mail_cache_set(messagenum + 1, server, true, 0, large))) {
+		errmsg = "The large message text wasn't accepted by the cache.";
+		st_free(large);
+	}
+	// Large messages should be moved into a memory file, which can be handed to the kernel.
+	else if (!(*((uint32_t *)mapped->text) & MAPPED_T) || st_length_get(mapped->text) != MAIL_CACHE_MAPPED_LENGTH ||
+		*(st_char_get(mapped->text) + MAIL_CACHE_MAPPED_LENGTH) != '\0') {
+		errmsg = "The large message text wasn't mapped correctly.";
+	}
+	// Messages decompressed into a memory file are cached without a copy, even if they're larger than a shard's share of the cache.
+	else if (length + sizeof(mail_cache_t) <= magma.iface.cache.messages && (!(buffer = mail_cache_buffer(length)) ||
+		st_length_set(buffer, length) != length)) {
+		errmsg = "Unable to allocate a memory file buffer.";
+		st_cleanup(buffer);
+	}
+	else if (buffer && (!(whole = mail_cache_set(messagenum + 2, NULL, false, 0, buffer)) || whole->text != buffer)) {
+		errmsg = "The memory file buffer wasn't accepted by the cache.";
+		if (!whole) st_free(buffer);
+	}
+
+	mail_cache_release(hit);
+	mail_cache_release(entry);
+	mail_cache_release(mapped);
+	mail_cache_release(whole);
+
+	log_unit("%10.10s\n", (!errmsg ? "PASSED" : "FAILED"));
+	fail_unless(!errmsg, errmsg);
+} END_TEST
+
 Suite * suite_check_objects(void) {
 
 	TCase *tc;
@@ -436,6 +516,7 @@ Suite * suite_check_objects(void) {
 	testcase(s, tc, "Credential Processing/S", check_credential_auth_creation_s);
 	testcase(s, tc, "Object Serials/S", check_object_serials_s);
 	testcase(s, tc, "Object Warehouse Domains/S", check_warehouse_domains_s);
+	testcase(s, tc, "Mail Cache/S", check_mail_cache_s);
 
 	return s;
 }
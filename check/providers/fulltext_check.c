@@ -0,0 +1,103 @@
+
+/**
+ * @file /magma.check/providers/fulltext_check.c
+ *
+ * @brief Checks the full text search index.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma_check.h"
+
+// Returns true if the result holds exactly the listed message numbers, in order.
+static bool_t check_fulltext_result(fulltext_result_t *result, uint64_t count, uint64_t *expected) {
+
+	if (!result || result->count != count) {
+		return false;
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		if (result->messages[i] != expected[i] || !fulltext_result_contains(result, expected[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool_t check_fulltext_query(chr_t *query, bool_t headers, uint64_t count, uint64_t *expected) {
+
+	bool_t outcome;
+	fulltext_result_t *result;
+
+	result = fulltext_query(FULLTEXT_CHECK_USERNUM, NULLER(query), headers);
+	outcome = check_fulltext_result(result, count, expected);
+	fulltext_result_free(result);
+
+	return outcome;
+}
+
+bool_t check_fulltext_sthread(void) {
+
+	bool_t outcome = true;
+	fulltext_result_t *result = NULL;
+	chr_t location[128], *original = magma.storage.fulltext;
+	stringer_t *first = NULLER("Subject: Quarterly Report\r\nFrom: alice@example.com\r\n\r\nThe BUDGET numbers look great.\r\n"),
+		*second = NULLER("Subject: Lunch\r\nFrom: bob@example.com\r\n\r\nThe budget meeting has moved.\r\n");
+
+	snprintf(location, sizeof(location), "/tmp/magma.check.fulltext.%i", getpid());
+	magma.storage.fulltext = location;
+
+	if (!fulltext_start() || !fulltext_enabled()) {
+		magma.storage.fulltext = original;
+		return false;
+	}
+
+	if (!fulltext_index(FULLTEXT_CHECK_USERNUM, 1, first) || !fulltext_index(FULLTEXT_CHECK_USERNUM, 2, second) ||
+		!fulltext_indexed(FULLTEXT_CHECK_USERNUM, 1) || fulltext_indexed(FULLTEXT_CHECK_USERNUM, 3)) {
+		outcome = false;
+	}
+
+	// Words are matched regardless of case, header words only count for text searches, and every complete word must be present.
+	else if (!check_fulltext_query(" budget ", false, 2, (uint64_t []){ 1, 2 }) || !check_fulltext_query(" quarterly ", false, 0, NULL) ||
+		!check_fulltext_query(" Quarterly ", true, 1, (uint64_t []){ 1 }) || !check_fulltext_query(" budget GREAT ", false, 1, (uint64_t []){ 1 }) ||
+		!check_fulltext_query(" alice budget ", true, 1, (uint64_t []){ 1 }) || !check_fulltext_query(" missing ", true, 0, NULL)) {
+		outcome = false;
+	}
+
+	// Words touching either end of the query may be part of a longer word, so only the words in the middle narrow the candidates.
+	else if (!check_fulltext_query("bob@example.com", true, 2, (uint64_t []){ 1, 2 }) || !check_fulltext_query("The budget meet", false, 2, (uint64_t []){ 1, 2 }) ||
+		(result = fulltext_query(FULLTEXT_CHECK_USERNUM, NULLER("meet"), true))) {
+		fulltext_result_free(result);
+		outcome = false;
+	}
+
+	// Copies share the terms of the original, and removed messages are dropped from the posting lists.
+	else if (!fulltext_copy(FULLTEXT_CHECK_USERNUM, 1, 3) || !check_fulltext_query(" great ", false, 2, (uint64_t []){ 1, 3 })) {
+		outcome = false;
+	}
+	else {
+
+		fulltext_remove(FULLTEXT_CHECK_USERNUM, 1);
+
+		if (fulltext_indexed(FULLTEXT_CHECK_USERNUM, 1) || !check_fulltext_query(" great ", false, 1, (uint64_t []){ 3 }) ||
+			!check_fulltext_query(" budget ", false, 2, (uint64_t []){ 2, 3 })) {
+			outcome = false;
+		}
+
+		// Queries without any indexable words can't be answered using the index.
+		else if ((result = fulltext_query(FULLTEXT_CHECK_USERNUM, NULLER("@@ !!"), true))) {
+			fulltext_result_free(result);
+			outcome = false;
+		}
+	}
+
+	fulltext_stop();
+	magma.storage.fulltext = original;
+	unlink(location);
+
+	return outcome;
+}
@@ -104,6 +104,17 @@ START_TEST (check_compress_bzip_m)
 	}
 END_TEST
 
+//! Full Text Search Tests
+START_TEST (check_fulltext_s)
+	{
+		bool_t outcome;
+		log_unit("%-64.64s", "STORAGE / FULLTEXT / SINGLE THREADED:");
+		outcome = check_fulltext_sthread();
+		log_unit("%10.10s\n", (outcome ? (status() ? "PASSED" : "SKIPPED") : "FAILED"));
+		fail_unless(outcome, "check_fulltext_sthread failed");
+	}
+END_TEST
+
 //! Storage Tank Tests
 START_TEST (check_tank_lzo_s)
 	{
@@ -431,6 +442,8 @@ Suite * suite_check_provide(void) {
 	testcase(s, tc, "Cryptography SYMMETRIC/S", check_symmetric_s);
 	testcase(s, tc, "Cryptography SCRAMBLE/S", check_scramble_s);
 
+	testcase(s, tc, "Fulltext/S", check_fulltext_s);
+
 	// Tank functionality is temporarily disabled.
 
 	do_tank_check = false;
@@ -33,6 +33,9 @@ stringer_t *  check_rand_mthread(void);
 void          check_rand_mthread_wrap(void);
 stringer_t *  check_rand_sthread(void);
 
+/// fulltext_check.c
+bool_t   check_fulltext_sthread(void);
+
 /// tank_check.c
 bool_t   check_tokyo_tank(check_tank_opt_t *opts);
 bool_t   check_tokyo_tank_cleanup(inx_t *check_collection);
@@ -38,6 +38,9 @@ cl_engine_set_num_d = &cl_engine_set_num;
 cl_engine_set_str_d = &cl_engine_set_str;
 cl_load_d = &cl_load;
 cl_scandesc_d = &cl_scandesc;
+cl_fmap_close_d = &cl_fmap_close;
+cl_fmap_open_memory_d = &cl_fmap_open_memory;
+cl_scanmap_callback_d = &cl_scanmap_callback;
 dspam_version_d = &dspam_version;
 dspam_detach_d = &dspam_detach;
 dspam_destroy_d = &dspam_destroy;
@@ -177,6 +180,7 @@ EC_KEY_check_key_d = &EC_KEY_check_key;
 EVP_MD_CTX_cleanup_d = &EVP_MD_CTX_cleanup;
 ERR_remove_state_d = &ERR_remove_state;
 SSL_peek_d = &SSL_peek;
+SSL_pending_d = &SSL_pending;
 X509_get_subject_name_d = &X509_get_subject_name;
 EC_KEY_new_by_curve_name_d = &EC_KEY_new_by_curve_name;
 BN_hex2bn_d = &BN_hex2bn;
@@ -307,6 +311,8 @@ tchdbtune_d = &tchdbtune;
 tchdboptimize_d = &tchdboptimize;
 tcndbputkeep_d = &tcndbputkeep;
 tchdbputasync_d = &tchdbputasync;
+tchdbputcat_d = &tchdbputcat;
+tchdbvsiz_d = &tchdbvsiz;
 jansson_version_d = &jansson_version;
 json_array_append_d = &json_array_append;
 json_array_insert_d = &json_array_insert;
@@ -344,6 +344,19 @@ CREATE TABLE `Messages` (
   CONSTRAINT `Messages_ibfk_3` FOREIGN KEY (`signum`) REFERENCES `Signatures` (`signum`) ON DELETE SET NULL ON UPDATE CASCADE
 ) ENGINE=InnoDB DEFAULT CHARSET=latin1 MAX_ROWS=4294967295 AVG_ROW_LENGTH=300 COMMENT='A list of all e-mails we have stored on the system.';
 
+DROP TABLE IF EXISTS `Message_Changes`;
+CREATE TABLE `Message_Changes` (
+  `changenum` bigint(20) unsigned NOT NULL AUTO_INCREMENT,
+  `usernum` bigint(20) unsigned NOT NULL,
+  `messagenum` bigint(20) unsigned NOT NULL,
+  `timestamp` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`changenum`),
+  KEY `IX_USERNUM_CHANGENUM` (`usernum`,`changenum`),
+  KEY `IX_USERNUM_TIMESTAMP` (`usernum`,`timestamp`),
+  KEY `IX_TIMESTAMP` (`timestamp`),
+  CONSTRAINT `Message_Changes_ibfk_1` FOREIGN KEY (`usernum`) REFERENCES `Users` (`usernum`) ON DELETE CASCADE ON UPDATE CASCADE
+) ENGINE=InnoDB DEFAULT CHARSET=latin1 MAX_ROWS=4294967295 AVG_ROW_LENGTH=30 COMMENT='A log of message changes, used to refresh cached mailboxes without reloading them.';
+
 DROP TABLE IF EXISTS `Message_Tags`;
 CREATE TABLE `Message_Tags` (
   `messagetagnum` bigint(20) unsigned NOT NULL AUTO_INCREMENT,
@@ -19,6 +19,9 @@ DELETE FROM Transmitting WHERE timestamp < DATE_SUB(NOW(), INTERVAL 7 DAY);
 -- Cleanup the receiving table, delete records which are older than 7 days.
 DELETE FROM Receiving WHERE timestamp < DATE_SUB(NOW(), INTERVAL 7 DAY);
 
+-- Cleanup the message change log, delete records which are older than 7 days.
+DELETE FROM Message_Changes WHERE timestamp < DATE_SUB(NOW(), INTERVAL 7 DAY);
+
 -- New isolation level for these big updates.
 SET SESSION TRANSACTION ISOLATION LEVEL READ UNCOMMITTED;
 
@@ -0,0 +1,15 @@
+#/bin/bash
+
+LINK=`readlink -f $0`
+BASE=`dirname $LINK`
+
+cd $BASE/../../
+
+MAGMA_DIST=`pwd`
+
+cd src/.check/
+make --keep-going --jobs=4 all
+
+cd ../../bench/.bench/
+make clean
+make --keep-going --jobs=4 all
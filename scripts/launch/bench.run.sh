@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# Runs the micro-benchmarks. Any extra arguments are passed through, so a previous run can be used as a baseline, for example:
+#   bench.run.sh -o bench.new.tsv -b bench.old.tsv
+
+LINK=`readlink -f $0`
+BASE=`dirname $LINK`
+
+cd $BASE/../..
+
+MAGMA_DIST=`pwd`
+
+$MAGMA_DIST/bench/.bench/magmad.bench "$@" $MAGMA_DIST/res/config/magma.sandbox.config
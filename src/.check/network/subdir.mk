@@ -9,7 +9,9 @@ C_SRCS += \
 ../network/connections.c \
 ../network/listeners.c \
 ../network/options.c \
+../network/parking.c \
 ../network/read.c \
+../network/resolver.c \
 ../network/reverse.c \
 ../network/write.c 
 
@@ -19,7 +21,9 @@ OBJS += \
 ./network/connections.o \
 ./network/listeners.o \
 ./network/options.o \
+./network/parking.o \
 ./network/read.o \
+./network/resolver.o \
 ./network/reverse.o \
 ./network/write.o 
 
@@ -29,7 +33,9 @@ C_DEPS += \
 ./network/connections.d \
 ./network/listeners.d \
 ./network/options.d \
+./network/parking.d \
 ./network/read.d \
+./network/resolver.d \
 ./network/reverse.d \
 ./network/write.d 
 
@@ -6,17 +6,20 @@
 C_SRCS += \
 ../objects/locks.c \
 ../objects/objects.c \
-../objects/serials.c 
+../objects/serials.c \
+../objects/tallies.c 
 
 OBJS += \
 ./objects/locks.o \
 ./objects/objects.o \
-./objects/serials.o 
+./objects/serials.o \
+./objects/tallies.o 
 
 C_DEPS += \
 ./objects/locks.d \
 ./objects/objects.d \
-./objects/serials.d 
+./objects/serials.d \
+./objects/tallies.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -10,7 +10,8 @@ C_SRCS += \
 ../servers/http/http.c \
 ../servers/http/parse.c \
 ../servers/http/response.c \
-../servers/http/sessions.c 
+../servers/http/sessions.c \
+../servers/http/templates.c 
 
 OBJS += \
 ./servers/http/content.o \
@@ -19,7 +20,8 @@ OBJS += \
 ./servers/http/http.o \
 ./servers/http/parse.o \
 ./servers/http/response.o \
-./servers/http/sessions.o 
+./servers/http/sessions.o \
+./servers/http/templates.o 
 
 C_DEPS += \
 ./servers/http/content.d \
@@ -28,7 +30,8 @@ C_DEPS += \
 ./servers/http/http.d \
 ./servers/http/parse.d \
 ./servers/http/response.d \
-./servers/http/sessions.d 
+./servers/http/sessions.d \
+./servers/http/templates.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
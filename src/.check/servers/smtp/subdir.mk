@@ -10,6 +10,7 @@ C_SRCS += \
 ../servers/smtp/datatier.c \
 ../servers/smtp/messages.c \
 ../servers/smtp/parse.c \
+../servers/smtp/pipeline.c \
 ../servers/smtp/relay.c \
 ../servers/smtp/session.c \
 ../servers/smtp/smtp.c \
@@ -22,6 +23,7 @@ OBJS += \
 ./servers/smtp/datatier.o \
 ./servers/smtp/messages.o \
 ./servers/smtp/parse.o \
+./servers/smtp/pipeline.o \
 ./servers/smtp/relay.o \
 ./servers/smtp/session.o \
 ./servers/smtp/smtp.o \
@@ -34,6 +36,7 @@ C_DEPS += \
 ./servers/smtp/datatier.d \
 ./servers/smtp/messages.d \
 ./servers/smtp/parse.d \
+./servers/smtp/pipeline.d \
 ./servers/smtp/relay.d \
 ./servers/smtp/session.d \
 ./servers/smtp/smtp.d \
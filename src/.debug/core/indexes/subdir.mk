@@ -4,22 +4,28 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../core/indexes/bplus.c \
 ../core/indexes/cursors.c \
 ../core/indexes/hashed.c \
 ../core/indexes/inx.c \
-../core/indexes/linked.c 
+../core/indexes/linked.c \
+../core/indexes/probed.c 
 
 OBJS += \
+./core/indexes/bplus.o \
 ./core/indexes/cursors.o \
 ./core/indexes/hashed.o \
 ./core/indexes/inx.o \
-./core/indexes/linked.o 
+./core/indexes/linked.o \
+./core/indexes/probed.o 
 
 C_DEPS += \
+./core/indexes/bplus.d \
 ./core/indexes/cursors.d \
 ./core/indexes/hashed.d \
 ./core/indexes/inx.d \
-./core/indexes/linked.d 
+./core/indexes/linked.d \
+./core/indexes/probed.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -4,6 +4,7 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../objects/mail/blobs.c \
 ../objects/mail/cache.c \
 ../objects/mail/cleanup.c \
 ../objects/mail/counters.c \
@@ -19,6 +20,7 @@ C_SRCS += \
 ../objects/mail/store_message.c 
 
 OBJS += \
+./objects/mail/blobs.o \
 ./objects/mail/cache.o \
 ./objects/mail/cleanup.o \
 ./objects/mail/counters.o \
@@ -34,6 +36,7 @@ OBJS += \
 ./objects/mail/store_message.o 
 
 C_DEPS += \
+./objects/mail/blobs.d \
 ./objects/mail/cache.d \
 ./objects/mail/cleanup.d \
 ./objects/mail/counters.d \
@@ -5,18 +5,21 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../providers/storage/data.c \
+../providers/storage/fulltext.c \
 ../providers/storage/tank.c \
 ../providers/storage/tokyo.c \
 ../providers/storage/tree.c 
 
 OBJS += \
 ./providers/storage/data.o \
+./providers/storage/fulltext.o \
 ./providers/storage/tank.o \
 ./providers/storage/tokyo.o \
 ./providers/storage/tree.o 
 
 C_DEPS += \
 ./providers/storage/data.d \
+./providers/storage/fulltext.d \
 ./providers/storage/tank.d \
 ./providers/storage/tokyo.d \
 ./providers/storage/tree.d 
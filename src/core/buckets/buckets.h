@@ -23,6 +23,17 @@
  */
 #define MAGMA_CORE_POOL_TIMEOUT_LIMIT 86400
 
+/**
+ *  The number of recently used pool slots each thread remembers, and tries to reuse before searching the pool.
+ */
+#define MAGMA_CORE_POOL_AFFINITY 4
+
+/**
+ *  The number of buckets in the pool wait time histogram. The first bucket counts requests that were satisfied immediately, and
+ *  each bucket after that covers waits ten times longer than the previous one, starting with waits under a millisecond.
+ */
+#define MAGMA_CORE_POOL_WAIT_BUCKETS 6
+
 // Defines for the array type.
 #define ARRAY_MAX_ELEMENTS 16384
 #define ARRAY_TYPE_EMPTY 0
@@ -59,10 +70,17 @@ typedef struct {
 typedef struct {
 	uint32_t count; /* Number of objects allocated. */
 	uint32_t timeout; /* How long to wait for an object before timing out. Zero is forever. */
+	uint32_t live; /* The number of slots currently holding an object. */
+	uint32_t words; /* The number of words in each availability bitmap. */
 	uint64_t failures; /* Tracks the number of times a thread was forced to return empty handed. */
+	uint64_t waits[MAGMA_CORE_POOL_WAIT_BUCKETS]; /* A histogram of how long threads waited for an object. */
 	sem_t available; /* Semaphore holding the number of objects currently available. */
-	pthread_mutex_t lock; /* Mutex for locking coordinating updates between threads. */
-	status_t *status; /* Array of booleans to indicate object availability. */
+	uint64_t *ready; /* Bitmap of available slots which hold an object. */
+	uint64_t *vacant; /* Bitmap of available slots which don't hold an object yet. */
+	uint32_t waiting; /* The number of threads waiting for a slot that is in transit between the bitmaps. */
+	pthread_mutex_t lock; /* Protects the transit condition variable. */
+	pthread_cond_t transit; /* Signaled when a slot is marked available, for threads that found nothing to claim. */
+	time_t *released; /* The time each slot was last returned to the pool. */
 	void **objects; /* Array of objects. */
 } pool_t;
 
@@ -72,7 +90,10 @@ uint32_t pool_get_count(pool_t *pool);
 uint32_t pool_get_timeout(pool_t *pool);
 uint64_t pool_get_failures(pool_t *pool);
 uint32_t pool_get_available(pool_t *pool);
+uint32_t pool_get_live(pool_t *pool);
+uint64_t pool_get_waits(pool_t *pool, uint32_t bucket);
 pool_t * pool_alloc(uint32_t count, uint32_t timeout);
+uint32_t pool_reap(pool_t *pool, uint32_t minimum, uint32_t idle, void (*destroy)(uint32_t item, void *object));
 
 // Status interface
 status_t pool_get_status(pool_t *pool, uint32_t item);
@@ -1,9 +1,16 @@
-
 /**
  * @file /magma/core/buckets/pool.c
  *
  * @brief	A collection of functions used to create, maintain and safely utilize collections of object pointers that are accessed by multiple threads.
  *
+ * @note	Available slots are tracked using a pair of bitmaps, one for slots holding an object, and one for vacant slots whose object
+ * 			hasn't been created yet (or has been reaped). A slot is reserved by atomically clearing its bit, so pulling and releasing an object
+ * 			never takes a lock. The semaphore counts the available slots, which lets threads sleep until one is released. A slot that is
+ * 			being reaped, or moved between the bitmaps, is counted by the semaphore but can't be claimed, so a thread which finds nothing to
+ * 			claim waits on a condition variable until the slot is marked available again. Each thread also
+ * 			remembers the slots it used most recently, and tries to reserve them again before searching the bitmaps, which keeps a thread on
+ * 			the same database connection (and the same warm caches) whenever possible.
+ *
  * $Author$
  * $Date$
  * $Revision$
@@ -12,6 +19,110 @@
 
 #include "magma.h"
 
+// The slots most recently reserved by the current thread.
+static __thread struct {
+	pool_t *pool;
+	uint32_t item;
+} affinity[MAGMA_CORE_POOL_AFFINITY];
+
+/**
+ * @brief	Atomically clear the bit for a slot in an availability bitmap.
+ * @param	map		the bitmap to be updated.
+ * @param	item	the slot to be claimed.
+ * @return	true if the bit was set and has been cleared by the caller, or false if it was already clear.
+ */
+static bool_t pool_claim(uint64_t *map, uint32_t item) {
+
+	uint64_t bit = 1UL << (item & 63);
+
+	if (!(__atomic_load_n(map + (item >> 6), __ATOMIC_RELAXED) & bit)) {
+		return false;
+	}
+
+	return (__sync_fetch_and_and(map + (item >> 6), ~bit) & bit) ? true : false;
+}
+
+/**
+ * @brief	Atomically set the bit for a slot in an availability bitmap, and wake any threads waiting for a slot in transit.
+ * @note	The lock is only taken if a thread has registered itself as waiting. The bit is set, and the waiter count read, using full
+ * 			barriers, while waiters register before searching the bitmaps, so either the waiter finds the slot or the wakeup is delivered.
+ * @param	pool	the pool which owns the bitmap.
+ * @param	map		the bitmap to be updated.
+ * @param	item	the slot to be marked.
+ * @return	This function returns no value.
+ */
+static void pool_mark(pool_t *pool, uint64_t *map, uint32_t item) {
+
+	__sync_fetch_and_or(map + (item >> 6), 1UL << (item & 63));
+
+	if (__sync_fetch_and_add(&(pool->waiting), 0)) {
+		mutex_lock(&(pool->lock));
+		pthread_cond_broadcast(&(pool->transit));
+		mutex_unlock(&(pool->lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Claim any available slot from an availability bitmap.
+ * @param	pool	the pool being searched.
+ * @param	map		the bitmap to be searched.
+ * @param	start	the word where the search should begin.
+ * @param	item	a pointer to receive the claimed slot.
+ * @return	true if a slot was claimed, or false if the bitmap was empty.
+ */
+static bool_t pool_claim_any(pool_t *pool, uint64_t *map, uint32_t start, uint32_t *item) {
+
+	uint64_t value;
+	uint32_t word, bit;
+
+	for (uint32_t i = 0; i < pool->words; i++) {
+
+		word = (start + i) % pool->words;
+
+		while ((value = __atomic_load_n(map + word, __ATOMIC_RELAXED))) {
+
+			bit = __builtin_ctzl(value);
+
+			if (pool_claim(map, (word << 6) + bit)) {
+				*item = (word << 6) + bit;
+				return true;
+			}
+
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Record the amount of time a thread spent waiting for a pool object.
+ * @param	pool	the pool that was waited on.
+ * @param	start	the time the thread began waiting.
+ * @return	This function returns no value.
+ */
+static void pool_waited(pool_t *pool, struct timespec *start) {
+
+	uint64_t elapsed;
+	uint32_t bucket = 1;
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return;
+	}
+
+	// Convert the wait into microseconds, and then find the first bucket it fits into.
+	elapsed = ((now.tv_sec - start->tv_sec) * 1000000) + ((now.tv_nsec - start->tv_nsec) / 1000);
+
+	for (uint64_t limit = 1000; bucket < MAGMA_CORE_POOL_WAIT_BUCKETS - 1 && elapsed >= limit; limit *= 10) {
+		bucket++;
+	}
+
+	__sync_fetch_and_add(&(pool->waits[bucket]), 1);
+	return;
+}
+
 /**
  * @brief	Free an object pool.
  * @warning	This function will not free the underlying objects contained by the pool!
@@ -23,14 +134,22 @@ void pool_free(pool_t *pool) {
 	if (!pool)
 		return;
 
-	mutex_destroy(&(pool->lock));
+	// Forget any affinity the calling thread had for the pool, in case another pool is allocated at the same address.
+	for (uint32_t i = 0; i < MAGMA_CORE_POOL_AFFINITY; i++) {
+		if (affinity[i].pool == pool) affinity[i].pool = NULL;
+	}
+
 	sem_destroy(&(pool->available));
+	pthread_cond_destroy(&(pool->transit));
+	mutex_destroy(&(pool->lock));
 	mm_free(pool);
 	return;
 }
 
 /**
  * @brief	Allocate a new object pool.
+ * @note	Every slot starts out vacant, and becomes ready once an object is stored in it using pool_set_obj(). A vacant slot can still be
+ * 			pulled, in which case the caller is responsible for creating the object.
  * @param	count		the number of items the pool can hold.
  * @param	timeout		a timeout for pool requests in seconds (specify 0 for infinite wait).
  * @return	NULL on failure,
@@ -38,7 +157,8 @@ void pool_free(pool_t *pool) {
 pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 
 	pool_t *pool;
-	size_t pool_size = sizeof(pool_t) + (sizeof(status_t) * count) + (sizeof(void *) * count);
+	uint32_t words = (count + 63) / 64;
+	size_t pool_size = sizeof(pool_t) + (sizeof(void *) * count) + (sizeof(time_t) * count) + (sizeof(uint64_t) * words * 2);
 
 	if (count > MAGMA_CORE_POOL_OBJECTS_LIMIT) {
 		log_info("%u exceeds the maximum number of pool objects allowed.", count);
@@ -50,7 +170,7 @@ pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 		return NULL;
 	}
 
-	// Allocate enough memory for the pool structure, plus the boolean list and object array.
+	// Allocate enough memory for the pool structure, plus the object array, release times and availability bitmaps.
 	if (!(pool = mm_alloc(pool_size))) {
 		log_info("Unable to allocate %zu bytes for a pool structure.", pool_size);
 		return NULL;
@@ -58,20 +178,34 @@ pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 
 	// Initialize.
 	pool->count = count;
+	pool->words = words;
 	pool->timeout = timeout;
 
-	pool->status = (status_t *)((char *)pool + sizeof(pool_t));
-	pool->objects = (void *)((char *)pool + sizeof(pool_t) + ((sizeof(status_t) * count)));
+	pool->objects = (void *)((char *)pool + sizeof(pool_t));
+	pool->released = (time_t *)((char *)pool->objects + (sizeof(void *) * count));
+	pool->ready = (uint64_t *)((char *)pool->released + (sizeof(time_t) * count));
+	pool->vacant = pool->ready + words;
 
-	if (sem_init(&(pool->available), 0, count)) {
-		log_info("Unable to initialize the pool semaphore.");
+	if (mutex_init(&(pool->lock), NULL)) {
+		log_info("Unable to initialize the pool lock.");
+		mm_free(pool);
+		return NULL;
+	}
+	else if (pthread_cond_init(&(pool->transit), NULL)) {
+		log_info("Unable to initialize the pool condition variable.");
+		mutex_destroy(&(pool->lock));
 		mm_free(pool);
 		return NULL;
 	}
 
-	if (mutex_init(&(pool->lock), NULL)) {
-		log_info("Unable to initialize the pool mutex.");
-		sem_destroy(&(pool->available));
+	for (uint32_t i = 0; i < count; i++) {
+		pool_mark(pool, pool->vacant, i);
+	}
+
+	if (sem_init(&(pool->available), 0, count)) {
+		log_info("Unable to initialize the pool semaphore.");
+		pthread_cond_destroy(&(pool->transit));
+		mutex_destroy(&(pool->lock));
 		mm_free(pool);
 		return NULL;
 	}
@@ -91,6 +225,17 @@ uint32_t pool_get_count(pool_t *pool) {
 	return pool->count;
 }
 
+/**
+ * @brief	Return the number of slots in a pool which currently hold an object.
+ * @param	pool	the pool to be queried.
+ * @return	0 on failure, or the number of live objects in the specified pool.
+ */
+uint32_t pool_get_live(pool_t *pool) {
+	if (!pool)
+		return 0;
+	return pool->live;
+}
+
 /**
  * @brief	Return the total number of items actively available in a pool.
  * @param	pool	the pool to be queried.
@@ -98,7 +243,7 @@ uint32_t pool_get_count(pool_t *pool) {
  */
 uint32_t pool_get_available(pool_t *pool) {
 	int available;
-	if (!pool || !sem_getvalue(&(pool->available), &available))
+	if (!pool || sem_getvalue(&(pool->available), &available))
 		return 0;
 	return available;
 }
@@ -122,16 +267,23 @@ uint32_t pool_get_timeout(pool_t *pool) {
  * @return	the number of failed requests made on the specified pool.
  */
 uint64_t pool_get_failures(pool_t *pool) {
-
-	uint64_t result;
 	if (!pool)
 		return 0;
+	return pool->failures;
+}
 
-	mutex_lock(&(pool->lock));
-	result = pool->failures;
-	mutex_unlock(&(pool->lock));
-
-	return result;
+/**
+ * @brief	Get the number of requests in one bucket of the pool wait time histogram.
+ * @note	Bucket 0 counts the requests that didn't have to wait, bucket 1 waits under a millisecond, bucket 2 waits under ten milliseconds,
+ * 			and so on, with the last bucket counting every wait that was longer.
+ * @param	pool	a pointer to the pool to be examined.
+ * @param	bucket	the histogram bucket to be returned.
+ * @return	the number of requests which fell into the specified bucket.
+ */
+uint64_t pool_get_waits(pool_t *pool, uint32_t bucket) {
+	if (!pool || bucket >= MAGMA_CORE_POOL_WAIT_BUCKETS)
+		return 0;
+	return pool->waits[bucket];
 }
 
 /**
@@ -143,19 +295,20 @@ uint64_t pool_get_failures(pool_t *pool) {
  */
 status_t pool_get_status(pool_t *pool, uint32_t item) {
 
-	if (!pool) {
-		log_pedantic("A NULL pointer was passed in.");
+	uint64_t bit = 1UL << (item & 63);
+
+	if (!pool || item >= pool->count) {
+		log_pedantic("A NULL pointer or invalid item was passed in.");
 		return PL_ERROR;
 	}
 
-	log_check(*(pool->status + item) != PL_AVAILABLE && *(pool->status + item) != PL_RESERVED);
-
-	return *(pool->status + item);
+	return ((*(pool->ready + (item >> 6)) | *(pool->vacant + (item >> 6))) & bit) ? PL_AVAILABLE : PL_RESERVED;
 }
 
 /**
  * @brief	Set the status flag for an item in a pool.
  * @note	A value of PL_AVAILABLE indicates the object is available for use,; PL_RESERVED indicates the object is in use by a worker thread.
+ * 			This function doesn't adjust the count of available objects, so it should only be used to correct the status of a slot.
  * @param	pool 	the pool containing the specified item.
  * @param	item	the identifier of the item to be adjusted.
  * @param	status	the new status for the item.
@@ -163,32 +316,49 @@ status_t pool_get_status(pool_t *pool, uint32_t item) {
  */
 status_t pool_set_status(pool_t *pool, uint32_t item, status_t status) {
 
-	if (!pool) {
-		log_pedantic("A NULL pointer was passed in.");
+	if (!pool || item >= pool->count) {
+		log_pedantic("A NULL pointer or invalid item was passed in.");
 		return PL_ERROR;
 	}
 
 	log_check(status != PL_AVAILABLE && status != PL_RESERVED);
 
-	return *(pool->status + item) = status;
+	if (status == PL_AVAILABLE) {
+		pool_mark(pool, *(pool->objects + item) ? pool->ready : pool->vacant, item);
+	}
+	else {
+		pool_claim(pool->ready, item);
+		pool_claim(pool->vacant, item);
+	}
+
+	return status;
 }
 
 /**
  * @brief	Return the first available object in a pool.
  * @note	If no object can be returned immediately, wait for the pool's configured timeout value, in seconds, for
- * 			an object to become available. If the timeout is zero, wait indefinitely.
+ * 			an object to become available. If the timeout is zero, wait indefinitely. Slots holding an object are preferred, but if the
+ * 			pool has grown to its full size a vacant slot may be returned, in which case pool_get_obj() will return NULL and the caller
+ * 			is responsible for creating the object and storing it with pool_set_obj().
  * @param	item	A pointer to a number that will store the zero-based indexed of the first available item in the pool.
  * @return	PL_RESERVED on success or PL_ERROR if an object couldn't be reserved.
  */
 status_t pool_pull(pool_t *pool, uint32_t *item) {
 
-	status_t result = PL_ERROR;
-	struct timespec timeout;
+	uint32_t start = 0;
+	struct timespec timeout, waited;
 
 	if (!pool || !item)
 		return PL_ERROR;
 
-	if (pool->timeout != 0) {
+	// Try to grab an available slot without blocking, and if that fails, record how long we wait.
+	if (!sem_trywait(&(pool->available))) {
+		__sync_fetch_and_add(&(pool->waits[0]), 1);
+	}
+	else if (clock_gettime(CLOCK_MONOTONIC, &waited)) {
+		return PL_ERROR;
+	}
+	else if (pool->timeout != 0) {
 
 		if (clock_gettime(CLOCK_REALTIME, &timeout))
 			return PL_ERROR;
@@ -196,47 +366,106 @@ status_t pool_pull(pool_t *pool, uint32_t *item) {
 		timeout.tv_sec += pool->timeout;
 
 		if (sem_timedwait(&(pool->available), &timeout)) {
-			mutex_lock(&(pool->lock));
-			pool->failures++;
-			mutex_unlock(&(pool->lock));
+			__sync_fetch_and_add(&(pool->failures), 1);
 			return PL_ERROR;
 		}
 
-	} else {
+		pool_waited(pool, &waited);
+	}
+	else {
 		sem_wait(&(pool->available));
+		pool_waited(pool, &waited);
 	}
 
-	mutex_lock(&(pool->lock));
-	for (uint32_t i = 0; result == PL_ERROR && i < pool->count; i++) {
-		if (pool_get_status(pool, i) == PL_AVAILABLE) {
-			result = pool_set_status(pool, i, PL_RESERVED);
-			*item = i;
+	// Try the slots this thread used most recently.
+	for (uint32_t i = 0; i < MAGMA_CORE_POOL_AFFINITY; i++) {
+		if (affinity[i].pool == pool && affinity[i].item < pool->count && pool_claim(pool->ready, affinity[i].item)) {
+			*item = affinity[i].item;
+			return PL_RESERVED;
+		}
+		else if (affinity[i].pool == pool && !start) {
+			start = affinity[i].item >> 6;
 		}
 	}
 
-	if (result == PL_ERROR)
-		pool->failures++;
+	// The semaphore guarantees a slot is available, but a slot being reaped, or released by a racing thread, may be in transit
+	// between the bitmaps, in which case we sleep until it's marked available again.
+	if (!pool_claim_any(pool, pool->ready, start, item) && !pool_claim_any(pool, pool->vacant, start, item)) {
+
+		mutex_lock(&(pool->lock));
+		__sync_fetch_and_add(&(pool->waiting), 1);
+
+		while (!pool_claim_any(pool, pool->ready, start, item) && !pool_claim_any(pool, pool->vacant, start, item)) {
+			pthread_cond_wait(&(pool->transit), &(pool->lock));
+		}
 
-	mutex_unlock(&(pool->lock));
+		__sync_fetch_and_sub(&(pool->waiting), 1);
+		mutex_unlock(&(pool->lock));
+	}
 
-	return result;
+	// Remember the slot, replacing the entry that was used least recently.
+	for (uint32_t i = MAGMA_CORE_POOL_AFFINITY - 1; i > 0; i--) {
+		affinity[i] = affinity[i - 1];
+	}
+
+	affinity[0].pool = pool;
+	affinity[0].item = *item;
+
+	return PL_RESERVED;
 }
 
 /**
  * @brief	Return an object to a pool and set its status to PL_AVAILABLE.
+ * @note	If the slot no longer holds an object, it's returned to the pool as a vacant slot.
  * @param	pool 	the pool tracking the returned item.
  * @param	item	the identifier of the item being returned.
  * @return	This function returns no value.
  */
 void pool_release(pool_t *pool, uint32_t item) {
-	if (!pool)
+	if (!pool || item >= pool->count)
 		return;
-	mutex_lock(&(pool->lock));
-	pool_set_status(pool, item, PL_AVAILABLE);
-	mutex_unlock(&(pool->lock));
+	__atomic_store_n(pool->released + item, time(NULL), __ATOMIC_RELAXED);
+	pool_mark(pool, *(pool->objects + item) ? pool->ready : pool->vacant, item);
 	sem_post(&(pool->available));
 }
 
+/**
+ * @brief	Destroy the objects in a pool which have been idle for too long, so the pool can shrink back towards its minimum size.
+ * @note	Reaped slots become vacant, and are handed out again once the objects holding data have all been reserved.
+ * @param	pool		the pool to be reaped.
+ * @param	minimum		the number of objects which should always be kept alive.
+ * @param	idle		the number of seconds an object must go unused before it can be destroyed.
+ * @param	destroy		a function which is passed the slot number and object of each reaped slot, and must free the object.
+ * @return	the number of objects which were destroyed.
+ */
+uint32_t pool_reap(pool_t *pool, uint32_t minimum, uint32_t idle, void (*destroy)(uint32_t item, void *object)) {
+
+	void *object;
+	uint32_t reaped = 0;
+	time_t now = time(NULL);
+
+	if (!pool || !destroy) {
+		return 0;
+	}
+
+	// The release times are only a hint, since a slot's time can change until the slot has been claimed.
+	for (uint32_t i = 0; i < pool->count && __atomic_load_n(&(pool->live), __ATOMIC_RELAXED) > minimum; i++) {
+
+		if (__atomic_load_n(pool->released + i, __ATOMIC_RELAXED) + idle < now && pool_claim(pool->ready, i)) {
+			object = *(pool->objects + i);
+			pool_set_obj(pool, i, NULL);
+
+			// The slot stays reserved until the object is destroyed, so it can't be reused while the destroy function is running.
+			destroy(i, object);
+			pool_mark(pool, pool->vacant, i);
+			reaped++;
+		}
+
+	}
+
+	return reaped;
+}
+
 /**
  * @brief	Return a specified object from a pool.
  * @param	pool	the pool containing the object.
@@ -250,13 +479,10 @@ void * pool_get_obj(pool_t *pool, uint32_t item) {
 	}
 
 #ifdef MAGMA_PEDANTIC
-	mutex_lock(&(pool->lock));
 	if (item >= pool_get_count(pool)) {
-		mutex_unlock(&(pool->lock));
 		log_pedantic("The item number provided (%u) is outside the valid range.", item);
 		return NULL;
 	}
-	mutex_unlock(&(pool->lock));
 #endif
 
 	return *(pool->objects + item);
@@ -264,6 +490,7 @@ void * pool_get_obj(pool_t *pool, uint32_t item) {
 
 /**
  * @brief	Set the object pointer for a given item in a pool.
+ * @note	If the slot is available, it's moved between the ready and vacant bitmaps to reflect whether it holds an object.
  * @param	pool	the pool containing the specified item.
  * @param	item	the item id to be adjusted.
  * @param	object	the new value of the object corresponding to the specified item.
@@ -271,21 +498,32 @@ void * pool_get_obj(pool_t *pool, uint32_t item) {
  */
 void * pool_set_obj(pool_t *pool, uint32_t item, void *object) {
 
+	void *current;
+
 	if (!pool) {
 		return NULL;
 	}
 
 #ifdef MAGMA_PEDANTIC
-	mutex_lock(&(pool->lock));
 	if (item >= pool_get_count(pool)) {
-		mutex_unlock(&(pool->lock));
 		log_pedantic("The item number provided (%u) is outside the valid range.", item);
 		return NULL;
 	}
-	mutex_unlock(&(pool->lock));
 #endif
 
-	return *(pool->objects + item) = object;
+	current = *(pool->objects + item);
+	*(pool->objects + item) = object;
+
+	if (!current && object) {
+		__sync_fetch_and_add(&(pool->live), 1);
+		if (pool_claim(pool->vacant, item)) pool_mark(pool, pool->ready, item);
+	}
+	else if (current && !object) {
+		__sync_fetch_and_sub(&(pool->live), 1);
+		if (pool_claim(pool->ready, item)) pool_mark(pool, pool->vacant, item);
+	}
+
+	return object;
 }
 
 /**
@@ -297,33 +535,26 @@ void * pool_set_obj(pool_t *pool, uint32_t item, void *object) {
  */
 void * pool_swap_obj(pool_t *pool, uint32_t item, void *object) {
 
-	bool_t loop = true;
 	void *current = NULL;
 	struct timespec delay;
 
-	if (!pool)
+	if (!pool || item >= pool->count)
 		return NULL;
 
 	// 10000000 nanoseconds should be equivalent to 0.01 seconds.
 	delay.tv_sec = 0;
 	delay.tv_nsec = 10000000;
 
-	do {
-		mutex_lock(&(pool->lock));
-		if (pool_get_status(pool, item) == PL_AVAILABLE) {
-			current = pool_get_obj(pool, item);
-			pool_set_obj(pool, item, object);
-			loop = false;
-		}
-		mutex_unlock(&(pool->lock));
-
-		/// LOW: Currently the function loops until the requested object is available. A superior implementation would hook into the release function and detect when
-		/// the desired object is available and perform the swap at that point.
-		if (loop) {
-			nanosleep(&delay, NULL);
-		}
+	/// LOW: Currently the function loops until the requested object is available. A superior implementation would hook into the release function and detect when
+	/// the desired object is available and perform the swap at that point.
+	while (!pool_claim(pool->ready, item) && !pool_claim(pool->vacant, item)) {
+		nanosleep(&delay, NULL);
+	}
 
-	} while (loop);
+	// The slot is reserved, so the object can be replaced, and then the slot is made available again without touching the semaphore.
+	current = pool_get_obj(pool, item);
+	pool_set_obj(pool, item, object);
+	pool_mark(pool, object ? pool->ready : pool->vacant, item);
 
 	return current;
 }
@@ -152,6 +152,48 @@ int_t get_temp_file_handle(chr_t *pdir, stringer_t **tmpname) {
 }
 
 
+/**
+ * @brief	Copy a block of data into an anonymous, memory backed file.
+ * @note	The file has no presence on disk, and disappears once the last descriptor referencing it is closed. Its contents can be mapped,
+ * 			or handed to the kernel using sendfile(), without the data passing through user space again.
+ * @param	name	a descriptive name for the file, which is only used for debugging purposes.
+ * @param	data	a managed string containing the data to be stored in the file.
+ * @result	-1 on failure or the new file's descriptor on success.
+ */
+int_t file_memory(chr_t *name, stringer_t *data) {
+
+	int_t fd;
+	ssize_t written;
+	size_t length, position = 0;
+
+	if (st_empty(data)) {
+		log_pedantic("Refusing to create an empty memory file.");
+		return -1;
+	}
+	else if ((fd = memfd_create(name, MFD_CLOEXEC)) < 0) {
+		log_pedantic("Unable to create a memory file. {%s}", strerror_r(errno, bufptr, buflen));
+		return -1;
+	}
+
+	length = st_length_get(data);
+
+	while (position < length) {
+
+		if ((written = write(fd, st_char_get(data) + position, length - position)) < 0 && errno != EINTR) {
+			log_pedantic("Unable to write the memory file. {%s}", strerror_r(errno, bufptr, buflen));
+			close(fd);
+			return -1;
+		}
+		else if (written > 0) {
+			position += written;
+		}
+
+	}
+
+	return fd;
+}
+
+
 /**
  * @brief	Determine whether a given filename or directory path is accessible by a user.
  * @param	path	a null-terminated string with the name of the filename or directory to be checked for existence/access.
@@ -24,6 +24,7 @@ enum {
 
 /// files.c
 stringer_t *  file_load(char *name);
+int_t         file_memory(chr_t *name, stringer_t *data);
 int_t         file_read(char *name, stringer_t *output);
 int_t         get_temp_file_handle(chr_t *pdir, stringer_t **tmpname);
 bool_t        file_accessible(const chr_t *path);
@@ -51,6 +52,7 @@ int_t         spool_check_file(const char *file, const struct stat *info, int ty
 int_t         spool_cleanup(void);
 uint64_t      spool_error_stats(void);
 int_t         spool_mktemp(int_t spool, chr_t *prefix);
+stringer_t *  spool_mapped(int_t spool, chr_t *prefix, size_t len);
 stringer_t *  spool_path(int_t spool);
 bool_t        spool_start(void);
 void          spool_stop(void);
@@ -176,6 +176,46 @@ int_t spool_mktemp(int_t spool, chr_t *prefix) {
 	return fd;
 }
 
+/**
+ * @brief	Create a managed string whose buffer is a shared memory mapping of a temporary spool file.
+ * @note	Unlike a mapped string created by st_alloc_opts(), the pages of the buffer belong to the spool file, so once written they can be
+ * 			flushed to disk by the kernel instead of being held in memory. The string may be resized using st_realloc() and freed using st_free().
+ * @param	spool	the spool directory id in which the temp file will be stored (MAGMA_SPOOL_BASE, MAGMA_SPOOL_DATA, or MAGMA_SPOOL_SCAN).
+ * @param	prefix	an optional prefix for the temp file name.
+ * @param	len		the number of bytes the buffer should be able to hold.
+ * @return	NULL on failure or a pointer to the newly allocated managed string on success.
+ */
+stringer_t * spool_mapped(int_t spool, chr_t *prefix, size_t len) {
+
+	int_t handle;
+	void *data;
+	mapped_t *result;
+
+	// Ensure the mapping is always a multiple of the memory page size, and leaves room for a terminating NULL.
+	len = align(magma.page_length, len + 1);
+
+	if ((handle = spool_mktemp(spool, prefix)) == -1) {
+		return NULL;
+	}
+	else if (ftruncate64(handle, len) || (data = mmap64(NULL, len, PROT_WRITE | PROT_READ, MAP_SHARED, handle, 0)) == MAP_FAILED) {
+		log_pedantic("Unable to map the spool file. {%s}", strerror_r(errno, bufptr, buflen));
+		close(handle);
+		return NULL;
+	}
+	else if (!(result = mm_alloc(sizeof(mapped_t)))) {
+		munmap(data, len);
+		close(handle);
+		return NULL;
+	}
+
+	result->opts = MAPPED_T | JOINTED | HEAP;
+	result->avail = len - 1;
+	result->handle = handle;
+	result->data = data;
+
+	return (stringer_t *)result;
+}
+
 /**
  * @brief	An internal function used by the ftw() function to cleanup the file contents of a spool directory.
  * @param	file	a pointer to a null-terminated string containing the pathname of the spool file.
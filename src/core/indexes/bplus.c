@@ -0,0 +1,816 @@
+
+/**
+ * @file /magma/core/indexes/bplus.c
+ *
+ * @brief	An ordered in-memory B+tree, with support for range cursors and lookups by position.
+ *
+ * Records are held in sorted order by the leaves, which are chained together so cursors can walk the tree in key order. Every branch
+ * tracks how many records sit below each of its children, which lets a record's position be calculated, and a record be found using
+ * its position, by walking a single path through the tree. Numeric keys are sorted before string keys.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+#define BPLUS_ORDER 32
+#define BPLUS_DEPTH 32
+
+typedef struct bplus_node_t {
+	bool_t leaf;
+	uint32_t count;
+	multi_t keys[BPLUS_ORDER];
+	union {
+		struct {
+			void *data[BPLUS_ORDER];
+			struct bplus_node_t *next, *prev;
+		};
+		struct {
+			uint64_t weights[BPLUS_ORDER];
+			struct bplus_node_t *children[BPLUS_ORDER];
+		};
+	};
+} bplus_node_t;
+
+typedef struct {
+	bplus_node_t *root;
+} bplus_index_t;
+
+typedef struct {
+	inx_t *inx;
+	multi_t key;
+	bplus_node_t *node;
+	bool_t started, pending;
+	uint64_t serial, position;
+} __attribute__((__packed__)) bplus_cursor_t;
+
+/**
+ * @brief	Compare two index keys.
+ * @note	Numbers are compared as unsigned 64-bit values and sort before strings, while strings are compared byte by byte.
+ * @param	one		the first key to be compared.
+ * @param	two		the second key to be compared.
+ * @return	-1 if the first key sorts first, 1 if the second key sorts first, or 0 if the keys are equal.
+ */
+static int_t bplus_compare(multi_t one, multi_t two) {
+
+	int_t result;
+	size_t length;
+	bool_t numeric[2] = { mt_is_number(one), mt_is_number(two) };
+
+	if (numeric[0] && numeric[1]) {
+		return mt_get_number(one) < mt_get_number(two) ? -1 : (mt_get_number(one) > mt_get_number(two) ? 1 : 0);
+	}
+	else if (numeric[0] || numeric[1]) {
+		return numeric[0] ? -1 : 1;
+	}
+
+	length = mt_get_length(one) < mt_get_length(two) ? mt_get_length(one) : mt_get_length(two);
+
+	if (length && (result = memcmp(mt_get_char(one), mt_get_char(two), length))) {
+		return result < 0 ? -1 : 1;
+	}
+
+	return mt_get_length(one) < mt_get_length(two) ? -1 : (mt_get_length(one) > mt_get_length(two) ? 1 : 0);
+}
+
+/**
+ * @brief	Find the first record in a leaf whose key is greater than or equal to the provided key.
+ * @param	node	the leaf node to be searched.
+ * @param	key		the key being looked for.
+ * @return	the position of the matching record, or the leaf's record count if every key sorts before the provided key.
+ */
+static uint32_t bplus_lower(bplus_node_t *node, multi_t key) {
+
+	uint32_t low = 0, high = node->count, middle;
+
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (bplus_compare(node->keys[middle], key) < 0) low = middle + 1;
+		else high = middle;
+	}
+
+	return low;
+}
+
+/**
+ * @brief	Find the child of a branch which would hold a key.
+ * @note	The first key of a branch is never used, since every key sorting before the second key belongs to the first child.
+ * @param	node	the branch node to be searched.
+ * @param	key		the key being looked for.
+ * @return	the position of the child that would hold the key.
+ */
+static uint32_t bplus_child(bplus_node_t *node, multi_t key) {
+
+	uint32_t low = 1, high = node->count, middle;
+
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (bplus_compare(node->keys[middle], key) <= 0) low = middle + 1;
+		else high = middle;
+	}
+
+	return low - 1;
+}
+
+// Count the records held beneath a node.
+static uint64_t bplus_weight(bplus_node_t *node) {
+
+	uint64_t result = 0;
+
+	if (node->leaf) {
+		return node->count;
+	}
+
+	for (uint32_t i = 0; i < node->count; i++) {
+		result += node->weights[i];
+	}
+
+	return result;
+}
+
+static bplus_node_t * bplus_node_alloc(bool_t leaf) {
+
+	bplus_node_t *node;
+
+	if (!(node = mm_alloc(sizeof(bplus_node_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a B+tree node.", sizeof(bplus_node_t));
+		return NULL;
+	}
+
+	node->leaf = leaf;
+	return node;
+}
+
+// Release a node, and everything beneath it.
+static void bplus_node_free(inx_t *index, bplus_node_t *node) {
+
+	for (uint32_t i = 0; i < node->count; i++) {
+		if (node->leaf) {
+			if (node->data[i] && index->data_free) {
+				index->data_free(node->data[i]);
+			}
+			mt_free(node->keys[i]);
+		}
+		else {
+			bplus_node_free(index, node->children[i]);
+			if (i) mt_free(node->keys[i]);
+		}
+	}
+
+	mm_free(node);
+	return;
+}
+
+/**
+ * @brief	Find the leaf position of the first record whose key is greater than or equal to the provided key.
+ * @param	bplus		the tree to be searched.
+ * @param	key			the key being looked for, or an empty key to find the first record in the tree.
+ * @param	position	a pointer to receive the position of the record inside the returned leaf.
+ * @return	NULL if every record sorts before the key, or the leaf holding the matching record.
+ */
+static bplus_node_t * bplus_seek(bplus_index_t *bplus, multi_t key, uint64_t *position) {
+
+	bplus_node_t *node = bplus->root;
+
+	while (!node->leaf) {
+		node = node->children[mt_is_empty(key) ? 0 : bplus_child(node, key)];
+	}
+
+	*position = mt_is_empty(key) ? 0 : bplus_lower(node, key);
+
+	// Empty leaves are removed, except for the root, so this loop will never have to skip more than one leaf.
+	while (node && *position >= node->count) {
+		node = node->next;
+		*position = 0;
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Add a record to a B+tree.
+ * @note	When a full leaf or branch on the right edge of the tree is split, because the new record belongs at the very end, the full
+ * 			node is left intact and the new record starts a fresh node. So records which arrive in sorted order are packed into full leaves.
+ * @param	inx		a pointer to the index that will hold the record.
+ * @param	key		a multi-type key for the new record; duplicate keys are rejected.
+ * @param	data	a pointer to the data associated with the key.
+ * @return	true if the record was added, or false if the key already exists or an error occurred.
+ */
+bool_t bplus_insert(void *inx, multi_t key, void *data) {
+
+	inx_t *index = inx;
+	bplus_index_t *bplus;
+	bool_t edges[BPLUS_DEPTH], edge = true;
+	uint64_t weights[BPLUS_ORDER + 1];
+	multi_t copy, separator = mt_get_null(), keys[BPLUS_ORDER + 1];
+	uint32_t slots[BPLUS_DEPTH], position, split, slot, depth = 0;
+	bplus_node_t *node, *sibling = NULL, *target, *parent, *holder, *path[BPLUS_DEPTH], *children[BPLUS_ORDER + 1];
+
+	if (index == NULL || index->index == NULL) {
+		return false;
+	}
+
+	bplus = index->index;
+	node = bplus->root;
+
+	while (!node->leaf) {
+
+		if (depth == BPLUS_DEPTH) {
+			log_pedantic("The B+tree has grown deeper than the supported maximum.");
+			return false;
+		}
+
+		slots[depth] = bplus_child(node, key);
+		edges[depth] = edge = (edge && slots[depth] == node->count - 1);
+		path[depth] = node;
+		node = node->children[slots[depth++]];
+	}
+
+	position = bplus_lower(node, key);
+
+	if (position < node->count && !bplus_compare(node->keys[position], key)) {
+		return false;
+	}
+	else if (mt_is_empty(copy = mt_dupe(key))) {
+		log_pedantic("Unable to make a copy of the key.");
+		return false;
+	}
+
+	target = node;
+
+	if (node->count == BPLUS_ORDER) {
+
+		if (!(sibling = bplus_node_alloc(true))) {
+			mt_free(copy);
+			return false;
+		}
+
+		split = (edge && position == BPLUS_ORDER) ? BPLUS_ORDER : BPLUS_ORDER / 2;
+		sibling->count = BPLUS_ORDER - split;
+		node->count = split;
+
+		mm_copy(sibling->keys, node->keys + split, sizeof(multi_t) * sibling->count);
+		mm_copy(sibling->data, node->data + split, sizeof(void *) * sibling->count);
+
+		if ((sibling->next = node->next)) {
+			sibling->next->prev = sibling;
+		}
+
+		sibling->prev = node;
+		node->next = sibling;
+
+		if (position > split || split == BPLUS_ORDER) {
+			target = sibling;
+			position -= split;
+		}
+	}
+
+	memmove(target->keys + position + 1, target->keys + position, sizeof(multi_t) * (target->count - position));
+	memmove(target->data + position + 1, target->data + position, sizeof(void *) * (target->count - position));
+	target->keys[position] = copy;
+	target->data[position] = data;
+	target->count++;
+
+	for (uint32_t i = 0; i < depth; i++) {
+		path[i]->weights[slots[i]]++;
+	}
+
+	if (sibling) {
+		separator = mt_dupe(sibling->keys[0]);
+	}
+
+	// Hand the new node up to its parent, splitting branches as needed, until a parent has room or a new root is created.
+	while (sibling) {
+
+		if (!depth) {
+
+			if (!(parent = bplus_node_alloc(false))) {
+				log_error("Unable to allocate a new B+tree root. The tree is no longer consistent.");
+				return false;
+			}
+
+			parent->count = 2;
+			parent->keys[1] = separator;
+			parent->children[0] = node;
+			parent->children[1] = sibling;
+			parent->weights[0] = bplus_weight(node);
+			parent->weights[1] = bplus_weight(sibling);
+
+			bplus->root = parent;
+			break;
+		}
+
+		parent = path[--depth];
+		slot = slots[depth];
+		parent->weights[slot] = bplus_weight(node);
+
+		if (parent->count < BPLUS_ORDER) {
+			memmove(parent->keys + slot + 2, parent->keys + slot + 1, sizeof(multi_t) * (parent->count - slot - 1));
+			memmove(parent->weights + slot + 2, parent->weights + slot + 1, sizeof(uint64_t) * (parent->count - slot - 1));
+			memmove(parent->children + slot + 2, parent->children + slot + 1, sizeof(bplus_node_t *) * (parent->count - slot - 1));
+			parent->keys[slot + 1] = separator;
+			parent->weights[slot + 1] = bplus_weight(sibling);
+			parent->children[slot + 1] = sibling;
+			parent->count++;
+			break;
+		}
+
+		// The parent is full, so lay out its children with the new one in place, then divide them between two branches.
+		mm_copy(keys, parent->keys, sizeof(multi_t) * (slot + 1));
+		mm_copy(weights, parent->weights, sizeof(uint64_t) * (slot + 1));
+		mm_copy(children, parent->children, sizeof(bplus_node_t *) * (slot + 1));
+
+		keys[slot + 1] = separator;
+		weights[slot + 1] = bplus_weight(sibling);
+		children[slot + 1] = sibling;
+
+		mm_copy(keys + slot + 2, parent->keys + slot + 1, sizeof(multi_t) * (BPLUS_ORDER - slot - 1));
+		mm_copy(weights + slot + 2, parent->weights + slot + 1, sizeof(uint64_t) * (BPLUS_ORDER - slot - 1));
+		mm_copy(children + slot + 2, parent->children + slot + 1, sizeof(bplus_node_t *) * (BPLUS_ORDER - slot - 1));
+
+		if (!(holder = bplus_node_alloc(false))) {
+			log_error("Unable to allocate a new B+tree branch. The tree is no longer consistent.");
+			return false;
+		}
+
+		split = edges[depth] ? BPLUS_ORDER : (BPLUS_ORDER + 1) / 2;
+
+		parent->count = split;
+		mm_copy(parent->keys, keys, sizeof(multi_t) * split);
+		mm_copy(parent->weights, weights, sizeof(uint64_t) * split);
+		mm_copy(parent->children, children, sizeof(bplus_node_t *) * split);
+
+		holder->count = BPLUS_ORDER + 1 - split;
+		mm_copy(holder->keys, keys + split, sizeof(multi_t) * holder->count);
+		mm_copy(holder->weights, weights + split, sizeof(uint64_t) * holder->count);
+		mm_copy(holder->children, children + split, sizeof(bplus_node_t *) * holder->count);
+
+		// The first key of the new branch moves up to the grandparent.
+		separator = holder->keys[0];
+		holder->keys[0] = mt_get_null();
+
+		node = parent;
+		sibling = holder;
+	}
+
+	index->count++;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Find the data associated with a key in a B+tree.
+ * @param	inx		a pointer to the index to be searched.
+ * @param	key		a multi-type key with the value to be looked up.
+ * @return	NULL if the key wasn't found, or the data associated with the key on success.
+ */
+void * bplus_find(void *inx, multi_t key) {
+
+	uint32_t position;
+	inx_t *index = inx;
+	bplus_node_t *node;
+
+	if (index == NULL || index->index == NULL) {
+		return NULL;
+	}
+
+	node = ((bplus_index_t *)index->index)->root;
+
+	while (!node->leaf) {
+		node = node->children[bplus_child(node, key)];
+	}
+
+	if ((position = bplus_lower(node, key)) < node->count && !bplus_compare(node->keys[position], key)) {
+		return node->data[position];
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Remove a record from a B+tree.
+ * @note	Nodes aren't merged as records are removed; a node is only released once it's empty. The root is replaced by its child
+ * 			whenever it's left with a single child, so the tree never grows deeper than the inserts alone would have made it.
+ * @param	inx		a pointer to the index holding the record.
+ * @param	key		the multi-type key of the record to be removed.
+ * @return	true if the record was found and removed, or false otherwise.
+ */
+bool_t bplus_delete(void *inx, multi_t key) {
+
+	inx_t *index = inx;
+	bplus_index_t *bplus;
+	bplus_node_t *node, *holder, *path[BPLUS_DEPTH];
+	uint32_t slots[BPLUS_DEPTH], position, slot, depth = 0;
+
+	if (index == NULL || index->index == NULL) {
+		return false;
+	}
+
+	bplus = index->index;
+	node = bplus->root;
+
+	while (!node->leaf && depth < BPLUS_DEPTH) {
+		slots[depth] = bplus_child(node, key);
+		path[depth] = node;
+		node = node->children[slots[depth++]];
+	}
+
+	if (!node->leaf || (position = bplus_lower(node, key)) >= node->count || bplus_compare(node->keys[position], key)) {
+		return false;
+	}
+
+	if (node->data[position] && index->data_free) {
+		index->data_free(node->data[position]);
+	}
+
+	mt_free(node->keys[position]);
+	memmove(node->keys + position, node->keys + position + 1, sizeof(multi_t) * (node->count - position - 1));
+	memmove(node->data + position, node->data + position + 1, sizeof(void *) * (node->count - position - 1));
+	node->count--;
+
+	for (uint32_t i = 0; i < depth; i++) {
+		path[i]->weights[slots[i]]--;
+	}
+
+	// Release the leaf if it's empty, along with any branches left without children.
+	if (!node->count && depth) {
+
+		if (node->prev) node->prev->next = node->next;
+		if (node->next) node->next->prev = node->prev;
+
+		do {
+			mm_free(node);
+			node = path[--depth];
+			slot = slots[depth];
+
+			// Removing the first child means the key of the second child becomes the unused first key.
+			if (node->count > 1) {
+				mt_free(node->keys[slot ? slot : 1]);
+				memmove(node->keys + (slot ? slot : 1), node->keys + (slot ? slot : 1) + 1, sizeof(multi_t) * (node->count - (slot ? slot : 1) - 1));
+			}
+
+			memmove(node->weights + slot, node->weights + slot + 1, sizeof(uint64_t) * (node->count - slot - 1));
+			memmove(node->children + slot, node->children + slot + 1, sizeof(bplus_node_t *) * (node->count - slot - 1));
+			node->count--;
+
+		} while (!node->count && depth);
+
+		while (!bplus->root->leaf && bplus->root->count == 1) {
+			holder = bplus->root;
+			bplus->root = holder->children[0];
+			mm_free(holder);
+		}
+	}
+
+	index->count--;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Calculate the position of a record within a B+tree.
+ * @param	inx		a pointer to the index to be searched.
+ * @param	key		the multi-type key of the record.
+ * @return	0 if the key wasn't found, or the position of the record, starting with 1 for the lowest key.
+ */
+uint64_t bplus_rank(void *inx, multi_t key) {
+
+	uint32_t slot;
+	uint64_t result = 0;
+	inx_t *index = inx;
+	bplus_node_t *node;
+
+	if (index == NULL || index->index == NULL) {
+		return 0;
+	}
+
+	node = ((bplus_index_t *)index->index)->root;
+
+	while (!node->leaf) {
+		slot = bplus_child(node, key);
+		for (uint32_t i = 0; i < slot; i++) {
+			result += node->weights[i];
+		}
+		node = node->children[slot];
+	}
+
+	if ((slot = bplus_lower(node, key)) < node->count && !bplus_compare(node->keys[slot], key)) {
+		return result + slot + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Find a record in a B+tree using its position.
+ * @param	inx			a pointer to the index to be searched.
+ * @param	position	the position of the record, starting with 1 for the lowest key.
+ * @return	NULL if the position is out of range, or the data associated with the record on success.
+ */
+void * bplus_select(void *inx, uint64_t position) {
+
+	uint32_t slot;
+	inx_t *index = inx;
+	bplus_node_t *node;
+
+	if (index == NULL || index->index == NULL || !position || position > index->count) {
+		return NULL;
+	}
+
+	node = ((bplus_index_t *)index->index)->root;
+	position--;
+
+	while (!node->leaf) {
+		for (slot = 0; slot < node->count - 1 && position >= node->weights[slot]; slot++) {
+			position -= node->weights[slot];
+		}
+		node = node->children[slot];
+	}
+
+	return position < node->count ? node->data[position] : NULL;
+}
+
+// Move a cursor onto a record, and keep a copy of the key, so the cursor can find its place again if the tree changes.
+static bplus_node_t * bplus_cursor_land(bplus_cursor_t *cursor, bplus_node_t *node, uint64_t position) {
+
+	cursor->node = node;
+	cursor->position = position;
+	cursor->serial = cursor->inx->serial;
+
+	if (node) {
+		mt_free(cursor->key);
+		cursor->key = mt_dupe(node->keys[position]);
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Make sure a cursor's node pointer is still valid, and find its place again if the tree has changed.
+ * @note	If the record the cursor was on has been removed, the cursor is moved to the following record, which is
+ * 			marked as pending so the next call to advance the cursor returns it instead of skipping over it.
+ * @param	cursor	the cursor to be checked.
+ * @return	NULL if the cursor has run past the last record, or the leaf the cursor is positioned in.
+ */
+static bplus_node_t * bplus_cursor_current(bplus_cursor_t *cursor) {
+
+	uint64_t position;
+	bplus_node_t *node;
+
+	// A cursor without a key started on an empty tree, so any records found now haven't been returned.
+	if (cursor->serial != cursor->inx->serial) {
+		node = bplus_seek(cursor->inx->index, cursor->key, &position);
+
+		if (node && (mt_is_empty(cursor->key) || bplus_compare(node->keys[position], cursor->key))) {
+			cursor->pending = true;
+		}
+
+		bplus_cursor_land(cursor, node, position);
+	}
+
+	return cursor->node;
+}
+
+bplus_node_t * bplus_cursor_start(bplus_cursor_t *cursor) {
+
+	uint64_t position;
+	bplus_node_t *node;
+
+	node = bplus_seek(cursor->inx->index, mt_get_null(), &position);
+	cursor->started = true;
+	cursor->pending = false;
+
+	return bplus_cursor_land(cursor, node, position);
+}
+
+bplus_node_t * bplus_cursor_active(bplus_cursor_t *cursor) {
+
+	if (!cursor->started) {
+		return bplus_cursor_start(cursor);
+	}
+	else if (!bplus_cursor_current(cursor)) {
+		return NULL;
+	}
+
+	cursor->pending = false;
+	return cursor->node;
+}
+
+bplus_node_t * bplus_cursor_next(bplus_cursor_t *cursor) {
+
+	bplus_node_t *node;
+	uint64_t position;
+
+	if (!cursor->started) {
+		return bplus_cursor_start(cursor);
+	}
+	else if (!(node = bplus_cursor_current(cursor))) {
+		return NULL;
+	}
+	else if (cursor->pending) {
+		cursor->pending = false;
+		return node;
+	}
+
+	if ((position = cursor->position + 1) >= node->count) {
+		node = node->next;
+		position = 0;
+	}
+
+	// When the cursor runs off the end of the tree, the last key is retained, so records added later can still be picked up.
+	return bplus_cursor_land(cursor, node, position);
+}
+
+/**
+ * @brief	Position a cursor on the first record whose key is greater than or equal to the provided key.
+ * @note	The record isn't consumed, so the next call to advance the cursor will return it.
+ * @param	cursor	the cursor to be positioned.
+ * @param	key		the key to seek.
+ * @return	true if a record was found, or false if every record sorts before the key.
+ */
+bool_t bplus_cursor_seek(bplus_cursor_t *cursor, multi_t key) {
+
+	uint64_t position;
+	bplus_node_t *node;
+
+	node = bplus_seek(cursor->inx->index, key, &position);
+	cursor->started = true;
+	cursor->pending = true;
+
+	// If nothing was found, hold on to the sought key, so a matching record added later is still returned.
+	if (!bplus_cursor_land(cursor, node, position)) {
+		mt_free(cursor->key);
+		cursor->key = mt_dupe(key);
+	}
+
+	return node != NULL;
+}
+
+void * bplus_cursor_value_next(bplus_cursor_t *cursor) {
+
+	bplus_node_t *node;
+
+	if ((node = bplus_cursor_next(cursor))) {
+		return node->data[cursor->position];
+	}
+	return NULL;
+}
+
+void * bplus_cursor_value_active(bplus_cursor_t *cursor) {
+
+	bplus_node_t *node;
+
+	if ((node = bplus_cursor_active(cursor))) {
+		return node->data[cursor->position];
+	}
+	return NULL;
+}
+
+multi_t bplus_cursor_key_next(bplus_cursor_t *cursor) {
+
+	bplus_node_t *node;
+
+	if ((node = bplus_cursor_next(cursor))) {
+		return node->keys[cursor->position];
+	}
+	return mt_get_null();
+}
+
+multi_t bplus_cursor_key_active(bplus_cursor_t *cursor) {
+
+	bplus_node_t *node;
+
+	if ((node = bplus_cursor_active(cursor))) {
+		return node->keys[cursor->position];
+	}
+	return mt_get_null();
+}
+
+void bplus_cursor_reset(bplus_cursor_t *cursor) {
+
+	if (cursor) {
+		mt_free(cursor->key);
+		cursor->key = mt_get_null();
+		cursor->node = NULL;
+		cursor->started = cursor->pending = false;
+		cursor->serial = cursor->position = 0;
+	}
+
+	return;
+}
+
+void bplus_cursor_free(bplus_cursor_t *cursor) {
+
+	if (cursor) {
+		mt_free(cursor->key);
+		mm_free(cursor);
+	}
+
+	return;
+}
+
+void * bplus_cursor_alloc(inx_t *inx) {
+
+	bplus_cursor_t *cursor;
+
+	if (!(cursor = mm_alloc(sizeof(bplus_cursor_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a B+tree cursor.", sizeof(bplus_cursor_t));
+		return NULL;
+	}
+
+	cursor->inx = inx;
+	cursor->key = mt_get_null();
+
+	return cursor;
+}
+
+/**
+ * @brief	Remove every record from a B+tree, leaving an empty root leaf in place.
+ * @param	inx		a pointer to the index to be truncated.
+ * @return	This function returns no value.
+ */
+void bplus_truncate(void *inx) {
+
+	inx_t *index = inx;
+	bplus_index_t *bplus;
+	bplus_node_t *root;
+
+	if (index == NULL || index->index == NULL || !(root = bplus_node_alloc(true))) {
+		return;
+	}
+
+	bplus = index->index;
+	bplus_node_free(index, bplus->root);
+	bplus->root = root;
+
+	index->count = 0;
+	index->serial++;
+	return;
+}
+
+void bplus_free(void *inx) {
+
+	inx_t *index = inx;
+	bplus_index_t *bplus;
+
+	if (index == NULL || index->index == NULL) {
+		return;
+	}
+
+	bplus = index->index;
+	bplus_node_free(index, bplus->root);
+	mm_free(bplus);
+
+	index->index = NULL;
+	return;
+}
+
+/**
+ * @brief	Allocate a new B+tree.
+ * @param	options		an options value for the tree.
+ * @param	data_free	a pointer to the function used to free the data associated with a record.
+ * @return	NULL on failure, or a pointer to the newly allocated B+tree object on success.
+ */
+inx_t * bplus_alloc(uint64_t options, void *data_free) {
+
+	inx_t *result;
+	bplus_index_t *bplus;
+
+	if ((result = mm_alloc(sizeof(inx_t))) == NULL) {
+		return NULL;
+	}
+	else if (!(bplus = mm_alloc(sizeof(bplus_index_t))) || !(bplus->root = bplus_node_alloc(true))) {
+		log_pedantic("Failed to allocate the root of a B+tree.");
+		if (bplus) mm_free(bplus);
+		mm_free(result);
+		return NULL;
+	}
+
+	result->index = bplus;
+	result->options = options;
+	result->data_free = data_free;
+	result->index_free = bplus_free;
+	result->index_truncate = bplus_truncate;
+
+	result->find = bplus_find;
+	result->insert = bplus_insert;
+	result->delete = bplus_delete;
+	result->rank = bplus_rank;
+	result->select = bplus_select;
+
+	result->cursor_free = (void (*)(void *))&bplus_cursor_free;
+	result->cursor_reset = (void (*)(void *))&bplus_cursor_reset;
+	result->cursor_alloc = (void * (*)(void *))&bplus_cursor_alloc;
+	result->cursor_seek = (bool_t (*)(void *, multi_t))&bplus_cursor_seek;
+
+	result->cursor_key_next = (multi_t (*)(void *))&bplus_cursor_key_next;
+	result->cursor_key_active = (multi_t (*)(void *))&bplus_cursor_key_active;
+
+	result->cursor_value_next = (void * (*)(void *))&bplus_cursor_value_next;
+	result->cursor_value_active = (void * (*)(void *))&bplus_cursor_value_active;
+
+	return result;
+}
@@ -71,6 +71,26 @@ inx_cursor_t * inx_cursor_alloc(inx_t *index) {
 	return cursor;
 }
 
+/**
+ * @brief	Position an inx cursor on the first record with a key greater than or equal to the provided key.
+ * @note	Only the B+tree index supports this operation. The record isn't consumed, so it will be returned by the next call to advance the cursor.
+ * @param	cursor	the inx cursor to be positioned.
+ * @param	key		the key to seek.
+ * @return	true if a matching record was found, or false on failure or if every record sorts before the key.
+ */
+bool_t inx_cursor_seek(inx_cursor_t *cursor, multi_t key) {
+
+	bool_t result = false;
+
+	if (cursor && cursor->inx && cursor->inx->cursor_seek) {
+		inx_auto_read(cursor->inx);
+		result = cursor->inx->cursor_seek(cursor, key);
+		inx_auto_unlock(cursor->inx);
+	}
+
+	return result;
+}
+
 /**
  * @brief	Get the key at the next inx cursor position.
  * @param	cursor	the inx cursor to be examined.
@@ -23,13 +23,15 @@ typedef enum {
 	M_INX_LINKED = 4, //!< M_INX_LINKED
 	//M_INX_ALLOW_DUPE = 8, //!< M_INX_ALLOW_DUPE
 	M_INX_LOCK_MANUAL = 16, //!< M_INX_LOCK_MANUAL
+	M_INX_PROBED = 32, //!< M_INX_PROBED
+	M_INX_BPLUS = 64, //!< M_INX_BPLUS
 
 } MAGMA_INDEX;
 
 /**
  * The different types of indexes.
  */
-#define MAGMA_INDEX_TYPE (M_INX_TREE | M_INX_LINKED | M_INX_HASHED)
+#define MAGMA_INDEX_TYPE (M_INX_TREE | M_INX_LINKED | M_INX_HASHED | M_INX_PROBED | M_INX_BPLUS)
 
 /**
  * The different index options.
@@ -53,9 +55,14 @@ typedef struct {
 
 	void * (*find)(void *index, multi_t envelope);
 
+	// Optional, only provided by the ordered indexes.
+	uint64_t (*rank)(void *index, multi_t envelope);
+	void * (*select)(void *index, uint64_t position);
+
 	void (*cursor_free)(void *cursor);
 	void (*cursor_reset)(void *cursor);
 	void * (*cursor_alloc)(void *index);
+	bool_t (*cursor_seek)(void *cursor, multi_t envelope);
 
 	void * (*cursor_value_next)(void *cursor);
 	void * (*cursor_value_active)(void *cursor);
@@ -75,6 +82,7 @@ void            inx_cursor_free(inx_cursor_t *cursor);
 multi_t         inx_cursor_key_active(inx_cursor_t *cursor);
 multi_t         inx_cursor_key_next(inx_cursor_t *cursor);
 void            inx_cursor_reset(inx_cursor_t *cursor);
+bool_t          inx_cursor_seek(inx_cursor_t *cursor, multi_t key);
 void *          inx_cursor_value_active(inx_cursor_t *cursor);
 void *          inx_cursor_value_next(inx_cursor_t *cursor);
 
@@ -92,15 +100,23 @@ bool_t     inx_insert(inx_t *inx, multi_t key, void *data);
 void       inx_lock_read(inx_t *inx);
 void       inx_lock_write(inx_t *inx);
 uint64_t   inx_options(inx_t *inx);
+uint64_t   inx_rank(inx_t *inx, multi_t key);
 bool_t     inx_replace(inx_t *inx, multi_t key, void *data);
+void *     inx_select(inx_t *inx, uint64_t position);
 uint64_t   inx_serial(inx_t *inx);
 void       inx_truncate(inx_t *inx);
 void       inx_unlock(inx_t *inx);
 
+/// bplus.c
+inx_t * bplus_alloc(uint64_t options, void *data_free);
+
 /// linked.c
 inx_t * linked_alloc(uint64_t options, void *data_free);
 
 /// hashed.c
 inx_t * hashed_alloc(uint64_t options, void *data_free);
 
+/// probed.c
+inx_t * probed_alloc(uint64_t options, void *data_free);
+
 #endif
@@ -236,6 +236,52 @@ void * inx_find(inx_t *inx, multi_t key) {
 	return result;
 }
 
+/**
+ * @brief	Find the position of a record within an ordered inx object.
+ * @note	Only the B+tree index supports this operation.
+ * @param	inx		a pointer to the inx object to be searched.
+ * @param	key		the key of the record to be located.
+ * @return	0 if the key wasn't found or the index isn't ordered, or the position of the record, starting from 1, on success.
+ */
+uint64_t inx_rank(inx_t *inx, multi_t key) {
+
+	uint64_t result;
+
+	if (!inx || !(inx->rank)) {
+		log_pedantic("Invalid index or function pointer.");
+		return 0;
+	}
+
+	inx_auto_read(inx);
+	result = inx->rank(inx, key);
+	inx_auto_unlock(inx);
+
+	return result;
+}
+
+/**
+ * @brief	Find the record held at a given position within an ordered inx object.
+ * @note	Only the B+tree index supports this operation.
+ * @param	inx			a pointer to the inx object to be searched.
+ * @param	position	the position of the record, starting from 1.
+ * @return	NULL on failure, or the value associated with the record at the requested position on success.
+ */
+void * inx_select(inx_t *inx, uint64_t position) {
+
+	void *result;
+
+	if (!inx || !(inx->select)) {
+		log_pedantic("Invalid index or function pointer.");
+		return NULL;
+	}
+
+	inx_auto_read(inx);
+	result = inx->select(inx, position);
+	inx_auto_unlock(inx);
+
+	return result;
+}
+
 void inx_free(inx_t *inx) {
 
 	uint64_t refs;
@@ -291,7 +337,8 @@ void inx_cleanup(inx_t *inx) {
 
 /**
  * @brief	Allocate a new inx instance.
- * @param	options	 	a value indicating the inx type. Can be M_INX_TREE for a binary tree, M_INX_LINKED for a linked list, or M_INX_HASHED for a hash tree.
+ * @param	options	 	a value indicating the inx type. Can be M_INX_TREE for a binary tree, M_INX_LINKED for a linked list,
+ * 						M_INX_HASHED for a hash tree, M_INX_PROBED for an open addressing hash table, or M_INX_BPLUS for an ordered B+tree.
  * @param	data_free	a function pointer to a routine to free the data associated with an inx record.
  * @return	NULL on failure or a pointer to the newly created inx object on success.
  */
@@ -309,6 +356,12 @@ inx_t * inx_alloc(uint64_t options, void *data_free) {
 	case M_INX_HASHED:
 		inx = hashed_alloc(options, data_free);
 		break;
+	case M_INX_PROBED:
+		inx = probed_alloc(options, data_free);
+		break;
+	case M_INX_BPLUS:
+		inx = bplus_alloc(options, data_free);
+		break;
 	default:
 		log_options(M_LOG_ERROR | M_LOG_STACK_TRACE, "Unsupported index type detected. {type = %lu}", options & MAGMA_INDEX_TYPE);
 		break;
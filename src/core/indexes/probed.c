@@ -0,0 +1,577 @@
+
+/**
+ * @file /magma/core/indexes/probed.c
+ *
+ * @brief	An open addressing hash table that grows as records are added.
+ *
+ * Records are stored in a flat slot array, with a parallel array of control bytes. A control byte is either empty, deleted, or holds
+ * the low seven bits of the record's hash. Slots are probed in groups of sixteen, so a single SSE2 compare can test a whole group of
+ * control bytes against the hash fragment we're looking for, and the full key comparison is only performed on likely matches.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+#define PROBED_GROUP 16
+#define PROBED_CAPACITY 64
+
+#define PROBED_EMPTY 0x80
+#define PROBED_DELETED 0xFE
+
+#define PROBED_FULL(c) (((c) & 0x80) == 0)
+
+typedef struct {
+	void *data;
+	multi_t key;
+	uint64_t hash;
+} probed_slot_t;
+
+typedef struct {
+	uint8_t *control;
+	probed_slot_t *slots;
+	uint64_t capacity, used, deleted, generation;
+} probed_index_t;
+
+typedef struct {
+	inx_t *inx;
+	void *data;
+	bool_t started;
+	uint64_t generation, position, hash;
+} __attribute__((__packed__)) probed_cursor_t;
+
+/**
+ * @brief	Calculate the hash value for an index key.
+ * @note	Numbers are run through the MurmurHash3 finalizer, and strings are hashed using the 64-bit Murmur hash.
+ * @param	key		a multi-type key with the value to be hashed; numbers and strings are supported.
+ * @return	the 64-bit hash value for the specified key.
+ */
+static uint64_t probed_hash(multi_t key) {
+
+	uint64_t result;
+
+	if (mt_is_number(key)) {
+		result = mt_get_number(key);
+		result ^= result >> 33;
+		result *= 0xff51afd7ed558ccdULL;
+		result ^= result >> 33;
+		result *= 0xc4ceb9fe1a85ec53ULL;
+		result ^= result >> 33;
+	}
+	else {
+		result = hash_murmur64(mt_get_char(key), mt_get_length(key));
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Find the slots in a group whose control byte matches a value.
+ * @param	control		a pointer to the first control byte in the group.
+ * @param	value		the control byte value to be matched.
+ * @return	a bitmask with one bit set for every matching slot in the group.
+ */
+static uint32_t probed_match(uint8_t *control, uint8_t value) {
+
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)control), _mm_set1_epi8((chr_t)value)));
+#else
+	uint32_t result = 0;
+
+	for (int_t i = 0; i < PROBED_GROUP; i++) {
+		if (control[i] == value) {
+			result |= (1 << i);
+		}
+	}
+
+	return result;
+#endif
+}
+
+/**
+ * @brief	Find the slot holding a record.
+ * @note	Groups are probed using triangular steps, which visit every group exactly once because the number of groups is a power of two.
+ * 			If a data pointer is provided, the record is matched using the hash and data pointer, otherwise the key is compared.
+ * @param	probed	the probed index to be searched.
+ * @param	hash	the hash value of the record.
+ * @param	key		the key of the record, which is only used when no data pointer is provided.
+ * @param	data	if not NULL, the data pointer of the record.
+ * @return	-1 if no matching record was found, or the slot number of the record on success.
+ */
+static int64_t probed_locate(probed_index_t *probed, uint64_t hash, multi_t key, void *data) {
+
+	probed_slot_t *slot;
+	uint32_t match, offset;
+	uint64_t groups = probed->capacity / PROBED_GROUP, group = (hash >> 7) & (groups - 1);
+
+	for (uint64_t step = 1; step <= groups; step++) {
+
+		match = probed_match(probed->control + (group * PROBED_GROUP), hash & 0x7F);
+
+		while (match) {
+			offset = __builtin_ctz(match);
+			slot = &(probed->slots[(group * PROBED_GROUP) + offset]);
+
+			if (slot->hash == hash && (data ? slot->data == data : ident_mt_mt(slot->key, key))) {
+				return (group * PROBED_GROUP) + offset;
+			}
+
+			match &= match - 1;
+		}
+
+		// An empty slot ends the probe sequence, since an insert would have used it.
+		if (probed_match(probed->control + (group * PROBED_GROUP), PROBED_EMPTY)) {
+			return -1;
+		}
+
+		group = (group + step) & (groups - 1);
+	}
+
+	return -1;
+}
+
+/**
+ * @brief	Find the first empty or deleted slot along the probe sequence for a hash value.
+ * @param	probed	the probed index to be searched.
+ * @param	hash	the hash value of the record being placed.
+ * @return	the slot number of the first available slot.
+ */
+static uint64_t probed_vacant(probed_index_t *probed, uint64_t hash) {
+
+	uint32_t match;
+	uint64_t groups = probed->capacity / PROBED_GROUP, group = (hash >> 7) & (groups - 1);
+
+	// Deleted slots are the only control bytes besides empty with the high bit set.
+	for (uint64_t step = 1; !(match = probed_match(probed->control + (group * PROBED_GROUP), PROBED_EMPTY) |
+		probed_match(probed->control + (group * PROBED_GROUP), PROBED_DELETED)); step++) {
+		group = (group + step) & (groups - 1);
+	}
+
+	return (group * PROBED_GROUP) + __builtin_ctz(match);
+}
+
+/**
+ * @brief	Move every record in a probed index into a freshly allocated table.
+ * @note	This is also used to purge deleted slots without growing the table, which is why the capacity may match the current size.
+ * @param	probed		the probed index to be resized.
+ * @param	capacity	the number of slots in the new table, which must be a power of two.
+ * @return	true on success, or false if the new table couldn't be allocated.
+ */
+static bool_t probed_resize(probed_index_t *probed, uint64_t capacity) {
+
+	uint64_t position;
+	uint8_t *control;
+	probed_slot_t *slots;
+	probed_index_t holder = { .capacity = capacity };
+
+	if (!(control = mm_alloc(capacity)) || !(slots = mm_alloc(capacity * sizeof(probed_slot_t)))) {
+		log_pedantic("Failed to allocate %lu slots for a probed index.", capacity);
+		if (control) mm_free(control);
+		return false;
+	}
+
+	memset(control, PROBED_EMPTY, capacity);
+	holder.control = control;
+	holder.slots = slots;
+
+	for (uint64_t i = 0; i < probed->capacity; i++) {
+		if (PROBED_FULL(probed->control[i])) {
+			position = probed_vacant(&holder, probed->slots[i].hash);
+			control[position] = probed->control[i];
+			mm_copy(&(slots[position]), &(probed->slots[i]), sizeof(probed_slot_t));
+		}
+	}
+
+	mm_free(probed->control);
+	mm_free(probed->slots);
+
+	probed->control = control;
+	probed->slots = slots;
+	probed->capacity = capacity;
+	probed->deleted = 0;
+	probed->generation++;
+
+	return true;
+}
+
+/**
+ * @brief	Add a record to a probed index.
+ * @note	The table is rebuilt once live and deleted slots fill seven eighths of it. If deleted slots account for most of that load
+ * 			the table is rebuilt at the same size, otherwise its capacity is doubled.
+ * @param	inx		a pointer to the index that will hold the record.
+ * @param	key		a multi-type key for the new record; duplicate keys are rejected.
+ * @param	data	a pointer to the data associated with the key.
+ * @return	true if the record was added, or false if the key already exists or an error occurred.
+ */
+bool_t probed_insert(void *inx, multi_t key, void *data) {
+
+	uint64_t hash, position;
+	inx_t *index = inx;
+	probed_index_t *probed;
+
+	if (index == NULL || index->index == NULL) {
+		return false;
+	}
+
+	probed = index->index;
+	hash = probed_hash(key);
+
+	if (probed_locate(probed, hash, key, NULL) != -1) {
+		return false;
+	}
+
+	if ((probed->used + probed->deleted + 1) > (probed->capacity - (probed->capacity / 8)) &&
+		!probed_resize(probed, (probed->used + 1) > (probed->capacity / 2) ? probed->capacity * 2 : probed->capacity)) {
+		return false;
+	}
+
+	position = probed_vacant(probed, hash);
+
+	if (probed->control[position] == PROBED_DELETED) {
+		probed->deleted--;
+	}
+
+	probed->control[position] = hash & 0x7F;
+	probed->slots[position].key = mt_dupe(key);
+	probed->slots[position].hash = hash;
+	probed->slots[position].data = data;
+	probed->used++;
+
+	index->count++;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Find the data associated with a key in a probed index.
+ * @param	inx		a pointer to the index to be searched.
+ * @param	key		a multi-type key with the value to be looked up.
+ * @return	NULL if the key wasn't found, or the data associated with the key on success.
+ */
+void * probed_find(void *inx, multi_t key) {
+
+	int64_t position;
+	inx_t *index = inx;
+	probed_index_t *probed;
+
+	if (index == NULL || index->index == NULL) {
+		return NULL;
+	}
+
+	probed = index->index;
+
+	if ((position = probed_locate(probed, probed_hash(key), key, NULL)) == -1) {
+		return NULL;
+	}
+
+	return probed->slots[position].data;
+}
+
+/**
+ * @brief	Remove a record from a probed index.
+ * @note	If the slot's group still has an empty slot, no probe sequence can pass through the group, so the slot is simply marked empty.
+ * 			Otherwise it's marked deleted so later probes continue on to the next group.
+ * @param	inx		a pointer to the index holding the record.
+ * @param	key		the multi-type key of the record to be removed.
+ * @return	true if the record was found and removed, or false otherwise.
+ */
+bool_t probed_delete(void *inx, multi_t key) {
+
+	int64_t position;
+	inx_t *index = inx;
+	probed_index_t *probed;
+
+	if (index == NULL || index->index == NULL) {
+		return false;
+	}
+
+	probed = index->index;
+
+	if ((position = probed_locate(probed, probed_hash(key), key, NULL)) == -1) {
+		return false;
+	}
+
+	if (probed->slots[position].data && index->data_free) {
+		index->data_free(probed->slots[position].data);
+	}
+
+	mt_free(probed->slots[position].key);
+	mm_wipe(&(probed->slots[position]), sizeof(probed_slot_t));
+
+	if (probed_match(probed->control + (position & ~((uint64_t)PROBED_GROUP - 1)), PROBED_EMPTY)) {
+		probed->control[position] = PROBED_EMPTY;
+	}
+	else {
+		probed->control[position] = PROBED_DELETED;
+		probed->deleted++;
+	}
+
+	probed->used--;
+	index->count--;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Position a cursor on the first occupied slot at or after a given slot.
+ * @param	cursor		the cursor to be positioned.
+ * @param	position	the slot number where the scan begins.
+ * @return	NULL if there are no more records, or a pointer to the slot the cursor now points at.
+ */
+static probed_slot_t * probed_cursor_seek(probed_cursor_t *cursor, uint64_t position) {
+
+	probed_index_t *probed = cursor->inx->index;
+
+	cursor->started = true;
+	cursor->generation = probed->generation;
+
+	for (; position < probed->capacity; position++) {
+		if (PROBED_FULL(probed->control[position])) {
+			cursor->position = position;
+			cursor->hash = probed->slots[position].hash;
+			cursor->data = probed->slots[position].data;
+			return &(probed->slots[position]);
+		}
+	}
+
+	cursor->data = NULL;
+	cursor->position = probed->capacity;
+	return NULL;
+}
+
+/**
+ * @brief	Get the slot a cursor points at, if the record it was positioned on still exists.
+ * @note	If the table has been rebuilt since the cursor was positioned, the record is found again using its hash and data pointer.
+ * 			Records in a rebuilt table are stored in a different order, so iterating across an insert may skip or repeat records.
+ * @param	cursor	the cursor to be checked.
+ * @return	NULL if the cursor isn't positioned on a live record, or a pointer to the record's slot on success.
+ */
+static probed_slot_t * probed_cursor_current(probed_cursor_t *cursor) {
+
+	int64_t position;
+	probed_index_t *probed = cursor->inx->index;
+
+	if (!cursor->started) {
+		return NULL;
+	}
+	else if (cursor->generation != probed->generation) {
+
+		// Records without a data pointer can't be told apart after a rebuild.
+		if (!cursor->data || (position = probed_locate(probed, cursor->hash, mt_get_null(), cursor->data)) == -1) {
+			return NULL;
+		}
+		cursor->position = position;
+		cursor->generation = probed->generation;
+	}
+	else if (cursor->position >= probed->capacity || !PROBED_FULL(probed->control[cursor->position]) ||
+		probed->slots[cursor->position].data != cursor->data) {
+		return NULL;
+	}
+
+	return &(probed->slots[cursor->position]);
+}
+
+probed_slot_t * probed_cursor_active(probed_cursor_t *cursor) {
+
+	probed_slot_t *slot;
+
+	if (!(slot = probed_cursor_current(cursor))) {
+		slot = probed_cursor_seek(cursor, cursor->started ? cursor->position : 0);
+	}
+
+	return slot;
+}
+
+probed_slot_t * probed_cursor_next(probed_cursor_t *cursor) {
+
+	// If the active record was removed, the scan picks up from its old slot.
+	if (!cursor->started) {
+		return probed_cursor_seek(cursor, 0);
+	}
+	else if (probed_cursor_current(cursor)) {
+		return probed_cursor_seek(cursor, cursor->position + 1);
+	}
+
+	return probed_cursor_seek(cursor, cursor->position);
+}
+
+void * probed_cursor_value_next(probed_cursor_t *cursor) {
+
+	probed_slot_t *slot;
+
+	if ((slot = probed_cursor_next(cursor))) {
+		return slot->data;
+	}
+	return NULL;
+}
+
+void * probed_cursor_value_active(probed_cursor_t *cursor) {
+
+	probed_slot_t *slot;
+
+	if ((slot = probed_cursor_active(cursor))) {
+		return slot->data;
+	}
+	return NULL;
+}
+
+multi_t probed_cursor_key_next(probed_cursor_t *cursor) {
+
+	probed_slot_t *slot;
+
+	if ((slot = probed_cursor_next(cursor))) {
+		return slot->key;
+	}
+	return mt_get_null();
+}
+
+multi_t probed_cursor_key_active(probed_cursor_t *cursor) {
+
+	probed_slot_t *slot;
+
+	if ((slot = probed_cursor_active(cursor))) {
+		return slot->key;
+	}
+	return mt_get_null();
+}
+
+void probed_cursor_reset(probed_cursor_t *cursor) {
+
+	if (cursor) {
+		cursor->data = NULL;
+		cursor->started = false;
+		cursor->generation = cursor->position = cursor->hash = 0;
+	}
+
+	return;
+}
+
+void probed_cursor_free(probed_cursor_t *cursor) {
+
+	if (cursor) {
+		mm_free(cursor);
+	}
+
+	return;
+}
+
+void * probed_cursor_alloc(inx_t *inx) {
+
+	probed_cursor_t *cursor;
+
+	if (!(cursor = mm_alloc(sizeof(probed_cursor_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a probed index cursor.", sizeof(probed_cursor_t));
+		return NULL;
+	}
+
+	cursor->inx = inx;
+
+	return cursor;
+}
+
+/**
+ * @brief	Remove every record from a probed index, while keeping the table allocated.
+ * @param	inx		a pointer to the index to be truncated.
+ * @return	This function returns no value.
+ */
+void probed_truncate(void *inx) {
+
+	inx_t *index = inx;
+	probed_index_t *probed;
+
+	if (index == NULL || index->index == NULL) {
+		return;
+	}
+
+	probed = index->index;
+
+	for (uint64_t i = 0; i < probed->capacity; i++) {
+		if (PROBED_FULL(probed->control[i])) {
+			if (probed->slots[i].data && index->data_free) {
+				index->data_free(probed->slots[i].data);
+			}
+			mt_free(probed->slots[i].key);
+		}
+	}
+
+	memset(probed->control, PROBED_EMPTY, probed->capacity);
+	mm_wipe(probed->slots, probed->capacity * sizeof(probed_slot_t));
+	probed->used = probed->deleted = 0;
+	probed->generation++;
+
+	index->count = 0;
+	index->serial++;
+	return;
+}
+
+void probed_free(void *inx) {
+
+	inx_t *index = inx;
+	probed_index_t *probed;
+
+	if (index == NULL || index->index == NULL) {
+		return;
+	}
+
+	probed = index->index;
+	probed_truncate(inx);
+
+	mm_free(probed->control);
+	mm_free(probed->slots);
+	mm_free(probed);
+
+	index->index = NULL;
+	return;
+}
+
+/**
+ * @brief	Allocate a new open addressing hash table.
+ * @param	options		an options value for the hash table.
+ * @param	data_free	a pointer to the function used to free the data associated with a record.
+ * @return	NULL on failure, or a pointer to the newly allocated hash table object on success.
+ */
+inx_t * probed_alloc(uint64_t options, void *data_free) {
+
+	inx_t *result;
+	probed_index_t *probed;
+
+	if ((result = mm_alloc(sizeof(inx_t))) == NULL) {
+		return NULL;
+	}
+	else if (!(probed = mm_alloc(sizeof(probed_index_t))) || !(probed->control = mm_alloc(PROBED_CAPACITY)) ||
+		!(probed->slots = mm_alloc(PROBED_CAPACITY * sizeof(probed_slot_t)))) {
+		log_pedantic("Failed to allocate the initial slots for a probed index.");
+		if (probed && probed->control) mm_free(probed->control);
+		if (probed) mm_free(probed);
+		mm_free(result);
+		return NULL;
+	}
+
+	memset(probed->control, PROBED_EMPTY, PROBED_CAPACITY);
+	probed->capacity = PROBED_CAPACITY;
+
+	result->index = probed;
+	result->options = options;
+	result->data_free = data_free;
+	result->index_free = probed_free;
+	result->index_truncate = probed_truncate;
+
+	result->find = probed_find;
+	result->insert = probed_insert;
+	result->delete = probed_delete;
+
+	result->cursor_free = (void (*)(void *))&probed_cursor_free;
+	result->cursor_reset = (void (*)(void *))&probed_cursor_reset;
+	result->cursor_alloc = (void * (*)(void *))&probed_cursor_alloc;
+
+	result->cursor_key_next = (multi_t (*)(void *))&probed_cursor_key_next;
+	result->cursor_key_active = (multi_t (*)(void *))&probed_cursor_key_active;
+
+	result->cursor_value_next = (void * (*)(void *))&probed_cursor_value_next;
+	result->cursor_value_active = (void * (*)(void *))&probed_cursor_value_active;
+
+	return result;
+}
@@ -16,6 +16,31 @@ uint64_t log_date;
 bool_t log_enabled = true;
 pthread_mutex_t log_mutex =	PTHREAD_MUTEX_INITIALIZER;
 
+typedef struct {
+	uint64_t sequence; /* Equals the queue position while the slot is empty, and the position plus one once the entry is ready to be written. */
+	size_t length; /* The length of the entry. */
+	chr_t *spill; /* Entries too long for the slot are stored in a separate buffer, which is released by the writer. */
+	chr_t data[MAGMA_LOG_SLOT_LENGTH];
+} log_slot_t;
+
+struct {
+	sem_t pending;
+	pthread_t writer;
+	log_slot_t *slots;
+	bool_t active, running;
+	uint64_t mask, producers, written, dropped, stalled;
+	uint64_t enqueue __attribute__ ((aligned (64)));
+	uint64_t dequeue __attribute__ ((aligned (64)));
+} log_queue = {
+		.slots = NULL,
+		.active = false,
+		.running = false
+};
+
+// Entries are formatted into a thread local buffer before being handed to the writer, so producers only hold a queue slot long
+// enough to copy the finished entry.
+static __thread chr_t log_buffer[MAGMA_LOG_BUFFER_LENGTH];
+
 /**
  * @brief	Disable logging.
  * @return	This function returns no value.
@@ -98,56 +123,343 @@ int_t print_backtrace() {
 }
 
 /**
- * Logs the message provided by @a format. The global configuration dictates whether the @a file, @a function and
- * @a line are also logged. The global configuration can be overridden on a per call basis using the @a options
- * parameter.
+ * @brief	Build the bracketed prefix which precedes a log entry.
+ * @param	buffer		the buffer which will receive the prefix.
+ * @param	length		the length of the buffer.
+ * @param	file		the source file which recorded the entry.
+ * @param	function	the function which recorded the entry.
+ * @param	line		the source line which recorded the entry.
+ * @param	options		the options passed to log_internal().
+ * @return	the length of the prefix, which will be zero if none of the prefix fields are enabled.
  */
-void log_internal(const char *file, const char *function, const int line, M_LOG_OPTIONS options, const char *format, ...) {
+static size_t log_prefix(chr_t *buffer, size_t length, const char *file, const char *function, const int line, M_LOG_OPTIONS options) {
 
 	time_t now;
-//	size_t size;
-	va_list args;
 	struct tm local;
-//	void *array[1024];
+	chr_t stamp[128];
+	size_t used = 0;
 	bool_t output = false;
-	char /***strings = NULL, */buffer[128], *errmsg;
-
-	va_start(args, format);
-
-	mutex_lock(&log_mutex);
-
-	// Someone has disabled the log output.
-	if (!log_enabled) {
-		mutex_unlock(&log_mutex);
-		return;
-	}
 
 	if ((magma.log.time || M_LOG_TIME == (options & M_LOG_TIME)) && !(M_LOG_TIME_DISABLE == (options & M_LOG_TIME_DISABLE))) {
 		now = time(NULL);
 		localtime_r(&now, &local);
-		strftime(buffer, 128, "%T", &local);
+		strftime(stamp, 128, "%T", &local);
 
-		fprintf(stdout, "%s%s", (output ? " - " : "["), buffer);
+		used += snprintf(buffer + used, length - used, "%s%s", (output ? " - " : "["), stamp);
 		output = true;
 	}
 
-	if ((magma.log.file || M_LOG_FILE == (options & M_LOG_FILE)) && !(M_LOG_FILE_DISABLE == (options & M_LOG_FILE_DISABLE))) {
-		fprintf(stdout, "%s%s", (output ? " - " : "["), file);
+	if (used < length && (magma.log.file || M_LOG_FILE == (options & M_LOG_FILE)) && !(M_LOG_FILE_DISABLE == (options & M_LOG_FILE_DISABLE))) {
+		used += snprintf(buffer + used, length - used, "%s%s", (output ? " - " : "["), file);
 		output = true;
 	}
 
-	if ((magma.log.function || M_LOG_FUNCTION == (options & M_LOG_FUNCTION)) && !(M_LOG_FUNCTION_DISABLE == (options & M_LOG_FUNCTION_DISABLE))) {
-		fprintf(stdout, "%s%s%s", (output ? " - " : "["), function, "()");
+	if (used < length && (magma.log.function || M_LOG_FUNCTION == (options & M_LOG_FUNCTION)) && !(M_LOG_FUNCTION_DISABLE == (options & M_LOG_FUNCTION_DISABLE))) {
+		used += snprintf(buffer + used, length - used, "%s%s%s", (output ? " - " : "["), function, "()");
 		output = true;
 	}
 
-	if ((magma.log.line || M_LOG_LINE == (options & M_LOG_LINE)) && !(M_LOG_LINE_DISABLE == (options & M_LOG_LINE_DISABLE))) {
-		fprintf(stdout, "%s%i", (output ? " - " : "["), line);
+	if (used < length && (magma.log.line || M_LOG_LINE == (options & M_LOG_LINE)) && !(M_LOG_LINE_DISABLE == (options & M_LOG_LINE_DISABLE))) {
+		used += snprintf(buffer + used, length - used, "%s%i", (output ? " - " : "["), line);
 		output = true;
 	}
 
-	if (output)
-		fprintf(stdout, "] = ");
+	if (used < length && output) {
+		used += snprintf(buffer + used, length - used, "] = ");
+	}
+
+	return used < length ? used : length - 1;
+}
+
+/**
+ * @brief	Format a log entry and place it on the queue serviced by the writer thread.
+ * @note	If the queue is full, the entry is either dropped, or the caller spins until the writer frees a slot, depending on the
+ * 			magma.output.drop setting. Both outcomes are counted.
+ * @param	file		the source file which recorded the entry.
+ * @param	function	the function which recorded the entry.
+ * @param	line		the source line which recorded the entry.
+ * @param	options		the options passed to log_internal().
+ * @param	format		the format string for the entry.
+ * @param	args		the arguments for the format string.
+ * @return	This function returns no value.
+ */
+static void log_enqueue(const char *file, const char *function, const int line, M_LOG_OPTIONS options, const char *format, va_list args) {
+
+	int_t written;
+	va_list copy;
+	log_slot_t *slot;
+	bool_t stalled = false;
+	size_t prefix, length;
+	uint64_t position, sequence;
+	chr_t *entry = log_buffer, *spill = NULL;
+
+	prefix = log_prefix(log_buffer, MAGMA_LOG_BUFFER_LENGTH, file, function, line, options);
+
+	va_copy(copy, args);
+	written = vsnprintf(log_buffer + prefix, MAGMA_LOG_BUFFER_LENGTH - prefix, format, copy);
+	va_end(copy);
+
+	if (written < 0) {
+		return;
+	}
+
+	// Leave room for the line feed. Entries which don't fit inside the thread buffer are formatted again into a buffer large enough to hold them.
+	length = prefix + written + 1;
+
+	if (length >= MAGMA_LOG_BUFFER_LENGTH && (spill = mm_alloc(length + 1))) {
+		mm_copy(spill, log_buffer, prefix);
+		vsnprintf(spill + prefix, length + 1 - prefix, format, args);
+		entry = spill;
+	}
+	else if (length >= MAGMA_LOG_BUFFER_LENGTH) {
+		length = MAGMA_LOG_BUFFER_LENGTH - 1;
+	}
+
+	if (!(M_LOG_LINE_FEED_DISABLE == (options & M_LOG_LINE_FEED_DISABLE))) {
+		entry[length - 1] = '\n';
+	}
+	else {
+		length--;
+	}
+
+	// Reserve a slot. A slot is free when its sequence matches the position being claimed, and a smaller sequence means the
+	// writer hasn't caught up yet, so the queue is full.
+	do {
+
+		position = *((volatile uint64_t *)&(log_queue.enqueue));
+		slot = log_queue.slots + (position & log_queue.mask);
+		sequence = ((volatile log_slot_t *)slot)->sequence;
+
+		if (sequence == position && __sync_bool_compare_and_swap(&(log_queue.enqueue), position, position + 1)) {
+			break;
+		}
+		else if (sequence < position && magma.output.drop) {
+			__sync_fetch_and_add(&(log_queue.dropped), 1);
+			mm_free(spill);
+			return;
+		}
+		else if (sequence < position) {
+
+			if (!stalled) {
+				__sync_fetch_and_add(&(log_queue.stalled), 1);
+				stalled = true;
+			}
+
+			sched_yield();
+		}
+
+	} while (true);
+
+	if (length > MAGMA_LOG_SLOT_LENGTH && !spill && (spill = mm_alloc(length))) {
+		mm_copy(spill, entry, length);
+		entry = spill;
+	}
+	else if (length > MAGMA_LOG_SLOT_LENGTH && !spill) {
+		length = MAGMA_LOG_SLOT_LENGTH;
+		entry[length - 1] = '\n';
+	}
+
+	if (spill) {
+		slot->spill = spill;
+	}
+	else {
+		mm_copy(slot->data, entry, length);
+		slot->spill = NULL;
+	}
+
+	slot->length = length;
+
+	// Publish the entry, then wake the writer.
+	__sync_synchronize();
+	slot->sequence = position + 1;
+	sem_post(&(log_queue.pending));
+
+	return;
+}
+
+/**
+ * @brief	Write the entries waiting on the log queue to the output file.
+ * @note	Runs of contiguous entries are gathered into a single writev() call, and the log mutex is held while writing so the output
+ * 			file can't be rotated out from under the writer.
+ * @return	the number of entries written.
+ */
+static uint64_t log_drain(void) {
+
+	ssize_t written;
+	log_slot_t *slot;
+	struct iovec vector[MAGMA_LOG_BATCH], *current;
+	uint64_t position = log_queue.dequeue, count = 0, total = 0;
+
+	do {
+
+		// Collect the entries that are ready.
+		for (count = 0; count < MAGMA_LOG_BATCH; count++) {
+
+			slot = log_queue.slots + ((position + count) & log_queue.mask);
+
+			if (((volatile log_slot_t *)slot)->sequence != position + count + 1) {
+				break;
+			}
+
+			vector[count].iov_base = slot->spill ? slot->spill : slot->data;
+			vector[count].iov_len = slot->length;
+		}
+
+		if (!count) {
+			break;
+		}
+
+		__sync_synchronize();
+		current = vector;
+
+		mutex_lock(&log_mutex);
+
+		for (uint64_t remaining = count; remaining && (written = writev(fileno(stdout), current, remaining)) != 0;) {
+
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			else if (written < 0) {
+				break;
+			}
+
+			// Skip past the vectors that were written completely, and adjust the one that was written partially.
+			while (remaining && (size_t)written >= current->iov_len) {
+				written -= current->iov_len;
+				current++;
+				remaining--;
+			}
+
+			if (remaining) {
+				current->iov_base = (chr_t *)current->iov_base + written;
+				current->iov_len -= written;
+			}
+		}
+
+		mutex_unlock(&log_mutex);
+
+		// Release the slots back to the producers.
+		for (uint64_t i = 0; i < count; i++) {
+
+			slot = log_queue.slots + ((position + i) & log_queue.mask);
+
+			if (slot->spill) {
+				mm_free(slot->spill);
+				slot->spill = NULL;
+			}
+
+			__sync_synchronize();
+			slot->sequence = position + i + log_queue.mask + 1;
+
+			// The first entry was accounted for by the wait which woke the writer.
+			if (i || total) {
+				sem_trywait(&(log_queue.pending));
+			}
+		}
+
+		position += count;
+		total += count;
+		log_queue.dequeue = position;
+
+	} while (count == MAGMA_LOG_BATCH);
+
+	log_queue.written += total;
+	return total;
+}
+
+/**
+ * @brief	The entry point for the log writer thread.
+ * @note	The thread sleeps on the pending semaphore, which is posted once for every queued entry, and drains everything that
+ * 			has accumulated each time it wakes up. The queue is drained one last time after the thread is told to stop.
+ * @return	This function returns no value.
+ */
+void log_writer(void) {
+
+	struct timespec timeout;
+
+	while (log_queue.running) {
+
+		if (clock_gettime(CLOCK_REALTIME, &timeout)) {
+			sleep(1);
+			continue;
+		}
+
+		timeout.tv_sec += 1;
+
+		// A wake up without any entries to write is harmless, it just means the writer already collected the entry that posted it.
+		if (!sem_timedwait(&(log_queue.pending), &timeout) || errno == ETIMEDOUT) {
+			log_drain();
+		}
+	}
+
+	while (log_drain());
+	pthread_exit(NULL);
+}
+
+/**
+ * @brief	Get the number of log entries that were discarded because the log queue was full.
+ * @return	the number of dropped entries.
+ */
+uint64_t log_get_dropped(void) {
+	return log_queue.dropped;
+}
+
+/**
+ * @brief	Get the number of log entries that had to wait for the writer because the log queue was full.
+ * @return	the number of stalled entries.
+ */
+uint64_t log_get_stalled(void) {
+	return log_queue.stalled;
+}
+
+/**
+ * Logs the message provided by @a format. The global configuration dictates whether the @a file, @a function and
+ * @a line are also logged. The global configuration can be overridden on a per call basis using the @a options
+ * parameter.
+ */
+void log_internal(const char *file, const char *function, const int line, M_LOG_OPTIONS options, const char *format, ...) {
+
+//	size_t size;
+	va_list args;
+//	void *array[1024];
+	char /***strings = NULL, */*errmsg;
+	bool_t stack = (magma.log.stack || M_LOG_STACK_TRACE == (options & M_LOG_STACK_TRACE)) && !(M_LOG_STACK_TRACE_DISABLE == (options & M_LOG_STACK_TRACE_DISABLE));
+
+	va_start(args, format);
+
+	// When the writer thread is running, the entry is queued instead. Entries which request a stack trace are still written directly,
+	// since the trace is dumped straight to the output descriptor.
+	if (log_queue.active && !stack) {
+
+		// The producer count lets log_stop() wait for entries which are still being queued before it releases the queue.
+		__sync_fetch_and_add(&(log_queue.producers), 1);
+
+		if (log_queue.active) {
+
+			if (log_enabled) {
+				log_enqueue(file, function, line, options, format, args);
+			}
+
+			__sync_fetch_and_sub(&(log_queue.producers), 1);
+			va_end(args);
+			return;
+		}
+
+		__sync_fetch_and_sub(&(log_queue.producers), 1);
+	}
+
+	mutex_lock(&log_mutex);
+
+	// Someone has disabled the log output.
+	if (!log_enabled) {
+		mutex_unlock(&log_mutex);
+		va_end(args);
+		return;
+	}
+
+	if (log_prefix(log_buffer, MAGMA_LOG_BUFFER_LENGTH, file, function, line, options)) {
+		fputs(log_buffer, stdout);
+	}
 
 	vfprintf(stdout, format, args);
 
@@ -155,7 +467,7 @@ void log_internal(const char *file, const char *function, const int line, M_LOG_
 		fprintf(stdout, "\n");
 	}
 
-	if ((magma.log.stack || M_LOG_STACK_TRACE == (options & M_LOG_STACK_TRACE)) && !(M_LOG_STACK_TRACE_DISABLE == (options & M_LOG_STACK_TRACE_DISABLE))) {
+	if (stack) {
 
 		if (print_backtrace() < 0) {
 			errmsg = "Error printing stack backtrace to stdout!\n";
@@ -261,9 +573,83 @@ bool_t log_start(void) {
 	}
 
 	fclose(stdin);
+
+	// Asynchronous logging. The queue length is rounded up to a power of two so positions can be mapped onto slots with a mask.
+	if (magma.output.async) {
+
+		for (log_queue.mask = MAGMA_LOG_BATCH; log_queue.mask < magma.output.queue; log_queue.mask <<= 1);
+
+		if (!(log_queue.slots = mm_alloc(sizeof(log_slot_t) * log_queue.mask))) {
+			log_critical("Unable to allocate the log queue. { slots = %lu }", log_queue.mask);
+			return false;
+		}
+
+		for (uint64_t i = 0; i < log_queue.mask; i++) {
+			(log_queue.slots + i)->sequence = i;
+		}
+
+		log_queue.mask--;
+		log_queue.enqueue = log_queue.dequeue = 0;
+		log_queue.written = log_queue.dropped = log_queue.stalled = 0;
+
+		if (sem_init(&(log_queue.pending), 0, 0)) {
+			log_critical("Unable to initialize the log queue semaphore.");
+			mm_free(log_queue.slots);
+			log_queue.slots = NULL;
+			return false;
+		}
+
+		log_queue.running = true;
+
+		if (thread_launch(&(log_queue.writer), &log_writer, NULL)) {
+			log_critical("Unable to launch the log writer thread.");
+			log_queue.running = false;
+			sem_destroy(&(log_queue.pending));
+			mm_free(log_queue.slots);
+			log_queue.slots = NULL;
+			return false;
+		}
+
+		__sync_synchronize();
+		log_queue.active = true;
+	}
+
 	return true;
 }
 
+/**
+ * @brief	Stop the log writer thread, and return to writing log entries directly.
+ * @note	Any entries still waiting on the queue are written before the writer thread exits.
+ * @return	This function returns no value.
+ */
+void log_stop(void) {
+
+	if (!log_queue.active) {
+		return;
+	}
+
+	// Send new entries down the synchronous path, and wait for the threads that are still queuing entries to finish.
+	log_queue.active = false;
+	__sync_synchronize();
+
+	while (log_queue.producers) {
+		sched_yield();
+	}
+
+	log_queue.running = false;
+	sem_post(&(log_queue.pending));
+	thread_join(log_queue.writer);
+
+	sem_destroy(&(log_queue.pending));
+	mm_free(log_queue.slots);
+	log_queue.slots = NULL;
+
+	log_info("The log writer thread has stopped. { written = %lu / stalled = %lu / dropped = %lu }", log_queue.written, log_queue.stalled,
+		log_queue.dropped);
+
+	return;
+}
+
 /**
  * @brief	A stub routine where it is convenient to set a breakpoint in a debugger.
  * @note	This function should be called by code paths that detect sanity check failures, but that are not fatal.
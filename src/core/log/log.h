@@ -38,6 +38,21 @@ typedef enum {
 	M_LOG_STACK_TRACE_DISABLE
 } M_LOG_OPTIONS;
 
+/**
+ *  The length of the thread local buffer used to format log entries. Longer entries are formatted into a buffer allocated on the heap.
+ */
+#define MAGMA_LOG_BUFFER_LENGTH 8192
+
+/**
+ *  The number of bytes each slot in the asynchronous log queue can hold. Longer entries are stored outside of the queue.
+ */
+#define MAGMA_LOG_SLOT_LENGTH 512
+
+/**
+ *  The maximum number of log entries written using a single writev() call. This is also the minimum length of the log queue.
+ */
+#define MAGMA_LOG_BATCH 64
+
 // All of the different log levels.
 #define MAGMA_LOG_LEVELS (M_LOG_PEDANTIC | M_LOG_INFO | M_LOG_INFO | M_LOG_CRITICAL)
 
@@ -48,6 +63,10 @@ void     log_disable(void);
 void     log_enable(void);
 void     log_rotate(void);
 bool_t   log_start(void);
+void     log_stop(void);
+void     log_writer(void);
+uint64_t log_get_dropped(void);
+uint64_t log_get_stalled(void);
 void     debug_hook(void);
 
 #ifdef MAGMA_PEDANTIC
@@ -77,7 +77,7 @@ void st_free(stringer_t *s) {
 			release(s);
 			break;
 		case (MAPPED_T | JOINTED):
-			munmap(((mapped_t *)s)->data, ((mapped_t *)s)->length + 1);
+			munmap(((mapped_t *)s)->data, ((mapped_t *)s)->avail + 1);
 			close(((mapped_t *)s)->handle);
 			release(s);
 			break;
@@ -79,6 +79,34 @@ pthread_t * thread_alloc(void *function, void *data) {
 	return result;
 }
 
+/**
+ * @brief	Restrict a thread to a single processor core.
+ * @note	If the requested core is larger than the number of online processors, it will wrap around.
+ * @param	thread	the thread to be pinned.
+ * @param	core	the number of the processor core the thread should run on.
+ * @return	0 on success, or a non-zero error code on failure.
+ */
+int_t thread_affinity(pthread_t thread, uint32_t core) {
+
+	int_t ret;
+	long cores;
+	cpu_set_t set;
+
+	if ((cores = sysconf(_SC_NPROCESSORS_ONLN)) <= 0) {
+		log_pedantic("Could not determine the number of online processors.");
+		return -1;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(core % cores, &set);
+
+	if ((ret = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &set))) {
+		log_pedantic("Could not set the processor affinity of the thread. {pthread_setaffinity_np = %i}", ret);
+	}
+
+	return ret;
+}
+
 /**
  * @brief	Block until a specified thread finishes execution.
  * @note	pthread_join()
@@ -14,6 +14,7 @@
 #define MAGMA_CORE_THREAD_H
 
 /// thread.c
+int_t        thread_affinity(pthread_t thread, uint32_t core);
 pthread_t *  thread_alloc(void *function, void *data);
 int_t        thread_cancel(pthread_t thread);
 void         thread_cancel_disable(void);
@@ -55,6 +55,30 @@
 // The default caching server connection timeout.
 #define MAGMA_CACHE_SOCKET_TIMEOUT 10
 
+// The default size limit, in bytes, of the in-process message cache.
+#define MAGMA_CACHE_MESSAGES 67108864
+
+// Message bodies smaller than this many bytes are always stored inside the message file, since sharing them saves very little.
+#define MAGMA_STORAGE_DEDUP_MINIMUM 4096
+
+// Cached mailboxes are refreshed by replaying the message change log. The log is pruned after 7 days, so a mailbox which hasn't
+// been synchronized within the window below is rebuilt instead. Every replay also revisits changes made during the overlap, since a
+// change number can be handed out by a transaction which commits after a larger number has already been read.
+#define MAGMA_MESSAGE_CHANGES_WINDOW 518400
+#define MAGMA_MESSAGE_CHANGES_OVERLAP 60
+
+// The maximum number of DNS servers used by the resolver, and the number of times a query is sent before a lookup fails.
+#define MAGMA_DNS_SERVERS 3
+#define MAGMA_DNS_ATTEMPTS 3
+
+// The maximum number of records kept from a single DNS answer.
+#define MAGMA_DNS_RECORDS 16
+
+// DNS answers are cached for the TTL supplied by the server, but positive answers are never kept longer than a day, and negative
+// answers are never kept longer than 15 minutes.
+#define MAGMA_DNS_TTL_MAXIMUM 86400
+#define MAGMA_DNS_TTL_NEGATIVE 900
+
 // The maximum number of server instances.
 #define MAGMA_BLACKLIST_INSTANCES 6
 
@@ -64,9 +88,15 @@
 // The maximum number of server instances.
 #define MAGMA_SERVER_INSTANCES 32
 
+// The maximum number of listening sockets a single server instance can bind to its port.
+#define MAGMA_SERVER_LISTENERS 64
+
 // The default size of connection buffer. Can be changed via the config.
 #define MAGMA_CONNECTION_BUFFER_SIZE 8192
 
+// The default size of the connection output buffer. Matches the largest SSL record payload, so a full buffer leaves as a single record.
+#define MAGMA_CONNECTION_OUTPUT_SIZE 16384
+
 // The maximum size of the HELO/EHLO string.
 // RFC 2821, section 4.5.3.1 dictates a max length of 255 characters for a domain
 #define MAGMA_SMTP_MAX_HELO_SIZE MAGMA_HOSTNAME_MAX
@@ -48,6 +48,11 @@ void config_free(void) {
 					st_free(magma.smtp.blacklists.domain[j]);
 				}
 			}
+			// The bypass entries are parsed into a subnet list, instead of being stored.
+			else if (!st_cmp_cs_eq(NULLER(magma_keys[i].name), PLACER("magma.smtp.bypass_addr", 22))) {
+				ip_list_free(magma.smtp.bypass_subnets);
+				magma.smtp.bypass_subnets = NULL;
+			}
 			else if (*((stringer_t **)(magma_keys[i].store))) {
 				st_free(*((stringer_t **)(magma_keys[i].store)));
 			}
@@ -58,6 +58,7 @@ typedef struct {
 		uint32_t thread_stack_size; /* How much memory should be allocated for thread stacks? */
 		uint32_t worker_threads; /* How many worker threads should we spawn? */
 		uint32_t network_buffer; /* The size of the network buffer? */
+		uint32_t network_output; /* The size of the buffer used to coalesce connection output. */
 
 		bool_t enable_core_dumps; /* Should fatal errors leave behind a core dump. */
 		uint64_t core_dump_size_limit; /* If core dumps are enabled, what size should they be limited too. */
@@ -65,6 +66,18 @@ typedef struct {
 		stringer_t *domain; /* The default domain name used in new user email addresses and for unqualified login names. */
 	} system;
 
+	struct {
+		chr_t *server; /* The address of the DNS server used for lookups, or NULL to use the servers listed in /etc/resolv.conf. */
+		uint32_t port; /* The port used to contact the DNS servers. */
+		uint32_t timeout; /* The number of seconds a lookup can take before it fails. */
+		uint32_t cache; /* The number of answers held by the DNS cache, or 0 to disable caching. */
+	} dns;
+
+	struct {
+		uint32_t slots; /* The number of greylisting stamps held by the local tally store. */
+		uint32_t sync; /* The number of seconds between pushes of new stamps to the distributed cache, or 0 to keep them local. */
+	} tally;
+
 	struct {
 		struct {
 			bool_t enable; /* Should the secure memory sub-system be enabled. */
@@ -79,6 +92,9 @@ typedef struct {
 	struct {
 		bool_t file; /* Send log messages to a file. */
 		chr_t *path; /* If log files are enabled, this will control whether the logs are stored. */
+		bool_t async; /* Hand log messages to a dedicated writer thread instead of writing them directly. */
+		bool_t drop; /* Discard log messages when the asynchronous log queue is full, instead of waiting for space. */
+		uint32_t queue; /* The number of messages the asynchronous log queue can hold. */
 	} output;
 
 	struct {
@@ -98,6 +114,8 @@ typedef struct {
 		chr_t *tank; /* The path of the storage tank. */
 		stringer_t *active; /* The default storage server used by the legacy mail storage logic. */
 		stringer_t *root; /* The root portion of the storage server directory paths. */
+		chr_t *fulltext; /* The path of the full text search index, or NULL if searches should scan the message content. */
+		bool_t dedup; /* Store identical message bodies once, and share them between the messages that use them. */
 	} storage;
 
 	struct {
@@ -114,8 +132,15 @@ typedef struct {
 			stringer_t *domain[MAGMA_BLACKLIST_INSTANCES];
 		} blacklists;
 
+		uint32_t throttle; /* The number of connections a single address may open per minute, or 0 for no limit. */
+
 		stringer_t *bypass_addr; /* Bypass address/subnet string for smtp checks. This value used only by config. */
-		inx_t *bypass_subnets; /* Holder for all the address/subnets to be waived through for bypass */
+		ip_list_t *bypass_subnets; /* Holder for all the address/subnets to be waived through for bypass */
+
+		struct {
+			uint32_t threads; /* The number of threads used to run inbound message checks concurrently. */
+			uint32_t cache; /* The number of seconds RBL and SPF results are cached, or 0 to disable caching. */
+		} pipeline;
 	} smtp;
 
 	struct {
@@ -125,6 +150,7 @@ typedef struct {
 		chr_t *pages; /* The static web pages directory. */
 		chr_t *templates; /* The web application templates. */
 		uint32_t session_timeout; /* Number of seconds before a session cookie expires. */
+		uint32_t keepalive_timeout; /* Number of seconds an idle keep-alive connection is held open between requests. */
 	} http;
 
 	struct {
@@ -172,13 +198,19 @@ typedef struct {
 
 			struct {
 				uint32_t timeout; /* The number of seconds to wait for a free database connection. */
-				uint32_t connections; /* The number of database connections in the pool. */
+				uint32_t connections; /* The maximum number of database connections in the pool. */
+				uint32_t minimum; /* The number of database connections opened at startup, and kept open while idle. */
+				uint32_t idle; /* The number of seconds a connection beyond the minimum can sit unused before it's closed. */
 			} pool;
 		} database;
 
 		struct {
 			bool_t available; /* Is ClamAV loaded at runtime. */
 			char *signatures; /* The signatures directory. */
+			struct {
+				uint32_t timeout; /* The number of seconds to wait for a free scanner. */
+				uint32_t scanners; /* The maximum number of messages being scanned at once. */
+			} pool;
 		} virus;
 
 		struct {
@@ -194,6 +226,7 @@ typedef struct {
 			} pool;
 			uint32_t retry; /* How often should dead caching servers be retried. */
 			uint32_t timeout; /* The TCP socket send/recv timeout. */
+			uint64_t messages; /* The maximum number of bytes held by the in-process message cache. */
 		} cache;
 
 		struct {
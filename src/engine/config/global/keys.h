@@ -78,6 +78,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = true
 	},
+	{
+		.store = (void *)&(magma.storage.fulltext),
+		.norm.type = M_TYPE_NULLER,
+		.norm.val.ns = NULL,
+		.name = "magma.storage.fulltext",
+		.description = "The location of the full text search index. If not provided, full text searches will scan the message content.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.storage.dedup),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = true,
+		.name = "magma.storage.dedup",
+		.description = "Store the body of large unencrypted messages once, and share it between every message with an identical body.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.daemonize),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -114,6 +138,90 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.system.network_output),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_CONNECTION_OUTPUT_SIZE,
+		.name = "magma.system.network_output",
+		.description = "The size of the buffer used to coalesce connection output. Zero disables output buffering.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.dns.server),
+		.norm.type = M_TYPE_NULLER,
+		.norm.val.ns = NULL,
+		.name = "magma.dns.server",
+		.description = "The IP address of the DNS server used for lookups. If not provided, the nameservers in /etc/resolv.conf are used.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.dns.port),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 53,
+		.name = "magma.dns.port",
+		.description = "The port used to contact the DNS servers.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.dns.timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 10,
+		.name = "magma.dns.timeout",
+		.description = "The number of seconds a DNS lookup can take before it fails.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.dns.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 16384,
+		.name = "magma.dns.cache",
+		.description = "The number of answers held by the DNS cache.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.tally.slots),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 262144,
+		.name = "magma.tally.slots",
+		.description = "The number of greylisting stamps held by the local tally store.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.tally.sync),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 5,
+		.name = "magma.tally.sync",
+		.description = "The number of seconds between pushes of new greylisting stamps to the distributed cache.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.impersonate_user),
 		.norm.type = M_TYPE_NULLER,
@@ -331,6 +439,18 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.http.keepalive_timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 15,
+		.name = "magma.http.keepalive_timeout",
+		.description = "The number of seconds an idle keep-alive connection is held open between requests.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.web.portal.indent),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -415,6 +535,42 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.output.async),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = false,
+		.name = "magma.output.async",
+		.description = "Queue log messages for a dedicated writer thread, instead of having every thread write to the log directly.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.output.queue),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 4096,
+		.name = "magma.output.queue",
+		.description = "The number of messages the asynchronous log queue can hold. The value is rounded up to a power of two.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.output.drop),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = false,
+		.name = "magma.output.drop",
+		.description = "Discard log messages when the asynchronous log queue is full, instead of waiting for the writer to catch up.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.log.content),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -619,6 +775,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.iface.database.pool.minimum),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 4,
+		.name = "magma.iface.database.pool.minimum",
+		.description = "The number of database connections opened at startup, and kept open while idle.",
+		.file = true,
+		.database = false,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.database.pool.idle),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 300,
+		.name = "magma.iface.database.pool.idle",
+		.description = "The number of seconds a database connection beyond the minimum can sit unused before it's closed.",
+		.file = true,
+		.database = false,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.iface.database.pool.timeout),
 		.norm.type = M_TYPE_UINT32,
@@ -667,6 +847,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.iface.virus.pool.scanners),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 8,
+		.name = "magma.iface.virus.pool.scanners",
+		.description = "The maximum number of messages the anti-virus engine will scan concurrently.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.iface.virus.pool.timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 60,
+		.name = "magma.iface.virus.pool.timeout",
+		.description = "The number of seconds a message will wait for a free anti-virus scanner before the scan fails.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.enable_core_dumps),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -799,6 +1003,42 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.smtp.throttle),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 0,
+		.name = "magma.smtp.throttle",
+		.description = "The number of SMTP connections a single address may open per minute.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.pipeline.threads),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 8,
+		.name = "magma.smtp.pipeline.threads",
+		.description = "The number of threads used to check inbound messages concurrently.",
+		.file = true,
+		.database = true,
+		.overwrite = false,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.smtp.pipeline.cache),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 300,
+		.name = "magma.smtp.pipeline.cache",
+		.description = "The number of seconds RBL and SPF results are cached.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.dkim.enabled),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -919,6 +1159,18 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.iface.cache.messages),
+		.norm.type = M_TYPE_UINT64,
+		.norm.val.u64 = MAGMA_CACHE_MESSAGES,
+		.name = "magma.iface.cache.messages",
+		.description = "The maximum number of bytes used to cache recently loaded messages in memory. Setting this to zero disables the cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.relay.timeout),
 		.norm.type = M_TYPE_UINT32,
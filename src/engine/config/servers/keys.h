@@ -86,6 +86,14 @@ server_keys_t server_keys[] = {
 		.description = "The size of the listen queue used by the instance.",
 		.required = false
 	},
+	{
+		.offset = offsetof (server_t, network.listeners),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 1,
+		.name = ".network.listeners",
+		.description = "The number of listening sockets bound to the port. Values above one use SO_REUSEPORT, and give each extra socket its own accept thread.",
+		.required = false
+	},
 	{
 		.offset = offsetof (server_t, network.type),
 		.norm.type = M_TYPE_ENUM,
@@ -178,6 +178,10 @@ server_t * servers_alloc(uint32_t number) {
 	// Set the default value to -1 so the shutdown function can detect uninitialized sockets.
 	magma.servers[number]->network.sockd = -1;
 
+	for (uint32_t i = 0; i < MAGMA_SERVER_LISTENERS; i++) {
+		magma.servers[number]->network.sockets[i] = -1;
+	}
+
 	return magma.servers[number];
 }
 
@@ -312,6 +316,10 @@ bool_t servers_validate(void) {
 			log_critical("The port %u cannot be assigned to more than one server instance.", magma.servers[i]->network.port);
 			return false;
 		}
+		else if (magma.servers[i] && (!magma.servers[i]->network.listeners || magma.servers[i]->network.listeners > MAGMA_SERVER_LISTENERS)) {
+			log_critical("magma.servers[%u].network.listeners must be between 1 and %u.", i, MAGMA_SERVER_LISTENERS);
+			result = false;
+		}
 	}
 
 	return result;
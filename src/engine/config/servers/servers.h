@@ -46,6 +46,8 @@ typedef struct {
 		uint32_t port;
 		uint32_t timeout;
 		uint32_t listen_queue;
+		uint32_t listeners;
+		int sockets[MAGMA_SERVER_LISTENERS];
 		M_PORT type;
 	} network;
 	struct {
@@ -105,6 +105,10 @@ void process_stop(void) {
 		dkim_stop,
 		dspam_stop,
 		cache_stop,
+		fulltext_stop, /* Close the full text search index. */
+		dns_stop, /* Stop the DNS resolver. */
+		smtp_pipeline_stop, /* Stop the inbound message filter threads. */
+		tally_stop, /* Push any remaining greylisting stamps and free the local tally store. */
 //		tank_stop, /* Shutdown the storage system. This should flush any pending write operations and cleanly close the tank data files. */
 
 		obj_cache_stop,
@@ -113,8 +117,9 @@ void process_stop(void) {
 		http_content_stop,
 		NULL, /* Protocol handlers. */
 		servers_encryption_stop,
+		parking_stop, /* Release the idle connection parking descriptor. */
 		queue_shutdown, /* Shutdown the thread pool. */
-		NULL /* Logging */
+		log_stop /* Logging */
 	};
 
 #ifdef MAGMA_PEDANTIC
@@ -201,6 +206,10 @@ bool_t process_start(void) {
 		(void *)&dkim_start,
 		(void *)&dspam_start,
 		(void *)&cache_start,
+		(void *)&fulltext_start,
+		(void *)&dns_start,
+		(void *)&smtp_pipeline_start,
+		(void *)&tally_start,
 //		(void *)&tank_start,
 
 		(void *)&obj_cache_start,
@@ -209,6 +218,7 @@ bool_t process_start(void) {
 		(void *)&http_content_start,
 		(void *)&protocol_init,
 		(void *)&servers_encryption_start,
+		(void *)&parking_start,
 		(void *)&queue_init,
 		(void *)&log_start
 	};
@@ -247,6 +257,10 @@ bool_t process_start(void) {
 		"Unable to initialize the DKIM engine. Exiting.",
 		"Unable to initialize the DSPAM engine. Exiting.",
 		"Unable to initialize the distributed cache system. Exiting.",
+		"Unable to open the full text search index. Exiting.",
+		"Unable to start the DNS resolver. Exiting.",
+		"Unable to launch the SMTP filter threads. Exiting.",
+		"Unable to start the local tally store. Exiting.",
 //		"Unable to initialize the storage system. Exiting.",
 
 		"Unable to initialize the local object cache. Exiting.",
@@ -255,6 +269,7 @@ bool_t process_start(void) {
 		"Unable to initialize the web content cache. Exiting.",
 		"Unable to initialize the protocol handlers. Exiting.",
 		"Unable to initialize the server encryption context. Exiting.",
+		"Unable to initialize the connection parking descriptor. Exiting.",
 		"Unable to initialize the thread pool. Exiting.",
 		"Initialization of the log configuration failed. Exiting."
 	};
@@ -13,14 +13,13 @@
 #include "magma.h"
 
 /**
- * @brief	Prepare a thread to exit by destroying its mysql and openssl-specific and associated mail cache data.
+ * @brief	Prepare a thread to exit by destroying its mysql and openssl-specific data.
  * @return	This function returns no value.
  */
 void thread_stop(void) {
 
 	sql_thread_stop();
 	ssl_thread_stop();
-	mail_cache_thread_stop();
 
 	return;
 }
@@ -43,33 +43,33 @@ void protocol_enqueue(connection_t *con) {
 	switch (con->server->protocol) {
 
 	case (POP):
-		stats_increment_by_name("pop.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("pop.connections.secure");
+		stats_increment_by_num(STATS_POP_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_POP_CONNECTIONS_SECURE);
 		function = &pop_init;
 		break;
 	case (IMAP):
-		stats_increment_by_name("imap.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("imap.connections.secure");
+		stats_increment_by_num(STATS_IMAP_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_IMAP_CONNECTIONS_SECURE);
 		function = &imap_init;
 		break;
 	case (HTTP):
-		stats_increment_by_name("http.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("http.connections.secure");
+		stats_increment_by_num(STATS_HTTP_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_HTTP_CONNECTIONS_SECURE);
 		function = &http_init;
 		break;
 	case (SMTP):
-		stats_increment_by_name("smtp.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("smtp.connections.secure");
+		stats_increment_by_num(STATS_SMTP_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_SMTP_CONNECTIONS_SECURE);
 		function = &smtp_init;
 		break;
 	case (SUBMISSION):
-		stats_increment_by_name("smtp.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("smtp.connections.secure");
+		stats_increment_by_num(STATS_SMTP_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_SMTP_CONNECTIONS_SECURE);
 		function = &submission_init;
 		break;
 	case (MOLTEN):
-		stats_increment_by_name("molten.connections.total");
-		if (con_secure(con) == 1) stats_increment_by_name("molten.connections.secure");
+		stats_increment_by_num(STATS_MOLTEN_CONNECTIONS_TOTAL);
+		if (con_secure(con) == 1) stats_increment_by_num(STATS_MOLTEN_CONNECTIONS_SECURE);
 		function = &molten_init;
 		break;
 	default:
@@ -105,6 +105,7 @@ void protocol_secure(connection_t *con) {
 		if (con->network.ssl) ssl_free(con->network.ssl);
 		if (con->network.sockd != -1) close(con->network.sockd);
 		if (con->network.buffer) st_free(con->network.buffer);
+		if (con->network.output) st_free(con->network.output);
 		mutex_destroy(&(con->lock));
 		mm_free(con);
 		return;
@@ -1,9 +1,13 @@
-
 /**
  * @file /magma/engine/controller/queue.c
  *
  * @brief	Functions used to distribute tasks to available worker threads.
  *
+ * @note	Every worker thread owns a private deque of jobs. Workers push the jobs they create onto their own deque, while jobs created by
+ * 			other threads (like the listener) are spread across the deques in round robin order. An idle worker services its own deque first,
+ * 			and then steals from its siblings, so no single lock is shared by the entire thread pool. Job nodes are recycled through a free
+ * 			list attached to each deque, which avoids a trip through the allocator for every job.
+ *
  * $Author$
  * $Date$
  * $Revision$
@@ -12,21 +16,152 @@
 
 #include "magma.h"
 
+// The number of spare job nodes each deque will hold on to before returning them to the allocator.
+#define MAGMA_QUEUE_POOL 1024
+
 typedef struct {
 	void (*function)(void *data), (*requeue)(void *data), *data;
 	struct queue_t *next;
 } queue_t;
 
+typedef struct {
+	pthread_mutex_t lock;
+	queue_t *head, *tail, *pool;
+	uint64_t count, pooled;
+} deque_t;
+
 struct {
 	sem_t sema;
+	deque_t *deques;
 	pthread_t *workers;
-	pthread_mutex_t lock;
-	queue_t *items;
+	uint64_t count, cursor, launched;
 } queue = {
+		.deques = NULL,
 		.workers = NULL,
-		.items = NULL
+		.count = 0,
+		.cursor = 0,
+		.launched = 0
 };
 
+// The deque owned by the current thread, or -1 if the current thread isn't a worker.
+static __thread int64_t worker = -1;
+
+/**
+ * @brief	Append a job to the tail of a deque.
+ * @param	deque		the deque that will receive the job.
+ * @param	function	a pointer to the function to be executed.
+ * @param	requeue		an optional pointer to the function to be called after function is executed.
+ * @param	data		a pointer to an arbitrary block of data to be passed to function and/or requeue upon execution.
+ * @return	false if a job node couldn't be allocated, or true on success.
+ */
+static bool_t queue_push(deque_t *deque, void *function, void *requeue, void *data) {
+
+	queue_t *work;
+
+	mutex_lock(&deque->lock);
+
+	if ((work = deque->pool)) {
+		deque->pool = (queue_t *)work->next;
+		deque->pooled--;
+	}
+	else if (!(work = mm_alloc(sizeof(queue_t)))) {
+		mutex_unlock(&deque->lock);
+		return false;
+	}
+
+	work->function = function;
+	work->requeue = requeue;
+	work->data = data;
+	work->next = NULL;
+
+	if (deque->tail) {
+		deque->tail->next = (struct queue_t *)work;
+	}
+	else {
+		deque->head = work;
+	}
+
+	deque->tail = work;
+	__atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELAXED);
+
+	mutex_unlock(&deque->lock);
+	return true;
+}
+
+/**
+ * @brief	Remove the job at the head of a deque.
+ * @note	The job is copied into the supplied structure so its node can be returned to the pool before the lock is released.
+ * @param	deque	the deque to be examined.
+ * @param	job		a pointer to a queue_t structure that will receive the job.
+ * @return	false if the deque was empty, or true if a job was removed.
+ */
+static bool_t queue_pop(deque_t *deque, queue_t *job) {
+
+	queue_t *work;
+
+	// Peeking at the count without the lock lets idle workers skip over empty deques cheaply. The count is only written while the lock
+	// is held, but it's read and written atomically so the peek never sees a torn value. A stale read is resolved by the caller, which
+	// keeps looking until it finds the job its semaphore wait promised.
+	if (!__atomic_load_n(&deque->count, __ATOMIC_RELAXED)) {
+		return false;
+	}
+
+	mutex_lock(&deque->lock);
+
+	if (!(work = deque->head)) {
+		mutex_unlock(&deque->lock);
+		return false;
+	}
+
+	if (!(deque->head = (queue_t *)work->next)) {
+		deque->tail = NULL;
+	}
+
+	__atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+
+	job->function = work->function;
+	job->requeue = work->requeue;
+	job->data = work->data;
+
+	if (deque->pooled < MAGMA_QUEUE_POOL) {
+		work->next = (struct queue_t *)deque->pool;
+		deque->pool = work;
+		deque->pooled++;
+		work = NULL;
+	}
+
+	mutex_unlock(&deque->lock);
+
+	if (work) {
+		mm_free(work);
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Find a job to execute, starting with the deque owned by the calling thread and then stealing from the others.
+ * @param	job		a pointer to a queue_t structure that will receive the job.
+ * @return	false if every deque was empty, or true if a job was found.
+ */
+static bool_t queue_take(queue_t *job) {
+
+	uint64_t start = worker >= 0 ? worker : 0;
+
+	if (queue_pop(queue.deques + start, job)) {
+		return true;
+	}
+
+	for (uint64_t i = 1; i < queue.count; i++) {
+		if (queue_pop(queue.deques + ((start + i) % queue.count), job)) {
+			stats_increment_by_num(STATS_CORE_QUEUE_STEALS);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /**
  * @brief	Push a function on the job queue to be executed asynchronously.
  * @note	Warning: If this function fails to allocate a new queue_t object, the work unit is lost forever.
@@ -37,28 +172,27 @@ struct {
  */
 void requeue(void *function, void *requeue, void *data) {
 
-	queue_t *local, *work;
+	uint64_t target;
 
-	if (!(work = mm_alloc(sizeof(queue_t)))) {
-		log_critical("Failed to allocate a queue_t structure. Work request is lost forever!");
+	if (!queue.deques || !queue.count) {
+		log_critical("The job queue hasn't been initialized. Work request is lost forever!");
 		return;
 	}
 
-	work->function = function;
-	work->requeue = requeue;
-	work->data = data;
-
-	mutex_lock(&queue.lock);
-
-	if ((local = queue.items)) {
-		while (local->next) local = (queue_t *)local->next;
-		local->next = (struct queue_t *)work;
+	// Workers keep the jobs they create, while everyone else spreads their jobs across the pool.
+	if (worker >= 0) {
+		target = worker;
 	}
 	else {
-		queue.items = work;
+		target = __sync_fetch_and_add(&queue.cursor, 1) % queue.count;
 	}
 
-	mutex_unlock(&queue.lock);
+	if (!queue_push(queue.deques + target, function, requeue, data)) {
+		log_critical("Failed to allocate a queue_t structure. Work request is lost forever!");
+		return;
+	}
+
+	stats_increment_by_num(STATS_CORE_QUEUE_DEPTH);
 	sem_post(&queue.sema);
 
 	return;
@@ -83,37 +217,42 @@ void enqueue(void *function, void *data) {
  */
 void dequeue(void) {
 
-	queue_t *work;
+	bool_t found;
+	queue_t work;
 
 	if (!thread_start()) {
 		log_error("Unable to setup the thread context.");
 		pthread_exit(NULL);
 	}
 
+	worker = __sync_fetch_and_add(&queue.launched, 1) % queue.count;
+
 	do {
-		sem_wait(&queue.sema);
+		found = false;
 
-		mutex_lock(&queue.lock);
-		work = queue.items;
+		if (sem_wait(&queue.sema)) {
+			continue;
+		}
 
-		if (work) {
-			queue.items = (queue_t *)work->next;
+		// The semaphore is posted once for every job, so a successful wait guarantees a job is waiting for us. But it may have been pushed
+		// onto a deque we already checked, so keep looking until we find it, or the daemon begins shutting down.
+		while (!(found = queue_take(&work)) && status()) {
+			sched_yield();
 		}
 
-		mutex_unlock(&queue.lock);
+		if (found) {
+			stats_decrement_by_num(STATS_CORE_QUEUE_DEPTH);
+			stats_increment_by_num(STATS_CORE_QUEUE_DISPATCHED);
 
-		if (work) {
-			work->function(work->data);
+			work.function(work.data);
 
-			if (work->requeue) {
-				work->requeue(work->data);
+			if (work.requeue) {
+				work.requeue(work.data);
 			}
-
-			mm_free(work);
 		}
 
 	// Continue processing until the work queue is empty and the status tracker indicates a shutdown.
-	} while (work || status());
+	} while (found || status());
 
 	// Clear the thread specific error stack inside the OpenSSL library.
 	thread_stop();
@@ -143,20 +282,36 @@ void queue_signal(void) {
 
 /**
  * @brief	Create a queue of worker threads and set them into motion.
- * @note	Up to magma.system.worker_threads number of threads will be created.
+ * @note	Up to magma.system.worker_threads number of threads will be created, each with its own deque of jobs.
  * @result	false on failure or true on success.
  */
 bool_t queue_init(void) {
 
+	if (!magma.system.worker_threads) {
+		log_error("At least one worker thread is required.");
+		return false;
+	}
+
 	if (sem_init(&queue.sema, 0, 0)) {
 		return false;
 	}
 
-	if (mutex_init(&queue.lock, NULL)) {
+	if (!(queue.deques = mm_alloc(sizeof(deque_t) * magma.system.worker_threads))) {
 		sem_destroy(&queue.sema);
 		return false;
 	}
 
+	for (uint64_t i = 0; i < magma.system.worker_threads; i++) {
+
+		if (mutex_init(&((queue.deques + i)->lock), NULL)) {
+			log_error("Unable to initialize the worker deque locks.");
+			queue_shutdown();
+			return false;
+		}
+
+		queue.count++;
+	}
+
 	if (!(queue.workers = mm_alloc(sizeof(pthread_t) * magma.system.worker_threads))) {
 		queue_shutdown();
 		return false;
@@ -170,7 +325,7 @@ bool_t queue_init(void) {
 			return false;
 		}
 
-		stats_increment_by_name("core.threading.workers");
+		stats_increment_by_num(STATS_CORE_THREADING_WORKERS);
 	}
 
 	return true;
@@ -182,6 +337,10 @@ bool_t queue_init(void) {
  */
 void queue_shutdown(void) {
 
+	queue_t *work;
+	deque_t *deque;
+	uint64_t abandoned = 0;
+
 	for (uint64_t i = 0; queue.workers && i < magma.system.worker_threads + 128; i++) {
 		sem_post(&queue.sema);
 	}
@@ -190,13 +349,40 @@ void queue_shutdown(void) {
 
 		if (queue.workers + i) {
 			thread_join(*(queue.workers + i));
-			stats_decrement_by_name("core.threading.workers");
+			stats_decrement_by_num(STATS_CORE_THREADING_WORKERS);
 		}
 
 	}
 
+	// Release the pooled nodes, and any jobs that were pushed after the workers exited.
+	for (uint64_t i = 0; queue.deques && i < queue.count; i++) {
+
+		deque = queue.deques + i;
+		abandoned += deque->count;
+
+		while ((work = deque->head)) {
+			deque->head = (queue_t *)work->next;
+			mm_free(work);
+		}
+
+		while ((work = deque->pool)) {
+			deque->pool = (queue_t *)work->next;
+			mm_free(work);
+		}
+
+		mutex_destroy(&deque->lock);
+	}
+
+	if (abandoned) {
+		log_pedantic("Jobs were still queued during shutdown. {count = %lu}", abandoned);
+	}
+
 	mm_cleanup(queue.workers);
-	mutex_destroy(&queue.lock);
+	mm_cleanup(queue.deques);
+	queue.workers = NULL;
+	queue.deques = NULL;
+	queue.count = 0;
+
 	sem_destroy(&queue.sema);
 
 	return;
@@ -12,78 +12,102 @@
 
 #include "magma.h"
 
+// Every counter occupies its own cache line, so threads updating different counters don't contend with each other.
+typedef struct {
+	uint64_t value;
+} __attribute__ ((aligned (64))) stats_slot_t;
+
 struct {
 	size_t count;
-	pthread_mutex_t locks[128][2];
-	uint64_t values[128];
-	char *names[128];
+	stats_slot_t values[STATS_TOTAL];
+	uint16_t hashed[MAGMA_STATS_HASH];
+	char *names[STATS_TOTAL];
 } stats = {
 		.names = {
-			"default",
+			[STATS_DEFAULT] = "default",
 
 			// Core Statistics
-			"core.threading.workers",
+			[STATS_CORE_THREADING_WORKERS] = "core.threading.workers",
+			[STATS_CORE_NETWORK_PARKED] = "core.network.parked",
+			[STATS_CORE_DNS_QUERIES] = "core.dns.queries",
+			[STATS_CORE_DNS_CACHED] = "core.dns.cached",
+			[STATS_CORE_DNS_ERRORS] = "core.dns.errors",
+			[STATS_CORE_QUEUE_DEPTH] = "core.queue.depth",
+			[STATS_CORE_QUEUE_DISPATCHED] = "core.queue.dispatched",
+			[STATS_CORE_QUEUE_STEALS] = "core.queue.steals",
 
 			// SMTP Statistics
-			"smtp.connections.total",
-			"smtp.connections.secure",
+			[STATS_SMTP_CONNECTIONS_TOTAL] = "smtp.connections.total",
+			[STATS_SMTP_CONNECTIONS_SECURE] = "smtp.connections.secure",
+			[STATS_SMTP_CHECKS_CACHED] = "smtp.checks.cached",
+			[STATS_SMTP_CHECKS_RBL_TIME] = "smtp.checks.rbl.time",
+			[STATS_SMTP_CHECKS_SPF_TIME] = "smtp.checks.spf.time",
+			[STATS_SMTP_CHECKS_DKIM_TIME] = "smtp.checks.dkim.time",
+			[STATS_SMTP_CHECKS_VIRUS_TIME] = "smtp.checks.virus.time",
+			[STATS_SMTP_CHECKS_DSPAM_TIME] = "smtp.checks.dspam.time",
 
 			// HTTP Statistics
-			"http.connections.total",
-			"http.connections.secure",
+			[STATS_HTTP_CONNECTIONS_TOTAL] = "http.connections.total",
+			[STATS_HTTP_CONNECTIONS_SECURE] = "http.connections.secure",
 
 			// IMAP Statistics
-			"imap.connections.total",
-			"imap.connections.secure",
+			[STATS_IMAP_CONNECTIONS_TOTAL] = "imap.connections.total",
+			[STATS_IMAP_CONNECTIONS_SECURE] = "imap.connections.secure",
 
 			// POP Statistics
-			"pop.connections.total",
-			"pop.connections.secure",
+			[STATS_POP_CONNECTIONS_TOTAL] = "pop.connections.total",
+			[STATS_POP_CONNECTIONS_SECURE] = "pop.connections.secure",
 
 			// Molten Statistics
-			"molten.connections.total",
-			"molten.connections.secure",
+			[STATS_MOLTEN_CONNECTIONS_TOTAL] = "molten.connections.total",
+			[STATS_MOLTEN_CONNECTIONS_SECURE] = "molten.connections.secure",
 
 			// Provider Statistics
-			"provider.virus.available",
-			"provider.virus.error",
-			"provider.virus.scan.total",
-			"provider.virus.scan.clean",
-			"provider.virus.scan.infected",
-			"provider.virus.scan.phishing",
-			"provider.virus.signatures.total",
-			"provider.virus.signatures.loaded",
-
-			"provider.spf.checked",
-			"provider.spf.missing",
-			"provider.spf.neutral",
-			"provider.spf.error",
-			"provider.spf.fail",
-			"provider.spf.pass",
-
-			"provider.dkim.signed",
-			"provider.dkim.checked",
-			"provider.dkim.missing",
-			"provider.dkim.neutral",
-			"provider.dkim.error",
-			"provider.dkim.fail",
-			"provider.dkim.pass",
+			[STATS_PROVIDER_VIRUS_AVAILABLE] = "provider.virus.available",
+			[STATS_PROVIDER_VIRUS_ERROR] = "provider.virus.error",
+			[STATS_PROVIDER_VIRUS_SCAN_TOTAL] = "provider.virus.scan.total",
+			[STATS_PROVIDER_VIRUS_SCAN_CLEAN] = "provider.virus.scan.clean",
+			[STATS_PROVIDER_VIRUS_SCAN_INFECTED] = "provider.virus.scan.infected",
+			[STATS_PROVIDER_VIRUS_SCAN_PHISHING] = "provider.virus.scan.phishing",
+			[STATS_PROVIDER_VIRUS_SCAN_TIME] = "provider.virus.scan.time",
+			[STATS_PROVIDER_VIRUS_SIGNATURES_TOTAL] = "provider.virus.signatures.total",
+			[STATS_PROVIDER_VIRUS_SIGNATURES_LOADED] = "provider.virus.signatures.loaded",
+
+			[STATS_PROVIDER_SPF_CHECKED] = "provider.spf.checked",
+			[STATS_PROVIDER_SPF_MISSING] = "provider.spf.missing",
+			[STATS_PROVIDER_SPF_NEUTRAL] = "provider.spf.neutral",
+			[STATS_PROVIDER_SPF_ERROR] = "provider.spf.error",
+			[STATS_PROVIDER_SPF_FAIL] = "provider.spf.fail",
+			[STATS_PROVIDER_SPF_PASS] = "provider.spf.pass",
+
+			[STATS_PROVIDER_DKIM_SIGNED] = "provider.dkim.signed",
+			[STATS_PROVIDER_DKIM_CHECKED] = "provider.dkim.checked",
+			[STATS_PROVIDER_DKIM_MISSING] = "provider.dkim.missing",
+			[STATS_PROVIDER_DKIM_NEUTRAL] = "provider.dkim.neutral",
+			[STATS_PROVIDER_DKIM_ERROR] = "provider.dkim.error",
+			[STATS_PROVIDER_DKIM_FAIL] = "provider.dkim.fail",
+			[STATS_PROVIDER_DKIM_PASS] = "provider.dkim.pass",
 
 
 			// Objects
-			"objects.users.total",
-			"objects.users.expired",
-			"objects.sessions.total",
-			"objects.sessions.expired",
+			[STATS_OBJECTS_USERS_TOTAL] = "objects.users.total",
+			[STATS_OBJECTS_USERS_EXPIRED] = "objects.users.expired",
+			[STATS_OBJECTS_SESSIONS_TOTAL] = "objects.sessions.total",
+			[STATS_OBJECTS_SESSIONS_EXPIRED] = "objects.sessions.expired",
+			[STATS_OBJECTS_MAIL_CACHE_HITS] = "objects.mail.cache.hits",
+			[STATS_OBJECTS_MAIL_CACHE_MISSES] = "objects.mail.cache.misses",
+			[STATS_OBJECTS_MAIL_CACHE_EVICTIONS] = "objects.mail.cache.evictions",
+			[STATS_OBJECTS_MAIL_BLOBS_STORED] = "objects.mail.blobs.stored",
+			[STATS_OBJECTS_MAIL_BLOBS_SHARED] = "objects.mail.blobs.shared",
 
 			// Patterns
-			"objects.patterns.checked",
-			"objects.patterns.error",
-			"objects.patterns.fail",
-			"objects.patterns.pass",
+			[STATS_OBJECTS_PATTERNS_CHECKED] = "objects.patterns.checked",
+			[STATS_OBJECTS_PATTERNS_ERROR] = "objects.patterns.error",
+			[STATS_OBJECTS_PATTERNS_FAIL] = "objects.patterns.fail",
+			[STATS_OBJECTS_PATTERNS_PASS] = "objects.patterns.pass",
 
 			// Web Applications
-			"web.register.blocked",
+			[STATS_WEB_REGISTER_BLOCKED] = "web.register.blocked",
 
 			// TODO: Add stubs for derived statistics like uptime, CPU, memory and secure memory stats.
 			// system.pid
@@ -244,20 +268,33 @@ uint64_t derived_value(uint64_t position) {
 
 // LOW: There should be some index validation for functions that reference statistics by index.
 
+/**
+ * @brief	Calculate the slot in the name table where the search for a statistic should begin.
+ * @param	name	the name of the statistic.
+ * @return	the starting position inside the name table.
+ */
+static uint32_t stats_hash(char *name) {
+
+	return hash_murmur32(name, ns_length_get(name)) & (MAGMA_STATS_HASH - 1);
+}
+
 /**
  * @brief	Get the index of a statistic by name.
+ * @note	The names are stored in an open addressing table built by stats_init(), so a lookup costs a single hash and usually one
+ * 			string comparison. Code paths which update a statistic frequently should use the STATS_* constants directly.
  * @param	name	the name of the statistic to be queried.
  * @return	0 on failure, or the zero-based index of the requested statistic on success.
  */
 uint64_t stats_get_name_pos(char *name) {
 
-	bool_t match = false;
+	uint16_t position;
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		mutex_lock(&stats.locks[i][0]);
-		match = !st_cmp_cs_eq(NULLER(name), NULLER(stats.names[i]));
-		mutex_unlock(&stats.locks[i][0]);
-		if (match) return i;
+	if (name) {
+		for (uint32_t i = stats_hash(name); (position = stats.hashed[i]); i = (i + 1) & (MAGMA_STATS_HASH - 1)) {
+			if (!st_cmp_cs_eq(NULLER(name), NULLER(stats.names[position]))) {
+				return position;
+			}
+		}
 	}
 
 	log_info("Could not find the statistic requested. {name = %s}", name);
@@ -272,13 +309,11 @@ uint64_t stats_get_name_pos(char *name) {
  */
 char * stats_get_name(uint64_t position) {
 
-	char *name;
-
-	mutex_lock(&stats.locks[position][0]);
-	name = stats.names[position];
-	mutex_unlock(&stats.locks[position][0]);
+	if (position >= STATS_TOTAL) {
+		return NULL;
+	}
 
-	return name;
+	return stats.names[position];
 }
 
 /**
@@ -295,9 +330,7 @@ void stats_set_by_name(char *name, uint64_t value) {
 		return;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] = value;
-	mutex_unlock(&stats.locks[position][1]);
+	stats_set_by_num(position, value);
 	return;
 }
 
@@ -309,10 +342,7 @@ void stats_set_by_name(char *name, uint64_t value) {
  */
 void stats_set_by_num(uint64_t position, uint64_t value) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] = value;
-	mutex_unlock(&stats.locks[position][1]);
-
+	*((volatile uint64_t *)&(stats.values[position].value)) = value;
 	return;
 }
 
@@ -323,17 +353,13 @@ void stats_set_by_num(uint64_t position, uint64_t value) {
  */
 uint64_t stats_get_value_by_name(char *name) {
 
-	uint64_t position, value;
+	uint64_t position;
 
 	if (!(position = stats_get_name_pos(name))) {
 			return 0;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	value = stats.values[position];
-	mutex_unlock(&stats.locks[position][1]);
-
-	return value;
+	return stats_get_value_by_num(position);
 }
 
 /**
@@ -343,13 +369,7 @@ uint64_t stats_get_value_by_name(char *name) {
  */
 uint64_t stats_get_value_by_num(uint64_t position) {
 
-	uint64_t value;
-
-	mutex_lock(&stats.locks[position][1]);
-	value = stats.values[position];
-	mutex_unlock(&stats.locks[position][1]);
-
-	return value;
+	return *((volatile uint64_t *)&(stats.values[position].value));
 }
 
 /**
@@ -366,10 +386,7 @@ void stats_adjust_by_name(char *name, int32_t value) {
 		return;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] += value;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_adjust_by_num(position, value);
 	return;
 }
 
@@ -381,10 +398,7 @@ void stats_adjust_by_name(char *name, int32_t value) {
  */
 void stats_adjust_by_num(uint64_t position, int32_t value) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] += value;
-	mutex_unlock(&stats.locks[position][1]);
-
+	__sync_fetch_and_add(&(stats.values[position].value), (int64_t)value);
 	return;
 }
 
@@ -401,10 +415,7 @@ void stats_increment_by_name(char *name) {
 		return;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]++;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_increment_by_num(position);
 	return;
 }
 
@@ -415,10 +426,7 @@ void stats_increment_by_name(char *name) {
  */
 void stats_increment_by_num(uint64_t position) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]++;
-	mutex_unlock(&stats.locks[position][1]);
-
+	__sync_fetch_and_add(&(stats.values[position].value), 1);
 	return;
 }
 
@@ -435,10 +443,7 @@ void stats_decrement_by_name(char *name) {
 		return;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]--;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_decrement_by_num(position);
 	return;
 }
 
@@ -449,10 +454,7 @@ void stats_decrement_by_name(char *name) {
  */
 void stats_decrement_by_num(uint64_t position) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]--;
-	mutex_unlock(&stats.locks[position][1]);
-
+	__sync_fetch_and_sub(&(stats.values[position].value), 1);
 	return;
 }
 
@@ -466,38 +468,44 @@ uint64_t stats_get_count(void) {
 }
 
 /**
- * @brief	Initialize and reset all statistics counters.
+ * @brief	Initialize and reset all statistics counters, and build the table used to find statistics by name.
  * @return	false on failure or true on success.
  */
 bool_t stats_init(void) {
 
-	mm_wipe(stats.locks, sizeof(stats.locks));
+	uint32_t slot;
+
 	mm_wipe(stats.values, sizeof(stats.values));
+	mm_wipe(stats.hashed, sizeof(stats.hashed));
+	stats.count = 0;
 
-	for (uint64_t i = 0; i < sizeof(stats.names) / sizeof(char *); i++) {
-		if (stats.names[i]) stats.count++;
-	}
+	for (uint64_t i = 0; i < STATS_TOTAL; i++) {
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		if (mutex_init(&stats.locks[i][0], NULL) || mutex_init(&stats.locks[i][1], NULL)) {
-			log_critical("Could not initialize the statistic locks.");
+		if (!stats.names[i]) {
+			log_critical("A statistic is missing its name. {position = %lu}", i);
 			return false;
 		}
+
+		stats.count++;
+
+		// The default entry doubles as the marker for an empty slot, so it isn't added to the table.
+		if (i == STATS_DEFAULT) {
+			continue;
+		}
+
+		for (slot = stats_hash(stats.names[i]); stats.hashed[slot]; slot = (slot + 1) & (MAGMA_STATS_HASH - 1));
+		stats.hashed[slot] = i;
 	}
 
 	return true;
 }
 
 /**
- * @brief	Destroy all statistics locks.
+ * @brief	Shutdown the statistics interface.
+ * @note	The counters are lock free, so there is nothing to release.
  * @return	This function returns no value.
  */
 void stats_shutdown(void) {
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		mutex_destroy(&stats.locks[i][0]);
-		mutex_destroy(&stats.locks[i][1]);
-	}
-
 	return;
 }
@@ -31,12 +31,87 @@ void       status_set(int value);
 uint64_t   status_startup(void);
 
 /************  STATISTICS  ************/
+/**
+ * The statistics tracked by magma. Code paths that update a statistic frequently should use these constants with the *_by_num
+ * functions, which avoids the name lookup. The names are defined by the table inside statistics.c.
+ */
+typedef enum {
+	STATS_DEFAULT,
+	STATS_CORE_THREADING_WORKERS,
+	STATS_CORE_NETWORK_PARKED,
+	STATS_CORE_DNS_QUERIES,
+	STATS_CORE_DNS_CACHED,
+	STATS_CORE_DNS_ERRORS,
+	STATS_CORE_QUEUE_DEPTH,
+	STATS_CORE_QUEUE_DISPATCHED,
+	STATS_CORE_QUEUE_STEALS,
+	STATS_SMTP_CONNECTIONS_TOTAL,
+	STATS_SMTP_CONNECTIONS_SECURE,
+	STATS_SMTP_CHECKS_CACHED,
+	STATS_SMTP_CHECKS_RBL_TIME,
+	STATS_SMTP_CHECKS_SPF_TIME,
+	STATS_SMTP_CHECKS_DKIM_TIME,
+	STATS_SMTP_CHECKS_VIRUS_TIME,
+	STATS_SMTP_CHECKS_DSPAM_TIME,
+	STATS_HTTP_CONNECTIONS_TOTAL,
+	STATS_HTTP_CONNECTIONS_SECURE,
+	STATS_IMAP_CONNECTIONS_TOTAL,
+	STATS_IMAP_CONNECTIONS_SECURE,
+	STATS_POP_CONNECTIONS_TOTAL,
+	STATS_POP_CONNECTIONS_SECURE,
+	STATS_MOLTEN_CONNECTIONS_TOTAL,
+	STATS_MOLTEN_CONNECTIONS_SECURE,
+	STATS_PROVIDER_VIRUS_AVAILABLE,
+	STATS_PROVIDER_VIRUS_ERROR,
+	STATS_PROVIDER_VIRUS_SCAN_TOTAL,
+	STATS_PROVIDER_VIRUS_SCAN_CLEAN,
+	STATS_PROVIDER_VIRUS_SCAN_INFECTED,
+	STATS_PROVIDER_VIRUS_SCAN_PHISHING,
+	STATS_PROVIDER_VIRUS_SCAN_TIME,
+	STATS_PROVIDER_VIRUS_SIGNATURES_TOTAL,
+	STATS_PROVIDER_VIRUS_SIGNATURES_LOADED,
+	STATS_PROVIDER_SPF_CHECKED,
+	STATS_PROVIDER_SPF_MISSING,
+	STATS_PROVIDER_SPF_NEUTRAL,
+	STATS_PROVIDER_SPF_ERROR,
+	STATS_PROVIDER_SPF_FAIL,
+	STATS_PROVIDER_SPF_PASS,
+	STATS_PROVIDER_DKIM_SIGNED,
+	STATS_PROVIDER_DKIM_CHECKED,
+	STATS_PROVIDER_DKIM_MISSING,
+	STATS_PROVIDER_DKIM_NEUTRAL,
+	STATS_PROVIDER_DKIM_ERROR,
+	STATS_PROVIDER_DKIM_FAIL,
+	STATS_PROVIDER_DKIM_PASS,
+	STATS_OBJECTS_USERS_TOTAL,
+	STATS_OBJECTS_USERS_EXPIRED,
+	STATS_OBJECTS_SESSIONS_TOTAL,
+	STATS_OBJECTS_SESSIONS_EXPIRED,
+	STATS_OBJECTS_MAIL_CACHE_HITS,
+	STATS_OBJECTS_MAIL_CACHE_MISSES,
+	STATS_OBJECTS_MAIL_CACHE_EVICTIONS,
+	STATS_OBJECTS_MAIL_BLOBS_STORED,
+	STATS_OBJECTS_MAIL_BLOBS_SHARED,
+	STATS_OBJECTS_PATTERNS_CHECKED,
+	STATS_OBJECTS_PATTERNS_ERROR,
+	STATS_OBJECTS_PATTERNS_FAIL,
+	STATS_OBJECTS_PATTERNS_PASS,
+	STATS_WEB_REGISTER_BLOCKED,
+	STATS_TOTAL
+} M_STATS;
+
+/**
+ * The number of slots in the table used to find statistics by name. This must be a power of two, and larger than the number of statistics.
+ */
+#define MAGMA_STATS_HASH 256
+
 uint64_t derived_count (void);
 char *derived_name (uint64_t position);
 uint64_t derived_value (uint64_t position);
 
 bool_t stats_init(void);
 void stats_shutdown(void);
+uint64_t stats_get_name_pos(char *name);
 
 uint64_t stats_get_count(void);
 char * stats_get_name(uint64_t position);
@@ -50,6 +50,13 @@
 #include <search.h>
 #include <semaphore.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+
+// SSE2 intrinsics, used by the probed index to scan its control bytes.
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // GNU C Library
 #include <gnu/libc-version.h>
@@ -696,3 +696,344 @@ bool_t ip_matches_subnet(subnet_t *subnet, ip_t *addr) {
 
 	return true;
 }
+
+/**
+ * @brief	Return the value of a single bit from an address prefix, counting from the most significant bit of the first byte.
+ * @param	prefix		a pointer to the address bytes, in network order.
+ * @param	position	the zero-indexed position of the bit to be extracted.
+ * @return	0 or 1, depending on the value of the requested bit.
+ */
+uint32_t ip_trie_bit(uchr_t *prefix, uint32_t position) {
+	return (prefix[position >> 3] >> (7 - (position & 7))) & 1;
+}
+
+/**
+ * @brief	Count the number of leading bits shared by two address prefixes.
+ * @param	a		a pointer to the first address, in network order.
+ * @param	b		a pointer to the second address, in network order.
+ * @param	limit	the maximum number of bits which should be compared.
+ * @return	the length of the common prefix, which will never exceed the limit.
+ */
+uint32_t ip_trie_common(uchr_t *a, uchr_t *b, uint32_t limit) {
+
+	uint32_t bits = 0;
+
+	for (uint32_t i = 0; bits < limit; i++) {
+
+		if (a[i] != b[i]) {
+			bits += __builtin_clz((uint32_t)(a[i] ^ b[i])) - 24;
+			break;
+		}
+
+		bits += 8;
+	}
+
+	return bits < limit ? bits : limit;
+}
+
+/**
+ * @brief	Clear every bit of an address prefix past the specified length.
+ * @param	prefix	a pointer to a sixteen byte address prefix, which will be modified in place.
+ * @param	length	the number of significant bits which should be preserved.
+ * @return	This function returns no value.
+ */
+void ip_trie_mask(uchr_t *prefix, uint32_t length) {
+
+	if (length % 8) {
+		prefix[length / 8] &= 0xff << (8 - (length % 8));
+	}
+
+	for (uint32_t i = (length + 7) / 8; i < 16; i++) {
+		prefix[i] = 0;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free an address trie node, and all of the nodes beneath it.
+ * @param	node	a pointer to the trie node to be freed.
+ * @return	This function returns no value.
+ */
+void ip_trie_node_free(ip_trie_node_t *node) {
+
+	if (node) {
+		ip_trie_node_free(node->children[0]);
+		ip_trie_node_free(node->children[1]);
+		mm_free(node);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free an address trie.
+ * @param	trie	a pointer to the trie to be freed.
+ * @return	This function returns no value.
+ */
+void ip_trie_free(ip_trie_t *trie) {
+
+	if (trie) {
+		ip_trie_node_free(trie->ipv4);
+		ip_trie_node_free(trie->ipv6);
+		mm_free(trie);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate an empty address trie.
+ * @return	NULL on failure, or a pointer to the newly allocated trie on success.
+ */
+ip_trie_t * ip_trie_alloc(void) {
+
+	ip_trie_t *trie;
+
+	if (!(trie = mm_alloc(sizeof(ip_trie_t)))) {
+		log_pedantic("Unable to allocate an address trie.");
+		return NULL;
+	}
+
+	return trie;
+}
+
+/**
+ * @brief	Add a subnet to an address trie.
+ * @note	The trie is path compressed, so a node is only created where a subnet ends, or where two subnets diverge. New nodes are
+ * 			fully initialized before a single atomic pointer store links them into the trie, which means lookups running concurrently
+ * 			will see the trie either with or without the new subnet. Callers must still make sure only one thread inserts at a time.
+ * @param	trie	a pointer to the trie which will receive the subnet.
+ * @param	subnet	a pointer to the subnet being added.
+ * @return	true if the subnet was added, or was already present, and false on failure.
+ */
+bool_t ip_trie_insert(ip_trie_t *trie, subnet_t *subnet) {
+
+	uchr_t prefix[16];
+	uint32_t common = 0, width;
+	ip_trie_node_t **slot, *node, *leaf, *branch;
+
+	if (subnet->address.family == AF_INET && subnet->mask <= 32) {
+		slot = &(trie->ipv4);
+		width = 4;
+	}
+	else if (subnet->address.family == AF_INET6 && subnet->mask <= 128) {
+		slot = &(trie->ipv6);
+		width = 16;
+	}
+	else {
+		return false;
+	}
+
+	// The host bits are cleared so they can't interfere with the prefix comparisons.
+	mm_wipe(prefix, 16);
+	mm_copy(prefix, &(subnet->address.ip), width);
+	ip_trie_mask(prefix, subnet->mask);
+
+	// Descend for as long as the node prefix is a prefix of the subnet.
+	while ((node = *slot) && (common = ip_trie_common(node->prefix, prefix, node->length < subnet->mask ? node->length : subnet->mask)) == node->length) {
+
+		// The subnet ends at a node which already exists, possibly as a branch point, so it only needs to be marked.
+		if (node->length == subnet->mask) {
+
+			if (!node->terminal) {
+				__atomic_store_n(&(node->terminal), true, __ATOMIC_RELEASE);
+				trie->count++;
+			}
+
+			return true;
+		}
+
+		slot = &(node->children[ip_trie_bit(prefix, node->length)]);
+	}
+
+	if (!(leaf = mm_alloc(sizeof(ip_trie_node_t)))) {
+		log_pedantic("Unable to allocate an address trie node.");
+		return false;
+	}
+
+	mm_copy(leaf->prefix, prefix, 16);
+	leaf->length = subnet->mask;
+	leaf->terminal = true;
+
+	// When the new subnet contains the node occupying the slot it's inserted above it. Otherwise the two diverge, and a branch node
+	// holding their common prefix takes the slot, with the existing node and the new subnet beneath it.
+	if (node && common == subnet->mask) {
+		leaf->children[ip_trie_bit(node->prefix, common)] = node;
+	}
+	else if (node) {
+
+		if (!(branch = mm_alloc(sizeof(ip_trie_node_t)))) {
+			log_pedantic("Unable to allocate an address trie node.");
+			mm_free(leaf);
+			return false;
+		}
+
+		mm_copy(branch->prefix, prefix, 16);
+		ip_trie_mask(branch->prefix, common);
+		branch->length = common;
+		branch->children[ip_trie_bit(node->prefix, common)] = node;
+		branch->children[ip_trie_bit(prefix, common)] = leaf;
+		leaf = branch;
+	}
+
+	// The release store guarantees the new nodes are visible in their entirety before they become reachable.
+	__atomic_store_n(slot, leaf, __ATOMIC_RELEASE);
+	trie->count++;
+
+	return true;
+}
+
+/**
+ * @brief	Determine whether an address falls inside any of the subnets stored in an address trie.
+ * @param	trie	a pointer to the trie to be searched.
+ * @param	addr	a pointer to the IP address of interest.
+ * @return	true if the address matched at least one subnet, or false if it did not.
+ */
+bool_t ip_trie_match(ip_trie_t *trie, ip_t *addr) {
+
+	uchr_t *bytes = (uchr_t *)&(addr->ip);
+	ip_trie_node_t *node;
+
+	if (addr->family == AF_INET) {
+		node = __atomic_load_n(&(trie->ipv4), __ATOMIC_ACQUIRE);
+	}
+	else if (addr->family == AF_INET6) {
+		node = __atomic_load_n(&(trie->ipv6), __ATOMIC_ACQUIRE);
+	}
+	else {
+		return false;
+	}
+
+	// Every subnet containing the address lies along a single path, so the first subnet encountered is sufficient.
+	while (node && ip_trie_common(node->prefix, bytes, node->length) == node->length) {
+
+		if (__atomic_load_n(&(node->terminal), __ATOMIC_ACQUIRE)) {
+			return true;
+		}
+
+		node = __atomic_load_n(&(node->children[ip_trie_bit(bytes, node->length)]), __ATOMIC_ACQUIRE);
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Allocate an empty subnet list.
+ * @note	Subnet lists wrap an address trie so it can be searched by any number of threads without locking, while still being
+ * 			extended, or replaced outright, at runtime.
+ * @return	NULL on failure, or a pointer to the newly allocated subnet list on success.
+ */
+ip_list_t * ip_list_alloc(void) {
+
+	ip_list_t *list;
+
+	if (!(list = mm_alloc(sizeof(ip_list_t)))) {
+		log_pedantic("Unable to allocate a subnet list.");
+		return NULL;
+	}
+	else if (!(list->trie = ip_trie_alloc())) {
+		mm_free(list);
+		return NULL;
+	}
+	else if (mutex_init(&(list->lock), NULL)) {
+		log_pedantic("Unable to initialize the subnet list mutex.");
+		ip_trie_free(list->trie);
+		mm_free(list);
+		return NULL;
+	}
+
+	return list;
+}
+
+/**
+ * @brief	Free a subnet list.
+ * @note	The caller must ensure the list is no longer being searched.
+ * @param	list	a pointer to the subnet list to be freed.
+ * @return	This function returns no value.
+ */
+void ip_list_free(ip_list_t *list) {
+
+	if (list) {
+		mutex_destroy(&(list->lock));
+		ip_trie_free(list->trie);
+		mm_free(list);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Add a subnet to the trie currently published by a subnet list.
+ * @param	list	a pointer to the subnet list being updated.
+ * @param	subnet	a pointer to the subnet being added.
+ * @return	true if the subnet was added, or false on failure.
+ */
+bool_t ip_list_add(ip_list_t *list, subnet_t *subnet) {
+
+	bool_t result;
+
+	mutex_lock(&(list->lock));
+	result = ip_trie_insert(list->trie, subnet);
+	mutex_unlock(&(list->lock));
+
+	return result;
+}
+
+/**
+ * @brief	Replace the trie published by a subnet list, and free the previous trie once no lookup can still be using it.
+ * @note	Lookups register with the reader counter for the current epoch. After the swap, the epoch is flipped and the counter for
+ * 			the epoch being retired is drained, twice over, which covers both counters while still letting new lookups proceed.
+ * @param	list	a pointer to the subnet list being updated.
+ * @param	trie	a pointer to the replacement trie, which becomes owned by the list.
+ * @return	This function returns no value.
+ */
+void ip_list_swap(ip_list_t *list, ip_trie_t *trie) {
+
+	uint32_t epoch;
+	ip_trie_t *previous;
+
+	mutex_lock(&(list->lock));
+
+	previous = __atomic_exchange_n(&(list->trie), trie, __ATOMIC_SEQ_CST);
+
+	for (int_t i = 0; i < 2; i++) {
+
+		epoch = __sync_fetch_and_xor(&(list->epoch), 1) & 1;
+
+		while (__sync_fetch_and_add(&(list->readers[epoch]), 0)) {
+			sched_yield();
+		}
+	}
+
+	mutex_unlock(&(list->lock));
+	ip_trie_free(previous);
+
+	return;
+}
+
+/**
+ * @brief	Determine whether an address falls inside any of the subnets held by a subnet list.
+ * @note	This function never blocks, and is safe to call while the list is being updated.
+ * @param	list	a pointer to the subnet list to be searched.
+ * @param	addr	a pointer to the IP address of interest.
+ * @return	true if the address matched at least one subnet, or false if it did not.
+ */
+bool_t ip_list_match(ip_list_t *list, ip_t *addr) {
+
+	bool_t result;
+	uint32_t epoch;
+
+	if (!list || !addr) {
+		return false;
+	}
+
+	epoch = __sync_fetch_and_add(&(list->epoch), 0) & 1;
+	__sync_fetch_and_add(&(list->readers[epoch]), 1);
+
+	result = ip_trie_match(__atomic_load_n(&(list->trie), __ATOMIC_ACQUIRE), addr);
+
+	__sync_fetch_and_sub(&(list->readers[epoch]), 1);
+
+	return result;
+}
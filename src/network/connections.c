@@ -54,54 +54,57 @@ void con_destroy(connection_t *con) {
 
 	if (con && !con_decrement_refs(con)) {
 
+		// Send whatever is left in the output buffer, before the session state and the socket are torn down.
+		con_flush(con);
+
 		switch (con->server->protocol) {
 			case (POP):
 
 				if (con->network.ssl) {
-					stats_decrement_by_name("pop.connections.secure");
+					stats_decrement_by_num(STATS_POP_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("pop.connections.total");
+				stats_decrement_by_num(STATS_POP_CONNECTIONS_TOTAL);
 				pop_session_destroy(con);
 				break;
 			case (IMAP):
 				if (con->network.ssl) {
-					stats_decrement_by_name("imap.connections.secure");
+					stats_decrement_by_num(STATS_IMAP_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("imap.connections.total");
+				stats_decrement_by_num(STATS_IMAP_CONNECTIONS_TOTAL);
 				imap_session_destroy(con);
 				break;
 			case (HTTP):
 				if (con->network.ssl) {
-					stats_decrement_by_name("http.connections.secure");
+					stats_decrement_by_num(STATS_HTTP_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("http.connections.total");
+				stats_decrement_by_num(STATS_HTTP_CONNECTIONS_TOTAL);
 				http_session_destroy(con);
 				break;
 			case (SMTP):
 				if (con->network.ssl) {
-					stats_decrement_by_name("smtp.connections.secure");
+					stats_decrement_by_num(STATS_SMTP_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("smtp.connections.total");
+				stats_decrement_by_num(STATS_SMTP_CONNECTIONS_TOTAL);
 				smtp_session_destroy(con);
 				break;
 			case (SUBMISSION):
 				if (con->network.ssl) {
-					stats_decrement_by_name("smtp.connections.secure");
+					stats_decrement_by_num(STATS_SMTP_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("smtp.connections.total");
+				stats_decrement_by_num(STATS_SMTP_CONNECTIONS_TOTAL);
 				smtp_session_destroy(con);
 				break;
 			case (MOLTEN):
 				if (con->network.ssl) {
-					stats_decrement_by_name("molten.connections.secure");
+					stats_decrement_by_num(STATS_MOLTEN_CONNECTIONS_SECURE);
 				}
 
-				stats_decrement_by_name("molten.connections.total");
+				stats_decrement_by_num(STATS_MOLTEN_CONNECTIONS_TOTAL);
 				molten_session_destroy(con);
 				break;
 			default:
@@ -117,7 +120,9 @@ void con_destroy(connection_t *con) {
 		}
 
 		st_cleanup(con->network.buffer);
+		st_cleanup(con->network.output);
 		st_cleanup(con->network.reverse.domain);
+		pthread_cond_destroy(&(con->network.reverse.ready));
 		mutex_destroy(&(con->lock));
 		mm_free(con);
 	}
@@ -197,6 +202,11 @@ connection_t * con_init(int cond, server_t *server) {
 		mm_free(con);
 		return NULL;
 	}
+	else if (pthread_cond_init(&(con->network.reverse.ready), NULL)) {
+		mutex_destroy(&(con->lock));
+		mm_free(con);
+		return NULL;
+	}
 
 	con->network.sockd = cond;
 	con->server = server;
@@ -44,15 +44,37 @@ typedef struct {
 } http_data_t;
 
 typedef struct {
-	stringer_t *location, *resource, *type;
+	placer_t id;
+	uint32_t depth, skip;
+	size_t name, start, open, close, end;
+} http_slot_t;
+
+typedef struct {
+	uint32_t count;
+	http_slot_t *slots;
+} http_template_t;
+
+typedef struct {
+	uint64_t hash;
+	stringer_t *location, *resource, *type, *gzip;
+	http_template_t *compiled;
 	struct http_content_t *next;
 } http_content_t;
 
 typedef struct {
-	xmlDocPtr doc_obj;
+	stringer_t *name, *value;
+	struct http_property_t *next;
+} http_property_t;
+
+typedef struct {
+	stringer_t *content, *sibling;
+	http_property_t *properties;
+} http_change_t;
+
+typedef struct {
+	size_t length;
+	http_change_t *changes;
 	http_content_t *content;
-	xmlParserCtxtPtr doc_ctx;
-	xmlXPathContextPtr xpath_ctx;
 } http_page_t;
 
 typedef struct {
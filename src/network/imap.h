@@ -27,9 +27,22 @@ typedef struct {
 
 typedef struct {
 	stringer_t *key, *value;
+	void *cache; /* An optional reference to a cached message, which holds literal data written after the value. */
+	size_t offset, length;
 	struct imap_fetch_response_t *next;
 } imap_fetch_response_t;
 
+typedef struct imap_search_node_t {
+	int_t type; /* The test performed by the node. */
+	bool_t content; /* Set if the node, or any of its children, needs to examine the message content. */
+	uint32_t mask, flags; /* Flag tests compare the status bits selected by the mask with the expected flags. */
+	uint64_t number; /* The size, or calendar day (formatted as YYYYMMDD) used by size and date tests. */
+	uint64_t *ranges, count; /* Pairs of inclusive bounds used by sequence and UID tests. The asterisk is stored as UINT64_MAX. */
+	stringer_t *field, *value; /* The header field and search string used by content tests. Both reference the command arguments. */
+	fulltext_result_t *matches; /* The indexed messages which could contain a body or text search string, and still need to be scanned. */
+	struct imap_search_node_t *children, *next;
+} imap_search_node_t;
+
 typedef struct {
 	meta_user_t *user;
 	imap_arguments_t *arguments;
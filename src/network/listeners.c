@@ -12,21 +12,176 @@
 
 #include "magma.h"
 
+struct {
+	uint32_t count;
+	acceptor_t *list;
+} acceptors = {
+		.count = 0,
+		.list = NULL
+};
+
+/**
+ * @brief	Accept a connection from a listening socket.
+ * @note	The accepted socket is marked close-on-exec atomically, but is left in blocking mode since the connection layer relies on the socket
+ * 			timeouts to bound its blocking reads and writes.
+ * @param	sd	the listening socket descriptor.
+ * @return	-1 on failure, or the descriptor of the newly accepted connection.
+ */
+int net_accept(int sd) {
+
+	return accept4(sd, NULL, NULL, SOCK_CLOEXEC);
+}
+
+/**
+ * @brief	Accept every pending connection on a listening socket and dispatch them to the protocol-specific handlers.
+ * @param	server	the server instance that owns the listening socket.
+ * @param	sd		the listening socket descriptor.
+ * @return	This function returns no value.
+ */
+void net_accept_all(server_t *server, int sd) {
+
+	int connection;
+
+	do {
+
+		// Keep calling accept until it fails.
+		if ((connection = net_accept(sd)) != -1) {
+			protocol_process(server, connection);
+		}
+		// Keep calling accept until we get an error, but only log errors that are unexpected.
+		else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			log_info("Socket connection attempt failed. { accept = -1 / error = %s}", strerror_r(errno, bufptr, buflen));
+		}
+
+	} while (connection != -1);
+
+	return;
+}
+
+/**
+ * @brief	The entry point for the threads servicing the additional listening sockets of a server instance.
+ * @note	Each acceptor thread is pinned to its own processor core, and only watches a single socket, so the kernel can spread inbound
+ * 			connections evenly across the acceptors.
+ * @param	acceptor	a pointer to the acceptor structure describing the socket to be serviced.
+ * @return	This function always returns NULL.
+ */
+void * net_acceptor(acceptor_t *acceptor) {
+
+	int ed, ready;
+	struct epoll_event epoll_context, event;
+
+	thread_affinity(pthread_self(), acceptor->core);
+	mm_wipe(&epoll_context, sizeof(struct epoll_event));
+
+	if ((ed = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		log_critical("The epoll_create() call returned an error. {%s}", strerror_r(errno, bufptr, buflen));
+		status_set(-2);
+		return NULL;
+	}
+
+	epoll_context.events = EPOLLIN | EPOLLET;
+	epoll_context.data.fd = acceptor->sockd;
+
+	if ((epoll_ctl(ed, EPOLL_CTL_ADD, acceptor->sockd, &epoll_context)) == -1) {
+		log_critical("The epoll_ctl() call returned an error. {%s}", strerror_r(errno, bufptr, buflen));
+		status_set(-2);
+		close(ed);
+		return NULL;
+	}
+
+	while (status()) {
+
+		if ((ready = epoll_wait(ed, &event, 1, 100)) < 0 && errno != EINTR) {
+			log_info("The connection accepter returned an error. { epoll_wait = -1 / error = %s }", strerror_r(errno, bufptr, buflen));
+		}
+		else if (ready > 0 && !(event.events & (EPOLLERR | EPOLLHUP))) {
+			net_accept_all(acceptor->server, acceptor->sockd);
+		}
+
+	}
+
+	close(ed);
+	return NULL;
+}
+
+/**
+ * @brief	Launch an acceptor thread for every additional listening socket bound by the configured server instances.
+ * @return	true if all of the acceptor threads were launched, or false on failure.
+ */
+bool_t net_acceptors_start(void) {
+
+	server_t *server;
+	uint32_t total = 0;
+
+	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
+		if ((server = magma.servers[i]) && server->network.listeners > 1) {
+			total += server->network.listeners - 1;
+		}
+	}
+
+	if (!total) {
+		return true;
+	}
+	else if (!(acceptors.list = mm_alloc(sizeof(acceptor_t) * total))) {
+		log_critical("Unable to allocate the acceptor thread list.");
+		return false;
+	}
+
+	// The first socket of every server is serviced by the main listener, so the acceptor threads are pinned starting with the second core.
+	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
+		for (uint32_t j = 1; (server = magma.servers[i]) && j < server->network.listeners; j++) {
+
+			(acceptors.list + acceptors.count)->server = server;
+			(acceptors.list + acceptors.count)->sockd = server->network.sockets[j];
+			(acceptors.list + acceptors.count)->core = acceptors.count + 1;
+
+			if (thread_launch(&((acceptors.list + acceptors.count)->thread), &net_acceptor, acceptors.list + acceptors.count)) {
+				log_critical("Unable to launch the configured number of acceptor threads. {threads = %u / configured = %u}", acceptors.count, total);
+				return false;
+			}
+
+			acceptors.count++;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Wait for the acceptor threads to notice the daemon is shutting down, and then release the acceptor thread list.
+ * @return	This function returns no value.
+ */
+void net_acceptors_stop(void) {
+
+	for (uint32_t i = 0; i < acceptors.count; i++) {
+		thread_join((acceptors.list + i)->thread);
+	}
+
+	mm_cleanup(acceptors.list);
+	acceptors.list = NULL;
+	acceptors.count = 0;
+
+	return;
+}
+
 /**
  * @brief	The main network handler entry point; poll the listening socket of each configured protocol server, and dispatch the
  * 			protocol-specific handler for any inbound client connection that is accepted.
- * @see		protocol_process()
+ * @note	The parking descriptor is polled alongside the listening sockets, so idle connections are handed back to the worker threads as soon
+ * 			as their clients send more data. Servers configured with multiple listeners have their additional sockets serviced by dedicated
+ * 			acceptor threads. Connections which stay parked past their idle timeout are destroyed by the same loop.
+ * @see		protocol_process(), parking_wake(), parking_sweep(), net_acceptor()
  * @return	This function returns no value.
  */
 void net_listen(void) {
 
+	int ed, ready;
 	server_t *server;
-	int ed, ready, connection;
-	struct epoll_event epoll_context, events[MAGMA_SERVER_INSTANCES];
+	struct epoll_event epoll_context, events[MAGMA_SERVER_INSTANCES + 1];
 
 	mm_wipe(&epoll_context, sizeof(struct epoll_event));
 
-	if ((ed = epoll_create(MAGMA_SERVER_INSTANCES)) == -1) {
+	if ((ed = epoll_create(MAGMA_SERVER_INSTANCES + 1)) == -1) {
 		log_critical("The epoll_create() call returned an error. {%s}", strerror_r(errno, bufptr, buflen));
 		status_set(-2);
 		return;
@@ -49,11 +204,26 @@ void net_listen(void) {
 
 	}
 
+	// The parking descriptor is level triggered, so it will keep waking us until every ready connection has been dispatched.
+	epoll_context.events = EPOLLIN;
+	epoll_context.data.fd = parking_descriptor();
+
+	if ((epoll_ctl(ed, EPOLL_CTL_ADD, epoll_context.data.fd, &epoll_context)) == -1) {
+		log_info("The epoll_ctl() call returned an error. {%s}", strerror_r(errno, bufptr, buflen));
+		status_set(-2);
+		return;
+	}
+
+	// Any sockets bound beyond the first one would never be serviced if their acceptor failed to launch, so treat that as a fatal error.
+	if (!net_acceptors_start()) {
+		status_set(-2);
+	}
+
 	// Keep looping until its time for the daemon to shutdown.
 	while (status()) {
 
 		// Get back a list of sockets ready for data.
-		if ((ready = epoll_wait(ed, &events[0], MAGMA_SERVER_INSTANCES, 100)) < 0 && errno != EINTR) {
+		if ((ready = epoll_wait(ed, &events[0], MAGMA_SERVER_INSTANCES + 1, 100)) < 0 && errno != EINTR) {
 			log_info("The connection accepter returned an error. { epoll_wait = -1 / error = %s }", strerror_r(errno, bufptr, buflen));
 		}
 		// Skip socket processing if a timeout occurs.
@@ -61,70 +231,78 @@ void net_listen(void) {
 
 			for (int i = 0; i < ready; i++) {
 
+				// Hand any parked connections that have become readable back to the worker threads.
+				if (events[i].data.fd == parking_descriptor()) {
+					parking_wake();
+				}
 				// Determine which server instance is responsible for the requested port.
-				if (!(server = servers_get_by_socket(events[i].data.fd))) {
+				else if (!(server = servers_get_by_socket(events[i].data.fd))) {
 					log_info("Unable to locate the server structure for a socket descriptor. {%i}", events[i].data.fd);
 				}
 				// Don't bother trying to accept connections on sockets indicating an error event.
 				else if (!(events[i].events & (EPOLLERR | EPOLLHUP))) {
-
-					do {
-
-						// Keep calling accept until it fails.
-						if ((connection = accept(events[i].data.fd, NULL, NULL)) != -1) {
-							protocol_process(server, connection);
-						}
-						// Keep calling accept until we get an error, but only log errors that are unexpected.
-						else if (errno != EAGAIN && errno == EWOULDBLOCK) {
-							log_info("Socket connection attempt failed. { accept = -1 / error = %s}", strerror_r(errno, bufptr, buflen));
-						}
-
-					} while (connection != -1);
-
+					net_accept_all(server, events[i].data.fd);
 				}
 			}
 		}
+
+		// Drop any clients that have stayed silent past the server timeout while parked.
+		parking_sweep();
 	}
 
+	net_acceptors_stop();
+
+	// Release any connections that were still waiting on their clients so the workers can close them.
+	parking_flush();
 	close(ed);
 
 	return;
 }
 
 /**
- * @brief	Initialize a server and listen for connections.
- * @note	Each server listens on either an ipv4 or ipv6 address in non-blocking mode, and will be bound and listen on the configured port.
- * @param	server	a pointer to the server object to be initialized.
- * @result	true on successful initialization of the server, or false on failure.
+ * @brief	Create a listening socket for a server instance.
+ * @note	The socket is non-blocking, and bound to either the ipv4 or ipv6 wildcard address using the configured port.
+ * @param	server	a pointer to the server object being initialized.
+ * @param	shared	if true, the socket is created with SO_REUSEPORT so it can share the port with the other sockets bound by the server.
+ * @return	-1 on failure, or the listening socket descriptor on success.
  */
-bool_t net_init(server_t *server) {
+int net_bind(server_t *server, bool_t shared) {
 
 	int sd;
 	struct sockaddr_in sin4;
 	struct sockaddr_in6 sin6;
 
 	// Create the socket.
-	if ((sd = socket(server->network.ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0)) == -1) {
+	if ((sd = socket(server->network.ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
 		log_critical("Error while calling socket.");
-		return false;
+		return -1;
 	}
 
 	// Set non-blocking IO.
 	if (!net_set_non_blocking(sd, false)) {
-    log_critical("Error attempting to setup non-blocking IO.");
-		return false;
-  }
+		log_critical("Error attempting to setup non-blocking IO.");
+		close(sd);
+		return -1;
+	}
 
 	// Make this a reusable socket.
 	if (!net_set_reuseable_address(sd, true)) {
 		log_critical("Could not make the socket reusable.");
-		return false;
+		close(sd);
+		return -1;
+	}
+
+	// Sharing the port has to be requested on every socket before any of them are bound.
+	if (shared && !net_set_reuseable_port(sd, true)) {
+		log_critical("Could not configure the socket to share its port.");
+		close(sd);
+		return -1;
 	}
 
 	if (!net_set_buffer_length(sd, magma.system.network_buffer, magma.system.network_buffer)) {
 		log_critical("Could not configure the socket buffer size.");
-		return false;
-
+		close(sd);
+		return -1;
 	}
 
 	// Zero out the server socket structure, and set the values.
@@ -137,7 +315,8 @@ bool_t net_init(server_t *server) {
 		// Bind the socket.
 		if (bind(sd, (struct sockaddr *)&sin6, sizeof(sin6)) == -1) {
 			log_critical("Error while binding to socket. Attempting to use port %u.", server->network.port);
-			return false;
+			close(sd);
+			return -1;
 		}
 	}
 	else {
@@ -149,27 +328,59 @@ bool_t net_init(server_t *server) {
 		// Bind the socket.
 		if (bind(sd, (struct sockaddr *)&sin4, sizeof(sin4)) == -1) {
 			log_critical("Error while binding to socket. Attempting to use port %u.", server->network.port);
-			return false;
+			close(sd);
+			return -1;
 		}
 	}
 
 	// Start listening for incoming connections. We set the queue to our config file listen queue value.
 	if (listen(sd, server->network.listen_queue) == -1) {
 		log_critical("Error while listening to socket. Attempting to use port %u.", server->network.port);
-		return false;
+		close(sd);
+		return -1;
 	}
 
-	// Store the socket descriptor elsewhere, so it can be shutdown later.
-	server->network.sockd = sd;
+	return sd;
+}
+
+/**
+ * @brief	Initialize a server and listen for connections.
+ * @note	Each server listens on either an ipv4 or ipv6 address in non-blocking mode, and will be bound and listen on the configured port. If
+ * 			the server is configured with more than one listener, every socket shares the port using SO_REUSEPORT.
+ * @param	server	a pointer to the server object to be initialized.
+ * @result	true on successful initialization of the server, or false on failure.
+ */
+bool_t net_init(server_t *server) {
+
+	bool_t shared = server->network.listeners > 1;
+
+	for (uint32_t i = 0; i < server->network.listeners && i < MAGMA_SERVER_LISTENERS; i++) {
+
+		// Store the socket descriptors elsewhere, so they can be shutdown later.
+		if ((server->network.sockets[i] = net_bind(server, shared)) == -1) {
+			net_shutdown(server);
+			return false;
+		}
+
+	}
+
+	server->network.sockd = server->network.sockets[0];
 
 	return true;
 }
 
 /**
- * @brief	Close the listening socket associated with a server.
+ * @brief	Close the listening sockets associated with a server.
  * @return	This function returns no value.
  */
 void net_shutdown(server_t *server) {
 
-	close(server->network.sockd);
+	for (uint32_t i = 0; i < MAGMA_SERVER_LISTENERS; i++) {
+		if (server->network.sockets[i] != -1) {
+			close(server->network.sockets[i]);
+			server->network.sockets[i] = -1;
+		}
+	}
+
+	server->network.sockd = -1;
 }
@@ -96,6 +96,10 @@ typedef struct {
 	struct {
 		uint64_t user, messages, folders, contacts;
 	} serials;
+	struct {
+		time_t stamp; /* When the messages collection was last synchronized. */
+		uint64_t checkpoint; /* The highest message change number applied to the messages collection. */
+	} changes;
 	struct {
 		time_t stamp;
 		uint64_t smtp, pop, imap, web, generic;
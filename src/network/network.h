@@ -25,6 +25,25 @@
 			uint32_t mask;
 			ip_t address;
 		} subnet_t;
+
+		typedef struct ip_trie_node_t {
+			uchr_t prefix[16]; /* The prefix bits, with everything past the length cleared. */
+			uint32_t length; /* The number of significant bits in the prefix. */
+			bool_t terminal; /* Set if a subnet ends at this node, instead of the node only being a branch point. */
+			struct ip_trie_node_t *children[2]; /* The subtrees for prefixes continuing with a zero bit, or a one bit. */
+		} ip_trie_node_t;
+
+		typedef struct {
+			uint64_t count; /* The number of subnets in the trie. */
+			ip_trie_node_t *ipv4, *ipv6; /* Separate tries are used for each address family. */
+		} ip_trie_t;
+
+		typedef struct {
+			ip_trie_t *trie; /* The published trie, which is only ever replaced via ip_list_swap(). */
+			uint32_t epoch; /* Selects which reader counter new lookups register with. */
+			uint64_t readers[2]; /* The number of lookups in progress, for each epoch. */
+			pthread_mutex_t lock; /* Serializes updates. Lookups never take the lock. */
+		} ip_list_t;
 	#define GOT_IP_T_DEFINITION
 	#endif
 #endif
@@ -45,6 +64,13 @@
 typedef int16_t octet_t;
 typedef int32_t segment_t;
 
+enum {
+	DNS_ERROR = -1,
+	DNS_PENDING = 0,
+	DNS_SUCCESS = 1,
+	DNS_NOTFOUND = 2
+};
+
 enum {
 	REVERSE_ERROR = -1,
 	REVERSE_EMPTY = 0,
@@ -58,6 +84,13 @@ typedef struct {
 	void *function;
 } command_t;
 
+typedef struct {
+	int_t status; /* The outcome of the lookup, either DNS_SUCCESS, DNS_NOTFOUND or DNS_ERROR. */
+	uint32_t ttl; /* The number of seconds the answer remains valid. */
+	uint32_t count; /* The number of records in the answer. */
+	stringer_t *records[MAGMA_DNS_RECORDS]; /* The records of the requested type, in presentation format. */
+} dns_answer_t;
+
 // Setup the structure of variables used to relay and bounce messages.
 typedef struct {
 	void *ssl; /* The SSL connection object. */
@@ -86,12 +119,21 @@ typedef struct {
 		int status; /* Track whether the last network operation generated an error. */
 		placer_t line; /* The current line being processed. */
 		stringer_t *buffer; /* The connection buffer. */
+		stringer_t *output; /* Response data waiting to be flushed to the client. */
 
 		struct {
 			int_t status;
 			stringer_t *domain;
+			pthread_cond_t ready; /* Signaled when the lookup finishes. */
 		} reverse;
 
+		struct {
+			bool_t registered; /* Whether the socket has been added to the parking descriptor. */
+			void *function; /* The protocol handler to dispatch once the connection becomes readable. */
+			time_t stamp; /* When the connection was parked, so idle clients can be dropped once the server timeout expires. */
+			uint32_t timeout; /* If set, the number of idle seconds allowed while parked, in place of the server timeout. */
+		} park;
+
 	} network;
 	uint64_t refs; /* The number of memory references or threads pointing at this structure. */
 	pthread_mutex_t lock; /* The mutex used for locking during non-thread save operations. */
@@ -99,6 +141,13 @@ typedef struct {
 	command_t *command; /* The command structure. */
 } connection_t;
 
+typedef struct {
+	int sockd; /* The listening socket serviced by the acceptor. */
+	uint32_t core; /* The processor core the acceptor thread is pinned to. */
+	pthread_t thread; /* The acceptor thread. */
+	server_t *server; /* The server instance that owns the listening socket. */
+} acceptor_t;
+
 /// addresses.c
 ip_t *        con_addr(connection_t *con, ip_t *output);
 octet_t       con_addr_octet(connection_t *con, int_t position);
@@ -120,6 +169,19 @@ uint32_t      ip_word(ip_t *address, int_t position);
 bool_t        ip_str_addr(chr_t *ipstr, ip_t *out);
 bool_t        ip_str_subnet(chr_t *substr, subnet_t *out);
 bool_t        ip_matches_subnet(subnet_t *subnet, ip_t *addr);
+bool_t        ip_list_add(ip_list_t *list, subnet_t *subnet);
+ip_list_t *   ip_list_alloc(void);
+void          ip_list_free(ip_list_t *list);
+bool_t        ip_list_match(ip_list_t *list, ip_t *addr);
+void          ip_list_swap(ip_list_t *list, ip_trie_t *trie);
+ip_trie_t *   ip_trie_alloc(void);
+uint32_t      ip_trie_bit(uchr_t *prefix, uint32_t position);
+uint32_t      ip_trie_common(uchr_t *a, uchr_t *b, uint32_t limit);
+void          ip_trie_free(ip_trie_t *trie);
+bool_t        ip_trie_insert(ip_trie_t *trie, subnet_t *subnet);
+void          ip_trie_mask(uchr_t *prefix, uint32_t length);
+bool_t        ip_trie_match(ip_trie_t *trie, ip_t *addr);
+void          ip_trie_node_free(ip_trie_node_t *node);
 
 
 /// connections.c
@@ -144,6 +206,7 @@ bool_t   net_set_linger(int sd, bool_t linger, int_t timeout);
 bool_t   net_set_nodelay(int sd, bool_t nodelay);
 bool_t   net_set_non_blocking(int sd, bool_t blocking);
 bool_t   net_set_reuseable_address(int sd, bool_t reuse);
+bool_t   net_set_reuseable_port(int sd, bool_t reuse);
 bool_t   net_set_timeout(int sd, uint32_t timeout_recv, uint32_t timeout_send);
 
 /// read.c
@@ -152,15 +215,47 @@ int64_t   client_read_line(client_t *client);
 int64_t   con_read(connection_t *con);
 int64_t   con_read_line(connection_t *con, bool_t block);
 
+/// parking.c
+void     con_park(connection_t *con, void *function);
+void     con_park_dispatch(connection_t *con);
+void     con_park_expire(connection_t *con);
+bool_t   con_park_pending(connection_t *con);
+int      parking_descriptor(void);
+void     parking_flush(void);
+bool_t   parking_start(void);
+void     parking_stop(void);
+void     parking_sweep(void);
+void     parking_wake(void);
+
+/// resolver.c
+void            dns_answer_clear(dns_answer_t *answer);
+dns_answer_t *  dns_answer_copy(dns_answer_t *output, dns_answer_t *answer);
+bool_t          dns_cache_get(uint64_t hash, uint16_t type, chr_t *name, dns_answer_t *output);
+void            dns_cache_set(uint64_t hash, uint16_t type, chr_t *name, dns_answer_t *answer);
+uint64_t        dns_clock(void);
+void            dns_engine(void);
+size_t          dns_name_normalize(chr_t *name, chr_t *output);
+int_t           dns_name_read(uchr_t *packet, size_t length, size_t offset, chr_t *output, size_t *next);
+void            dns_query(chr_t *name, uint16_t type, void *function, void *data);
+void            dns_resolve(uint32_t count, chr_t **names, uint16_t type, dns_answer_t *answers);
+bool_t          dns_server_add(chr_t *address);
+bool_t          dns_start(void);
+void            dns_stop(void);
+
 /// reverse.c
 stringer_t *  con_reverse_check(connection_t *con, uint32_t timeout);
+void          con_reverse_complete(dns_answer_t *answer, connection_t *con);
 void          con_reverse_domain(connection_t *con, stringer_t *domain, int_t status);
 void          con_reverse_enqueue(connection_t *con);
-void          con_reverse_lookup(connection_t *con);
 void          con_reverse_status(connection_t *con, int_t status);
 
 /// listeners.c
 int      net_accept(int sd);
+void     net_accept_all(server_t *server, int sd);
+void *   net_acceptor(acceptor_t *acceptor);
+bool_t   net_acceptors_start(void);
+void     net_acceptors_stop(void);
+int      net_bind(server_t *server, bool_t shared);
 bool_t   net_init(server_t *server);
 void     net_listen(void);
 void     net_shutdown(server_t *server);
@@ -168,8 +263,10 @@ void     net_shutdown(server_t *server);
 /// write.c
 int64_t   client_print(client_t *client, chr_t *format, ...);
 int64_t   client_write(client_t *client, stringer_t *s);
+int64_t   con_flush(connection_t *con);
 int64_t   con_print(connection_t *con, chr_t *format, ...);
 int64_t   con_write_bl(connection_t *con, char *block, size_t length);
+int64_t   con_write_file(connection_t *con, int fd, off_t offset, size_t length);
 int64_t   con_write_ns(connection_t *con, char *string);
 int64_t   con_write_pl(connection_t *con, placer_t string);
 int64_t   con_write_st(connection_t *con, stringer_t *string);
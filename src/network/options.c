@@ -98,6 +98,25 @@ bool_t net_set_reuseable_address(int sd, bool_t reuse) {
 	return true;
 }
 
+/**
+ * @brief	Set the reusable port flag for a socket, which allows several sockets to bind the same port and have the kernel balance
+ * 			incoming connections between them.
+ * @param	sd		the socket descriptor to be adjusted.
+ * @param	reuse	a boolean variable specifying whether the listening port should be shared or not.
+ * @return	true if the flag was successfully set or false on failure.
+ */
+bool_t net_set_reuseable_port(int sd, bool_t reuse) {
+
+	int val = (reuse ? 1 : 0);
+
+	if (setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)))  {
+		log_pedantic("Socket port reuse configuration failed. {%s}", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * @brief	Set the blocking flag for a socket.
  * @param	sd			the socket descriptor to be adjusted.
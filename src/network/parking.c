@@ -0,0 +1,298 @@
+
+/**
+ * @file /magma/network/parking.c
+ *
+ * @brief	Functions used to park idle connections until their socket becomes readable, so they don't pin a worker thread while the
+ * 			client is thinking.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+// The maximum number of ready connections collected by a single dispatch pass.
+#define MAGMA_PARKING_EVENTS 256
+
+struct {
+	int ed;
+	time_t swept; /* When the parked connections were last checked for idle clients. */
+	inx_t *connections;
+} parking = {
+		.ed = -1,
+		.swept = 0,
+		.connections = NULL
+};
+
+/**
+ * @brief	Determine whether a connection already has a complete line of input waiting in its buffers.
+ * @note	Data that has already been decrypted by the SSL library won't trigger a readiness event on the socket, so it must be checked for explicitly.
+ * @param	con		the connection to be examined.
+ * @return	true if the connection can be serviced without reading from the network, or false if it must wait for more data.
+ */
+bool_t con_park_pending(connection_t *con) {
+
+	size_t length;
+
+	// If there is data past the current line, and it contains a line terminator, the next read will be satisfied from the buffer.
+	if (con->network.buffer && (length = st_length_get(con->network.buffer)) > pl_length_get(con->network.line) &&
+		memchr(st_char_get(con->network.buffer) + pl_length_get(con->network.line), '\n', length - pl_length_get(con->network.line))) {
+		return true;
+	}
+	else if (con->network.ssl && SSL_pending_d(con->network.ssl) > 0) {
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Remove a connection from the parking lot and hand it to a worker thread.
+ * @note	The connection is only dispatched if it could be removed from the registry, which ensures a connection woken by the listener and
+ * 			swept up by parking_flush() at the same time is only enqueued once.
+ * @param	con		the parked connection.
+ * @return	This function returns no value.
+ */
+void con_park_dispatch(connection_t *con) {
+
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = con->network.sockd };
+
+	if (inx_delete(parking.connections, key)) {
+		stats_decrement_by_num(STATS_CORE_NETWORK_PARKED);
+		enqueue(con->network.park.function, con);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Remove an idle connection from the parking lot and destroy it.
+ * @note	Like con_park_dispatch(), the connection is only touched if it could be removed from the registry. The socket is also removed from
+ * 			the parking descriptor before the connection is released, so a readiness event can't arrive for a connection that no longer exists.
+ * @param	con		the parked connection.
+ * @return	This function returns no value.
+ */
+void con_park_expire(connection_t *con) {
+
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = con->network.sockd };
+
+	if (inx_delete(parking.connections, key)) {
+
+		if (epoll_ctl(parking.ed, EPOLL_CTL_DEL, con->network.sockd, NULL) == -1) {
+			log_pedantic("Unable to remove an idle connection from the parking descriptor. {sockd = %i / error = %s}", con->network.sockd,
+				strerror_r(errno, bufptr, buflen));
+		}
+
+		con->network.park.registered = false;
+		stats_decrement_by_num(STATS_CORE_NETWORK_PARKED);
+
+		// Shutting down an SSL session can block, so the connection is released by a worker rather than the listener.
+		enqueue(&con_destroy, con);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Park a connection until its socket is readable, and then enqueue the specified function to service it.
+ * @note	If data is already buffered, the daemon is shutting down, or the socket can't be registered, the function is enqueued immediately.
+ * @param	con			the connection to be parked.
+ * @param	function	the protocol handler that should be dispatched once the client sends more data.
+ * @return	This function returns no value.
+ */
+void con_park(connection_t *con, void *function) {
+
+	int operation;
+	struct epoll_event event;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = con->network.sockd };
+
+	// The client won't send anything else until it has seen our response.
+	con_flush(con);
+
+	if (!status() || parking.ed == -1 || con->network.sockd == -1 || con_park_pending(con)) {
+		enqueue(function, con);
+		return;
+	}
+
+	mm_wipe(&event, sizeof(struct epoll_event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = con;
+
+	con->network.park.function = function;
+	con->network.park.stamp = time(NULL);
+
+	stats_increment_by_num(STATS_CORE_NETWORK_PARKED);
+
+	// The connection must be registered before the socket is armed, otherwise the listener could wake it before it can be found.
+	if (!inx_insert(parking.connections, key, con)) {
+		log_pedantic("Unable to record the parked connection. {sockd = %i}", con->network.sockd);
+		stats_decrement_by_num(STATS_CORE_NETWORK_PARKED);
+		enqueue(function, con);
+		return;
+	}
+
+	// One shot descriptors remain registered after they fire, so only the first park needs to add the socket. Once the socket is armed
+	// another thread may service the connection at any moment, so the connection object can't be touched after the epoll_ctl() call succeeds.
+	operation = con->network.park.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	con->network.park.registered = true;
+
+	if (epoll_ctl(parking.ed, operation, con->network.sockd, &event) == -1) {
+		log_pedantic("Unable to park the connection. {sockd = %i / error = %s}", con->network.sockd, strerror_r(errno, bufptr, buflen));
+		if (operation == EPOLL_CTL_ADD) con->network.park.registered = false;
+		con_park_dispatch(con);
+	}
+	// If the daemon started shutting down while we were parking the connection, the flush may have already run.
+	else if (!status() && inx_delete(parking.connections, key)) {
+		stats_decrement_by_num(STATS_CORE_NETWORK_PARKED);
+		enqueue(function, con);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Get the descriptor which becomes readable whenever a parked connection is ready to be serviced.
+ * @return	-1 if the parking lot hasn't been initialized, or the epoll descriptor used to watch parked connections.
+ */
+int parking_descriptor(void) {
+	return parking.ed;
+}
+
+/**
+ * @brief	Enqueue every parked connection that has become readable.
+ * @note	This function is called by the listener thread whenever the parking descriptor indicates it has pending events.
+ * @return	This function returns no value.
+ */
+void parking_wake(void) {
+
+	int ready;
+	struct epoll_event events[MAGMA_PARKING_EVENTS];
+
+	do {
+
+		if ((ready = epoll_wait(parking.ed, &events[0], MAGMA_PARKING_EVENTS, 0)) < 0 && errno != EINTR) {
+			log_info("Unable to retrieve the list of ready connections. { epoll_wait = -1 / error = %s }", strerror_r(errno, bufptr, buflen));
+		}
+
+		for (int i = 0; i < ready; i++) {
+			con_park_dispatch(events[i].data.ptr);
+		}
+
+	} while (ready == MAGMA_PARKING_EVENTS);
+
+	return;
+}
+
+/**
+ * @brief	Destroy any connections which have been parked for longer than their idle timeout, or if one wasn't set, their server's network timeout.
+ * @note	Before connections were parked, the receive timeout on the socket dropped clients who went quiet. This function is called by the
+ * 			listener thread on every pass, but only checks the registry once per second. Expired connections are collected in batches, since
+ * 			removing them while the cursor is active would force the cursor to restart after every hit.
+ * @return	This function returns no value.
+ */
+void parking_sweep(void) {
+
+	time_t now;
+	connection_t *con;
+	uint32_t count, timeout;
+	inx_cursor_t *cursor;
+	connection_t *expired[MAGMA_PARKING_EVENTS];
+
+	if (!parking.connections || (now = time(NULL)) == parking.swept) {
+		return;
+	}
+
+	parking.swept = now;
+
+	do {
+
+		count = 0;
+
+		if (!(cursor = inx_cursor_alloc(parking.connections))) {
+			return;
+		}
+
+		while (count < MAGMA_PARKING_EVENTS && (con = inx_cursor_value_next(cursor))) {
+			if ((timeout = con->network.park.timeout ? con->network.park.timeout : con->server ? con->server->network.timeout : 0) &&
+				(now - con->network.park.stamp) > timeout) {
+				expired[count++] = con;
+			}
+		}
+
+		inx_cursor_free(cursor);
+
+		for (uint32_t i = 0; i < count; i++) {
+			con_park_expire(expired[i]);
+		}
+
+	} while (count == MAGMA_PARKING_EVENTS);
+
+	return;
+}
+
+/**
+ * @brief	Wake every parked connection so the protocol handlers can see the daemon is shutting down and close them.
+ * @return	This function returns no value.
+ */
+void parking_flush(void) {
+
+	connection_t *con;
+	inx_cursor_t *cursor;
+
+	if (!parking.connections || !(cursor = inx_cursor_alloc(parking.connections))) {
+		return;
+	}
+
+	// Dispatching a connection removes it from the index, so the cursor is reset after every hit.
+	while ((con = inx_cursor_value_next(cursor))) {
+		con_park_dispatch(con);
+		inx_cursor_reset(cursor);
+	}
+
+	inx_cursor_free(cursor);
+	return;
+}
+
+/**
+ * @brief	Create the epoll descriptor and the registry used to track parked connections.
+ * @return	true on success or false on failure.
+ */
+bool_t parking_start(void) {
+
+	if ((parking.ed = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		log_critical("Unable to create the connection parking descriptor. {%s}", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+	else if (!(parking.connections = inx_alloc(M_INX_HASHED, NULL))) {
+		log_critical("Unable to allocate the parked connection index.");
+		close(parking.ed);
+		parking.ed = -1;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Release the parking descriptor and the parked connection registry.
+ * @note	This function assumes the worker threads have finished, so any connections left in the registry are abandoned.
+ * @return	This function returns no value.
+ */
+void parking_stop(void) {
+
+	if (parking.connections && inx_count(parking.connections)) {
+		log_pedantic("Connections were still parked during shutdown. {count = %lu}", inx_count(parking.connections));
+	}
+
+	inx_cleanup(parking.connections);
+	parking.connections = NULL;
+
+	if (parking.ed != -1) {
+		close(parking.ed);
+		parking.ed = -1;
+	}
+
+	return;
+}
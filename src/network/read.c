@@ -63,6 +63,11 @@ int64_t con_read_line(connection_t *con, bool_t block) {
 		con->network.line = pl_null();
 	}
 
+	// Any pending output has to reach the client before we wait on its reply.
+	if ((bytes = con_flush(con)) < 0) {
+		return bytes;
+	}
+
 	// Loop until we get a complete line, an error, or the buffer is filled.
 	do {
 
@@ -161,6 +166,11 @@ int64_t con_read(connection_t *con) {
 		con->network.line = pl_null();
 	}
 
+	// Any pending output has to reach the client before we wait on its reply.
+	if ((bytes = con_flush(con)) < 0) {
+		return bytes;
+	}
+
 	// Loop until the buffer has data or we get an error.
 	do {
 		blocking = st_length_get(con->network.buffer) ? false : true;
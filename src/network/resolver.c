@@ -0,0 +1,1182 @@
+/**
+ * @file /magma/network/resolver.c
+ *
+ * @brief	A non-blocking DNS resolver, shared by every thread that needs to perform lookups.
+ *
+ * @note	Queries are sent over UDP by the requesting thread, and the answers are collected by a single engine thread which
+ * 			watches the query sockets using epoll. Every attempt uses a fresh socket bound to a random ephemeral port, so a forged
+ * 			answer has to guess the source port as well as the query id. Truncated answers are retried over TCP. Callers are notified through a
+ * 			completion function, so nothing sits in a loop waiting for an answer, and several lookups can be in flight at once.
+ * 			Identical lookups which overlap are merged into a single query, and answers are cached for their TTL, including
+ * 			answers which indicate the name doesn't exist.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+// The maximum number of socket events collected by a single pass of the engine thread.
+#define MAGMA_DNS_EVENTS 64
+
+typedef struct {
+	int sockd; /* The socket descriptor, or -1 if no socket is open. */
+	bool_t stream; /* True if this is the TCP socket used for a truncated answer, and false if it's the UDP socket used for the query. */
+	struct dns_request *request; /* The request which owns the socket, since the epoll events point at the socket. */
+} dns_socket_t;
+
+typedef struct {
+	socklen_t length;
+	struct sockaddr_storage address;
+} dns_server_t;
+
+typedef struct dns_waiter {
+	void *function; /* The function called with the answer. */
+	void *data; /* The value passed to the completion function. */
+	struct dns_waiter *next;
+} dns_waiter_t;
+
+typedef struct dns_request {
+	dns_socket_t udp; /* The socket used by the current attempt, which is replaced every time the query is sent. */
+	dns_socket_t tcp; /* The socket used for truncated answers. */
+	uint16_t id, type;
+	uint32_t attempts; /* The number of times the query has been sent. */
+	uint64_t hash, retry, deadline;
+	bool_t indexed; /* Whether the request can be found in the index of pending lookups. */
+	chr_t name[NS_MAXDNAME];
+	size_t length;
+	uchr_t packet[NS_PACKETSZ];
+
+	struct {
+		bool_t sent;
+		size_t offset;
+		uchr_t *buffer;
+	} stream;
+
+	dns_answer_t answer;
+	dns_waiter_t *waiters;
+	struct dns_request *prev, *next;
+} dns_request_t;
+
+typedef struct {
+	uint64_t hash;
+	uint16_t type;
+	time_t expires;
+	chr_t *name;
+	dns_answer_t answer;
+} dns_cache_t;
+
+typedef struct {
+	uint32_t pending;
+	pthread_cond_t done;
+	pthread_mutex_t lock;
+} dns_batch_t;
+
+typedef struct {
+	dns_batch_t *batch;
+	dns_answer_t *answer;
+} dns_slot_t;
+
+struct {
+	int ed;
+	bool_t running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	inx_t *requests;
+	dns_request_t *head;
+	uint32_t count;
+	dns_server_t servers[MAGMA_DNS_SERVERS];
+
+	struct {
+		uint32_t size;
+		dns_cache_t *entries;
+		pthread_rwlock_t lock;
+	} cache;
+} resolver = {
+		.ed = -1,
+		.running = false,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.requests = NULL,
+		.head = NULL,
+		.count = 0,
+		.cache = {
+			.size = 0,
+			.entries = NULL
+		}
+};
+
+/**
+ * @brief	Get the value of the monotonic clock in milliseconds.
+ * @return	the number of milliseconds since an arbitrary point in the past.
+ */
+uint64_t dns_clock(void) {
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief	Free the records held by a DNS answer, and reset it to an error.
+ * @param	answer	the answer to be cleared.
+ * @return	This function returns no value.
+ */
+void dns_answer_clear(dns_answer_t *answer) {
+
+	for (uint32_t i = 0; i < answer->count && i < MAGMA_DNS_RECORDS; i++) {
+		st_cleanup(answer->records[i]);
+	}
+
+	mm_wipe(answer, sizeof(dns_answer_t));
+	answer->status = DNS_ERROR;
+
+	return;
+}
+
+/**
+ * @brief	Copy a DNS answer, including its records.
+ * @note	If a record can't be copied, the output is returned as an error.
+ * @param	output	the answer that will receive the copy.
+ * @param	answer	the answer to be copied.
+ * @return	a pointer to the output answer.
+ */
+dns_answer_t * dns_answer_copy(dns_answer_t *output, dns_answer_t *answer) {
+
+	mm_wipe(output, sizeof(dns_answer_t));
+	output->status = answer->status;
+	output->ttl = answer->ttl;
+
+	for (uint32_t i = 0; i < answer->count; i++) {
+		if (!(output->records[i] = st_dupe(answer->records[i]))) {
+			dns_answer_clear(output);
+			return output;
+		}
+		output->count++;
+	}
+
+	return output;
+}
+
+/**
+ * @brief	Copy a domain name into the form used for queries and cache keys.
+ * @note	Names are converted to lower case and any trailing dot is removed.
+ * @param	name	a pointer to a null-terminated string containing the name.
+ * @param	output	a buffer of at least NS_MAXDNAME bytes that will receive the normalized name.
+ * @return	0 if the name isn't valid, or the length of the normalized name.
+ */
+size_t dns_name_normalize(chr_t *name, chr_t *output) {
+
+	size_t length, label = 0;
+
+	if (!name || !(length = ns_length_get(name))) {
+		return 0;
+	}
+	else if (name[length - 1] == '.') {
+		length--;
+	}
+
+	if (!length || length > NS_MAXDNAME - 2) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+
+		if (name[i] == '.') {
+			if (!label) return 0;
+			label = 0;
+		}
+		else if (++label > NS_MAXLABEL) {
+			return 0;
+		}
+
+		output[i] = lower_chr(name[i]);
+	}
+
+	output[length] = '\0';
+
+	return label ? length : 0;
+}
+
+/**
+ * @brief	Read a possibly compressed domain name from a DNS packet.
+ * @param	packet	the DNS packet.
+ * @param	length	the length, in bytes, of the DNS packet.
+ * @param	offset	the position of the name inside the packet.
+ * @param	output	a buffer of at least NS_MAXDNAME bytes that will receive the name, with its labels separated by dots.
+ * @param	next	a pointer to receive the position of the data following the name.
+ * @return	-1 if the name is malformed, or the length of the name on success.
+ */
+int_t dns_name_read(uchr_t *packet, size_t length, size_t offset, chr_t *output, size_t *next) {
+
+	uchr_t label;
+	int_t jumps = 0;
+	bool_t jumped = false;
+	size_t position = offset, written = 0;
+
+	while (true) {
+
+		if (position >= length) {
+			return -1;
+		}
+
+		// Compression pointers are followed, but only a limited number of times so a loop can't trap us.
+		if (((label = packet[position]) & 0xc0) == 0xc0) {
+
+			if (position + 1 >= length || ++jumps > 32) {
+				return -1;
+			}
+			else if (!jumped) {
+				*next = position + 2;
+				jumped = true;
+			}
+
+			position = ((label & 0x3f) << 8) | packet[position + 1];
+		}
+		else if (label & 0xc0) {
+			return -1;
+		}
+		else if (!label) {
+
+			if (!jumped) {
+				*next = position + 1;
+			}
+
+			break;
+		}
+		else if (position + 1 + label > length || written + label + 2 > NS_MAXDNAME) {
+			return -1;
+		}
+		else {
+
+			if (written) {
+				output[written++] = '.';
+			}
+
+			mm_copy(output + written, packet + position + 1, label);
+			written += label;
+			position += label + 1;
+		}
+	}
+
+	output[written] = '\0';
+
+	return written;
+}
+
+/**
+ * @brief	Build the query packet for a lookup.
+ * @param	request		the request, which holds the normalized name, the record type, and the query id.
+ * @return	true on success or false if the name is too long to fit in a query.
+ */
+bool_t dns_packet_build(dns_request_t *request) {
+
+	size_t position = HFIXEDSZ;
+	chr_t *label = request->name, *dot;
+
+	mm_wipe(request->packet, HFIXEDSZ);
+
+	// The header asks for recursion, and holds a single question.
+	request->packet[0] = request->id >> 8;
+	request->packet[1] = request->id & 0xff;
+	request->packet[2] = 0x01;
+	request->packet[5] = 1;
+
+	do {
+
+		dot = strchr(label, '.');
+		request->packet[position] = dot ? (dot - label) : ns_length_get(label);
+
+		if (position + request->packet[position] + 6 > NS_PACKETSZ) {
+			return false;
+		}
+
+		mm_copy(request->packet + position + 1, label, request->packet[position]);
+		position += request->packet[position] + 1;
+		label = dot + 1;
+
+	} while (dot);
+
+	request->packet[position++] = 0;
+	request->packet[position++] = request->type >> 8;
+	request->packet[position++] = request->type & 0xff;
+	request->packet[position++] = 0;
+	request->packet[position++] = ns_c_in;
+	request->length = position;
+
+	return true;
+}
+
+/**
+ * @brief	Parse the answer to a query.
+ * @note	The answer is only stored in the request if the packet is a complete answer to the question that was asked.
+ * @param	request		the request the answer belongs to.
+ * @param	packet		the DNS packet.
+ * @param	length		the length, in bytes, of the DNS packet.
+ * @return	-1 if the packet is malformed or answers a different question, 0 if the answer was stored, 1 if the answer was truncated,
+ * 			or 2 if the server couldn't answer the question.
+ */
+int_t dns_packet_parse(dns_request_t *request, uchr_t *packet, size_t length) {
+
+	dns_answer_t answer;
+	chr_t name[NS_MAXDNAME];
+	size_t offset = HFIXEDSZ, end;
+	uint16_t questions, answers, authorities, type, class, rdlength, preference[MAGMA_DNS_RECORDS];
+	uint32_t ttl, negative = 0;
+	uchr_t rcode;
+	int_t len;
+
+	if (length < HFIXEDSZ || !(packet[2] & 0x80)) {
+		return -1;
+	}
+
+	questions = (packet[4] << 8) | packet[5];
+	answers = (packet[6] << 8) | packet[7];
+	authorities = (packet[8] << 8) | packet[9];
+	rcode = packet[3] & 0x0f;
+
+	// Answers are only accepted if they repeat the question we asked.
+	if (questions != 1 || dns_name_read(packet, length, offset, name, &offset) < 0 || offset + 4 > length ||
+		strcasecmp(name, request->name) || ((packet[offset] << 8) | packet[offset + 1]) != request->type) {
+		return -1;
+	}
+	else if (packet[2] & 0x02) {
+		return 1;
+	}
+	else if (rcode != ns_r_noerror && rcode != ns_r_nxdomain) {
+		return 2;
+	}
+
+	offset += 4;
+	mm_wipe(&answer, sizeof(dns_answer_t));
+	answer.status = DNS_NOTFOUND;
+	answer.ttl = MAGMA_DNS_TTL_MAXIMUM;
+
+	for (uint32_t i = 0; i < answers + authorities; i++) {
+
+		if (dns_name_read(packet, length, offset, name, &offset) < 0 || offset + 10 > length) {
+			dns_answer_clear(&answer);
+			return -1;
+		}
+
+		type = (packet[offset] << 8) | packet[offset + 1];
+		class = (packet[offset + 2] << 8) | packet[offset + 3];
+		ttl = ((uint32_t)packet[offset + 4] << 24) | (packet[offset + 5] << 16) | (packet[offset + 6] << 8) | packet[offset + 7];
+		rdlength = (packet[offset + 8] << 8) | packet[offset + 9];
+		offset += 10;
+		end = offset + rdlength;
+
+		if (end > length) {
+			dns_answer_clear(&answer);
+			return -1;
+		}
+
+		// The SOA record in the authority section says how long a negative answer can be cached. The value is the smaller of the
+		// record's TTL and the minimum field, which is the last field in the record.
+		if (i >= answers) {
+			if (type == ns_t_soa && rdlength >= 20) {
+				negative = ((uint32_t)packet[end - 4] << 24) | (packet[end - 3] << 16) | (packet[end - 2] << 8) | packet[end - 1];
+				negative = negative < ttl ? negative : ttl;
+			}
+		}
+		else if (class == ns_c_in && type == request->type && rcode == ns_r_noerror && answer.count < MAGMA_DNS_RECORDS) {
+
+			switch (type) {
+				case (ns_t_a):
+					if (rdlength == 4 && inet_ntop(AF_INET, packet + offset, name, NS_MAXDNAME)) {
+						answer.records[answer.count] = st_import(name, ns_length_get(name));
+					}
+					break;
+				case (ns_t_aaaa):
+					if (rdlength == 16 && inet_ntop(AF_INET6, packet + offset, name, NS_MAXDNAME)) {
+						answer.records[answer.count] = st_import(name, ns_length_get(name));
+					}
+					break;
+				case (ns_t_ptr):
+					if ((len = dns_name_read(packet, length, offset, name, &end)) > 0) {
+						answer.records[answer.count] = st_import(name, len);
+					}
+					break;
+				case (ns_t_mx):
+					if (rdlength > 2 && (len = dns_name_read(packet, length, offset + 2, name, &end)) > 0) {
+						preference[answer.count] = (packet[offset] << 8) | packet[offset + 1];
+						answer.records[answer.count] = st_import(name, len);
+					}
+					break;
+				case (ns_t_txt):
+					if ((answer.records[answer.count] = st_alloc(rdlength))) {
+						for (size_t j = offset; j < offset + rdlength && j + 1 + packet[j] <= offset + rdlength; j += packet[j] + 1) {
+							mm_copy(st_char_get(answer.records[answer.count]) + st_length_get(answer.records[answer.count]), packet + j + 1, packet[j]);
+							st_length_set(answer.records[answer.count], st_length_get(answer.records[answer.count]) + packet[j]);
+						}
+					}
+					break;
+			}
+
+			if (answer.records[answer.count]) {
+				answer.ttl = ttl < answer.ttl ? ttl : answer.ttl;
+				answer.count++;
+			}
+		}
+
+		offset = end;
+	}
+
+	// Mail exchangers are returned in order of preference.
+	for (uint32_t i = 1; request->type == ns_t_mx && i < answer.count; i++) {
+		for (uint32_t j = i; j > 0 && preference[j] < preference[j - 1]; j--) {
+			stringer_t *record = answer.records[j];
+			uint16_t holder = preference[j];
+			answer.records[j] = answer.records[j - 1];
+			preference[j] = preference[j - 1];
+			answer.records[j - 1] = record;
+			preference[j - 1] = holder;
+		}
+	}
+
+	// Negative answers are only cached if the server said how long they remain valid.
+	if (answer.count) {
+		answer.status = DNS_SUCCESS;
+	}
+	else {
+		answer.ttl = negative < MAGMA_DNS_TTL_NEGATIVE ? negative : MAGMA_DNS_TTL_NEGATIVE;
+	}
+
+	dns_answer_clear(&(request->answer));
+	mm_copy(&(request->answer), &answer, sizeof(dns_answer_t));
+
+	return 0;
+}
+
+/**
+ * @brief	Look for a cached answer.
+ * @param	hash	the hash of the normalized name and record type.
+ * @param	type	the record type.
+ * @param	name	the normalized name.
+ * @param	output	the answer that will receive a copy of the cached answer.
+ * @return	true if a valid answer was found in the cache, or false otherwise.
+ */
+bool_t dns_cache_get(uint64_t hash, uint16_t type, chr_t *name, dns_answer_t *output) {
+
+	time_t now;
+	dns_cache_t *entry;
+	bool_t result = false;
+
+	if (!resolver.cache.size) {
+		return false;
+	}
+
+	now = time(NULL);
+	entry = &(resolver.cache.entries[hash % resolver.cache.size]);
+
+	rwlock_lock_read(&(resolver.cache.lock));
+
+	if (entry->name && entry->hash == hash && entry->type == type && entry->expires > now && !strcmp(entry->name, name)) {
+		dns_answer_copy(output, &(entry->answer));
+		output->ttl = entry->expires - now;
+		result = output->status != DNS_ERROR;
+	}
+
+	rwlock_unlock(&(resolver.cache.lock));
+
+	return result;
+}
+
+/**
+ * @brief	Store an answer in the cache.
+ * @note	The cache is direct mapped, so a new answer replaces whatever was stored in its slot. Errors, and answers without a TTL, aren't cached.
+ * @param	hash	the hash of the normalized name and record type.
+ * @param	type	the record type.
+ * @param	name	the normalized name.
+ * @param	answer	the answer to be cached.
+ * @return	This function returns no value.
+ */
+void dns_cache_set(uint64_t hash, uint16_t type, chr_t *name, dns_answer_t *answer) {
+
+	chr_t *copy;
+	dns_cache_t *entry;
+
+	if (!resolver.cache.size || answer->status == DNS_ERROR || !answer->ttl || !(copy = ns_dupe(name))) {
+		return;
+	}
+
+	entry = &(resolver.cache.entries[hash % resolver.cache.size]);
+
+	rwlock_lock_write(&(resolver.cache.lock));
+
+	ns_cleanup(entry->name);
+	dns_answer_clear(&(entry->answer));
+
+	entry->name = copy;
+	entry->hash = hash;
+	entry->type = type;
+	entry->expires = time(NULL) + answer->ttl;
+	dns_answer_copy(&(entry->answer), answer);
+
+	rwlock_unlock(&(resolver.cache.lock));
+
+	return;
+}
+
+/**
+ * @brief	Send, or resend, the query for a lookup.
+ * @note	Each attempt goes to the next server in the list, using a new socket, so every attempt is sent from a different random port.
+ * 			Connecting the socket means the kernel discards datagrams which don't come from the server. The caller must hold the resolver lock.
+ * @param	request		the request to be sent.
+ * @return	This function returns no value.
+ */
+void dns_transmit(dns_request_t *request) {
+
+	struct epoll_event event;
+	dns_server_t *server = &(resolver.servers[request->attempts % resolver.count]);
+
+	request->attempts++;
+	request->retry = dns_clock() + ((magma.dns.timeout * 1000) / MAGMA_DNS_ATTEMPTS);
+
+	// Closing the socket also removes it from the epoll descriptor, so answers to the previous attempt are discarded.
+	if (request->udp.sockd != -1) {
+		close(request->udp.sockd);
+		request->udp.sockd = -1;
+	}
+
+	mm_wipe(&event, sizeof(struct epoll_event));
+	event.events = EPOLLIN;
+	event.data.ptr = &(request->udp);
+
+	// A failed send is retried when the attempt times out.
+	if ((request->udp.sockd = socket(server->address.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+		connect(request->udp.sockd, (struct sockaddr *)&(server->address), server->length) ||
+		epoll_ctl(resolver.ed, EPOLL_CTL_ADD, request->udp.sockd, &event) ||
+		send(request->udp.sockd, request->packet, request->length, MSG_DONTWAIT) != request->length) {
+		log_pedantic("Unable to send a DNS query. {name = %s / error = %s}", request->name, strerror_r(errno, bufptr, buflen));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Finish a lookup, and move it to the list of requests whose waiters need to be notified.
+ * @note	The caller must hold the resolver lock.
+ * @param	request		the completed request.
+ * @param	finished	a pointer to the list of finished requests.
+ * @return	This function returns no value.
+ */
+void dns_complete(dns_request_t *request, dns_request_t **finished) {
+
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = request->hash };
+
+	if (request->prev) request->prev->next = request->next;
+	else resolver.head = request->next;
+	if (request->next) request->next->prev = request->prev;
+
+	if (request->indexed) {
+		inx_delete(resolver.requests, key);
+	}
+
+	if (request->udp.sockd != -1) {
+		close(request->udp.sockd);
+		request->udp.sockd = -1;
+	}
+
+	if (request->tcp.sockd != -1) {
+		close(request->tcp.sockd);
+		request->tcp.sockd = -1;
+	}
+
+	if (request->answer.status == DNS_ERROR) {
+		stats_increment_by_num(STATS_CORE_DNS_ERRORS);
+	}
+
+	dns_cache_set(request->hash, request->type, request->name, &(request->answer));
+
+	request->prev = NULL;
+	request->next = *finished;
+	*finished = request;
+
+	return;
+}
+
+/**
+ * @brief	Notify the waiters of each finished lookup, and then free the requests.
+ * @note	The resolver lock must not be held, since the completion functions may start new lookups.
+ * @param	finished	the list of finished requests.
+ * @return	This function returns no value.
+ */
+void dns_finish(dns_request_t *finished) {
+
+	dns_waiter_t *waiter;
+	dns_request_t *request;
+
+	while ((request = finished)) {
+
+		finished = request->next;
+
+		while ((waiter = request->waiters)) {
+			request->waiters = waiter->next;
+			((void (*)(dns_answer_t *, void *))waiter->function)(&(request->answer), waiter->data);
+			mm_free(waiter);
+		}
+
+		dns_answer_clear(&(request->answer));
+
+		if (request->stream.buffer) {
+			mm_free(request->stream.buffer);
+		}
+
+		mm_free(request);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Retry a truncated answer over TCP.
+ * @note	The caller must hold the resolver lock.
+ * @param	request		the request whose answer was truncated.
+ * @param	finished	a pointer to the list of finished requests, which receives the request if the connection can't be started.
+ * @return	This function returns no value.
+ */
+void dns_stream_start(dns_request_t *request, dns_request_t **finished) {
+
+	struct epoll_event event;
+	dns_server_t *server = &(resolver.servers[(request->attempts - 1) % resolver.count]);
+
+	mm_wipe(&event, sizeof(struct epoll_event));
+	event.events = EPOLLIN | EPOLLOUT;
+	event.data.ptr = &(request->tcp);
+
+	// Once the lookup switches to TCP, any further datagrams are ignored.
+	close(request->udp.sockd);
+	request->udp.sockd = -1;
+
+	if (!(request->stream.buffer = mm_alloc(NS_MAXMSG + 2)) ||
+		(request->tcp.sockd = socket(server->address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+		(connect(request->tcp.sockd, (struct sockaddr *)&(server->address), server->length) && errno != EINPROGRESS) ||
+		epoll_ctl(resolver.ed, EPOLL_CTL_ADD, request->tcp.sockd, &event)) {
+		log_pedantic("Unable to retry a truncated DNS answer over TCP. {name = %s / error = %s}", request->name, strerror_r(errno, bufptr, buflen));
+		request->answer.status = DNS_ERROR;
+		dns_complete(request, finished);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Handle a readiness event on the TCP socket of a lookup.
+ * @note	The caller must hold the resolver lock.
+ * @param	request		the request that owns the socket.
+ * @param	events		the epoll events reported for the socket.
+ * @param	finished	a pointer to the list of finished requests.
+ * @return	This function returns no value.
+ */
+void dns_stream(dns_request_t *request, uint32_t events, dns_request_t **finished) {
+
+	ssize_t ret;
+	size_t expected;
+	struct epoll_event event;
+	uchr_t prefix[2] = { request->length >> 8, request->length & 0xff };
+	struct iovec vector[2] = { { .iov_base = prefix, .iov_len = 2 }, { .iov_base = request->packet, .iov_len = request->length } };
+
+	// The query is small enough to fit in the socket buffer of a new connection, so it's written in one piece.
+	if ((events & EPOLLOUT) && !request->stream.sent) {
+
+		mm_wipe(&event, sizeof(struct epoll_event));
+		event.events = EPOLLIN;
+		event.data.ptr = &(request->tcp);
+
+		if (writev(request->tcp.sockd, vector, 2) != request->length + 2 || epoll_ctl(resolver.ed, EPOLL_CTL_MOD, request->tcp.sockd, &event)) {
+			request->answer.status = DNS_ERROR;
+			dns_complete(request, finished);
+			return;
+		}
+
+		request->stream.sent = true;
+	}
+
+	if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP)) || !request->stream.sent) {
+		return;
+	}
+
+	if ((ret = recv(request->tcp.sockd, request->stream.buffer + request->stream.offset, NS_MAXMSG + 2 - request->stream.offset, MSG_DONTWAIT)) <= 0) {
+		if (ret == 0 || (errno != EAGAIN && errno != EINTR)) {
+			request->answer.status = DNS_ERROR;
+			dns_complete(request, finished);
+		}
+		return;
+	}
+
+	request->stream.offset += ret;
+
+	if (request->stream.offset < 2 || request->stream.offset < (expected = (request->stream.buffer[0] << 8) | request->stream.buffer[1]) + 2) {
+		return;
+	}
+	else if (dns_packet_parse(request, request->stream.buffer + 2, expected)) {
+		request->answer.status = DNS_ERROR;
+	}
+
+	dns_complete(request, finished);
+
+	return;
+}
+
+/**
+ * @brief	Collect the answers waiting on the UDP socket of a lookup.
+ * @note	The caller must hold the resolver lock.
+ * @param	request		the request whose socket is readable.
+ * @param	finished	a pointer to the list of finished requests.
+ * @return	This function returns no value.
+ */
+void dns_receive(dns_request_t *request, dns_request_t **finished) {
+
+	ssize_t length;
+	uint32_t attempts;
+	uchr_t packet[NS_MAXMSG];
+
+	// Completing, resending or switching the lookup to TCP replaces the socket, so the loop ends once the socket changes.
+	for (attempts = request->attempts; request->udp.sockd != -1 && attempts == request->attempts &&
+		(length = recv(request->udp.sockd, packet, NS_MAXMSG, MSG_DONTWAIT)) >= 0;) {
+
+		// Answers which don't match the query id are ignored.
+		if (length < HFIXEDSZ || ((packet[0] << 8) | packet[1]) != request->id) {
+			continue;
+		}
+
+		switch (dns_packet_parse(request, packet, length)) {
+			case (0):
+				dns_complete(request, finished);
+				break;
+			case (1):
+				dns_stream_start(request, finished);
+				break;
+			case (2):
+				if (request->attempts < MAGMA_DNS_ATTEMPTS) {
+					dns_transmit(request);
+				}
+				else {
+					request->answer.status = DNS_ERROR;
+					dns_complete(request, finished);
+				}
+				break;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Resend the queries which haven't been answered, and fail the lookups which have run out of time.
+ * @note	The caller must hold the resolver lock.
+ * @param	finished	a pointer to the list of finished requests.
+ * @return	This function returns no value.
+ */
+void dns_expire(dns_request_t **finished) {
+
+	uint64_t now = dns_clock();
+	dns_request_t *request = resolver.head, *next;
+
+	while (request) {
+
+		next = request->next;
+
+		if (now >= request->deadline) {
+			request->answer.status = DNS_ERROR;
+			dns_complete(request, finished);
+		}
+		else if (request->tcp.sockd == -1 && now >= request->retry && request->attempts < MAGMA_DNS_ATTEMPTS) {
+			dns_transmit(request);
+		}
+
+		request = next;
+	}
+
+	return;
+}
+
+/**
+ * @brief	The main loop of the resolver engine thread.
+ * @return	This function returns no value.
+ */
+void dns_engine(void) {
+
+	int ready;
+	bool_t running = true;
+	dns_socket_t *handle;
+	dns_request_t *finished;
+	struct epoll_event events[MAGMA_DNS_EVENTS];
+
+	while (running) {
+
+		if ((ready = epoll_wait(resolver.ed, &events[0], MAGMA_DNS_EVENTS, 100)) < 0 && errno != EINTR) {
+			log_info("The DNS resolver returned an error. { epoll_wait = -1 / error = %s }", strerror_r(errno, bufptr, buflen));
+		}
+
+		finished = NULL;
+		mutex_lock(&(resolver.lock));
+
+		for (int i = 0; i < ready; i++) {
+
+			handle = events[i].data.ptr;
+
+			// A request which was completed earlier in this pass has already been unlinked, and its sockets closed.
+			if (handle->sockd == -1) {
+				continue;
+			}
+			else if (!handle->stream) {
+				dns_receive(handle->request, &finished);
+			}
+			else {
+				dns_stream(handle->request, events[i].events, &finished);
+			}
+		}
+
+		dns_expire(&finished);
+		running = resolver.running;
+		mutex_unlock(&(resolver.lock));
+
+		dns_finish(finished);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Look up the records of a specific type associated with a name.
+ * @note	The completion function is called exactly once, either from the calling thread if the answer is cached or the lookup
+ * 			can't be started, or from the resolver thread once the lookup finishes. It is passed the answer, which is only valid until
+ * 			the function returns, and the data pointer. Completion functions must not block.
+ * @param	name		a pointer to a null-terminated string containing the name to be looked up.
+ * @param	type		the record type, either ns_t_a, ns_t_aaaa, ns_t_ptr, ns_t_mx or ns_t_txt.
+ * @param	function	the completion function, which has the prototype void function(dns_answer_t *answer, void *data).
+ * @param	data		the value passed to the completion function.
+ * @return	This function returns no value.
+ */
+void dns_query(chr_t *name, uint16_t type, void *function, void *data) {
+
+	uint64_t hash;
+	size_t length;
+	dns_answer_t answer;
+	dns_waiter_t *waiter;
+	dns_request_t *request;
+	chr_t normalized[NS_MAXDNAME];
+	multi_t key = { .type = M_TYPE_UINT64 };
+
+	mm_wipe(&answer, sizeof(dns_answer_t));
+	answer.status = DNS_ERROR;
+
+	if (!(length = dns_name_normalize(name, normalized))) {
+		log_pedantic("An invalid DNS name was passed in. {name = %s}", name ? name : "NULL");
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		return;
+	}
+
+	hash = hash_murmur64(normalized, length) ^ type;
+	key.val.u64 = hash;
+
+	if (dns_cache_get(hash, type, normalized, &answer)) {
+		stats_increment_by_num(STATS_CORE_DNS_CACHED);
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		dns_answer_clear(&answer);
+		return;
+	}
+	else if (!(waiter = mm_alloc(sizeof(dns_waiter_t)))) {
+		log_pedantic("Unable to allocate memory for a DNS lookup.");
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		return;
+	}
+
+	waiter->function = function;
+	waiter->data = data;
+
+	mutex_lock(&(resolver.lock));
+
+	if (!resolver.running) {
+		mutex_unlock(&(resolver.lock));
+		mm_free(waiter);
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		return;
+	}
+
+	// If the same lookup is already in flight, wait for its answer instead of sending another query.
+	if ((request = inx_find(resolver.requests, key)) && request->type == type && !strcmp(request->name, normalized)) {
+		waiter->next = request->waiters;
+		request->waiters = waiter;
+		mutex_unlock(&(resolver.lock));
+		return;
+	}
+
+	if (!(request = mm_alloc(sizeof(dns_request_t)))) {
+		mutex_unlock(&(resolver.lock));
+		log_pedantic("Unable to allocate memory for a DNS lookup.");
+		mm_free(waiter);
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		return;
+	}
+
+	// Query ids are chosen at random, and together with the random source port of each attempt, make forged answers harder to deliver.
+	request->id = rand_get_uint16();
+	request->hash = hash;
+	request->type = type;
+	request->waiters = waiter;
+	request->udp.sockd = -1;
+	request->udp.stream = false;
+	request->udp.request = request;
+	request->tcp.sockd = -1;
+	request->tcp.stream = true;
+	request->tcp.request = request;
+	request->answer.status = DNS_ERROR;
+	request->deadline = dns_clock() + (magma.dns.timeout * 1000);
+	mm_copy(request->name, normalized, length + 1);
+
+	if (!dns_packet_build(request)) {
+		mutex_unlock(&(resolver.lock));
+		log_pedantic("Unable to build a DNS query. {name = %s}", normalized);
+		mm_free(waiter);
+		mm_free(request);
+		((void (*)(dns_answer_t *, void *))function)(&answer, data);
+		return;
+	}
+
+	// Hash collisions between different names are rare, and only mean the second lookup can't be merged with later ones.
+	request->indexed = inx_insert(resolver.requests, key, request);
+
+	if ((request->next = resolver.head)) {
+		request->next->prev = request;
+	}
+
+	resolver.head = request;
+
+	stats_increment_by_num(STATS_CORE_DNS_QUERIES);
+	dns_transmit(request);
+
+	mutex_unlock(&(resolver.lock));
+
+	return;
+}
+
+/**
+ * @brief	The completion function used by dns_resolve() to store an answer and wake the waiting thread.
+ * @param	answer	the answer to the lookup.
+ * @param	slot	the slot where the answer should be stored.
+ * @return	This function returns no value.
+ */
+void dns_resolve_complete(dns_answer_t *answer, dns_slot_t *slot) {
+
+	dns_answer_copy(slot->answer, answer);
+
+	mutex_lock(&(slot->batch->lock));
+	if (!--slot->batch->pending) {
+		pthread_cond_signal(&(slot->batch->done));
+	}
+	mutex_unlock(&(slot->batch->lock));
+
+	return;
+}
+
+/**
+ * @brief	Look up several names at once, and wait for all of the answers.
+ * @note	Every query is sent before the function starts waiting, so the total wait is bound by the slowest lookup rather than the sum of them.
+ * @param	count		the number of names to be looked up.
+ * @param	names		an array of null-terminated strings containing the names.
+ * @param	type		the record type being requested for every name.
+ * @param	answers		an array of count answers which receive the results, and must be freed using dns_answer_clear().
+ * @return	This function returns no value.
+ */
+void dns_resolve(uint32_t count, chr_t **names, uint16_t type, dns_answer_t *answers) {
+
+	dns_batch_t batch;
+	dns_slot_t *slots;
+
+	for (uint32_t i = 0; i < count; i++) {
+		mm_wipe(&answers[i], sizeof(dns_answer_t));
+		answers[i].status = DNS_ERROR;
+	}
+
+	if (!count || !(slots = mm_alloc(sizeof(dns_slot_t) * count))) {
+		return;
+	}
+
+	mm_wipe(&batch, sizeof(dns_batch_t));
+	mutex_init(&(batch.lock), NULL);
+	pthread_cond_init(&(batch.done), NULL);
+
+	// The pending count is set first, since answers found in the cache complete before dns_query() returns.
+	batch.pending = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		slots[i].batch = &batch;
+		slots[i].answer = &answers[i];
+		dns_query(names[i], type, &dns_resolve_complete, &slots[i]);
+	}
+
+	mutex_lock(&(batch.lock));
+	while (batch.pending) {
+		pthread_cond_wait(&(batch.done), &(batch.lock));
+	}
+	mutex_unlock(&(batch.lock));
+
+	pthread_cond_destroy(&(batch.done));
+	mutex_destroy(&(batch.lock));
+	mm_free(slots);
+
+	return;
+}
+
+/**
+ * @brief	Add a DNS server to the list used for lookups.
+ * @param	address		a pointer to a null-terminated string containing the IP address of the server.
+ * @return	true on success or false on failure.
+ */
+bool_t dns_server_add(chr_t *address) {
+
+	ip_t ip;
+	dns_server_t *server;
+
+	mm_wipe(&ip, sizeof(ip_t));
+
+	if (resolver.count >= MAGMA_DNS_SERVERS || !ip_str_addr(address, &ip)) {
+		log_pedantic("Unable to add the DNS server %s.", address);
+		return false;
+	}
+
+	server = &(resolver.servers[resolver.count]);
+	mm_wipe(server, sizeof(dns_server_t));
+
+	if (ip.family == AF_INET) {
+		((struct sockaddr_in *)&(server->address))->sin_family = AF_INET;
+		((struct sockaddr_in *)&(server->address))->sin_port = htons(magma.dns.port);
+		((struct sockaddr_in *)&(server->address))->sin_addr = ip.ip4;
+		server->length = sizeof(struct sockaddr_in);
+	}
+	else {
+		((struct sockaddr_in6 *)&(server->address))->sin6_family = AF_INET6;
+		((struct sockaddr_in6 *)&(server->address))->sin6_port = htons(magma.dns.port);
+		((struct sockaddr_in6 *)&(server->address))->sin6_addr = ip.ip6;
+		server->length = sizeof(struct sockaddr_in6);
+	}
+
+	resolver.count++;
+
+	return true;
+}
+
+/**
+ * @brief	Start the resolver engine.
+ * @note	If magma.dns.server isn't set, the nameservers listed in /etc/resolv.conf are used, and if none are found, a server on the local host.
+ * @return	true on success or false on failure.
+ */
+bool_t dns_start(void) {
+
+	FILE *file;
+	chr_t line[256], address[128];
+
+	if (!magma.dns.timeout || !magma.dns.port || magma.dns.port > UINT16_MAX) {
+		log_critical("The DNS resolver configuration is invalid. {port = %u / timeout = %u}", magma.dns.port, magma.dns.timeout);
+		return false;
+	}
+	else if ((resolver.ed = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		log_critical("Unable to create the DNS resolver descriptor. {%s}", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+	else if (!(resolver.requests = inx_alloc(M_INX_HASHED, NULL)) || (magma.dns.cache && !(resolver.cache.entries = mm_alloc(sizeof(dns_cache_t) * magma.dns.cache)))) {
+		log_critical("Unable to allocate memory for the DNS resolver.");
+		dns_stop();
+		return false;
+	}
+
+	if ((resolver.cache.size = magma.dns.cache)) {
+		rwlock_init(&(resolver.cache.lock), NULL);
+	}
+
+	if (magma.dns.server) {
+		dns_server_add(magma.dns.server);
+	}
+	else if ((file = fopen("/etc/resolv.conf", "r"))) {
+
+		while (fgets(line, sizeof(line), file)) {
+			if (sscanf(line, " nameserver %127s", address) == 1) {
+				dns_server_add(address);
+			}
+		}
+
+		fclose(file);
+	}
+
+	if (!magma.dns.server && !resolver.count) {
+		log_info("No DNS servers were configured, so lookups will be sent to the local host.");
+		dns_server_add("127.0.0.1");
+	}
+
+	if (!resolver.count) {
+		log_critical("Unable to add any of the DNS servers.");
+		dns_stop();
+		return false;
+	}
+
+	resolver.running = true;
+
+	if (thread_launch(&(resolver.thread), &dns_engine, NULL)) {
+		log_critical("Unable to launch the DNS resolver thread.");
+		resolver.running = false;
+		dns_stop();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the resolver engine.
+ * @note	Lookups which are still pending fail, so no thread is left waiting.
+ * @return	This function returns no value.
+ */
+void dns_stop(void) {
+
+	dns_request_t *finished = NULL;
+
+	mutex_lock(&(resolver.lock));
+
+	if (resolver.running) {
+		resolver.running = false;
+		mutex_unlock(&(resolver.lock));
+		thread_join(resolver.thread);
+		mutex_lock(&(resolver.lock));
+	}
+
+	while (resolver.head) {
+		resolver.head->answer.status = DNS_ERROR;
+		dns_complete(resolver.head, &finished);
+	}
+
+	mutex_unlock(&(resolver.lock));
+
+	dns_finish(finished);
+
+	resolver.count = 0;
+
+	if (resolver.ed != -1) {
+		close(resolver.ed);
+		resolver.ed = -1;
+	}
+
+	inx_cleanup(resolver.requests);
+	resolver.requests = NULL;
+
+	if (resolver.cache.entries) {
+
+		for (uint32_t i = 0; i < resolver.cache.size; i++) {
+			ns_cleanup(resolver.cache.entries[i].name);
+			dns_answer_clear(&(resolver.cache.entries[i].answer));
+		}
+
+		rwlock_destroy(&(resolver.cache.lock));
+		mm_free(resolver.cache.entries);
+		resolver.cache.entries = NULL;
+	}
+
+	resolver.cache.size = 0;
+
+	return;
+}
@@ -2,7 +2,7 @@
 /**
  * @file /magma/network/reverse.c
  *
- * @brief	Function to perform reverse DNS lookups.
+ * @brief	Functions used to perform reverse DNS lookups on connections.
  *
  * $Author$
  * $Date$
@@ -13,13 +13,17 @@
 #include "magma.h"
 
 /**
- * @brief	Queue a reverse DNS lookup on the specified connection, if one hasn't been performed.
+ * @brief	Start a reverse DNS lookup on the specified connection, if one hasn't been performed.
+ * @note	The lookup is handed to the resolver, which calls con_reverse_complete() with the answer, so no thread waits on it.
  * @param	con		the connection object to be examined.
  * @return	This function returns no value.
  */
 void con_reverse_enqueue(connection_t *con) {
 
+	ip_t address;
 	int_t pending;
+	chr_t name[NS_MAXDNAME];
+	stringer_t *reversed = MANAGEDBUF(128);
 
 	mutex_lock(&(con->lock));
 
@@ -30,10 +34,19 @@ void con_reverse_enqueue(connection_t *con) {
 
 	mutex_unlock(&(con->lock));
 
-	if (pending == REVERSE_EMPTY) {
-		enqueue(&con_reverse_lookup, con);
+	if (pending != REVERSE_EMPTY) {
+		return;
+	}
+
+	if (!con_addr(con, &address) || !(reversed = ip_reversed(&address, reversed)) || snprintf(name, NS_MAXDNAME, "%.*s.%s",
+		st_length_int(reversed), st_char_get(reversed), address.family == AF_INET6 ? "ip6.arpa" : "in-addr.arpa") <= 0) {
+		con_reverse_status(con, REVERSE_ERROR);
+		con_destroy(con);
+		return;
 	}
 
+	dns_query(name, ns_t_ptr, &con_reverse_complete, con);
+
 	return;
 }
 
@@ -49,6 +62,7 @@ void con_reverse_domain(connection_t *con, stringer_t *domain, int_t status) {
 	mutex_lock(&(con->lock));
 	con->network.reverse.status = status;
 	con->network.reverse.domain = domain;
+	pthread_cond_broadcast(&(con->network.reverse.ready));
 	mutex_unlock(&(con->lock));
 
 	return;
@@ -65,14 +79,14 @@ void con_reverse_status(connection_t *con, int_t status) {
 
 	mutex_lock(&(con->lock));
 	con->network.reverse.status = status;
+	pthread_cond_broadcast(&(con->network.reverse.ready));
 	mutex_unlock(&(con->lock));
 
 	return;
 }
 
 /**
- * @brief	Poll a connection periodically to see if a reverse DNS lookup operation has completed.
- * @note	Polling will occur every 100ms, for as many seconds as specified by the user.
+ * @brief	Wait for the reverse DNS lookup of a connection to finish.
  * @param	con		the specified connection object to be polled that is the target of the DNS lookup.
  * @param	timeout	the number of seconds to wait for the lookup operation to complete.
  * @return	NULL on failure, or a pointer to a managed string containing the connection's peer hostname on success.
@@ -80,70 +94,48 @@ void con_reverse_status(connection_t *con, int_t status) {
 stringer_t * con_reverse_check(connection_t *con, uint32_t timeout) {
 
 	stringer_t *result = NULL;
-	int_t pending, counter = (timeout *10);
-	struct timespec request = { .tv_sec= 0, .tv_nsec= 100000000 };
-
-	do {
+	struct timespec deadline;
 
-		mutex_lock(&(con->lock));
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout;
 
-		if ((pending = con->network.reverse.status) == REVERSE_COMPLETE) {
-			result = con->network.reverse.domain;
-		}
-
-		mutex_unlock(&(con->lock));
+	mutex_lock(&(con->lock));
 
-		// Sleep for 1/10th of a second.
-		if (pending == REVERSE_PENDING && counter && status()) {
-			nanosleep(&request, NULL);
-		}
+	// The resolver fails every pending lookup when it stops, so a shutdown won't leave us waiting here.
+	while (con->network.reverse.status == REVERSE_PENDING &&
+		pthread_cond_timedwait(&(con->network.reverse.ready), &(con->lock), &deadline) != ETIMEDOUT);
 
-	} while (!result && pending == REVERSE_PENDING && counter-- && status());
+	if (con->network.reverse.status == REVERSE_COMPLETE) {
+		result = con->network.reverse.domain;
+	}
 
+	mutex_unlock(&(con->lock));
 
 	return result;
 }
 
 /**
- * @brief	Perform a reverse DNS lookup on the remote end of a connection, and save the hostname.
- * @param	con		the connection object to be queried.
+ * @brief	Store the result of a reverse DNS lookup, and wake any thread waiting for it.
+ * @note	This function is called by the resolver, and hands the connection reference taken when the lookup was started to a worker thread
+ * 			to be released.
+ * @param	answer	the answer to the PTR query.
+ * @param	con		the connection object that was queried.
  * @return	This function returns no value.
  */
-void con_reverse_lookup(connection_t *con) {
+void con_reverse_complete(dns_answer_t *answer, connection_t *con) {
 
-	void *addr;
-	int_t ecode;
 	stringer_t *domain;
-	sa_family_t family;
-	struct sockaddr_in6 address;
-	struct hostent host, *hostp;
-	socklen_t len = sizeof(struct sockaddr_in6);
-
-	// Perform the lookup.
-	if (getsockname(con->network.sockd, &address, &len)) {
-		con_reverse_status(con, REVERSE_ERROR);
-		con_destroy(con);
-		return;
-	}
-
-	if (address.sin6_family == AF_INET6) {
-		family = address.sin6_family;
-		addr = (void *)&(address.sin6_addr);
-	}
-	else if (address.sin6_family == AF_INET) {
-		family = address.sin6_family;
-		addr = (void *)&(((struct sockaddr_in *)&address)->sin_addr);
-	}
 
-	if (!(gethostbyaddr_r(addr, len, family, &host, bufptr, buflen, &hostp, &ecode)) &&
-		(len = ns_length_get(host.h_name)) && (domain = st_import(host.h_name, len))) {
+	if (answer->status == DNS_SUCCESS && answer->count && (domain = st_dupe(answer->records[0]))) {
 		con_reverse_domain(con, domain, REVERSE_COMPLETE);
 	}
 	else {
 		con_reverse_status(con, REVERSE_ERROR);
 	}
 
-	con_destroy(con);
+	// If the client already went away, this is the last reference, and tearing down the connection can block, so the reference is
+	// released by a worker rather than the resolver thread.
+	enqueue(&con_destroy, con);
 
 	return;
 }
@@ -58,7 +58,12 @@ enum {
 	SMTP_OUTCOME_BOUNCE_VIRUS = 64,
 	SMTP_OUTCOME_BOUNCE_PHISH = 128,
 	SMTP_OUTCOME_BOUNCE_SPAM = 256,
-	SMTP_OUTCOME_BOUNCE_RBL = 512
+	SMTP_OUTCOME_BOUNCE_RBL = 512,
+
+	SMTP_CHECK_RBL = 1,
+	SMTP_CHECK_SPF = 2,
+	SMTP_CHECK_DKIM = 4,
+	SMTP_CHECK_VIRUS = 8
 };
 
 typedef struct {
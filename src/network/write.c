@@ -17,41 +17,36 @@
 /// In other words, always ensure that enqueue() is being called on a connection after all processing is performed, so that it is not lost (whether it is to be kept or not).
 
 /**
- * @brief	Write data to a network connection.
- * @note	This function works regardless of whether or not the connection is ssl-enabled.
- * 			If the network write requires multiple system calls, then this code will loop until all the data has been transmitted.
+ * @brief	Transmit a set of data blocks across a network connection.
+ * @note	Plain TCP connections hand every block to the kernel with a single sendmsg() call, looping only if the write is partial. Encrypted
+ * 			connections write each block as a separate record. If more output is expected the kernel is told to hold back partial segments.
  * @param	con		the connection across which the supplied data will be written.
- * @param	block	a pointer to a data buffer containing the data to be written to the connection's remote client.
- * @param	length	the length, in bytes, of the data buffer to be written.
+ * @param	vector	an array of blocks to be written, which will be modified as data is transmitted.
+ * @param	count	the number of blocks in the array.
+ * @param	more	true if the caller is about to write more data, and the kernel should cork the socket.
  * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
  */
-int64_t con_write_bl(connection_t *con, char *block, size_t length) {
+static int64_t con_send(connection_t *con, struct iovec *vector, int_t count, bool_t more) {
 
-	ssize_t written, position = 0;
 	int sslerr;
+	ssize_t written = 0;
+	int64_t position = 0;
+	struct msghdr message;
 
-	if (!con || con->network.sockd == -1) {
-		con->network.status = -1;
-		return -1;
-	}
-	else if (!block || !length) {
-		con->network.status = 0;
-		return 0;
+	mm_wipe(&message, sizeof(struct msghdr));
+
+	// Skip past any empty blocks.
+	while (count && !vector->iov_len) {
+		vector++;
+		count--;
 	}
 
 	// Loop until bytes have been written to the socket.
-	do {
+	while (count) {
 
 		if (con->network.ssl) {
-			written = ssl_write(con->network.ssl, block + position, length);
+			written = ssl_write(con->network.ssl, vector->iov_base, vector->iov_len);
 			sslerr = SSL_get_error_d(con->network.ssl, written);
-		}
-		else {
-			written = send(con->network.sockd, block + position, length, 0);
-		}
-
-		// Check for errors on SSL writes.
-		if (con->network.ssl) {
 
 			// If 0 bytes were written, and it wasn't related to a shutdown, or if < 0 was returned and there was no more data waiting to be written, it's an error.
 			if ((!written && sslerr != SSL_ERROR_NONE && sslerr != SSL_ERROR_ZERO_RETURN) || ((written < 0) && sslerr != SSL_ERROR_WANT_WRITE)) {
@@ -62,39 +57,166 @@ int64_t con_write_bl(connection_t *con, char *block, size_t length) {
 				con->network.status = 2;
 				return -2;
 			}
-		// Check for errors on non-SSL writes in the traditional way.
 		}
-		else if (written < 0) {
+		else {
 
-			if (errno == ECONNRESET) {
-				con->network.status = 2;
-				return -2;
-			}
-			else if (errno != EAGAIN) {
-				con->network.status = -1;
-				return -1;
-			}
+			message.msg_iov = vector;
+			message.msg_iovlen = count;
+
+			// Check for errors on non-SSL writes in the traditional way.
+			if ((written = sendmsg(con->network.sockd, &message, more ? MSG_MORE : 0)) < 0) {
+
+				if (errno == ECONNRESET) {
+					con->network.status = 2;
+					return -2;
+				}
+				else if (errno != EAGAIN) {
+					con->network.status = -1;
+					return -1;
+				}
 
+			}
 		}
 
 		if (written > 0) {
-			length -= written;
+
 			position += written;
-		}
 
-	} while (length);
+			// Advance past the blocks which were written in full, and then past the portion of the partially written block.
+			while (count && (size_t)written >= vector->iov_len) {
+				written -= vector->iov_len;
+				vector++;
+				count--;
+			}
 
-#ifdef MAGMA_PEDANTIC
-	if (written < 0) log_pedantic("write = %li {%s}", written, strerror_r(errno, bufptr, buflen));
-#endif
+			if (count) {
+				vector->iov_base = (chr_t *)vector->iov_base + written;
+				vector->iov_len -= written;
+			}
+		}
 
-	if (written > 0) {
+	}
+
+	if (position > 0) {
 		con->network.status = 1;
 	}
 
 	return position;
 }
 
+/**
+ * @brief	Write any buffered output to a network connection.
+ * @note	Output is held in the connection's output buffer until it fills, the connection reads from the network, parks, hands the socket
+ * 			to another layer, or is destroyed. Code which must guarantee the client has seen a response before doing anything else should flush.
+ * @param	con		the connection whose output should be transmitted.
+ * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ */
+int64_t con_flush(connection_t *con) {
+
+	int64_t result;
+	struct iovec vector;
+
+	if (!con || con->network.sockd == -1) {
+		if (con) con->network.status = -1;
+		return -1;
+	}
+	else if (!con->network.output || st_empty(con->network.output)) {
+		return 0;
+	}
+
+	vector.iov_base = st_char_get(con->network.output);
+	vector.iov_len = st_length_get(con->network.output);
+
+	// The buffer is emptied even if the write fails, since a broken connection won't be written to again.
+	result = con_send(con, &vector, 1, false);
+	st_length_set(con->network.output, 0);
+
+	return result;
+}
+
+/**
+ * @brief	Write data to a network connection.
+ * @note	This function works regardless of whether or not the connection is ssl-enabled.
+ * 			Small writes are collected in the connection's output buffer, so a response assembled from many fragments leaves in as few
+ * 			system calls and SSL records as possible. When the buffer overflows, plain connections transmit the buffer and the new block
+ * 			together, while encrypted connections top up the buffer first so every record is full. Set magma.system.network_output to
+ * 			zero to write every block immediately.
+ * @param	con		the connection across which the supplied data will be written.
+ * @param	block	a pointer to a data buffer containing the data to be written to the connection's remote client.
+ * @param	length	the length, in bytes, of the data buffer to be written.
+ * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ */
+int64_t con_write_bl(connection_t *con, char *block, size_t length) {
+
+	int64_t result;
+	struct iovec vector[2];
+	size_t avail, chunk, position = 0;
+
+	if (!con || con->network.sockd == -1) {
+		con->network.status = -1;
+		return -1;
+	}
+	else if (!block || !length) {
+		con->network.status = 0;
+		return 0;
+	}
+
+	// If output buffering is disabled, or the buffer can't be allocated, write the block directly.
+	if (!magma.system.network_output || (!con->network.output && !(con->network.output = st_alloc(magma.system.network_output)))) {
+		vector[0].iov_base = block;
+		vector[0].iov_len = length;
+		return con_send(con, vector, 1, false);
+	}
+
+	avail = st_avail_get(con->network.output) - st_length_get(con->network.output);
+
+	// The common case. The block fits inside the buffer.
+	if (length <= avail) {
+		mm_copy(st_char_get(con->network.output) + st_length_get(con->network.output), block, length);
+		st_length_set(con->network.output, st_length_get(con->network.output) + length);
+		con->network.status = 1;
+		return length;
+	}
+
+	// Plain connections send the buffered data and the new block with a single system call.
+	else if (!con->network.ssl) {
+		vector[0].iov_base = st_char_get(con->network.output);
+		vector[0].iov_len = st_length_get(con->network.output);
+		vector[1].iov_base = block;
+		vector[1].iov_len = length;
+
+		result = con_send(con, vector, 2, true);
+		st_length_set(con->network.output, 0);
+		return result < 0 ? result : (int64_t)length;
+	}
+
+	// Encrypted connections fill the buffer and flush it, until the remainder fits. Anything at least as large as the buffer is
+	// written directly, since copying it wouldn't reduce the number of records.
+	while (position < length) {
+
+		if (st_empty(con->network.output) && length - position >= st_avail_get(con->network.output)) {
+			vector[0].iov_base = block + position;
+			vector[0].iov_len = length - position;
+			return (result = con_send(con, vector, 1, true)) < 0 ? result : (int64_t)length;
+		}
+
+		avail = st_avail_get(con->network.output) - st_length_get(con->network.output);
+		chunk = length - position < avail ? length - position : avail;
+
+		mm_copy(st_char_get(con->network.output) + st_length_get(con->network.output), block + position, chunk);
+		st_length_set(con->network.output, st_length_get(con->network.output) + chunk);
+		position += chunk;
+
+		if (st_length_get(con->network.output) == st_avail_get(con->network.output) && (result = con_flush(con)) < 0) {
+			return result;
+		}
+
+	}
+
+	con->network.status = 1;
+	return length;
+}
+
 /**
  * @brief	Write a managed string to a network connection.
  * @see		con_write_bl()
@@ -131,6 +253,86 @@ int64_t con_write_pl(connection_t *con, placer_t string) {
 	return con_write_bl(con, pl_char_get(string), pl_length_get(string));
 }
 
+/**
+ * @brief	Write a range of bytes from an open file to a network connection.
+ * @note	Plain TCP connections hand the range to the kernel using sendfile(), so the data is never copied into user space. Encrypted
+ * 			connections need the data to pass through the SSL library, so the range is read in chunks using the thread buffer instead.
+ * @param	con		the connection across which the supplied data will be written.
+ * @param	fd		the file descriptor holding the data to be written.
+ * @param	offset	the position in the file where the data begins.
+ * @param	length	the number of bytes to be written.
+ * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ */
+int64_t con_write_file(connection_t *con, int fd, off_t offset, size_t length) {
+
+	ssize_t written, chunk;
+	int64_t position = 0;
+
+	if (!con || con->network.sockd == -1 || fd < 0) {
+		if (con) con->network.status = -1;
+		return -1;
+	}
+	else if (!length) {
+		con->network.status = 0;
+		return 0;
+	}
+	// Anything already buffered, like the response headers, must precede the file data.
+	else if ((written = con_flush(con)) < 0) {
+		return written;
+	}
+
+	if (con->network.ssl) {
+
+		do {
+
+			if ((chunk = pread(fd, bufptr, length < buflen ? length : buflen, offset + position)) <= 0) {
+				log_pedantic("Unable to read the file data. {read = %li / error = %s}", chunk, strerror_r(errno, bufptr, buflen));
+				con->network.status = -1;
+				return -1;
+			}
+			else if ((written = con_write_bl(con, bufptr, chunk)) != chunk) {
+				return written < 0 ? written : -1;
+			}
+
+			length -= chunk;
+			position += chunk;
+
+		} while (length);
+
+		return position;
+	}
+
+	do {
+
+		if ((written = sendfile(con->network.sockd, fd, &offset, length)) < 0) {
+
+			if (errno == ECONNRESET || errno == EPIPE) {
+				con->network.status = 2;
+				return -2;
+			}
+			else if (errno != EAGAIN && errno != EINTR) {
+				log_pedantic("sendfile = %li {%s}", written, strerror_r(errno, bufptr, buflen));
+				con->network.status = -1;
+				return -1;
+			}
+
+		}
+		// The file is shorter than the requested range.
+		else if (!written) {
+			con->network.status = -1;
+			return -1;
+		}
+		else {
+			length -= written;
+			position += written;
+		}
+
+	} while (length);
+
+	con->network.status = 1;
+	return position;
+}
+
 /**
  * @brief	Write a formatted string to a network connection.
  * @see		con_write_bl()
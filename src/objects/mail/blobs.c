@@ -0,0 +1,384 @@
+/**
+ * @file /magma/objects/mail/blobs.c
+ *
+ * @brief	Functions used to store a message body once, no matter how many messages share it.
+ *
+ * @note	Large bodies are compressed into a blob file named after the SHA-256 digest of the body, and the message file only holds the
+ * 			header. Each message using a blob gets a hard link to it, stored beside the message file with a ".body" suffix, so the file
+ * 			system link count doubles as the reference count. When the canonical name is the only link left, the blob is removed. If a
+ * 			blob reaches the file system link limit, a fresh copy is written and renamed over the canonical name.
+ *
+ * 			A blob file holds the standard message file header, followed by the raw digest, and then the compressed body.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Return the canonical path of the blob holding a body with the specified digest.
+ * @param	digest	a managed string containing the hex encoded digest of the body.
+ * @param	server	the hostname of the server where the blob resides, or if NULL, the default server.
+ * @return	NULL on failure, or a pointer to a null-terminated string containing the absolute file path of the blob.
+ */
+chr_t * mail_blob_path(stringer_t *digest, chr_t *server) {
+
+	chr_t *result;
+
+	if (st_length_get(digest) < 4) {
+		log_pedantic("The blob digest is too short.");
+		return NULL;
+	}
+	else if (!(result = ns_alloc(1024))) {
+		log_pedantic("Unable to allocate a buffer of %i bytes for the blob path.", 1024);
+		return NULL;
+	}
+
+	// The default storage server.
+	if (!server) {
+		server = st_char_get(magma.storage.active);
+	}
+
+	if ((snprintf(result, 1024, "%.*s/%s/blobs/%.2s/%.2s/%.*s", st_length_int(magma.storage.root), st_char_get(magma.storage.root), server,
+		st_char_get(digest), st_char_get(digest) + 2, st_length_int(digest), st_char_get(digest))) <= 0) {
+		log_pedantic("Unable to create the blob path.");
+		ns_free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Return the path of the link a message uses to reference its shared body.
+ * @param	number		the mail message id.
+ * @param	server		the hostname of the server where the message data resides or if NULL, the default server.
+ * @return	NULL on failure, or a pointer to a null-terminated string containing the absolute path of the body reference.
+ */
+chr_t * mail_blob_reference(uint64_t number, chr_t *server) {
+
+	chr_t *result;
+
+	if (!(result = mail_message_path(number, server))) {
+		return NULL;
+	}
+	else if (ns_length_get(result) + 6 > 1024) {
+		log_pedantic("The message path is too long to hold a body reference.");
+		ns_free(result);
+		return NULL;
+	}
+
+	strcat(result, ".body");
+	return result;
+}
+
+/**
+ * @brief	Create the directories needed to hold the blob with the specified digest.
+ * @param	digest	a managed string containing the hex encoded digest of the body.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_blob_directory(stringer_t *digest) {
+
+	chr_t dirpath[1024];
+	chr_t *server = st_char_get(magma.storage.active);
+
+	snprintf(dirpath, 1024, "%.*s/%s/blobs", st_length_int(magma.storage.root), st_char_get(magma.storage.root), server);
+
+	if (mkdir(dirpath, S_IRWXU) != 0 && errno != EEXIST) {
+		log_error("An error occurred while attempting to create the directory %s.", dirpath);
+		return false;
+	}
+
+	snprintf(dirpath, 1024, "%.*s/%s/blobs/%.2s", st_length_int(magma.storage.root), st_char_get(magma.storage.root), server, st_char_get(digest));
+
+	if (mkdir(dirpath, S_IRWXU) != 0 && errno != EEXIST) {
+		log_error("An error occurred while attempting to create the directory %s.", dirpath);
+		return false;
+	}
+
+	snprintf(dirpath, 1024, "%.*s/%s/blobs/%.2s/%.2s", st_length_int(magma.storage.root), st_char_get(magma.storage.root), server,
+		st_char_get(digest), st_char_get(digest) + 2);
+
+	if (mkdir(dirpath, S_IRWXU) != 0 && errno != EEXIST) {
+		log_error("An error occurred while attempting to create the directory %s.", dirpath);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Store the body of a message, reusing an existing blob if an identical body has already been stored.
+ * @note	The message file must already exist, since the body reference is created in the same directory.
+ * @param	messagenum	the numerical id of the message that will reference the body.
+ * @param	body		a managed string containing the body of the message.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_blob_store(uint64_t messagenum, stringer_t *body) {
+
+	int_t fd;
+	bool_t full = false;
+	compress_t *reduced;
+	message_fheader_t fheader;
+	chr_t *reference, *canonical, temporary[1024];
+	stringer_t *digest = MANAGEDBUF(32), *hex = MANAGEDBUF(64);
+
+	if (!(digest = digest_sha256(body, digest)) || !(hex = hex_encode_st(digest, hex))) {
+		log_error("Unable to calculate the message body digest.");
+		return false;
+	}
+	else if (!(reference = mail_blob_reference(messagenum, NULL))) {
+		log_error("Could not build the message body reference path.");
+		return false;
+	}
+	else if (!(canonical = mail_blob_path(hex, NULL))) {
+		log_error("Could not build the blob path.");
+		ns_free(reference);
+		return false;
+	}
+
+	// The message number was just allocated, so anything already at the reference path was left behind by an earlier failure.
+	unlink(reference);
+
+	// If an identical body has already been stored, all we need is another link to it.
+	if (!link(canonical, reference)) {
+		stats_increment_by_num(STATS_OBJECTS_MAIL_BLOBS_SHARED);
+		ns_free(canonical);
+		ns_free(reference);
+		return true;
+	}
+	// A blob which has reached the file system link limit is replaced by a fresh copy, which later deliveries will link to instead.
+	else if (errno != ENOENT && errno != EMLINK) {
+		log_error("Could not link the message to its body. {%s}", strerror_r(errno, bufptr, buflen));
+		ns_free(canonical);
+		ns_free(reference);
+		return false;
+	}
+	else if (errno == EMLINK) {
+		full = true;
+	}
+
+	if (!(reduced = compress_lzo(body))) {
+		log_error("An error occurred while attempting to compress a message body with %zu bytes.", st_length_get(body));
+		ns_free(canonical);
+		ns_free(reference);
+		return false;
+	}
+
+	fheader.magic1 = FMESSAGE_MAGIC_1;
+	fheader.magic2 = FMESSAGE_MAGIC_2;
+	fheader.reserved = 0;
+	fheader.flags = FMESSAGE_OPT_COMPRESSED | FMESSAGE_OPT_SHARED;
+
+	// The blob is written under a name only this message uses, so a concurrent delivery of the same body can't see a partial file.
+	snprintf(temporary, 1024, "%s.%lu", canonical, messagenum);
+
+	if ((!mail_blob_directory(hex) || (fd = open(temporary, O_CREAT | O_EXCL | O_WRONLY | O_SYNC, S_IRUSR | S_IWUSR)) < 0)) {
+		log_error("Could not create the blob file %s.", temporary);
+		compress_free(reduced);
+		ns_free(canonical);
+		ns_free(reference);
+		return false;
+	}
+
+	if (write(fd, &fheader, sizeof(fheader)) != sizeof(fheader) || write(fd, st_data_get(digest), 32) != 32 ||
+		write(fd, reduced, compress_total_length(reduced)) != compress_total_length(reduced) || fsync(fd) != 0) {
+		log_error("Error writing the message body to disk.");
+		compress_free(reduced);
+		close(fd);
+		unlink(temporary);
+		ns_free(canonical);
+		ns_free(reference);
+		return false;
+	}
+
+	close(fd);
+	compress_free(reduced);
+
+	// The message is linked to the file we wrote. If another delivery published an identical blob first, the canonical link fails, and
+	// the two copies live on independently until their references are released.
+	if (link(temporary, reference)) {
+		log_error("Could not link the message to its body. {%s}", strerror_r(errno, bufptr, buflen));
+		unlink(temporary);
+		ns_free(canonical);
+		ns_free(reference);
+		return false;
+	}
+	// When the existing blob is full, the fresh copy takes over the canonical name. Messages linked to the old copy keep their own
+	// links to it, so it lives on until the last of them is released.
+	else if (full && rename(temporary, canonical)) {
+		log_pedantic("Could not replace the blob %s. {%s}", canonical, strerror_r(errno, bufptr, buflen));
+	}
+	else if (!full && link(temporary, canonical) && errno != EEXIST) {
+		log_pedantic("Could not publish the blob %s. {%s}", canonical, strerror_r(errno, bufptr, buflen));
+	}
+
+	stats_increment_by_num(STATS_OBJECTS_MAIL_BLOBS_STORED);
+
+	unlink(temporary);
+	ns_free(canonical);
+	ns_free(reference);
+	return true;
+}
+
+/**
+ * @brief	Give a copy of a message its own reference to the original message's shared body.
+ * @param	original	the numerical id of the message being copied.
+ * @param	server		the hostname of the server where the original message resides or if NULL, the default server.
+ * @param	copy		the numerical id of the copy, which is always stored on the default server.
+ * @return	true if the body was linked, or the original doesn't have a shared body, and false on failure.
+ */
+bool_t mail_blob_copy(uint64_t original, chr_t *server, uint64_t copy) {
+
+	bool_t result = true;
+	stringer_t *body = NULL;
+	chr_t *source, *target;
+
+	if (!(source = mail_blob_reference(original, server)) || !(target = mail_blob_reference(copy, NULL))) {
+		ns_cleanup(source);
+		return false;
+	}
+
+	// If the original doesn't have a shared body, there is nothing to link.
+	if (!link(source, target) || errno == ENOENT) {
+		result = true;
+	}
+	else if (errno != EMLINK) {
+		log_error("Could not link the message copy to its body. {%s}", strerror_r(errno, bufptr, buflen));
+		result = false;
+	}
+	// The body has reached the file system link limit, so the copy is given a fresh blob instead.
+	else if (!(body = mail_blob_load(original, server)) || !mail_blob_store(copy, body)) {
+		log_error("Could not store a new body for the message copy.");
+		result = false;
+	}
+
+	st_cleanup(body);
+	ns_free(source);
+	ns_free(target);
+	return result;
+}
+
+/**
+ * @brief	Read the shared body of a message.
+ * @param	messagenum	the numerical id of the message.
+ * @param	server		the hostname of the server where the message resides or if NULL, the default server.
+ * @return	NULL on failure, or a managed string containing the decompressed body on success.
+ */
+stringer_t * mail_blob_load(uint64_t messagenum, chr_t *server) {
+
+	chr_t *reference;
+	compress_t *compressed;
+	message_fheader_t *fheader;
+	stringer_t *contents, *result;
+	size_t offset = sizeof(message_fheader_t) + 32;
+
+	if (!(reference = mail_blob_reference(messagenum, server))) {
+		log_pedantic("Could not build the message body reference path.");
+		return NULL;
+	}
+	else if (!(contents = file_load(reference))) {
+		log_pedantic("Unable to read the message body. { %s }", reference);
+		ns_free(reference);
+		return NULL;
+	}
+
+	fheader = (message_fheader_t *)st_data_get(contents);
+
+	if (st_length_get(contents) < offset || fheader->magic1 != FMESSAGE_MAGIC_1 || fheader->magic2 != FMESSAGE_MAGIC_2 ||
+		!(compressed = compress_import(PLACER(st_char_get(contents) + offset, st_length_get(contents) - offset)))) {
+		log_pedantic("Message body had incorrect file format. { %s }", reference);
+		ns_free(reference);
+		st_free(contents);
+		return NULL;
+	}
+
+	if (!(result = decompress_lzo(compressed))) {
+		log_pedantic("Could not uncompress the message body. { %s }", reference);
+	}
+
+	ns_free(reference);
+	st_free(contents);
+	return result;
+}
+
+/**
+ * @brief	Combine the compressed header of a message with its shared body, to produce a compressed copy of the complete message.
+ * @param	header		a managed string containing the compressed message header, as stored in the message file.
+ * @param	messagenum	the numerical id of the message.
+ * @param	server		the hostname of the server where the message resides or if NULL, the default server.
+ * @return	NULL on failure, or a compression buffer holding the complete message on success.
+ */
+compress_t * mail_blob_merge(stringer_t *header, uint64_t messagenum, chr_t *server) {
+
+	compress_t *compressed, *result = NULL;
+	stringer_t *uncompressed, *body, *joined;
+
+	if (!(compressed = compress_import(header)) || !(uncompressed = decompress_lzo(compressed))) {
+		log_pedantic("Could not uncompress the message header.");
+		return NULL;
+	}
+	else if (!(body = mail_blob_load(messagenum, server))) {
+		st_free(uncompressed);
+		return NULL;
+	}
+
+	if (!(joined = st_merge("ss", uncompressed, body)) || !(result = compress_lzo(joined))) {
+		log_pedantic("Unable to merge the message header and body.");
+	}
+
+	st_cleanup(joined);
+	st_free(uncompressed);
+	st_free(body);
+	return result;
+}
+
+/**
+ * @brief	Release the reference a message holds to its shared body, and remove the blob if nothing else references it.
+ * @note	A delivery can link to the canonical name between the link count check and the unlink. That message keeps its own link to the
+ * 			data, so the only cost is that a later delivery of the same body writes a new blob.
+ * @param	messagenum	the numerical id of the message.
+ * @param	server		the hostname of the server where the message resides or if NULL, the default server.
+ * @return	This function returns no value.
+ */
+void mail_blob_release(uint64_t messagenum, chr_t *server) {
+
+	int_t fd;
+	struct stat info;
+	message_fheader_t fheader;
+	chr_t *reference, *canonical = NULL;
+	stringer_t *digest = MANAGEDBUF(32), *hex = MANAGEDBUF(64);
+
+	if (!(reference = mail_blob_reference(messagenum, server))) {
+		return;
+	}
+
+	// Messages without a shared body don't have a reference to release.
+	if ((fd = open(reference, O_RDONLY)) < 0) {
+		ns_free(reference);
+		return;
+	}
+
+	if (read(fd, &fheader, sizeof(fheader)) == sizeof(fheader) && read(fd, st_data_get(digest), 32) == 32) {
+		st_length_set(digest, 32);
+		if ((hex = hex_encode_st(digest, hex))) {
+			canonical = mail_blob_path(hex, server);
+		}
+	}
+
+	close(fd);
+
+	if (unlink(reference)) {
+		log_pedantic("Could not unlink the message body reference %s. {%s}", reference, strerror_r(errno, bufptr, buflen));
+	}
+	else if (canonical && !stat(canonical, &info) && info.st_nlink == 1 && unlink(canonical)) {
+		log_pedantic("Could not unlink the unreferenced blob %s. {%s}", canonical, strerror_r(errno, bufptr, buflen));
+	}
+
+	ns_cleanup(canonical);
+	ns_free(reference);
+	return;
+}
@@ -1,8 +1,17 @@
-
 /**
  * @file /magma/objects/mail/cache.c
  *
- * @brief	Functions used to cache a mail message in its parsed form.
+ * @brief	Functions used to cache the decompressed, and decrypted, text of recently loaded mail messages.
+ *
+ * @note	The cache is shared by every worker thread. Entries are spread across a fixed number of shards using the message number, and each
+ * 			shard tracks the order its entries were used in, so the least recently used messages are evicted once the shard exceeds its share
+ * 			of the configured size limit. Entries are reference counted, which allows a cache hit to hand out the cached text without copying
+ * 			it, and allows an entry to be evicted while it's still in use. Large messages are moved into anonymous memory files, which lets
+ * 			the protocol handlers pass them to the kernel with sendfile(), rather than copying them through user space.
+ *
+ * 			Memory files aren't counted against their shard's share of the size limit, since that would cap them at a fraction of the cache.
+ * 			Instead they share a separate, cache wide, budget of the same size, and when it runs out the oldest memory files are evicted
+ * 			from each shard in turn.
  *
  * $Author$
  * $Date$
@@ -12,134 +21,522 @@
 
 #include "magma.h"
 
-static pthread_key_t mail_cache;
+typedef struct {
+	size_t bytes; /* The number of bytes held in heap memory by the shard. */
+	uint64_t mapped; /* The number of entries in the shard which are held in memory files. */
+	inx_t *entries;
+	pthread_mutex_t lock;
+	mail_cache_t *newest, *oldest;
+} mail_cache_shard_t;
+
+static struct {
+	size_t limit; /* The number of heap bytes each shard may hold. */
+	size_t budget; /* The number of bytes which may be held in memory files across every shard. */
+	uint64_t mapped; /* The number of bytes currently held in memory files. */
+	uint64_t cursor; /* The shard which will next give up a memory file when the budget runs out. */
+	mail_cache_shard_t shards[MAIL_CACHE_SHARDS];
+} mail_cache = {
+		.limit = 0,
+		.budget = 0,
+		.mapped = 0,
+		.cursor = 0
+};
 
 /**
  * @brief	Free a cached mail message.
- * @param	holder	a pointer to the cached mail message object to be freed.
+ * @param	entry	a pointer to the cached mail message object to be freed.
  * @return	This function returns no value.
  */
-void mail_cache_destroy(void *holder) {
+void mail_cache_free(mail_cache_t *entry) {
 
-	mail_cache_t *message = (mail_cache_t *)holder;
+	if (entry) {
+		st_cleanup(entry->text);
+		mm_free(entry);
+	}
 
-	 if (message) {
-		 st_cleanup(message->text);
-		 mm_free(message);
-	 }
+	return;
+}
 
-	 return;
+/**
+ * @brief	Map a memory file, and wrap the mapping in a managed string.
+ * @note	The file is extended by a single byte so the mapped text is always followed by a terminating NULL. The descriptor is closed on failure.
+ * @param	handle		the descriptor of the memory file.
+ * @param	length		the number of bytes of message text the file will hold.
+ * @param	protection	the memory protection flags for the mapping.
+ * @return	NULL on failure, or a mapped managed string which holds the descriptor of the file behind it.
+ */
+static stringer_t * mail_cache_mapping(int_t handle, size_t length, int protection) {
+
+	void *data;
+	mapped_t *result;
+
+	if (ftruncate64(handle, length + 1) || (data = mmap64(NULL, length + 1, protection, MAP_SHARED, handle, 0)) == MAP_FAILED) {
+		log_pedantic("Unable to map the cached message text. {%s}", strerror_r(errno, bufptr, buflen));
+		close(handle);
+		return NULL;
+	}
+	else if (!(result = mm_alloc(sizeof(mapped_t)))) {
+		munmap(data, length + 1);
+		close(handle);
+		return NULL;
+	}
+
+	result->opts = MAPPED_T | JOINTED | HEAP;
+	result->avail = length;
+	result->handle = handle;
+	result->data = data;
+
+	return (stringer_t *)result;
 }
 
 /**
- * @brief	Initialize the thread-specific data key used for the mail message cache.
- * @return	true on success or false on failure.
+ * @brief	Copy the text of a large message into a read only, memory backed file.
+ * @note	The original text is left alone, so the caller can decide which copy to keep.
+ * @param	text	a managed string containing the message text.
+ * @return	NULL on failure, or a mapped managed string which holds the message text and the descriptor of the file behind it.
  */
-bool_t mail_cache_start(void) {
+static stringer_t * mail_cache_map(stringer_t *text) {
+
+	int_t handle;
+	stringer_t *result;
+	size_t length = st_length_get(text);
 
-	 if (pthread_key_create(&mail_cache, mail_cache_destroy) != 0) {
-		 log_pedantic("Unable to create the thread local message cache.");
-		 return false;
-	 }
+	if ((handle = file_memory("magma-message", text)) == -1 || !(result = mail_cache_mapping(handle, length, PROT_READ))) {
+		return NULL;
+	}
 
-	 return true;
+	st_length_set(result, length);
+	return result;
 }
 
 /**
- * @brief	Destroy the thread-specific data key used for the mail message cache.
- * @return	This function returns no value.
+ * @brief	Allocate an empty memory file, so a large message can be decompressed directly into it, rather than being decompressed onto
+ * 			the heap and then copied.
+ * @note	The buffer is only handed out if a message of the given length would be moved into a memory file by mail_cache_set().
+ * @param	length	the length of the message text which will be written into the buffer.
+ * @return	NULL if the message should be loaded onto the heap, or a mapped managed string with room for length bytes.
  */
-void mail_cache_stop(void) {
+stringer_t * mail_cache_buffer(size_t length) {
+
+	int_t handle;
 
-	if (pthread_key_delete(mail_cache) != 0) {
-		log_pedantic("Unable to delete the thread local message cache.");
+	if (!mail_cache.limit || length + sizeof(mail_cache_t) < MAIL_CACHE_MAPPED_LENGTH || length + sizeof(mail_cache_t) > mail_cache.budget) {
+		return NULL;
+	}
+	else if ((handle = memfd_create("magma-message", MFD_CLOEXEC)) < 0) {
+		log_pedantic("Unable to create a memory file. {%s}", strerror_r(errno, bufptr, buflen));
+		return NULL;
 	}
 
-	return;
+	return mail_cache_mapping(handle, length, PROT_READ | PROT_WRITE);
+}
+
+/**
+ * @brief	Find the slot a server instance occupies in the server table.
+ * @note	The parsed form of a message embeds links which use the domain of the server it was loaded for, so parsed entries are kept
+ * 			separately for every server instance.
+ * @param	server	the server instance to be located.
+ * @return	-1 if the server isn't configured, or the slot number of the server instance.
+ */
+static int_t mail_cache_instance(server_t *server) {
+
+	for (int_t i = 0; server && i < MAGMA_SERVER_INSTANCES; i++) {
+		if (magma.servers[i] == server) {
+			return i;
+		}
+	}
+
+	return -1;
 }
 
 /**
- * @brief	Free the thread-specific data for the mail message cache.
+ * @brief	Build the index key for a cache entry.
+ * @note	The raw and parsed forms of a message are cached separately, so the low bit of the key records which form an entry holds, and
+ * 			the bits above it hold the server instance the parsed form was created for. Raw entries always use instance zero.
+ * @param	messagenum	the numerical id of the message.
+ * @param	instance	the server instance slot the entry was created for.
+ * @param	parsed		true if the entry holds the parsed form of the message.
+ * @return	the index key for the cache entry.
+ */
+static multi_t mail_cache_key(uint64_t messagenum, uint32_t instance, bool_t parsed) {
+
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (((messagenum * MAGMA_SERVER_INSTANCES) + instance) << 1) | (parsed ? 1 : 0) };
+
+	return key;
+}
+
+/**
+ * @brief	Remove an entry from its shard, and free it if nobody is using it.
+ * @note	The shard lock must be held by the caller.
+ * @param	shard	the shard holding the entry.
+ * @param	entry	the entry to be evicted.
  * @return	This function returns no value.
  */
-void mail_cache_thread_stop(void) {
+static void mail_cache_evict(mail_cache_shard_t *shard, mail_cache_t *entry) {
+
+	inx_delete(shard->entries, mail_cache_key(entry->messagenum, entry->instance, entry->parsed));
+
+	if (entry->newer) ((mail_cache_t *)entry->newer)->older = entry->older;
+	else shard->newest = (mail_cache_t *)entry->older;
+
+	if (entry->older) ((mail_cache_t *)entry->older)->newer = entry->newer;
+	else shard->oldest = (mail_cache_t *)entry->newer;
+
+	if (entry->mapped) {
+		__sync_fetch_and_sub(&(mail_cache.mapped), entry->bytes);
+		shard->mapped--;
+	}
+	else {
+		shard->bytes -= entry->bytes;
+	}
 
-	mail_cache_t *message;
+	entry->newer = entry->older = NULL;
+	entry->evicted = true;
 
-	if ((message = pthread_getspecific(mail_cache))) {
-		mail_cache_destroy(message);
-		pthread_setspecific(mail_cache, NULL);
+	// If the entry is still in use, the last reference holder will free it.
+	if (!entry->refs) {
+		mail_cache_free(entry);
 	}
 
 	return;
 }
 
 /**
- * @brief	Attempt to retrieve the contents of a message from the thread's cached data.
- * @note	The thread's cache only has the capacity to store a single message.
- * @param	messagenum		the id of the message to be retrieved.
- * @return	NULL on failure or a managed string containing the message data on success.
+ * @brief	Evict the oldest memory file held by the next shard that has one.
+ * @note	The shards are visited in turn, so the budget isn't drained from a single shard. The caller must not hold a shard lock.
+ * @return	true if an entry was evicted, or false if no shard holds a memory file.
  */
-stringer_t * mail_cache_get(uint64_t messagenum) {
+static bool_t mail_cache_shrink(void) {
 
-	mail_cache_t *message;
+	mail_cache_t *entry;
+	mail_cache_shard_t *shard;
 
-	if (!(message = pthread_getspecific(mail_cache))) {
-		return NULL;
+	for (uint32_t i = 0; i < MAIL_CACHE_SHARDS; i++) {
+
+		shard = &(mail_cache.shards[__sync_fetch_and_add(&(mail_cache.cursor), 1) % MAIL_CACHE_SHARDS]);
+		mutex_lock(&(shard->lock));
+
+		for (entry = shard->oldest; shard->mapped && entry; entry = (mail_cache_t *)entry->newer) {
+			if (entry->mapped) {
+				mail_cache_evict(shard, entry);
+				mutex_unlock(&(shard->lock));
+				stats_increment_by_num(STATS_OBJECTS_MAIL_CACHE_EVICTIONS);
+				return true;
+			}
+		}
+
+		mutex_unlock(&(shard->lock));
 	}
 
-	if (message->messagenum == messagenum) {
-		return st_dupe(message->text);
+	return false;
+}
+
+/**
+ * @brief	Reserve room in the memory file budget, evicting older memory files as needed.
+ * @param	bytes	the number of bytes to be reserved.
+ * @return	true if the bytes were reserved, or false if the budget couldn't accommodate them.
+ */
+static bool_t mail_cache_reserve(size_t bytes) {
+
+	uint64_t current;
+
+	if (bytes > mail_cache.budget) {
+		return false;
 	}
 
-	return NULL;
+	do {
+
+		current = __atomic_load_n(&(mail_cache.mapped), __ATOMIC_RELAXED);
+
+		if (current + bytes > mail_cache.budget && !mail_cache_shrink()) {
+			return false;
+		}
+
+	} while (current + bytes > mail_cache.budget ||
+		!__atomic_compare_exchange_n(&(mail_cache.mapped), &current, current + bytes, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return true;
 }
 
 /**
- * @brief	Reset the thread's mail cache and free any held message.
+ * @brief	Release a reference to a cached mail message.
+ * @param	entry	the cache entry returned by mail_cache_get() or mail_cache_set().
  * @return	This function returns no value.
  */
-void mail_cache_reset(void) {
+void mail_cache_release(mail_cache_t *entry) {
+
+	bool_t orphaned;
+	mail_cache_shard_t *shard;
 
-	mail_cache_t *message;
+	if (!entry) {
+		return;
+	}
+
+	shard = &(mail_cache.shards[entry->messagenum % MAIL_CACHE_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+	orphaned = (--entry->refs == 0 && entry->evicted);
+	mutex_unlock(&(shard->lock));
 
-	if ((message = pthread_getspecific(mail_cache))) {
-		st_cleanup(message->text);
-		message->text = NULL;
-		message->messagenum = 0;
+	if (orphaned) {
+		mail_cache_free(entry);
 	}
 
 	return;
 }
 
 /**
- * @brief	Set the contents of the thread's mail cache.
- * @param	messagenum	the numerical id of the message to be cached.
- * @text	a managed string containing the contents of the specified message to be cached.
+ * @brief	Acquire an additional reference to a cached mail message.
+ * @note	The caller must already hold a reference to the entry, and must release the new reference using mail_cache_release().
+ * @param	entry	the cache entry to be retained.
  * @return	This function returns no value.
  */
-void mail_cache_set(uint64_t messagenum, stringer_t *text) {
+void mail_cache_retain(mail_cache_t *entry) {
+
+	mail_cache_shard_t *shard;
 
-	mail_cache_t *message;
+	if (!entry) {
+		return;
+	}
+
+	shard = &(mail_cache.shards[entry->messagenum % MAIL_CACHE_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+	entry->refs++;
+	mutex_unlock(&(shard->lock));
+
+	return;
+}
 
-	if (!(message = pthread_getspecific(mail_cache))) {
+/**
+ * @brief	Attempt to retrieve the text of a message from the cache.
+ * @note	The returned entry is shared with the other worker threads, so its text must be treated as read only, and the entry must be
+ * 			released using mail_cache_release() once it is no longer needed.
+ * @param	messagenum	the id of the message to be retrieved.
+ * @param	server		the server instance the parsed form of the message is needed for.
+ * @param	parsed		true if the parsed form of the message is needed, or false for the raw form.
+ * @param	marks		the message status flags which affect the parsed text; an entry created with different marks is considered stale.
+ * @return	NULL if the message isn't cached, or a pointer to the referenced cache entry on success.
+ */
+mail_cache_t * mail_cache_get(uint64_t messagenum, server_t *server, bool_t parsed, uint32_t marks) {
 
-		if (!(message = mm_alloc(sizeof(mail_cache_t)))) {
-			return;
+	int_t instance = 0;
+	mail_cache_t *entry;
+	mail_cache_shard_t *shard;
+
+	if (!mail_cache.limit || (parsed && (instance = mail_cache_instance(server)) < 0)) {
+		return NULL;
+	}
+
+	shard = &(mail_cache.shards[messagenum % MAIL_CACHE_SHARDS]);
+	mutex_lock(&(shard->lock));
+
+	if ((entry = inx_find(shard->entries, mail_cache_key(messagenum, instance, parsed))) && entry->marks != marks) {
+		mail_cache_evict(shard, entry);
+		entry = NULL;
+	}
+	else if (entry) {
+
+		entry->refs++;
+
+		// Move the entry to the front of the list.
+		if (entry->newer) {
+			((mail_cache_t *)entry->newer)->older = entry->older;
+
+			if (entry->older) ((mail_cache_t *)entry->older)->newer = entry->newer;
+			else shard->oldest = (mail_cache_t *)entry->newer;
+
+			entry->newer = NULL;
+			entry->older = (struct mail_cache_t *)shard->newest;
+			shard->newest->newer = (struct mail_cache_t *)entry;
+			shard->newest = entry;
+		}
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	stats_increment_by_num(entry ? STATS_OBJECTS_MAIL_CACHE_HITS : STATS_OBJECTS_MAIL_CACHE_MISSES);
+	return entry;
+}
+
+/**
+ * @brief	Store the text of a message in the cache.
+ * @note	If the text is accepted, ownership of it passes to the cache, and the caller is given a reference to the new entry, which must be
+ * 			released using mail_cache_release(). If the text is rejected, the caller retains ownership of it. Large messages are moved into a
+ * 			memory file, in which case the original text is freed, and the caller must use the text held by the returned entry instead. Text
+ * 			which was decompressed into a buffer from mail_cache_buffer() is already held in a memory file, and is cached as is.
+ * @param	messagenum	the numerical id of the message to be cached.
+ * @param	server		the server instance the text was parsed for.
+ * @param	parsed		true if the text is the parsed form of the message, or false for the raw form.
+ * @param	marks		the message status flags used when the text was parsed.
+ * @param	text		a managed string containing the contents of the specified message to be cached.
+ * @return	NULL if the text wasn't cached, or a pointer to the referenced cache entry on success.
+ */
+mail_cache_t * mail_cache_set(uint64_t messagenum, server_t *server, bool_t parsed, uint32_t marks, stringer_t *text) {
+
+	size_t bytes;
+	int_t instance = 0;
+	uint64_t evictions = 0;
+	stringer_t *mapped, *original = NULL;
+	mail_cache_t *entry, *existing;
+	mail_cache_shard_t *shard;
+
+	if (!mail_cache.limit || st_empty(text) || (parsed && (instance = mail_cache_instance(server)) < 0)) {
+		return NULL;
+	}
+
+	bytes = st_length_get(text) + sizeof(mail_cache_t);
+
+	// Large messages are held in memory files, which are limited by the cache wide budget, while anything else that would consume more
+	// than an entire shard is never cached.
+	if ((bytes >= MAIL_CACHE_MAPPED_LENGTH || (*((uint32_t *)text) & MAPPED_T)) ? !mail_cache_reserve(bytes) : bytes > mail_cache.limit) {
+		return NULL;
+	}
+	else if (!(entry = mm_alloc(sizeof(mail_cache_t)))) {
+		if (bytes >= MAIL_CACHE_MAPPED_LENGTH || (*((uint32_t *)text) & MAPPED_T)) __sync_fetch_and_sub(&(mail_cache.mapped), bytes);
+		return NULL;
+	}
+
+	// Text from mail_cache_buffer() is already in a memory file, but it's no longer written to, so the mapping is made read only.
+	if (*((uint32_t *)text) & MAPPED_T) {
+		mprotect(((mapped_t *)text)->data, st_length_get(text) + 1, PROT_READ);
+		entry->mapped = true;
+	}
+	// The heap copy is only freed once the entry is in the index, so a rejected entry can hand the original back to the caller.
+	else if (bytes >= MAIL_CACHE_MAPPED_LENGTH && (mapped = mail_cache_map(text))) {
+		original = text;
+		text = mapped;
+		entry->mapped = true;
+	}
+	// If the text can't be moved into a memory file, it's still cached, but will be written out the old fashioned way.
+	else if (bytes >= MAIL_CACHE_MAPPED_LENGTH) {
+		__sync_fetch_and_sub(&(mail_cache.mapped), bytes);
+
+		if (bytes > mail_cache.limit) {
+			mm_free(entry);
+			return NULL;
 		}
+	}
+
+	entry->refs = 1;
+	entry->text = text;
+	entry->bytes = bytes;
+	entry->marks = marks;
+	entry->parsed = parsed;
+	entry->instance = instance;
+	entry->messagenum = messagenum;
+
+	shard = &(mail_cache.shards[messagenum % MAIL_CACHE_SHARDS]);
+	mutex_lock(&(shard->lock));
+
+	// Another thread may have loaded the same message, in which case the newer copy wins.
+	if ((existing = inx_find(shard->entries, mail_cache_key(messagenum, instance, parsed)))) {
+		mail_cache_evict(shard, existing);
+	}
+
+	// Only heap entries count against the shard limit, so the oldest heap entries are evicted until there is room.
+	for (mail_cache_t *oldest = shard->oldest, *next; !entry->mapped && oldest && shard->bytes + bytes > mail_cache.limit; oldest = next) {
+
+		next = (mail_cache_t *)oldest->newer;
 
-		if (pthread_setspecific(mail_cache, message) != 0) {
-			log_pedantic("Unable to setup thread message cache.");
-			mm_free(message);
-			return;
+		if (!oldest->mapped) {
+			mail_cache_evict(shard, oldest);
+			evictions++;
 		}
 	}
-	else {
-		st_cleanup(message->text);
+
+	if (!inx_insert(shard->entries, mail_cache_key(messagenum, instance, parsed), entry)) {
+		mutex_unlock(&(shard->lock));
+		log_pedantic("Unable to store the message in the cache. {messagenum = %lu}", messagenum);
+		if (entry->mapped) __sync_fetch_and_sub(&(mail_cache.mapped), bytes);
+		if (original) st_free(text);
+		mm_free(entry);
+		return NULL;
+	}
+
+	if ((entry->older = (struct mail_cache_t *)shard->newest)) shard->newest->newer = (struct mail_cache_t *)entry;
+	else shard->oldest = entry;
+
+	shard->newest = entry;
+
+	if (entry->mapped) shard->mapped++;
+	else shard->bytes += bytes;
+
+	mutex_unlock(&(shard->lock));
+
+	st_cleanup(original);
+
+	while (evictions--) {
+		stats_increment_by_num(STATS_OBJECTS_MAIL_CACHE_EVICTIONS);
+	}
+
+	return entry;
+}
+
+/**
+ * @brief	Write part of a cached message to a network connection.
+ * @note	If the message was moved into a memory file, and the connection isn't encrypted, the kernel transmits the data directly from the
+ * 			page cache, otherwise the data is written from the mapped text.
+ * @param	con		the connection across which the message will be written.
+ * @param	entry	a referenced cache entry holding the message text.
+ * @param	offset	the position in the message text where the output should begin.
+ * @param	length	the number of bytes to be written.
+ * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ */
+int64_t mail_cache_write(connection_t *con, mail_cache_t *entry, size_t offset, size_t length) {
+
+	if (!entry || offset + length > st_length_get(entry->text)) {
+		log_pedantic("Invalid cached message range. {offset = %zu / length = %zu}", offset, length);
+		return -1;
+	}
+	else if (!con->network.ssl && (*((uint32_t *)entry->text) & MAPPED_T)) {
+		return con_write_file(con, ((mapped_t *)entry->text)->handle, offset, length);
+	}
+
+	return con_write_bl(con, st_char_get(entry->text) + offset, length);
+}
+
+/**
+ * @brief	Initialize the shards used by the message cache.
+ * @note	The cache is disabled if magma.iface.cache.messages is zero.
+ * @return	true on success or false on failure.
+ */
+bool_t mail_cache_start(void) {
+
+	for (uint32_t i = 0; i < MAIL_CACHE_SHARDS; i++) {
+
+		if (mutex_init(&(mail_cache.shards[i].lock), NULL) || !(mail_cache.shards[i].entries = inx_alloc(M_INX_HASHED, NULL))) {
+			log_pedantic("Unable to initialize the message cache.");
+			return false;
+		}
+
 	}
 
-	message->messagenum = messagenum;
-	message->text = st_dupe_opts(MANAGED_T | HEAP | CONTIGUOUS, text);
+	mail_cache.budget = magma.iface.cache.messages;
+	mail_cache.limit = magma.iface.cache.messages / MAIL_CACHE_SHARDS;
+	return true;
+}
+
+/**
+ * @brief	Free every cached message, and destroy the message cache shards.
+ * @note	This function assumes the worker threads have finished, so no cache entries can still be referenced.
+ * @return	This function returns no value.
+ */
+void mail_cache_stop(void) {
+
+	mail_cache.limit = 0;
+
+	for (uint32_t i = 0; i < MAIL_CACHE_SHARDS; i++) {
+
+		while (mail_cache.shards[i].oldest) {
+			mail_cache.shards[i].oldest->refs = 0;
+			mail_cache_evict(&(mail_cache.shards[i]), mail_cache.shards[i].oldest);
+		}
+
+		inx_cleanup(mail_cache.shards[i].entries);
+		mail_cache.shards[i].entries = NULL;
+		mutex_destroy(&(mail_cache.shards[i].lock));
+	}
 
 	return;
 }
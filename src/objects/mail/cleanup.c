@@ -85,8 +85,8 @@ bool_t mail_message_cleanup(stringer_t **message) {
 		added++;
 	}
 
-	// Allocate a new stringer for the cleaned up message.
-	if (!(output = st_alloc_opts(MAPPED_T | JOINTED | HEAP,  added))) {
+	// Allocate a new stringer for the cleaned up message. The buffer is backed by a spool file, so large messages don't consume memory.
+	if (!(output = spool_mapped(MAGMA_SPOOL_DATA, "smtp", added))) {
 		log_pedantic("Unable to allocate %zu bytes for a new stringer.", added);
 		return false;
 	}
@@ -30,7 +30,9 @@ void mail_db_hide_message(uint64_t messagenum) {
 	parameters[0].is_unsigned = true;
 
 	// Hide the corrupt message.
-	stmt_exec(stmts.update_message_visibility, parameters);
+	if (stmt_exec(stmts.update_message_visibility, parameters)) {
+		meta_data_insert_message_change(messagenum, -1);
+	}
 
 	return;
 }
@@ -62,6 +64,11 @@ bool_t mail_db_delete_message(uint64_t usernum, uint64_t messagenum, uint32_t si
 	parameters[1].buffer = &usernum;
 	parameters[1].is_unsigned = true;
 
+	// The change is recorded first, since the message record is needed to find its owner.
+	if (!meta_data_insert_message_change(messagenum, transaction)) {
+		return false;
+	}
+
 	// Remove from the Messages table.
 	if ((affected = stmt_exec_affected_conn(stmts.delete_message, parameters, transaction)) == 0) {
 		log_error("Unable to delete the message from Messages table. The user number was %lu, the message number was %lu and the message size was %u.",
@@ -158,6 +165,9 @@ int_t mail_db_update_message_folder(uint64_t usernum, uint64_t messagenum, uint6
 	if (!result) {
 		return 0;
 	}
+	else if (!meta_data_insert_message_change(messagenum, transaction)) {
+		return -1;
+	}
 
 	return 1;
 }
@@ -270,6 +280,10 @@ uint64_t mail_db_insert_message(uint64_t usernum, uint64_t foldernum, uint32_t s
 
 	}
 
+	if (!meta_data_insert_message_change(result, transaction)) {
+		return 0;
+	}
+
 	// Update the quota.
 	mm_wipe(parameters, sizeof(parameters));
 
@@ -405,6 +419,10 @@ uint64_t mail_db_insert_duplicate_message(uint64_t usernum, uint64_t foldernum,
 		}
 	}
 
+	if (!meta_data_insert_message_change(result, transaction)) {
+		return 0;
+	}
+
 	// Update the quota.
 	mm_wipe(parameters, sizeof(parameters));
 
@@ -174,7 +174,9 @@ stringer_t * mail_load_header(meta_message_t *meta, meta_user_t *user) {
 			return NULL;
 		}
 		// Workaround for messages with headers longer than 8192 characters. If that happens we try loading the entire message and then searching for the end of the header.
-		else if ((fd = mail_header_end(uncompressed)) < 0 || fd == st_length_get(uncompressed)) {
+		// Messages with a shared body only store the header, so if the whole file was read the header is already complete.
+		else if ((fd = mail_header_end(uncompressed)) < 0 || (fd == st_length_get(uncompressed) &&
+			!((fheader.flags & FMESSAGE_OPT_SHARED) && taken == file_info.st_size - offset))) {
 
 			if (!(message = mail_load_message(meta, user, NULL, false))) {
 				log_pedantic("Could not find the end of the header.");
@@ -238,11 +240,14 @@ stringer_t * mail_load_header(meta_message_t *meta, meta_user_t *user) {
 mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, server_t *server, bool_t parse) {
 
 	int_t fd, keylen;
+	uint32_t marks;
 	chr_t *path, key[128];
 	message_fheader_t fheader;
 	compress_t *compressed;
-	stringer_t *raw, *uncompressed;
+	stringer_t *raw, *uncompressed = NULL, *body, *joined, *buffer = NULL;
 	uchr_t *unencrypted;
+	bool_t shared = false;
+	mail_cache_t *cached;
 	mail_message_t *result;
 	struct stat file_info;
 	size_t data_len, plain_len;
@@ -252,15 +257,19 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 		return NULL;
 	}
 
-	// Check the message cache first.
-	// Only parsed messages hit the mail cache because there is a lot more work to be performed for them.
-	if (parse && (uncompressed = mail_cache_get(meta->messagenum))) {
+	// The parsed text is branded according to these flags, so a cached copy is only valid if they haven't changed.
+	marks = parse ? meta->status & (MAIL_MARK_JUNK | MAIL_MARK_INFECTED | MAIL_MARK_SPOOFED | MAIL_MARK_BLACKHOLED | MAIL_MARK_PHISHING) : 0;
 
-		if (!(result = mail_message(uncompressed))) {
+	// Check the message cache first. A hit borrows the cached text, so the message object holds a reference instead of a copy.
+	if ((cached = mail_cache_get(meta->messagenum, server, parse, marks))) {
+
+		if (!(result = mail_message(cached->text))) {
 			log_pedantic("Unable to build the message structure.");
+			mail_cache_release(cached);
 			return NULL;
 		}
 
+		result->cache = cached;
 		return result;
 	}
 
@@ -337,6 +346,7 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 
 		// Tell the stringer how much data is there.
 		st_length_set(raw, data_len);
+		shared = (fheader.flags & FMESSAGE_OPT_SHARED) ? true : false;
 
 		if (meta->status & MAIL_STATUS_ENCRYPTED) {
 
@@ -398,8 +408,15 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 		return NULL;
 	}
 
-	// Decompress the message.
-	uncompressed = decompress_lzo(compressed);
+	// Large messages which won't be rewritten below are decompressed straight into a memory file, so the message cache can hand them to
+	// the kernel without making a copy. Otherwise the message is decompressed onto the heap.
+	if (!shared && (!parse || (!marks && !(meta->signum && meta->sigkey))) && (buffer = mail_cache_buffer(compress_orig_length(compressed))) &&
+		!(uncompressed = decompress_lzo_buffer(compressed, buffer))) {
+		st_free(buffer);
+	}
+	else if (!buffer) {
+		uncompressed = decompress_lzo(compressed);
+	}
 
 	st_free(raw);
 
@@ -412,6 +429,22 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 		return NULL;
 	}
 
+	// If the body is stored in a shared blob, append it to the header.
+	if (shared) {
+
+		if (!(body = mail_blob_load(meta->messagenum, meta->server)) || !(joined = st_merge("ss", uncompressed, body))) {
+			log_pedantic("Could not load the shared body of the message %s.", path);
+			st_cleanup(body);
+			st_free(uncompressed);
+			ns_free(path);
+			return NULL;
+		}
+
+		st_free(uncompressed);
+		st_free(body);
+		uncompressed = joined;
+	}
+
 	// Finally free the path.
 	ns_free(path);
 
@@ -446,10 +479,6 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 			mail_signature_add(result, server, meta->signum, meta->sigkey, (meta->status & MAIL_MARK_JUNK) == MAIL_MARK_JUNK ? 1 : 0);
 		}
 
-		// Set thread cache. We use a thread cache since some IMAP clients like to pull messages in chunks leading to
-		// lots of requests for small amounts of data.
-		mail_cache_set(meta->messagenum, result->text);
-
 	}
 	else if (!(result = mail_message(uncompressed))) {
 		log_pedantic("Unable to build the message structure.");
@@ -463,33 +492,41 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 		cache_add(PLACER(key, keylen), PLACER(st_char_get(result->text), result->header_length), 3600);
 	}
 
+	// Share the finished text with the other workers, since IMAP clients like to pull messages in chunks leading to lots of requests for
+	// small amounts of data. If the cache accepts the text it takes ownership, and the message holds a reference instead.
+	if ((cached = mail_cache_set(meta->messagenum, server, parse, marks, result->text)) && cached->text != result->text) {
+
+		// Large messages are moved into a memory file, so the message structure is rebuilt around the mapped copy of the text.
+		result->text = NULL;
+		mail_destroy(result);
+
+		if (!(result = mail_message(cached->text))) {
+			log_pedantic("Unable to build the message structure.");
+			mail_cache_release(cached);
+			return NULL;
+		}
+
+	}
+
+	result->cache = cached;
+
 	return result;
 }
 
 /**
- * @brief	Get the top of a mail message, up to a specified maximum number of lines of content.
- * @see		mail_load_message()
- * @param	meta	the meta message object of the message to be loaded from disk.
- * @param	user	the meta user object of the user that owns the requested message.
- * @param	server	the server object of the web server where the spam teacher application is hosted.
- * @param	lines	the maximum number of lines to be retrieved from the loaded message.
- * @param	parse	sets the parse parameter passed to mail_load_message().
- * @return	NULL on failure or a a mail message object containing the retrieved mail message data (truncated if necessary) on success.
+ * @brief	Determine how much of a mail message is needed to include the header and a specified number of lines of content.
+ * @param	text	a managed string containing the text of the mail message.
+ * @param	lines	the maximum number of lines of content to be included.
+ * @return	the length of the message text holding the header, and the requested number of content lines.
  */
-mail_message_t * mail_load_message_top(meta_message_t *meta, meta_user_t *user, server_t *server, uint64_t lines, bool_t parse) {
+size_t mail_message_top_length(stringer_t *text, uint64_t lines) {
 
 	chr_t *stream;
 	int_t header = 1;
-	mail_message_t *result;
 	size_t length, increment;
 
-	if (!(result = mail_load_message(meta, user, server, parse))) {
-		return NULL;
-	}
-
-	// Now that we've added the signature we iterate again.
-	length = st_length_get(result->text);
-	stream = st_char_get(result->text);
+	length = st_length_get(text);
+	stream = st_char_get(text);
 
 	// QUESTION: Does mail_header_end() already do this?
 	for (increment = 0; increment < length && header != 3; increment++) {
@@ -524,8 +561,5 @@ mail_message_t * mail_load_message_top(meta_message_t *meta, meta_user_t *user,
 		stream++;
 	}
 
-	// Use the stringer length parameter to restrict how much data is outputted.
-	st_length_set(result->text, increment);
-
-	return result;
+	return increment;
 }
@@ -16,9 +16,19 @@
 #define MAIL_MIME_RECURSION_LIMIT 16
 #define MAIL_SIGNATURES_RECURSION_LIMIT 16
 
+// The number of independently locked shards used by the message cache.
+#define MAIL_CACHE_SHARDS 16
+
+// Cached messages at least this large are moved into a memory file, so they can be handed to the kernel using sendfile().
+#define MAIL_CACHE_MAPPED_LENGTH 131072
+
 typedef struct {
-	uint64_t messagenum;
+	bool_t parsed, evicted, mapped;
+	uint32_t marks, instance;
+	size_t bytes;
+	uint64_t messagenum, refs;
 	stringer_t *text;
+	struct mail_cache_t *newer, *older;
 } mail_cache_t;
 
 typedef struct {
@@ -41,6 +51,7 @@ typedef struct {
 	size_t header_length;
 	placer_t to, from, date, subject;
 	stringer_t *text;
+	mail_cache_t *cache; /* If set, the text is shared with the message cache and must not be modified. */
 } mail_message_t;
 
 typedef struct {
@@ -49,14 +60,26 @@ typedef struct {
 	chr_t *name;
 } media_type_t;
 
+/// blobs.c
+bool_t        mail_blob_copy(uint64_t original, chr_t *server, uint64_t copy);
+bool_t        mail_blob_directory(stringer_t *digest);
+stringer_t *  mail_blob_load(uint64_t messagenum, chr_t *server);
+compress_t *  mail_blob_merge(stringer_t *header, uint64_t messagenum, chr_t *server);
+chr_t *       mail_blob_path(stringer_t *digest, chr_t *server);
+chr_t *       mail_blob_reference(uint64_t number, chr_t *server);
+void          mail_blob_release(uint64_t messagenum, chr_t *server);
+bool_t        mail_blob_store(uint64_t messagenum, stringer_t *body);
+
 /// cache.c
-void          mail_cache_destroy(void *holder);
-stringer_t *  mail_cache_get(uint64_t messagenum);
-void          mail_cache_reset(void);
-void          mail_cache_set(uint64_t messagenum, stringer_t *text);
-bool_t        mail_cache_start(void);
-void          mail_cache_stop(void);
-void          mail_cache_thread_stop(void);
+stringer_t *      mail_cache_buffer(size_t length);
+void              mail_cache_free(mail_cache_t *entry);
+mail_cache_t *    mail_cache_get(uint64_t messagenum, server_t *server, bool_t parsed, uint32_t marks);
+void              mail_cache_release(mail_cache_t *entry);
+void              mail_cache_retain(mail_cache_t *entry);
+mail_cache_t *    mail_cache_set(uint64_t messagenum, server_t *server, bool_t parsed, uint32_t marks, stringer_t *text);
+bool_t            mail_cache_start(void);
+void              mail_cache_stop(void);
+int64_t           mail_cache_write(connection_t *con, mail_cache_t *entry, size_t offset, size_t length);
 
 /// cleanup.c
 void          mail_destroy_header(stringer_t *header);
@@ -87,7 +110,7 @@ placer_t      mail_store_header(chr_t *stream, size_t length);
 
 /// load_message.c
 mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, server_t *server, bool_t parse);
-mail_message_t * mail_load_message_top(meta_message_t *meta, meta_user_t *user, server_t *server, uint64_t lines, bool_t parse);
+size_t           mail_message_top_length(stringer_t *text, uint64_t lines);
 stringer_t *     mail_load_header(meta_message_t *meta, meta_user_t *user);
 
 /// mime.c
@@ -85,7 +85,14 @@ void mail_setup_basic(basic_message_t *message, stringer_t *text) {
 void mail_destroy(mail_message_t *message) {
 
 	if (message) {
-		st_cleanup(message->text);
+
+		// Text borrowed from the message cache is released instead of freed.
+		if (message->cache) {
+			mail_cache_release(message->cache);
+		}
+		else {
+			st_cleanup(message->text);
+		}
 
 		if (message->mime) {
 			mail_mime_free(message->mime);
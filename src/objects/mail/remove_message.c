@@ -53,12 +53,17 @@ bool_t mail_remove_message(uint64_t usernum, uint64_t messagenum, uint32_t size,
 		return false;
 	}
 
+	fulltext_remove(usernum, messagenum);
+
 	// Unlink the file. We return success even if the unlink operation fails because the database record has already been removed. The result
 	// is an orphaned file that will someday need to be cleaned.
 	if ((state = unlink(path)) != 0) {
 		log_pedantic("Could not unlink the message %s. {unlink = %i}", path, state);
 	}
 
+	// Drop the message's reference to its shared body, which also removes the blob once no other message is using it.
+	mail_blob_release(messagenum, server);
+
 	ns_free(path);
 	return true;
 }
@@ -97,7 +97,8 @@ bool_t mail_store_message_data(uint64_t messagenum, uint8_t fflags, void *data,
 
 /**
  * @brief	Store a mail message, with its meta-information in the database, and the contents persisted to disk.
- * @note	The stored message is always compressed, but only encrypted if the user's public key is suppplied.
+ * @note	The stored message is always compressed, but only encrypted if the user's public key is suppplied. When deduplication is enabled,
+ * 			the body of a large unencrypted message is stored in a shared blob, and the message file only holds the header.
  * @param	usernum		the numerical id of the user to which the message belongs.
  * @param	pubkey		if not NULL, a public key that will be used to encrypt the message for the intended user.
  * @param	foldernum	the folder # that will contain the message.
@@ -115,13 +116,20 @@ uint64_t mail_store_message(uint64_t usernum, stringer_t *pubkey, uint64_t folde
 	compress_t *reduced;
 	uint64_t messagenum;
 	int64_t transaction, ret;
-	size_t write_len;
+	size_t write_len, split = 0;
 	uint8_t fflags = FMESSAGE_OPT_COMPRESSED;
 	uchr_t *write_data;
 	bool_t store_result;
 
+	// Large unencrypted bodies are stored in a shared blob, so only the header is compressed into the message file. Encrypted messages
+	// are always stored whole, since the ciphertext is unique to the recipient.
+	if (!pubkey && magma.storage.dedup && (split = mail_header_end(message)) < st_length_get(message) &&
+		st_length_get(message) - split >= MAGMA_STORAGE_DEDUP_MINIMUM) {
+		fflags |= FMESSAGE_OPT_SHARED;
+	}
+
 	// Compress the message.
-	if (!(reduced = compress_lzo(message))) {
+	if (!(reduced = compress_lzo((fflags & FMESSAGE_OPT_SHARED) ? PLACER(st_char_get(message), split) : message))) {
 		log_error("An error occurred while attempting to compress a message with %zu bytes.", st_length_get(message));
 		return 0;
 	}
@@ -181,6 +189,13 @@ uint64_t mail_store_message(uint64_t usernum, stringer_t *pubkey, uint64_t folde
 		compress_free(reduced);
 	}
 
+	// Link the message to a blob holding its body, storing the blob first if this is the first copy of the body.
+	if (store_result && path && (fflags & FMESSAGE_OPT_SHARED) &&
+		!mail_blob_store(messagenum, PLACER(st_char_get(message) + split, st_length_get(message) - split))) {
+		log_pedantic("Failed to store the message body to disk.");
+		store_result = false;
+	}
+
 	// If storage failed, fail out.
 	if (!store_result || !path) {
 		log_pedantic("Failed to store user's message to disk.");
@@ -197,11 +212,17 @@ uint64_t mail_store_message(uint64_t usernum, stringer_t *pubkey, uint64_t folde
 	// Commit the transaction.
 	if ((ret = tran_commit(transaction))) {
 		log_error("Could not commit the transaction. { commit = %li }", ret);
+		mail_blob_release(messagenum, NULL);
 		unlink(path);
 		ns_free(path);
 		return 0;
 	}
 
+	// Encrypted messages are left out of the search index, since indexing them would expose their content.
+	if (!pubkey) {
+		fulltext_index(usernum, messagenum, message);
+	}
+
 	ns_free(path);
 	return messagenum;
 }
@@ -282,9 +303,19 @@ uint64_t mail_copy_message(uint64_t usernum, uint64_t original, chr_t *server, u
 		return 0;
 	}
 
+	// If the original shares its body with other messages, the copy needs a reference of its own.
+	if (!mail_blob_copy(original, server, messagenum)) {
+		tran_rollback(transaction);
+		unlink(copypath);
+		ns_free(origpath);
+		ns_free(copypath);
+		return 0;
+	}
+
 	// Commit the transaction.
 	if ((ret = tran_commit(transaction))) {
 		log_error("Could not commit the transaction. { commit = %li }", ret);
+		mail_blob_release(messagenum, NULL);
 		ns_free(origpath);
 		ns_free(copypath);
 		return 0;
@@ -293,6 +324,9 @@ uint64_t mail_copy_message(uint64_t usernum, uint64_t original, chr_t *server, u
 	ns_free(origpath);
 	ns_free(copypath);
 
+	// The copy shares the content of the original, so it also shares the original's search terms.
+	fulltext_copy(usernum, original, messagenum);
+
 	return messagenum;
 }
 
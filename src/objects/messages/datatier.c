@@ -71,3 +71,129 @@ bool_t messages_fetch(uint64_t usernum, message_folder_t *folder) {
 
 	return true;
 }
+
+/**
+ * The result bindings and decoding state used while streaming a user's messages into their folders.
+ */
+typedef struct {
+	inx_t *folders;
+	message_folder_t *folder;
+	uint64_t foldernum, messagenum, created, signum, sigkey;
+	uint32_t status, size;
+	chr_t server[33];
+	unsigned long length;
+	my_bool nulls[2];
+} messages_stream_t;
+
+/**
+ * @brief	Decode a streamed message row and insert the resulting message record into its parent folder.
+ * @note	Rows are sorted by message number, so consecutive rows may belong to different folders. The last folder is remembered,
+ * 			since messages delivered together tend to land in the same one.
+ * @param	state	a pointer to the message stream state holding the current row.
+ * @return	true if the row was processed, or false if the fetch should be aborted.
+ */
+static bool_t messages_fetch_row(void *state) {
+
+	message_t *record;
+	messages_stream_t *stream = state;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = stream->foldernum };
+
+	// Messages in a folder the user can no longer see are skipped, just as they are when each folder is loaded individually.
+	if ((!stream->folder || stream->folder->foldernum != stream->foldernum) && !(stream->folder = inx_find(stream->folders, key))) {
+		return true;
+	}
+
+	if (!(record = message_alloc(stream->messagenum, stream->created, stream->nulls[0] ? 0 : stream->signum, stream->nulls[1] ? 0 : stream->sigkey,
+		stream->status, PLACER(stream->server, stream->length), stream->size)) || !(key.val.u64 = record->message.num) ||
+		!inx_insert(stream->folder->records, key, record)) {
+		log_info("The index refused to accept a message record. { message = %lu }", stream->messagenum);
+
+		if (record) {
+			message_free(record);
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Populate all of a user's message folders from the database, using a single query.
+ * @note	The rows are streamed from the server and decoded directly into message records, instead of being buffered in a result table.
+ * @param	usernum		the numerical id of the user that owns the folders.
+ * @param	folders		an inx holder containing the user's message folders, indexed by folder number.
+ * @return	true on success or false on failure.
+ */
+bool_t messages_fetch_all(uint64_t usernum, inx_t *folders) {
+
+	MYSQL_BIND parameters[1], results[8];
+	messages_stream_t stream;
+
+	if (!usernum || !folders) {
+		log_pedantic("Invalid data passed for message fetch.");
+		return false;
+	}
+
+	mm_wipe(&stream, sizeof(messages_stream_t));
+	mm_wipe(parameters, sizeof(parameters));
+	mm_wipe(results, sizeof(results));
+
+	stream.folders = folders;
+
+	// Usernum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &(usernum);
+	parameters[0].is_unsigned = true;
+
+	// Folder Number
+	results[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	results[0].buffer = &(stream.foldernum);
+	results[0].is_unsigned = true;
+
+	// Message Number
+	results[1].buffer_type = MYSQL_TYPE_LONGLONG;
+	results[1].buffer = &(stream.messagenum);
+	results[1].is_unsigned = true;
+
+	// Created
+	results[2].buffer_type = MYSQL_TYPE_LONGLONG;
+	results[2].buffer = &(stream.created);
+	results[2].is_unsigned = true;
+
+	// Signature
+	results[3].buffer_type = MYSQL_TYPE_LONGLONG;
+	results[3].buffer = &(stream.signum);
+	results[3].is_unsigned = true;
+	results[3].is_null = &(stream.nulls[0]);
+
+	// Signature Key
+	results[4].buffer_type = MYSQL_TYPE_LONGLONG;
+	results[4].buffer = &(stream.sigkey);
+	results[4].is_unsigned = true;
+	results[4].is_null = &(stream.nulls[1]);
+
+	// Status
+	results[5].buffer_type = MYSQL_TYPE_LONG;
+	results[5].buffer = &(stream.status);
+	results[5].is_unsigned = true;
+
+	// Server
+	results[6].buffer_type = MYSQL_TYPE_STRING;
+	results[6].buffer = stream.server;
+	results[6].buffer_length = sizeof(stream.server) - 1;
+	results[6].length = &(stream.length);
+
+	// Size
+	results[7].buffer_type = MYSQL_TYPE_LONG;
+	results[7].buffer = &(stream.size);
+	results[7].is_unsigned = true;
+
+	if (stmt_stream(stmts.select_message_folders, parameters, results, &messages_fetch_row, &stream) < 0) {
+		log_pedantic("Unable to fetch the user's messages. { usernum = %lu }", usernum);
+		return false;
+	}
+
+	return true;
+}
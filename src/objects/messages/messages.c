@@ -95,34 +95,23 @@ message_t * message_alloc(uint64_t messagenum, uint64_t created, uint64_t signat
 
 /**
  * @brief	Fetch all of a user's message folders and their child messages from the database.
+ * @note	The messages for every folder are loaded by a single streamed query, rather than one query per folder.
  * @param	usernum		the numerical id of the target user.
  * @return	NULL on failure or an inx object holding all the retrieved and populated message folder objects on success.
  */
 inx_t * messages_update(uint64_t usernum) {
 
 	inx_t *folders;
-	inx_cursor_t *cursor;
-	message_folder_t *active;
 
 	// If the fetch attempt fails, don't free the existing message folder index.
-	if (!(folders = magma_folder_fetch(usernum, M_FOLDER_MESSAGES)) || !(cursor = inx_cursor_alloc(folders))) {
-		inx_cleanup(folders);
+	if (!(folders = magma_folder_fetch(usernum, M_FOLDER_MESSAGES))) {
 		return NULL;
 	}
-
-	while ((active = inx_cursor_value_next(cursor))) {
-
-		if (!messages_fetch(usernum, active)) {
-			log_pedantic("Unable to load the user's messages. { usernum = %lu / folder = %lu }", usernum, active->foldernum);
-			inx_cursor_free(cursor);
-			inx_free(folders);
-			return NULL;
-		}
-
+	else if (!messages_fetch_all(usernum, folders)) {
+		log_pedantic("Unable to load the user's messages. { usernum = %lu }", usernum);
+		inx_free(folders);
+		return NULL;
 	}
 
-	inx_cursor_free(cursor);
-
 	return folders;
 }
-
@@ -55,6 +55,7 @@ typedef struct __attribute__ ((__packed__)) {
 
 #define FMESSAGE_OPT_COMPRESSED	0x1
 #define FMESSAGE_OPT_ENCRYPTED	0x2
+#define FMESSAGE_OPT_SHARED		0x4 // The message body is stored in a separate, shared blob file.
 
 
 typedef struct __attribute__ ((packed)) {
@@ -81,6 +82,7 @@ void              meta_messages_update_sequences(inx_t *folders, inx_t *messages
 
 /// datatier.c
 bool_t   messages_fetch(uint64_t usernum, message_folder_t *folder);
+bool_t   messages_fetch_all(uint64_t usernum, inx_t *folders);
 
 #endif
 
@@ -81,41 +81,62 @@ meta_message_t * meta_message_by_number(inx_t *messages, uint64_t number) {
 
 /**
  * @brief	Update the sequence numbers of a series of messages, each re-indexed by their containing folder.
- * @note	All messages will be sequenced incrementally per folder, starting with a value of 1.
+ * @note	All messages will be sequenced incrementally per folder, starting with a value of 1. The messages are numbered in a single pass,
+ * 			in the order they're held by the index, so if the index is sorted by message number, the sequence numbers follow the UIDs.
  * @param	folders		an inx holder containing all of the user's meta folder records.
  * @param	messages	an inx folder containing all the messages to be re-sequenced.
  * @return	This function returns no value.
  */
 void meta_messages_update_sequences(inx_t *folders, inx_t *messages) {
 
-	uint64_t sequence;
+	inx_t *sequences;
+	uint64_t *sequence;
 	meta_folder_t *folder;
 	meta_message_t *message;
-	inx_cursor_t *cursor_messages, *cursor_folders;
+	inx_cursor_t *cursor;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	if (!folders || !messages || !(sequences = inx_alloc(M_INX_PROBED, &mm_free))) {
+		return;
+	}
 
-	if (!folders || !messages || !(cursor_folders = inx_cursor_alloc(folders))) {
+	// Start a counter for every folder. Messages in a folder we don't know about are left alone.
+	if (!(cursor = inx_cursor_alloc(folders))) {
+		inx_free(sequences);
 		return;
 	}
 
-	// Iterate through all of the messages for each folder and set their sequence number.
-	while ((folder = inx_cursor_value_next(cursor_folders)) && (sequence = 1)) {
+	while ((folder = inx_cursor_value_next(cursor))) {
 
-		if ((cursor_messages = inx_cursor_alloc(messages))) {
+		key.val.u64 = folder->foldernum;
 
-			while ((message = inx_cursor_value_next(cursor_messages))) {
+		if (!(sequence = mm_alloc(sizeof(uint64_t))) || !inx_insert(sequences, key, sequence)) {
+			log_pedantic("Unable to track the sequence numbers for a folder. {foldernum = %lu}", folder->foldernum);
+			if (sequence) mm_free(sequence);
+			continue;
+		}
+
+		*sequence = 1;
+	}
+
+	inx_cursor_free(cursor);
 
-				if (message->foldernum == folder->foldernum) {
-					message->sequencenum = sequence++;
-				}
+	if ((cursor = inx_cursor_alloc(messages))) {
 
+		while ((message = inx_cursor_value_next(cursor))) {
+
+			key.val.u64 = message->foldernum;
+
+			if ((sequence = inx_find(sequences, key))) {
+				message->sequencenum = (*sequence)++;
 			}
 
-			inx_cursor_free(cursor_messages);
 		}
 
+		inx_cursor_free(cursor);
 	}
 
-	inx_cursor_free(cursor_folders);
+	inx_free(sequences);
 
 	return;
 }
@@ -130,6 +151,7 @@ void meta_messages_update_sequences(inx_t *folders, inx_t *messages) {
  */
 bool_t meta_messages_login_update(meta_user_t *user, META_LOCK_STATUS locked) {
 
+	int_t changes;
 	bool_t output = true;
 	uint64_t checkpoint;
 
@@ -149,7 +171,12 @@ bool_t meta_messages_login_update(meta_user_t *user, META_LOCK_STATUS locked) {
 			user->serials.messages = serial_increment(OBJECT_MESSAGES, user->usernum);
 		}
 
-		if ((output = meta_data_fetch_messages(user)) && user->folders) {
+		// Apply the changes made since the last refresh, and only rebuild the collection if that isn't possible.
+		if ((changes = meta_data_fetch_message_changes(user)) < 0) {
+			changes = output = meta_data_fetch_messages(user);
+		}
+
+		if (changes && user->folders) {
 			meta_messages_update_sequences(user->folders, user->messages);
 		}
 	}
@@ -177,6 +204,8 @@ bool_t meta_messages_login_update(meta_user_t *user, META_LOCK_STATUS locked) {
 /**
  * @brief	Refresh and resquence a user's message collection if it is stale.
  * @note	The user's messages will only be updated if they are empty or if they are out of sync and the user has no open pop sessions.
+ * 			A stale collection is patched using the message change log, and only rebuilt from scratch if the log can't be used.
+ * @see		meta_data_fetch_message_changes()
  * @see		meta_data_fetch_messages()
  * @param	user	a pointer to the meta user object requesting the messages update.
  * @param	locked	if set to META_NEED_LOCK, lock the specified meta user object for the duration of the request.
@@ -184,6 +213,7 @@ bool_t meta_messages_login_update(meta_user_t *user, META_LOCK_STATUS locked) {
  */
 int_t meta_messages_update(meta_user_t *user, META_LOCK_STATUS locked) {
 
+	int_t changes;
 	short output = 0;
 	uint64_t checkpoint;
 
@@ -203,7 +233,15 @@ int_t meta_messages_update(meta_user_t *user, META_LOCK_STATUS locked) {
 			user->serials.messages = serial_increment(OBJECT_MESSAGES, user->usernum);
 		}
 
-		if ((output = meta_data_fetch_messages(user)) && user->folders) {
+		// Apply the changes made since the last refresh, and only rebuild the collection if that isn't possible.
+		if ((changes = meta_data_fetch_message_changes(user)) < 0) {
+			changes = output = meta_data_fetch_messages(user);
+		}
+		else {
+			output = 1;
+		}
+
+		if (changes && user->folders) {
 			meta_messages_update_sequences(user->folders, user->messages);
 		}
 	}
@@ -103,8 +103,8 @@ void obj_cache_prune(void) {
 		inx_unlock(objects.users);
 		inx_cursor_free(cursor);
 
-		stats_set_by_name("objects.users.total", count);
-		stats_adjust_by_name("objects.users.expired", expired);
+		stats_set_by_num(STATS_OBJECTS_USERS_TOTAL, count);
+		stats_adjust_by_num(STATS_OBJECTS_USERS_EXPIRED, expired);
 	}
 
 	if (objects.sessions && (cursor = inx_cursor_alloc(objects.sessions))) {
@@ -141,8 +141,8 @@ void obj_cache_prune(void) {
 		inx_unlock(objects.sessions);
 		inx_cursor_free(cursor);
 
-		stats_set_by_name("objects.sessions.total", count);
-		stats_adjust_by_name("objects.sessions.expired", expired);
+		stats_set_by_num(STATS_OBJECTS_SESSIONS_TOTAL, count);
+		stats_adjust_by_num(STATS_OBJECTS_SESSIONS_EXPIRED, expired);
 	}
 
 
@@ -37,6 +37,21 @@ typedef struct {
 
 extern object_cache_t objects;
 
+typedef struct {
+	uint64_t hash;
+	chr_t *key; /* The key, or NULL if the slot is empty. */
+	time_t first; /* When the key was first seen, by this host or any other. */
+	time_t touched; /* When the key was last seen, which decides which entry is evicted from a full bucket. */
+	time_t expires; /* When the entry stops being valid. */
+	time_t pushed; /* When the entry was last pushed to the distributed cache. */
+	bool_t dirty; /* Set if the entry needs to be pushed to the distributed cache. */
+} tally_stamp_t;
+
+typedef struct {
+	pthread_mutex_t lock;
+	tally_stamp_t *entries;
+} tally_shard_t;
+
 /// locks.c
 int_t   lock_get(stringer_t *key);
 void    lock_release(stringer_t *key);
@@ -53,4 +68,14 @@ uint64_t serial_get(uint64_t type, uint64_t num);
 uint64_t serial_increment(uint64_t type, uint64_t num);
 uint64_t serial_reset(uint64_t type, uint64_t num);
 
+/// tallies.c
+tally_stamp_t *  tally_bucket(uint64_t hash, tally_shard_t **shard);
+uint64_t         tally_connection(ip_t *address);
+void             tally_merge(uint64_t hash, chr_t *key, time_t first);
+void             tally_push(void);
+int_t            tally_stamp(stringer_t *key, time_t expiration, time_t *first);
+bool_t           tally_start(void);
+void             tally_stop(void);
+void             tally_sync(void);
+
 #endif
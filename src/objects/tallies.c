@@ -0,0 +1,462 @@
+
+/**
+ * @file /magma/objects/tallies.c
+ *
+ * @brief	A local store for greylisting stamps and connection rates, which keeps the SMTP accept path off the distributed cache.
+ *
+ * @note	Stamps record the first time a key was seen, and are held in an exact table which is split into shards, each with its own lock.
+ * 			The shards are set associative, so when a bucket fills up its least recently used entry is evicted. Keys which aren't held locally
+ * 			are looked up in the distributed cache once, so a stamp recorded by another host, or before a restart, is still honored. New stamps
+ * 			are pushed to the distributed cache by a background thread, which also pulls in any older stamp another host recorded for the same
+ * 			key in the meantime, so the cluster converges on the earliest sighting. Keys already held locally never wait on the network.
+ *
+ * 			Connection rates are counted using a pair of count-min sketches, one for the current minute and one for the previous minute,
+ * 			so memory use doesn't grow with the number of remote addresses. The estimates can overcount, but never undercount.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+#define MAGMA_TALLY_SHARDS 64
+#define MAGMA_TALLY_WAYS 8
+#define MAGMA_TALLY_DEPTH 4
+#define MAGMA_TALLY_WIDTH 8192
+#define MAGMA_TALLY_WINDOW 60
+
+typedef struct {
+	uint64_t hash;
+	chr_t *key;
+	time_t first, expires;
+} tally_push_t;
+
+struct {
+	bool_t running;
+	pthread_t thread;
+	pthread_cond_t wake;
+	pthread_mutex_t lock;
+	uint32_t buckets; /* The number of buckets in each shard. */
+	tally_push_t *batch; /* The entries being pushed by the sync thread, sized to hold a full shard. */
+	tally_shard_t shards[MAGMA_TALLY_SHARDS];
+
+	struct {
+		uint64_t window; /* The minute being counted by the current sketch. */
+		uint32_t *current, *previous;
+		pthread_mutex_t lock; /* Serializes the rotation of the sketches. Counting never takes the lock. */
+	} rates;
+} tallies = {
+		.running = false,
+		.wake = PTHREAD_COND_INITIALIZER,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.buckets = 0,
+		.batch = NULL,
+		.rates = {
+			.window = 0,
+			.current = NULL,
+			.previous = NULL,
+			.lock = PTHREAD_MUTEX_INITIALIZER
+		}
+};
+
+/**
+ * @brief	Find the bucket a stamp belongs in, and lock the shard holding it.
+ * @note	The caller is responsible for unlocking the shard.
+ * @param	hash	the hash of the stamp key.
+ * @param	shard	a pointer which will receive the locked shard.
+ * @return	a pointer to the first entry of the bucket.
+ */
+tally_stamp_t * tally_bucket(uint64_t hash, tally_shard_t **shard) {
+
+	*shard = &(tallies.shards[hash % MAGMA_TALLY_SHARDS]);
+	mutex_lock(&((*shard)->lock));
+
+	return (*shard)->entries + (((hash / MAGMA_TALLY_SHARDS) % tallies.buckets) * MAGMA_TALLY_WAYS);
+}
+
+// Find the live entry for a key inside a locked bucket.
+static tally_stamp_t * tally_find(tally_stamp_t *bucket, uint64_t hash, stringer_t *key, time_t now) {
+
+	for (uint32_t i = 0; i < MAGMA_TALLY_WAYS; i++) {
+		if (bucket[i].key && bucket[i].expires > now && bucket[i].hash == hash && !st_cmp_cs_eq(NULLER(bucket[i].key), key)) {
+			return &bucket[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Record a sighting of a key, and retrieve when the key was first seen.
+ * @note	Keys found in the local table never leave the shard lock. When a key is missing and the store is synced with the distributed
+ * 			cache, a single lookup is made, without holding the lock, so a stamp recorded by another host, or before a restart, is honored.
+ * 			The lookup is bounded by the cache socket timeout, and is only paid once per key since the result is kept locally. New stamps
+ * 			are pushed to the distributed cache in the background.
+ * @param	key			a managed string holding the key.
+ * @param	expiration	the number of seconds the stamp should be kept after the last sighting.
+ * @param	first		a pointer which will receive the time the key was first seen.
+ * @return	-1 on error, 0 if the key wasn't found and a new stamp was created, or 1 if the key was already known.
+ */
+int_t tally_stamp(stringer_t *key, time_t expiration, time_t *first) {
+
+	uint64_t hash;
+	chr_t *copy = NULL;
+	stringer_t *value;
+	time_t now, remote = 0;
+	tally_shard_t *shard;
+	tally_stamp_t *bucket, *entry, *victim = NULL;
+
+	if (!tallies.buckets || st_empty(key)) {
+		return -1;
+	}
+
+	now = time(NULL);
+	hash = hash_murmur64(st_data_get(key), st_length_get(key));
+	bucket = tally_bucket(hash, &shard);
+
+	if (!(entry = tally_find(bucket, hash, key, now)) && magma.tally.sync) {
+
+		mutex_unlock(&(shard->lock));
+
+		// The value layout matches the one written by tally_push(), with the first sighting held in the leading 64 bit integer.
+		if ((value = cache_get(key)) && st_length_get(value) == 16 && *((uint64_t *)st_data_get(value)) <= (uint64_t)now) {
+			remote = *((uint64_t *)st_data_get(value));
+		}
+
+		st_cleanup(value);
+
+		// Another thread may have recorded the key while the lock was released.
+		now = time(NULL);
+		bucket = tally_bucket(hash, &shard);
+		entry = tally_find(bucket, hash, key, now);
+	}
+
+	if (entry) {
+
+		// Entries seen regularly are pushed once a day, so they don't expire from the distributed cache while still in use here.
+		if (magma.tally.sync && now - entry->pushed > 86400) {
+			entry->dirty = true;
+		}
+
+		if (remote && remote < entry->first) {
+			entry->first = remote;
+		}
+
+		entry->touched = now;
+		entry->expires = now + expiration;
+		*first = entry->first;
+
+		mutex_unlock(&(shard->lock));
+		return 1;
+	}
+
+	// Prefer an empty, or expired, slot. Otherwise evict the entry which has gone unused the longest.
+	for (uint32_t i = 0; i < MAGMA_TALLY_WAYS; i++) {
+		if (!victim || (victim->key && victim->expires > now && (!bucket[i].key || bucket[i].expires <= now || bucket[i].touched < victim->touched))) {
+			victim = &bucket[i];
+		}
+	}
+
+	if (!(copy = ns_import(st_char_get(key), st_length_get(key)))) {
+		log_pedantic("Unable to allocate a tally stamp.");
+		mutex_unlock(&(shard->lock));
+		return -1;
+	}
+
+	ns_cleanup(victim->key);
+
+	victim->key = copy;
+	victim->hash = hash;
+	victim->first = remote ? remote : now;
+	victim->touched = now;
+	victim->expires = now + expiration;
+	victim->pushed = 0;
+	victim->dirty = magma.tally.sync ? true : false;
+	*first = victim->first;
+
+	mutex_unlock(&(shard->lock));
+
+	return remote ? 1 : 0;
+}
+
+/**
+ * @brief	Merge a stamp recorded by another host into the local table.
+ * @note	Since stamps record the first sighting, the older value always wins.
+ * @param	hash	the hash of the stamp key.
+ * @param	key		a null-terminated string holding the stamp key.
+ * @param	first	the time the key was first seen by the other host.
+ * @return	This function returns no value.
+ */
+void tally_merge(uint64_t hash, chr_t *key, time_t first) {
+
+	tally_shard_t *shard;
+	tally_stamp_t *bucket = tally_bucket(hash, &shard);
+
+	for (uint32_t i = 0; i < MAGMA_TALLY_WAYS; i++) {
+		if (bucket[i].key && bucket[i].hash == hash && !strcmp(bucket[i].key, key) && bucket[i].first > first) {
+			bucket[i].first = first;
+		}
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	return;
+}
+
+/**
+ * @brief	Push new and refreshed stamps to the distributed cache.
+ * @note	The values use the same layout as the stamps previously stored directly in the distributed cache, a pair of 64 bit integers holding
+ * 			the first sighting and the time the value was written, so hosts can be upgraded one at a time. Each shard is only locked long
+ * 			enough to copy out its dirty entries.
+ * @return	This function returns no value.
+ */
+void tally_push(void) {
+
+	time_t now;
+	uint32_t count;
+	uint64_t stamp[2];
+	stringer_t *value;
+	tally_stamp_t *entry;
+
+	for (uint32_t i = 0; i < MAGMA_TALLY_SHARDS; i++) {
+
+		now = time(NULL);
+		count = 0;
+
+		mutex_lock(&(tallies.shards[i].lock));
+
+		for (uint64_t j = 0; j < (uint64_t)tallies.buckets * MAGMA_TALLY_WAYS; j++) {
+
+			entry = &(tallies.shards[i].entries[j]);
+
+			if (entry->key && entry->dirty && entry->expires > now && (tallies.batch[count].key = ns_dupe(entry->key))) {
+				tallies.batch[count].hash = entry->hash;
+				tallies.batch[count].first = entry->first;
+				tallies.batch[count].expires = entry->expires;
+				entry->dirty = false;
+				entry->pushed = now;
+				count++;
+			}
+		}
+
+		mutex_unlock(&(tallies.shards[i].lock));
+
+		for (uint32_t j = 0; j < count; j++) {
+
+			// Another host may have seen the key first.
+			if ((value = cache_get(NULLER(tallies.batch[j].key))) && st_length_get(value) == 16 &&
+				*((uint64_t *)st_data_get(value)) < (uint64_t)tallies.batch[j].first) {
+				tallies.batch[j].first = *((uint64_t *)st_data_get(value));
+				tally_merge(tallies.batch[j].hash, tallies.batch[j].key, tallies.batch[j].first);
+			}
+
+			st_cleanup(value);
+
+			stamp[0] = tallies.batch[j].first;
+			stamp[1] = now;
+
+			if (cache_set(NULLER(tallies.batch[j].key), PLACER(stamp, sizeof(stamp)), tallies.batch[j].expires - now) != 1) {
+				log_pedantic("Unable to push a tally stamp to the distributed cache. { key = %s }", tallies.batch[j].key);
+			}
+
+			ns_free(tallies.batch[j].key);
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	The entry point for the thread which pushes stamps to the distributed cache, every magma.tally.sync seconds.
+ * @note	Anything still waiting to be pushed when the store is stopped is flushed before the thread exits.
+ * @return	This function returns no value.
+ */
+void tally_sync(void) {
+
+	struct timespec deadline;
+
+	mutex_lock(&(tallies.lock));
+
+	while (tallies.running) {
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += magma.tally.sync;
+
+		while (tallies.running && pthread_cond_timedwait(&(tallies.wake), &(tallies.lock), &deadline) != ETIMEDOUT);
+
+		mutex_unlock(&(tallies.lock));
+		tally_push();
+		mutex_lock(&(tallies.lock));
+	}
+
+	mutex_unlock(&(tallies.lock));
+
+	return;
+}
+
+/**
+ * @brief	Count a connection from a remote address, and estimate how many connections the address has opened over the past minute.
+ * @note	The estimate blends the previous minute's count, weighted by how much of it still falls inside the sliding window, with the count
+ * 			for the current minute. The sketches are rotated by the first connection counted in a new minute. Connections counted while a
+ * 			rotation is underway may land in the wrong minute, which is harmless since the estimates are approximate anyway.
+ * @param	address		the remote address of the connection.
+ * @return	the estimated number of connections, including this one, or 0 if the connection couldn't be counted.
+ */
+uint64_t tally_connection(ip_t *address) {
+
+	time_t now;
+	uint64_t hash, window;
+	uint32_t *current, *previous, column, count, counted = UINT32_MAX, prior = UINT32_MAX;
+
+	if (!tallies.rates.current || !address || (address->family != AF_INET && address->family != AF_INET6)) {
+		return 0;
+	}
+
+	now = time(NULL);
+	window = now / MAGMA_TALLY_WINDOW;
+
+	if (__atomic_load_n(&(tallies.rates.window), __ATOMIC_ACQUIRE) != window) {
+
+		mutex_lock(&(tallies.rates.lock));
+
+		if (tallies.rates.window != window) {
+
+			// If more than a minute passed without any connections, both sketches are stale.
+			if (tallies.rates.window + 1 != window) {
+				mm_wipe(tallies.rates.current, sizeof(uint32_t) * MAGMA_TALLY_DEPTH * MAGMA_TALLY_WIDTH);
+			}
+
+			mm_wipe(tallies.rates.previous, sizeof(uint32_t) * MAGMA_TALLY_DEPTH * MAGMA_TALLY_WIDTH);
+
+			previous = tallies.rates.current;
+			__atomic_store_n(&(tallies.rates.current), tallies.rates.previous, __ATOMIC_RELEASE);
+			__atomic_store_n(&(tallies.rates.previous), previous, __ATOMIC_RELEASE);
+			__atomic_store_n(&(tallies.rates.window), window, __ATOMIC_RELEASE);
+		}
+
+		mutex_unlock(&(tallies.rates.lock));
+	}
+
+	current = __atomic_load_n(&(tallies.rates.current), __ATOMIC_ACQUIRE);
+	previous = __atomic_load_n(&(tallies.rates.previous), __ATOMIC_ACQUIRE);
+
+	// Each row of the sketch uses a different column, derived from the two halves of the address hash.
+	hash = hash_murmur64(&(address->ip), address->family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr));
+
+	for (uint32_t i = 0; i < MAGMA_TALLY_DEPTH; i++) {
+
+		column = (i * MAGMA_TALLY_WIDTH) + (((hash & 0xffffffff) + (i * ((hash >> 32) | 1))) % MAGMA_TALLY_WIDTH);
+
+		if ((count = __sync_add_and_fetch(current + column, 1)) < counted) {
+			counted = count;
+		}
+
+		if ((count = __atomic_load_n(previous + column, __ATOMIC_RELAXED)) < prior) {
+			prior = count;
+		}
+	}
+
+	return counted + ((uint64_t)prior * (MAGMA_TALLY_WINDOW - (now % MAGMA_TALLY_WINDOW)) / MAGMA_TALLY_WINDOW);
+}
+
+/**
+ * @brief	Allocate the local tally store, and launch the thread which pushes stamps to the distributed cache.
+ * @note	The number of stamps, set by magma.tally.slots, is rounded up so every shard holds the same number of buckets. If magma.tally.sync
+ * 			is zero the sync thread isn't launched, and stamps are only ever held locally.
+ * @return	true on success or false on failure.
+ */
+bool_t tally_start(void) {
+
+	tallies.buckets = (magma.tally.slots + (MAGMA_TALLY_SHARDS * MAGMA_TALLY_WAYS) - 1) / (MAGMA_TALLY_SHARDS * MAGMA_TALLY_WAYS);
+
+	if (!tallies.buckets) {
+		log_critical("The local tally store needs at least one slot.");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < MAGMA_TALLY_SHARDS; i++) {
+		if (mutex_init(&(tallies.shards[i].lock), NULL) || !(tallies.shards[i].entries = mm_alloc(sizeof(tally_stamp_t) * tallies.buckets * MAGMA_TALLY_WAYS))) {
+			log_critical("Unable to allocate memory for the local tally store.");
+			tally_stop();
+			return false;
+		}
+	}
+
+	if (!(tallies.rates.current = mm_alloc(sizeof(uint32_t) * MAGMA_TALLY_DEPTH * MAGMA_TALLY_WIDTH)) ||
+		!(tallies.rates.previous = mm_alloc(sizeof(uint32_t) * MAGMA_TALLY_DEPTH * MAGMA_TALLY_WIDTH)) ||
+		(magma.tally.sync && !(tallies.batch = mm_alloc(sizeof(tally_push_t) * tallies.buckets * MAGMA_TALLY_WAYS)))) {
+		log_critical("Unable to allocate memory for the local tally store.");
+		tally_stop();
+		return false;
+	}
+
+	tallies.rates.window = time(NULL) / MAGMA_TALLY_WINDOW;
+
+	if (magma.tally.sync) {
+
+		tallies.running = true;
+
+		if (thread_launch(&(tallies.thread), &tally_sync, NULL)) {
+			log_critical("Unable to launch the tally sync thread.");
+			tallies.running = false;
+			tally_stop();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the tally sync thread, once it has pushed any remaining stamps, and free the local tally store.
+ * @return	This function returns no value.
+ */
+void tally_stop(void) {
+
+	mutex_lock(&(tallies.lock));
+
+	if (tallies.running) {
+		tallies.running = false;
+		pthread_cond_signal(&(tallies.wake));
+		mutex_unlock(&(tallies.lock));
+		thread_join(tallies.thread);
+	}
+	else {
+		mutex_unlock(&(tallies.lock));
+	}
+
+	for (uint32_t i = 0; tallies.buckets && i < MAGMA_TALLY_SHARDS; i++) {
+
+		if (tallies.shards[i].entries) {
+
+			for (uint64_t j = 0; j < (uint64_t)tallies.buckets * MAGMA_TALLY_WAYS; j++) {
+				ns_cleanup(tallies.shards[i].entries[j].key);
+			}
+
+			mm_free(tallies.shards[i].entries);
+			tallies.shards[i].entries = NULL;
+			mutex_destroy(&(tallies.shards[i].lock));
+		}
+	}
+
+	if (tallies.rates.current) {
+		mm_free(tallies.rates.current);
+		tallies.rates.current = NULL;
+	}
+
+	if (tallies.rates.previous) {
+		mm_free(tallies.rates.previous);
+		tallies.rates.previous = NULL;
+	}
+
+	if (tallies.batch) {
+		mm_free(tallies.batch);
+		tallies.batch = NULL;
+	}
+
+	tallies.buckets = 0;
+
+	return;
+}
@@ -83,6 +83,9 @@ bool_t meta_data_flags_replace(inx_t *messages, uint64_t usernum, uint64_t folde
 					log_pedantic("Message flag replace failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
 					result = false;
 				}
+				else if (!meta_data_insert_message_change(active->messagenum, -1)) {
+					result = false;
+				}
 
 			}
 		}
@@ -155,6 +158,9 @@ bool_t meta_data_flags_remove(inx_t *messages, uint64_t usernum, uint64_t folder
 					log_pedantic("Message flag removal failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
 					result = false;
 				}
+				else if (!meta_data_insert_message_change(active->messagenum, -1)) {
+					result = false;
+				}
 
 			}
 		}
@@ -219,6 +225,9 @@ bool_t meta_data_flags_add(inx_t *messages, uint64_t usernum, uint64_t foldernum
 					log_pedantic("Message flag addition failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
 					result = false;
 				}
+				else if (!meta_data_insert_message_change(active->messagenum, -1)) {
+					result = false;
+				}
 
 			}
 
@@ -653,6 +662,21 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 	parameters[0].buffer = &(user->usernum);
 	parameters[0].is_unsigned = true;
 
+	// Note where the change log stands before reading the messages, so anything changed while we work gets replayed by the next refresh.
+	// If the checkpoint is unavailable the stamp is cleared, which forces the next refresh to rebuild the collection.
+	if ((result = stmt_get_result(stmts.select_message_changes_checkpoint, parameters)) && (row = res_row_next(result))) {
+		user->changes.checkpoint = res_field_uint64(row, 0);
+		user->changes.stamp = time(NULL);
+	}
+	else {
+		user->changes.checkpoint = 0;
+		user->changes.stamp = 0;
+	}
+
+	if (result) {
+		res_table_free(result);
+	}
+
 	if (!(result = stmt_get_result(stmts.select_messages, parameters))) {
 		return false;
 	}
@@ -661,8 +685,8 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 		return true;
 	}
 
-	if (!(user->messages = inx_alloc(M_INX_LINKED, &meta_message_free))) {
-		log_error("Could not create a linked list for the messages.");
+	if (!(user->messages = inx_alloc(M_INX_BPLUS, &meta_message_free))) {
+		log_error("Could not create an index for the messages.");
 		res_table_free(result);
 		return false;
 	}
@@ -735,6 +759,178 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 	return true;
 }
 
+/**
+ * @brief	Bring a user's messages collection up to date by applying the changes recorded since it was last synchronized.
+ * @note	Changed messages are updated in place, new messages are appended, and deleted or hidden messages are removed. The caller is
+ * 			responsible for resequencing the collection if anything changed.
+ * @param	user	the meta user object whose messages collection will be patched.
+ * @return	-1 if the collection can't be patched and must be rebuilt, 0 if nothing changed, or 1 if the collection was modified.
+ */
+int_t meta_data_fetch_message_changes(meta_user_t *user) {
+
+	row_t *row;
+	time_t stamp;
+	table_t *result;
+	int_t output = 0;
+	MYSQL_BIND parameters[3];
+	meta_message_t *message;
+	uint64_t checkpoint, overlap;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	if (!user || !user->usernum) {
+		log_pedantic("Invalid data passed for structure update.");
+		return -1;
+	}
+
+	stamp = time(NULL);
+
+	// Changes are pruned from the log, so a collection which hasn't been synchronized recently has to be rebuilt.
+	if (!user->changes.stamp || stamp - user->changes.stamp > MAGMA_MESSAGE_CHANGES_WINDOW) {
+		return -1;
+	}
+
+	checkpoint = user->changes.checkpoint;
+	overlap = user->changes.stamp - MAGMA_MESSAGE_CHANGES_OVERLAP;
+
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Usernum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &(user->usernum);
+	parameters[0].is_unsigned = true;
+
+	// Checkpoint
+	parameters[1].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[1].buffer_length = sizeof(uint64_t);
+	parameters[1].buffer = &checkpoint;
+	parameters[1].is_unsigned = true;
+
+	// Overlap
+	parameters[2].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[2].buffer_length = sizeof(uint64_t);
+	parameters[2].buffer = &overlap;
+	parameters[2].is_unsigned = true;
+
+	if (!(result = stmt_get_result(stmts.select_message_changes, parameters))) {
+		return -1;
+	}
+
+	// The changes are returned in order, and each row holds the current state of the message, so replaying a change twice is harmless.
+	while ((row = res_row_next(result))) {
+
+		key.val.u64 = res_field_uint64(row, 0);
+
+		if (res_field_uint64(row, 9) > checkpoint) {
+			checkpoint = res_field_uint64(row, 9);
+		}
+
+		// The message was deleted, or hidden.
+		if (!res_field_uint64(row, 1) || !res_field_uint8(row, 8)) {
+
+			if (user->messages && inx_delete(user->messages, key)) {
+				output = 1;
+			}
+
+			continue;
+		}
+
+		// We are using a fixed server name buffer of 33 bytes, so make sure the server name is 32 bytes or less.
+		else if (res_field_length(row, 2) > 32 || !res_field_length(row, 2) || !res_field_uint32(row, 4)) {
+			log_error("One of the critical message variables was invalid. {usernum = %lu / messagenum = %lu}", user->usernum, key.val.u64);
+			res_table_free(result);
+			return -1;
+		}
+
+		else if (!user->messages && !(user->messages = inx_alloc(M_INX_BPLUS, &meta_message_free))) {
+			log_error("Could not create an index for the messages.");
+			res_table_free(result);
+			return -1;
+		}
+
+		// New messages have the highest message numbers, so appending them preserves the ordering of a full load.
+		if (!(message = inx_find(user->messages, key))) {
+
+			if (!(message = mm_alloc(sizeof(meta_message_t)))) {
+				log_pedantic("Could not allocate %zu bytes to hold the message meta information.", sizeof(meta_message_t));
+				res_table_free(result);
+				return -1;
+			}
+
+			message->messagenum = key.val.u64;
+
+			if (!inx_insert(user->messages, key, message)) {
+				log_error("Could not append the message to the linked list.");
+				mm_free(message);
+				res_table_free(result);
+				return -1;
+			}
+
+		}
+
+		message->foldernum = res_field_uint64(row, 1);
+		mm_wipe(message->server, sizeof(message->server));
+		mm_copy(message->server, res_field_block(row, 2), res_field_length(row, 2));
+		message->status = res_field_uint32(row, 3);
+		message->size = res_field_uint32(row, 4);
+		message->signum = res_field_uint64(row, 5);
+		message->sigkey = res_field_uint64(row, 6);
+		message->created = res_field_uint64(row, 7);
+
+		if (message->tags) {
+			ar_free(message->tags);
+			message->tags = NULL;
+		}
+
+		if (message->status & MAIL_STATUS_TAGGED) {
+			meta_data_fetch_message_tags(message);
+		}
+
+		output = 1;
+	}
+
+	res_table_free(result);
+
+	user->changes.checkpoint = checkpoint;
+	user->changes.stamp = stamp;
+
+	return output;
+}
+
+/**
+ * @brief	Record a change to a message in the change log, so other nodes can refresh their copy of the mailbox incrementally.
+ * @note	The change has to be recorded before a message is deleted, since the owner is looked up using the message record.
+ * @param	messagenum	the numerical id of the message that was changed.
+ * @param	transaction	the mysql connection id on which to execute the statement, or -1 to use any available connection.
+ * @return	true on success or false on failure.
+ */
+bool_t meta_data_insert_message_change(uint64_t messagenum, int64_t transaction) {
+
+	bool_t result;
+	MYSQL_BIND parameters[1];
+
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Messagenum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &messagenum;
+	parameters[0].is_unsigned = true;
+
+	if (transaction < 0) {
+		result = stmt_exec(stmts.insert_message_change, parameters);
+	}
+	else {
+		result = stmt_exec_conn(stmts.insert_message_change, parameters, transaction);
+	}
+
+	if (!result) {
+		log_pedantic("Unable to record the message change. { message = %lu }", messagenum);
+	}
+
+	return result;
+}
+
 /**
  * @brief	Adjust the encrypted status of a message, in accordance with the user's secure flag.
  * @param	user		a pointer to the meta user object owning the specified message.
@@ -750,6 +946,7 @@ bool_t adjust_message_encryption(meta_user_t *user, meta_message_t *message, str
 	stringer_t *fcontents, *ftmpname;
 	message_fheader_t *fheader, new_fheader;
 	cryptex_t *enc_data = NULL;
+	compress_t *merged = NULL;
 	uint32_t transaction;
 	size_t data_length, mdatalen;
 	uchr_t *mdataptr;
@@ -808,7 +1005,28 @@ bool_t adjust_message_encryption(meta_user_t *user, meta_message_t *message, str
 			log_pedantic("Message state mismatch: unencrypted in database but encrypted on disk.");
 		}
 
-		if (!(enc_data = ecies_encrypt(user->storage_pubkey, ECIES_PUBLIC_BINARY, mdataptr, mdatalen))) {
+		// A shared body can't be encrypted in place, so the complete message is rebuilt and encrypted as a single file.
+		if (fheader->flags & FMESSAGE_OPT_SHARED) {
+
+			if (!(merged = mail_blob_merge(PLACER(mdataptr, mdatalen), message->messagenum, message->server))) {
+				log_pedantic("Unable to merge the message with its shared body.");
+				ns_free(msgpath);
+				ns_free(fcontents);
+				return false;
+			}
+
+			mdataptr = (uchr_t *)merged;
+			mdatalen = compress_total_length(merged);
+			new_fheader.flags &= ~FMESSAGE_OPT_SHARED;
+		}
+
+		enc_data = ecies_encrypt(user->storage_pubkey, ECIES_PUBLIC_BINARY, mdataptr, mdatalen);
+
+		if (merged) {
+			compress_free(merged);
+		}
+
+		if (!enc_data) {
 			log_pedantic("Unable to encrypt contents of user's message.");
 			ns_free(msgpath);
 			ns_free(fcontents);
@@ -939,6 +1157,11 @@ bool_t adjust_message_encryption(meta_user_t *user, meta_message_t *message, str
 		log_pedantic("Transaction commit for file encryption failed.");
 	}
 
+	// The encrypted file holds the complete message, so its reference to the shared body is no longer needed.
+	if (merged) {
+		mail_blob_release(message->messagenum, message->server);
+	}
+
 	ns_free(msgpath);
 	unlink(st_char_get(ftmpname));
 
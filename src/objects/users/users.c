@@ -277,8 +277,8 @@ int_t meta_user_prune(stringer_t *username) {
 		state = -1;
 	}
 
-	stats_set_by_name("objects.users.total", count);
-	stats_adjust_by_name("objects.users.expired", expired);
+	stats_set_by_num(STATS_OBJECTS_USERS_TOTAL, count);
+	stats_adjust_by_num(STATS_OBJECTS_USERS_EXPIRED, expired);
 
 	return state;
 }
@@ -92,6 +92,7 @@ inx_t *    meta_data_fetch_alerts(uint64_t usernum);
 bool_t     meta_data_fetch_folders(meta_user_t *user);
 bool_t     meta_data_fetch_mailbox_aliases(meta_user_t *user);
 bool_t     meta_data_check_mailbox(stringer_t *address);
+int_t      meta_data_fetch_message_changes(meta_user_t *user);
 bool_t     meta_data_fetch_messages(meta_user_t *user);
 int_t      meta_check_message_encryption(meta_user_t *user);
 inx_t *    meta_data_fetch_all_tags(uint64_t usernum);
@@ -100,6 +101,7 @@ bool_t     meta_data_fetch_user(meta_user_t *user);
 bool_t     meta_data_flags_add(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags);
 bool_t     meta_data_flags_remove(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags);
 bool_t     meta_data_flags_replace(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags);
+bool_t     meta_data_insert_message_change(uint64_t messagenum, int64_t transaction);
 uint64_t   meta_data_insert_folder(uint64_t usernum, stringer_t *name, uint64_t parent, uint32_t order);
 int_t      meta_data_insert_tag(meta_message_t *message, stringer_t *tag);
 int_t      meta_data_truncate_tags(meta_message_t *message);
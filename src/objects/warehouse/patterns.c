@@ -28,7 +28,7 @@ int_t pattern_check(stringer_t *message) {
 	stringer_t *current;
 	inx_cursor_t *cursor;
 
-	stats_adjust_by_name("objects.patterns.checked", 1);
+	stats_adjust_by_num(STATS_OBJECTS_PATTERNS_CHECKED, 1);
 
 	mutex_lock(&patterns_mutex);
 	cursor = inx_cursor_alloc(patterns_list);
@@ -50,11 +50,11 @@ int_t pattern_check(stringer_t *message) {
 	}
 
 	if (result == -2) {
-		stats_adjust_by_name("objects.patterns.fail", 1);
+		stats_adjust_by_num(STATS_OBJECTS_PATTERNS_FAIL, 1);
 	} else if (result == -1) {
-		stats_adjust_by_name("objects.patterns.errors", 1);
+		stats_increment_by_num(STATS_OBJECTS_PATTERNS_ERROR);
 	}else if (result == 1) {
-		stats_adjust_by_name("objects.patterns.pass", 1);
+		stats_adjust_by_num(STATS_OBJECTS_PATTERNS_PASS, 1);
 	}
 
 	return result;
@@ -37,6 +37,10 @@ enum {
 	FOREIGN = 1
 };
 
+typedef struct {
+	uint64_t references; /* The number of scans using the engine, plus one for the global context pointer. */
+	struct cl_engine *engine; /* The ClamAV engine. */
+} virus_context_t;
 
 /// clamav.c
 bool_t lib_load_clamav(void);
@@ -48,7 +52,11 @@ struct cl_engine * virus_engine_create(uint64_t *signatures);
 uint64_t virus_sigs_loaded(void);
 uint64_t virus_sigs_total(void);
 void virus_engine_destroy(struct cl_engine **target);
+int virus_scan(const struct cl_engine *engine, stringer_t *data, const char **virname, unsigned long int *scanned);
 void virus_stop(void);
+virus_context_t * virus_context_acquire(void);
+virus_context_t * virus_context_alloc(struct cl_engine *engine);
+void virus_context_release(virus_context_t *context);
 
 /// dkim.c
 int_t           dkim_check(stringer_t *id, stringer_t *message);
@@ -28,15 +28,20 @@ struct cl_stat virus_stat;
 unsigned int virus_sigs = 0;
 
 /**
- * The virus engine context pointer.
+ * The current virus engine context, and the number of references held against it.
  */
-struct cl_engine *virus_engine = NULL;
+virus_context_t *virus_context = NULL;
 
 /**
- * The virus engine read/write lock.
+ * The virus engine read/write lock. The lock only guards the context pointer, scans run against a referenced context without holding it.
  */
 pthread_rwlock_t virus_lock =	PTHREAD_RWLOCK_INITIALIZER;
 
+/**
+ * The pool used to limit the number of concurrent scans.
+ */
+pool_t *virus_pool = NULL;
+
 /**
  * @brief	Get the number of virus signatures loaded by the ClamAV engine context.
  * @return	the number of virus signatures loaded by the ClamAV engine context.
@@ -82,6 +87,60 @@ void virus_engine_destroy(struct cl_engine **target) {
 	return;
 }
 
+/**
+ * @brief	Take a reference to the current ClamAV engine context.
+ * @note	The context remains valid until the reference is returned using virus_context_release(), even if the engine is refreshed in the meantime.
+ * @return	NULL if no engine has been loaded, or a pointer to the referenced context on success.
+ */
+virus_context_t * virus_context_acquire(void) {
+
+	virus_context_t *context;
+
+	pthread_rwlock_rdlock(&virus_lock);
+	if ((context = virus_context)) {
+		__sync_add_and_fetch(&(context->references), 1);
+	}
+	pthread_rwlock_unlock(&virus_lock);
+
+	return context;
+}
+
+/**
+ * @brief	Return a reference to a ClamAV engine context, and free the context once the last reference has been returned.
+ * @param	context	the context being released.
+ * @return	This function returns no value.
+ */
+void virus_context_release(virus_context_t *context) {
+
+	if (context && !__sync_sub_and_fetch(&(context->references), 1)) {
+		virus_engine_destroy(&(context->engine));
+		mm_free(context);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Wrap a ClamAV engine in a context holding a single reference, which belongs to the global context pointer.
+ * @param	engine	the ClamAV engine being wrapped. The engine is destroyed if the context can't be allocated.
+ * @return	NULL on failure, or a pointer to the new context on success.
+ */
+virus_context_t * virus_context_alloc(struct cl_engine *engine) {
+
+	virus_context_t *context;
+
+	if (!(context = mm_alloc(sizeof(virus_context_t)))) {
+		log_error("Unable to allocate %zu bytes for the virus engine context.", sizeof(virus_context_t));
+		virus_engine_destroy(&engine);
+		return NULL;
+	}
+
+	context->engine = engine;
+	context->references = 1;
+
+	return context;
+}
+
 /**
  * Generates a new ClamAV engine context.
  *
@@ -202,6 +261,7 @@ bool_t virus_start(void) {
 
 	int state;
 	uint64_t loaded;
+	struct cl_engine *engine;
 
 	// If we are not supposed to be scanning messages. So don't initialize the engine.
 	if (!magma.iface.virus.available) {
@@ -211,14 +271,14 @@ bool_t virus_start(void) {
 	// The ClamAV library must be initialized before any library function is used.
 	if ((state = cl_init_d(CL_INIT_DEFAULT)) != CL_SUCCESS) {
 		log_critical("ClamAV returned an error during initialization. {cl_init = %i = %s}", state, cl_strerror_d(state));
-		stats_increment_by_name("provider.virus.error");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
 		return false;
 	}
 
 	// Configure the scanner spool directory. If spool is empty, use the ClamAV default values.
 	if (magma.spool && (!(virus_spool = spool_path(MAGMA_SPOOL_SCAN)) || spool_check(virus_spool))) {
 		log_critical("The virus spool path is invalid. {path = %.*s}", st_length_int(virus_spool), st_char_get(virus_spool));
-		stats_increment_by_name("provider.virus.error");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
 		return false;
 	}
 
@@ -226,10 +286,21 @@ bool_t virus_start(void) {
 	mm_wipe(&virus_stat, sizeof(struct cl_stat));
 	cl_statinidir_d(magma.iface.virus.signatures, &virus_stat);
 
-	if ((virus_engine = virus_engine_create(&loaded)) == NULL) {
+	if (!(engine = virus_engine_create(&loaded)) || !(virus_context = virus_context_alloc(engine))) {
 		log_critical("Failed to construct a new ClamAV engine context.");
-		stats_increment_by_name("provider.virus.error");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
+		cl_statfree_d(&virus_stat);
+		return false;
+	}
+
+	// The pool doesn't hold any objects, it only limits the number of messages being scanned at once.
+	if (!(virus_pool = pool_alloc(magma.iface.virus.pool.scanners, magma.iface.virus.pool.timeout))) {
+		log_critical("Unable to allocate the virus scanner pool. {scanners = %u / timeout = %u}", magma.iface.virus.pool.scanners,
+			magma.iface.virus.pool.timeout);
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
+		virus_context_release(virus_context);
 		cl_statfree_d(&virus_stat);
+		virus_context = NULL;
 		return false;
 	}
 
@@ -237,9 +308,9 @@ bool_t virus_start(void) {
 	virus_sigs = loaded;
 
 	// Update the ClamAV engine trackers.
-	stats_set_by_name("provider.virus.available", 1);
-	stats_set_by_name("provider.virus.signatures.loaded", loaded);
-	stats_set_by_name("provider.virus.signatures.total", virus_sigs_total());
+	stats_set_by_num(STATS_PROVIDER_VIRUS_AVAILABLE, 1);
+	stats_set_by_num(STATS_PROVIDER_VIRUS_SIGNATURES_LOADED, loaded);
+	stats_set_by_num(STATS_PROVIDER_VIRUS_SIGNATURES_TOTAL, virus_sigs_total());
 
 	// TODO: Create function to load each signature database found inside the ClamAV directory, and then output the ver/sig count using cl_cvdparse().
 	log_pedantic("------------------------------- SIGNATURES -------------------------------\n%-10.10s %63.lu\n%-10.10s %63.lu\n", "LOADED:", loaded, "AVAILABLE:", virus_sigs_total());
@@ -253,16 +324,29 @@ bool_t virus_start(void) {
  */
 void virus_stop(void) {
 
+	virus_context_t *context;
+
 	// If we are not supposed to be scanning messages. So don't free the engine.
 	if (!magma.iface.virus.available) {
 		return;
 	}
 
-	// Frees the engine context.
-	if (virus_engine) {
-		virus_engine_destroy(&virus_engine);
-		virus_engine = NULL;
+	if (virus_pool) {
+		log_pedantic("Virus scanner pool wait times. {immediate = %lu / <1ms = %lu / <10ms = %lu / <100ms = %lu / <1s = %lu / longer = %lu / failures = %lu}",
+			pool_get_waits(virus_pool, 0), pool_get_waits(virus_pool, 1), pool_get_waits(virus_pool, 2), pool_get_waits(virus_pool, 3),
+			pool_get_waits(virus_pool, 4), pool_get_waits(virus_pool, 5), pool_get_failures(virus_pool));
+		pool_free(virus_pool);
+		virus_pool = NULL;
+	}
+
+	// Release the global reference, which frees the engine context once any scans still using it have finished.
+	if (virus_context) {
+		pthread_rwlock_wrlock(&virus_lock);
+		context = virus_context;
+		virus_context = NULL;
 		virus_sigs = 0;
+		pthread_rwlock_unlock(&virus_lock);
+		virus_context_release(context);
 	}
 
 	// Free the memory associated with the virus scanning engine.
@@ -282,8 +366,8 @@ void virus_stop(void) {
 	// lt_dlexit_d();
 
 	// Update the ClamAV engine trackers. The values below are used to indicate a shutdown state.
-	stats_set_by_name("provider.virus.available", 0);
-	stats_set_by_name("provider.virus.signatures.loaded", 0);
+	stats_set_by_num(STATS_PROVIDER_VIRUS_AVAILABLE, 0);
+	stats_set_by_num(STATS_PROVIDER_VIRUS_SIGNATURES_LOADED, 0);
 
 	return;
 }
@@ -299,7 +383,8 @@ int virus_engine_refresh(void) {
 	time_t utime;
 	struct tm now;
 	uint64_t loaded, total;
-	struct cl_engine *original, *new = NULL;
+	struct cl_engine *engine;
+	virus_context_t *original, *new = NULL;
 
 	// If we are not supposed to be scanning messages. So don't bother refreshing engine.
 	if (!magma.iface.virus.available) {
@@ -308,21 +393,21 @@ int virus_engine_refresh(void) {
 
 	if (cl_statchkdir_d(&virus_stat) == 1) {
 
-		if ((new = virus_engine_create(&loaded)) == NULL) {
+		if (!(engine = virus_engine_create(&loaded)) || !(new = virus_context_alloc(engine))) {
 			log_error("Failed to construct a new ClamAV engine context.");
-			stats_increment_by_name("provider.virus.error");
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
 			return -1;
 		}
 
 		// Lock and then swap the pointer.
 		pthread_rwlock_wrlock(&virus_lock);
-		original = virus_engine;
-		virus_engine = new;
+		original = virus_context;
+		virus_context = new;
 		virus_sigs = loaded;
 		pthread_rwlock_unlock(&virus_lock);
 
-		// Free the old engine context.
-		virus_engine_destroy(&original);
+		// Drop the global reference to the old engine context. Scans still using it will free it when they finish.
+		virus_context_release(original);
 
 		// Refresh the statistics, so we can properly log the update.
 		cl_statfree_d(&virus_stat);
@@ -330,8 +415,8 @@ int virus_engine_refresh(void) {
 		cl_statinidir_d(magma.iface.virus.signatures, &virus_stat);
 
 		// Update the engine counters with counts from the new signature database.
-		stats_set_by_name("provider.virus.signatures.loaded", loaded);
-		stats_set_by_name("provider.virus.signatures.total", (total = virus_sigs_total()));
+		stats_set_by_num(STATS_PROVIDER_VIRUS_SIGNATURES_LOADED, loaded);
+		stats_set_by_num(STATS_PROVIDER_VIRUS_SIGNATURES_TOTAL, (total = virus_sigs_total()));
 
 		// If we have a problem calculating the local time, output the message without the time.
 		if ((utime = time(NULL)) == ((time_t)-1) || (localtime_r(&utime, &now)) == NULL) {
@@ -355,8 +440,41 @@ int virus_engine_refresh(void) {
 	return 1;
 }
 
+/**
+ * @brief	Scan a block of data using a specific ClamAV engine, without writing the data to disk.
+ * @note	The data is handed to ClamAV as a memory map. If the map can't be created, the data is copied into an anonymous memory file instead.
+ * @param	engine		the ClamAV engine used for the scan.
+ * @param	data		a managed string containing the block of data to be scanned.
+ * @param	virname		a pointer to receive the name of the signature matched by the data.
+ * @param	scanned		a pointer to receive the number of blocks scanned.
+ * @return	the ClamAV result code for the scan.
+ */
+int virus_scan(const struct cl_engine *engine, stringer_t *data, const char **virname, unsigned long int *scanned) {
+
+	int fd, state;
+	cl_fmap_t *map;
+
+	if ((map = cl_fmap_open_memory_d(st_data_get(data), st_length_get(data)))) {
+		state = cl_scanmap_callback_d(map, virname, scanned, engine, CL_SCAN_STDOPT, NULL);
+		cl_fmap_close_d(map);
+		return state;
+	}
+
+	log_pedantic("Unable to map the message being scanned, falling back to a memory file.");
+
+	if ((fd = file_memory("virus", data)) < 0) {
+		return CL_EMEM;
+	}
+
+	state = cl_scandesc_d(fd, virname, scanned, engine, CL_SCAN_STDOPT);
+	close(fd);
+
+	return state;
+}
+
 /**
  * @brief	Virus scan a block of data.
+ * @note	The number of concurrent scans is limited by the virus scanner pool, and callers wait for a free slot for up to magma.iface.virus.pool.timeout seconds.
  * @param	data	a managed string containing the block of data to be scanned.
  * @return	1 if the message passed the scan, or < 0 on failure.
  *        -1: general failure, or the virus scanner was not enabled.
@@ -365,10 +483,12 @@ int virus_engine_refresh(void) {
  */
 int virus_check(stringer_t *data) {
 
-	int fd, state;
-	char *virname;
-	ssize_t written;
-	unsigned long int scanned;
+	int state;
+	uint32_t item;
+	char *virname = NULL;
+	unsigned long int scanned = 0;
+	virus_context_t *context;
+	struct timespec start, finish;
 
 	// If we are not supposed to be scanning messages.
 	if (!magma.iface.virus.available) {
@@ -381,24 +501,27 @@ int virus_check(stringer_t *data) {
 		return -1;
 	}
 
-	// Create a temporary file to store the message being scanned.
-	if ((fd = spool_mktemp(MAGMA_SPOOL_SCAN, "virus")) < 0) {
-		log_pedantic("Unable to open a temporary file to hold the message being scanned.");
-		stats_increment_by_name("provider.virus.error");
+	// Wait for a free scanner.
+	if (pool_pull(virus_pool, &item) != PL_RESERVED) {
+		log_pedantic("Unable to reserve a virus scanner.");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
 		return -1;
 	}
-
-	// Stick the message in the file for ClamAV.
-	if ((written = write(fd, st_data_get(data), st_length_get(data))) != st_length_get(data)) {
-		log_error("Not all of the bytes were written to disk. Was %zi, but should have been %zu.", written, st_length_get(data));
-		stats_increment_by_name("provider.virus.error");
-		close(fd);
+	else if (!(context = virus_context_acquire())) {
+		log_pedantic("The virus engine context isn't available.");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
+		pool_release(virus_pool, item);
 		return -1;
 	}
 
 	// Scan the message.
-	pthread_rwlock_rdlock(&virus_lock);
-	state = cl_scandesc_d(fd, (const char **)&virname, &scanned, virus_engine, CL_SCAN_STDOPT);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	state = virus_scan(context->engine, data, (const char **)&virname, &scanned);
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	// The signature name points into the engine, so the context reference is held until the classification below is complete.
+	pool_release(virus_pool, item);
+	stats_adjust_by_num(STATS_PROVIDER_VIRUS_SCAN_TIME, ((finish.tv_sec - start.tv_sec) * 1000000) + ((finish.tv_nsec - start.tv_nsec) / 1000));
 
 	// If we found something, then spit it back.
 	// http://wiki.clamav.net/Main/MalwareNaming has naming conventions.
@@ -408,41 +531,37 @@ int virus_check(stringer_t *data) {
 
 		// These are signature based phishing matches.
 		if (!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Email.Phishing")) || !st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("HTML.Phishing"))) {
-			pthread_rwlock_unlock(&virus_lock);
-			stats_increment_by_name("provider.virus.scan.total");
-			stats_increment_by_name("provider.virus.scan.phishing");
-			close(fd);
+			virus_context_release(context);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_TOTAL);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_PHISHING);
 			return -3;
 		}
 		// We ignore email that ClamAV thinks is a phishing based on scanner's internal heuristic checks.
 		else if (!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Phishing")) ||
 			!st_cmp_ci_starts(PLACER(virname, ns_length_get(virname)), CONSTANT("Joke"))) {
-			pthread_rwlock_unlock(&virus_lock);
-			stats_increment_by_name("provider.virus.scan.total");
-			stats_increment_by_name("provider.virus.scan.clean");
-			close(fd);
+			virus_context_release(context);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_TOTAL);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_CLEAN);
 			return 1;
 		}
 		// Its probably a worm, trojan, virus or something similar.
 		else {
-			pthread_rwlock_unlock(&virus_lock);
-			stats_increment_by_name("provider.virus.scan.total");
-			stats_increment_by_name("provider.virus.scan.infected");
-			close(fd);
+			virus_context_release(context);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_TOTAL);
+			stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_INFECTED);
 			return -2;
 		}
 	}
 
-	pthread_rwlock_unlock(&virus_lock);
-	close(fd);
+	virus_context_release(context);
 
-	// Track the number of clean messages. We can do the tracking after the mutex is released.
+	// Track the number of clean messages.
 	if (state == CL_CLEAN) {
-		stats_increment_by_name("provider.virus.scan.total");
-		stats_increment_by_name("provider.virus.scan.clean");
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_TOTAL);
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_SCAN_CLEAN);
 	} else {
-		log_error("An error occurred while scanning a message. {cl_scandesc = %i = %s}", state, cl_strerror_d(state));
-		stats_increment_by_name("provider.virus.error");
+		log_error("An error occurred while scanning a message. {cl_scanmap_callback = %i = %s}", state, cl_strerror_d(state));
+		stats_increment_by_num(STATS_PROVIDER_VIRUS_ERROR);
 	}
 
 	return 1;
@@ -465,7 +584,8 @@ bool_t lib_load_clamav(void) {
 
 	symbol_t clamav[] = {
 		M_BIND(cl_countsigs), M_BIND(cl_engine_compile), M_BIND(cl_engine_free), M_BIND(cl_engine_new),	M_BIND(cl_engine_set_num),
-		M_BIND(cl_engine_set_str), M_BIND(cl_init),	M_BIND(cl_load), M_BIND(cl_retver),	M_BIND(cl_scandesc), M_BIND(cl_shutdown),
+		M_BIND(cl_engine_set_str), M_BIND(cl_fmap_close), M_BIND(cl_fmap_open_memory), M_BIND(cl_init),	M_BIND(cl_load), M_BIND(cl_retver),
+		M_BIND(cl_scandesc), M_BIND(cl_scanmap_callback), M_BIND(cl_shutdown),
 		M_BIND(cl_statchkdir), M_BIND(cl_statfree), M_BIND(cl_statinidir), M_BIND(cl_strerror),	M_BIND(lt_dlexit),
 	};
 
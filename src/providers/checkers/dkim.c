@@ -152,7 +152,7 @@ stringer_t * dkim_create(stringer_t *id, stringer_t *message) {
 
 	if (status == DKIM_STAT_OK && signature) {
 		output = st_merge("nns", DKIM_SIGNHEADER, ": ", signature);
-		stats_adjust_by_name("provider.dkim.signed", 1);
+		stats_adjust_by_num(STATS_PROVIDER_DKIM_SIGNED, 1);
 	}
 	else if (status != DKIM_STAT_OK) {
 		log_pedantic("An error occurred while trying to generate the DKIM signature. {result = %s}", dkim_getresultstr_d(status));
@@ -178,12 +178,12 @@ int_t dkim_check(stringer_t *id, stringer_t *message) {
 	DKIM *context;
 	DKIM_STAT status;
 
-	stats_adjust_by_name("provider.dkim.checked", 1);
+	stats_adjust_by_num(STATS_PROVIDER_DKIM_CHECKED, 1);
 
 	// Create a new handle to verify the signed message.
 	if (!(context = dkim_verify_d(dkim_engine, st_data_get(id), NULL, &status)) || status != DKIM_STAT_OK) {
 		log_pedantic("Allocation of the DKIM verification context failed. {%status = %s}", context ? "" : "dkim_verify = NULL / ", dkim_getresultstr_d(status));
-		stats_adjust_by_name("provider.dkim.errors", 1);
+		stats_increment_by_num(STATS_PROVIDER_DKIM_ERROR);
 
 		if (context) {
 			dkim_free_d(context);
@@ -201,22 +201,22 @@ int_t dkim_check(stringer_t *id, stringer_t *message) {
 
 	if (status == DKIM_STAT_BADSIG || status == DKIM_STAT_REVOKED || status == DKIM_STAT_KEYFAIL) {
 		//log_pedantic("The DKIM signature found but it does not validate.");
-		stats_adjust_by_name("provider.dkim.fail", 1);
+		stats_adjust_by_num(STATS_PROVIDER_DKIM_FAIL, 1);
 		return -2;
 	}
 	else if (status == DKIM_STAT_NOSIG) {
 		//log_pedantic("The message doesn't appear to contain a DKIM signature.");
-		stats_adjust_by_name("provider.dkim.missing", 1);
+		stats_adjust_by_num(STATS_PROVIDER_DKIM_MISSING, 1);
 		return -1;
 	}
 	else if (status != DKIM_STAT_OK) {
 		//log_pedantic("The DKIM signature could not be validated. {result = %s}", dkim_getresultstr_d(status));
-		stats_adjust_by_name("provider.dkim.neutral", 1);
+		stats_adjust_by_num(STATS_PROVIDER_DKIM_NEUTRAL, 1);
 		return -1;
 	}
 
 	//log_pedantic("DKIM signature found and it validated!");
-	stats_adjust_by_name("provider.dkim.pass", 1);
+	stats_adjust_by_num(STATS_PROVIDER_DKIM_PASS, 1);
 
 	return 1;
 }
@@ -79,7 +79,7 @@ int_t dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signature)
 
 	st_free(tmpdir);
 
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 		log_info("Unable to get an available connection for the query.");
 		dspam_destroy_d(ctx);
 		return -1;
@@ -98,7 +98,7 @@ int_t dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signature)
    	if (dspam_detach_d(ctx) != 0) {
 			log_pedantic("Could not detach the DB connection.");
 		}
-		pool_release(sql_pool, connection);
+		sql_release(connection);
 		log_pedantic("An error occurred while attaching to the statistical database. {dspam_attach = %i}", ret);
 		dspam_destroy_d(ctx);
 		return -1;
@@ -116,7 +116,7 @@ int_t dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signature)
 		if (dspam_detach_d(ctx) != 0) {
 			log_pedantic("Could not detach the DB connection.");
 		}
-		pool_release(sql_pool, connection);
+		sql_release(connection);
 		log_pedantic("An error occurred while analyzing an email with DSPAM. {dspam_process = %i}", ret);
 		dspam_destroy_d(ctx);
     return -1;
@@ -125,13 +125,13 @@ int_t dspam_check(uint64_t usernum, stringer_t *message, stringer_t **signature)
 	// We assume that the SQL connection will no longer be needed.
 	if ((ret = dspam_detach_d(ctx))) {
 		log_pedantic("Could not detach the DB connection. {dspam_detach = %i}", ret);
-		pool_release(sql_pool, connection);
+		sql_release(connection);
 		dspam_destroy_d(ctx);
     return -1;
 	}
 
 	// Return the connection to our pool.
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 
 	// Check to see if the message is junk mail.
 	if (ctx->result == DSR_ISSPAM) {
@@ -200,7 +200,7 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 	st_free(tmpdir);
 
 	// Get a DB connection.
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 		log_info("Unable to get an available connection for the query.");
 		dspam_destroy_d(ctx);
 		return false;
@@ -221,7 +221,7 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 			log_pedantic("Could not detach the DB connection.");
 		}
 
-		pool_release(sql_pool, connection);
+		sql_release(connection);
 		log_pedantic("An error occurred while attaching to the statistical database. {dspam_attach = %i}", ret);
 		dspam_destroy_d(ctx);
 		return false;
@@ -246,7 +246,7 @@ bool_t dspam_train(uint64_t usernum, int_t disposition, stringer_t *signature) {
 	ret = dspam_process_d(ctx, NULL);
 	dspam_detach_d(ctx);
 	dspam_destroy_d(ctx);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 
 	if (ret) {
 		log_pedantic("An error occurred while training message signature. {dspam_process = %i}", ret);
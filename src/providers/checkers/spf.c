@@ -125,10 +125,10 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 	SPF_response_t *spf_response = NULL;
 
 	mail_domain_get(mailfrom, &domain);
-	stats_adjust_by_name("provider.spf.checked", 1);
+	stats_adjust_by_num(STATS_PROVIDER_SPF_CHECKED, 1);
 
 	if (pool_pull(spf_pool, &item) != PL_RESERVED) {
-		stats_adjust_by_name("provider.spf.error", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 		return -1;
 	}
 
@@ -136,7 +136,7 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 	else if (!(spf_request = SPF_request_new_d(pool_get_obj(spf_pool, item)))) {
 		log_pedantic("SPF request allocation error. {SPF_request_new = NULL}");
 		pool_release(spf_pool, item);
-		stats_adjust_by_name("provider.spf.error", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 		return -1;
 	}
 
@@ -147,7 +147,7 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 		SPF_request_free_d(spf_request);
 		pool_release(spf_pool, item);
 		log_pedantic("SPF context configuration error. {error = %s}", SPF_strerror_d(error));
-		stats_adjust_by_name("provider.spf.error", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 		return -1;
 	}
 
@@ -156,7 +156,7 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 		(error = SPF_request_set_env_from_d(spf_request, st_char_get(mailfrom))) != SPF_E_SUCCESS) {
 		SPF_request_free_d(spf_request);
 		pool_release(spf_pool, item);
-		stats_adjust_by_name("provider.spf.error", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 		return -1;
 	}
 
@@ -168,11 +168,11 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 
 		// Indicates the domain being queried did not publish an SPF record.
 		if (error == SPF_E_NOT_SPF) {
-			stats_adjust_by_name("provider.spf.missing", 1);
+			stats_adjust_by_num(STATS_PROVIDER_SPF_MISSING, 1);
 		}
 		else {
 			log_pedantic("SPF query error. {domain = %.*s / error = %s}", st_length_int(&domain), st_char_get(&domain), SPF_strerror_d(error));
-			stats_adjust_by_name("provider.spf.error", 1);
+			stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 		}
 		return -1;
 	}
@@ -189,28 +189,28 @@ int_t spf_check(ip_t *ip, stringer_t *helo, stringer_t *mailfrom) {
 #ifdef MAGMA_SPF_DEBUG
 		log_pedantic("SPF check passed. {result = PASS / reason = %s}", SPF_strreason_d(reason));
 #endif
-		stats_adjust_by_name("provider.spf.pass", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_PASS, 1);
 		return 1;
 	}
 	else if (response == SPF_RESULT_NEUTRAL) {
 #ifdef MAGMA_SPF_DEBUG
 		log_pedantic("SPF check neutral. {result = NEUTRAL / reason = %s}", SPF_strreason_d(reason));
 #endif
-		stats_adjust_by_name("provider.spf.neutral", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_NEUTRAL, 1);
 		return -1;
 	}
 	else if (response == SPF_RESULT_FAIL) {
 #ifdef MAGMA_SPF_DEBUG
 		log_pedantic("SPF check failed. {result = FAILED / reason = %s}", SPF_strreason_d(reason));
 #endif
-		stats_adjust_by_name("provider.spf.fail", 1);
+		stats_adjust_by_num(STATS_PROVIDER_SPF_FAIL, 1);
 		return -2;
 	}
 
 #ifdef MAGMA_SPF_DEBUG
 	log_pedantic("SPF check error. {result = %s / reason = %s}", SPF_strresult_d(response), SPF_strreason_d(reason));
 #endif
-	stats_adjust_by_name("provider.spf.error", 1);
+	stats_adjust_by_num(STATS_PROVIDER_SPF_ERROR, 1);
 	return -1;
 }
 
@@ -66,10 +66,12 @@ compress_t * compress_lzo(stringer_t *input);
 const char * lib_version_lzo(void);
 stringer_t * decompress_block_lzo(stringer_t *block);
 stringer_t * decompress_lzo(compress_t *compressed);
+stringer_t * decompress_lzo_buffer(compress_t *compressed, stringer_t *output);
 
 /// zlib.c
 bool_t lib_load_zlib(void);
 const char * lib_version_zlib(void);
+stringer_t * compress_gzip(stringer_t *input);
 compress_t * compress_zlib(stringer_t *input);
 stringer_t * decompress_zlib(compress_t *compressed);
 
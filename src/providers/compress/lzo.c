@@ -89,6 +89,17 @@ stringer_t * decompress_block_lzo(stringer_t *block) {
  * @return	NULL on failure, or a managed string containing the uncompressed data on success.
  */
 stringer_t * decompress_lzo(compress_t *compressed) {
+	return decompress_lzo_buffer(compressed, NULL);
+}
+
+/**
+ * @brief	Decompress data using the lzo engine, into a caller supplied buffer.
+ * @note	The output buffer is never freed by this function, even on failure.
+ * @param	compressed	a pointer to the head of the compressed data.
+ * @param	output		a managed string large enough to hold the uncompressed data, or NULL to have a buffer allocated.
+ * @return	NULL on failure, or a managed string containing the uncompressed data on success.
+ */
+stringer_t * decompress_lzo_buffer(compress_t *compressed, stringer_t *output) {
 
 	int ret;
 	void *bptr;
@@ -109,18 +120,22 @@ stringer_t * decompress_lzo(compress_t *compressed) {
 		log_info("The compressed data has been corrupted. {expected = %lu / input = %lu}", head->hash.compressed, hash);
 		return NULL;
 	}
-	else if (!(result = st_alloc(rlen))) {
+	else if (output && st_avail_get(output) < rlen) {
+		log_info("The output buffer is too small for the uncompressed data. {avail = %zu / original = %lu}", st_avail_get(output), rlen);
+		return NULL;
+	}
+	else if (!(result = output) && !(result = st_alloc(rlen))) {
 		log_info("Could not allocate a block of %lu bytes for the uncompressed data.", head->length.original);
 		return NULL;
 	}
 	else if ((ret = lzo1x_decompress_safe_d(bptr, blen, st_data_get(result), &rlen, NULL)) != LZO_E_OK) {
 		log_info("Unable to decompress the buffer. {lzo1x_decompress_safe = %i}", ret);
-		st_free(result);
+		if (result != output) st_free(result);
 		return NULL;
 	}
 	else if (head->length.original != rlen || head->hash.original != (hash = hash_adler32(st_data_get(result), rlen))) {
 		log_info("The uncompressed data is corrupted. {input = %lu != %lu / hash = %lu != %lu}", head->length.original, rlen, head->hash.original, hash);
-		st_free(result);
+		if (result != output) st_free(result);
 		return NULL;
 	}
 
@@ -227,3 +227,47 @@ compress_t * compress_zlib(stringer_t *input) {
 
 	 return result;
 }
+
+/**
+ * @brief	Compress a block of data into the gzip format used by the HTTP Content-Encoding header.
+ * @note	Unlike compress_zlib(), the output is a standard gzip stream without the magma compression header.
+ * @param	input	a managed string containing the data to be compressed.
+ * @return	NULL on failure, or a managed string containing the gzip stream on success.
+ */
+stringer_t * compress_gzip(stringer_t *input) {
+
+	int ret;
+	z_stream zs;
+	stringer_t *result;
+
+	mm_wipe(&zs, sizeof(z_stream));
+
+	// The gzip wrapper adds a twelve byte header and trailer beyond what compressBound() allows for.
+	if (!(result = st_alloc(compressBound_d(st_length_get(input)) + 32))) {
+		log_info("Unable to allocate the gzip output buffer.");
+		return NULL;
+	}
+	// Adding sixteen to the window bits tells zlib to write a gzip header and trailer instead of a zlib header.
+	else if ((ret = deflateInit2__d(&zs, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY, ZLIB_VERSION, sizeof(z_stream))) != Z_OK) {
+		log_info("Unable to initialize the gzip stream. {deflateInit2 = %i}", ret);
+		st_free(result);
+		return NULL;
+	}
+
+	zs.next_in = st_data_get(input);
+	zs.avail_in = st_length_get(input);
+	zs.next_out = st_data_get(result);
+	zs.avail_out = st_avail_get(result);
+
+	if ((ret = deflate_d(&zs, Z_FINISH)) != Z_STREAM_END) {
+		log_info("Unable to compress the buffer. {deflate = %i}", ret);
+		deflateEnd_d(&zs);
+		st_free(result);
+		return NULL;
+	}
+
+	st_length_set(result, zs.total_out);
+	deflateEnd_d(&zs);
+
+	return result;
+}
@@ -76,6 +76,9 @@ uint_t   sql_errno(MYSQL *mysql);
 const    chr_t * sql_error(MYSQL *mysql);
 MYSQL *  sql_open(bool_t silent);
 int_t    sql_ping(uint32_t connection);
+status_t sql_pull(uint32_t *connection);
+void     sql_reap(uint32_t connection, void *object);
+void     sql_release(uint32_t connection);
 bool_t   sql_start(void);
 void     sql_stop(void);
 bool_t   sql_thread_start(void);
@@ -115,6 +118,7 @@ void res_table_free(table_t *table);
 
 /// stmts.c
 bool_t        stmt_bind_param(MYSQL_STMT *group, MYSQL_BIND *bind);
+void          stmt_clear(uint32_t connection);
 void          stmt_close(MYSQL_STMT *local);
 uint_t        stmt_errno(MYSQL_STMT *local);
 const         chr_t * stmt_error(MYSQL_STMT *local);
@@ -132,6 +136,8 @@ bool_t        stmt_rebuild(uint32_t connection);
 MYSQL_STMT *  stmt_reset(MYSQL_STMT **group, uint32_t connection);
 bool_t        stmt_start(void);
 void          stmt_stop(void);
+int64_t       stmt_stream(MYSQL_STMT **group, MYSQL_BIND *parameters, MYSQL_BIND *results, bool_t (*callback)(void *state), void *state);
+int64_t       stmt_stream_conn(MYSQL_STMT **group, MYSQL_BIND *parameters, MYSQL_BIND *results, bool_t (*callback)(void *state), void *state, uint32_t connection);
 
 /// transaction.c
 int64_t tran_commit(int64_t transaction);
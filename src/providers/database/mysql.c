@@ -155,6 +155,7 @@ struct {
 	char serv_schema[32];
 
 	const chr_t *type_serv, *type_embed, *dash;
+	time_t reaped;
 } sql = {
 	.type_serv = "MySQL",
 	.type_embed  = "Embedded",
@@ -196,9 +197,15 @@ void sql_stop(void) {
 
 	stmt_stop();
 
-	// Close the SQL connections.
-	for (uint32_t i = 0; i < magma.iface.database.pool.connections; i++) {
-		mysql_close_d(pool_get_obj(sql_pool, i));
+	if (sql_pool) {
+		log_pedantic("Database connection pool wait times. {immediate = %lu / <1ms = %lu / <10ms = %lu / <100ms = %lu / <1s = %lu / longer = %lu / failures = %lu}",
+			pool_get_waits(sql_pool, 0), pool_get_waits(sql_pool, 1), pool_get_waits(sql_pool, 2), pool_get_waits(sql_pool, 3),
+			pool_get_waits(sql_pool, 4), pool_get_waits(sql_pool, 5), pool_get_failures(sql_pool));
+	}
+
+	// Close the SQL connections. Connections the pool never needed were never opened.
+	for (uint32_t i = 0; sql_pool && i < magma.iface.database.pool.connections; i++) {
+		if (pool_get_obj(sql_pool, i)) mysql_close_d(pool_get_obj(sql_pool, i));
 	}
 
 	// Free the pool.
@@ -307,6 +314,74 @@ int_t sql_ping(uint32_t connection) {
 	return 0;
 }
 
+/**
+ * @brief	Close a database connection that was reaped from the pool after sitting idle.
+ * @param	connection	the pool slot of the connection.
+ * @param	object		the MYSQL object of the connection.
+ * @return	This function returns no value.
+ */
+void sql_reap(uint32_t connection, void *object) {
+
+	stmt_clear(connection);
+	mysql_close_d(object);
+
+	return;
+}
+
+/**
+ * @brief	Reserve a connection from the database pool.
+ * @note	The pool grows on demand, so if every open connection is busy, and the pool hasn't reached its maximum size, a new connection
+ * 			is opened and its prepared statements are built before it's returned.
+ * @param	connection	a pointer to receive the pool slot of the reserved connection.
+ * @return	PL_RESERVED on success or PL_ERROR if a connection couldn't be reserved.
+ */
+status_t sql_pull(uint32_t *connection) {
+
+	MYSQL *con;
+
+	if (pool_pull(sql_pool, connection) != PL_RESERVED) {
+		return PL_ERROR;
+	}
+	else if (pool_get_obj(sql_pool, *connection)) {
+		return PL_RESERVED;
+	}
+
+	if (!(con = sql_open(false))) {
+		pool_release(sql_pool, *connection);
+		return PL_ERROR;
+	}
+
+	pool_set_obj(sql_pool, *connection, con);
+
+	// If the statements can't be prepared now, stmt_reset() will try again when they're used.
+	if (!stmt_rebuild(*connection)) {
+		log_pedantic("Unable to prepare the statements for a new database connection. {connection = %u}", *connection);
+	}
+
+	return PL_RESERVED;
+}
+
+/**
+ * @brief	Return a connection to the database pool.
+ * @note	Connections beyond the configured minimum which have been idle longer than magma.iface.database.pool.idle seconds are closed,
+ * 			but the pool is only checked once per idle interval, by whichever thread notices first.
+ * @param	connection	the pool slot of the connection being returned.
+ * @return	This function returns no value.
+ */
+void sql_release(uint32_t connection) {
+
+	time_t now, last;
+
+	pool_release(sql_pool, connection);
+
+	if (magma.iface.database.pool.idle && (now = time(NULL)) - (last = sql.reaped) >= magma.iface.database.pool.idle &&
+		__sync_bool_compare_and_swap(&(sql.reaped), last, now)) {
+		pool_reap(sql_pool, magma.iface.database.pool.minimum, magma.iface.database.pool.idle, &sql_reap);
+	}
+
+	return;
+}
+
 /**
  * @brief	Load up the mysql subsystem.
  * @note	This function will check that all necessary database parameters have been supplied, and
@@ -320,7 +395,7 @@ bool_t sql_start(void) {
 
 	if (ns_empty(magma.iface.database.host) || ns_empty(magma.iface.database.user) ||
 			ns_empty(magma.iface.database.password) || ns_empty(magma.iface.database.schema) ||
-			magma.iface.database.pool.connections == 0) {
+			magma.iface.database.pool.connections == 0 || magma.iface.database.pool.minimum > magma.iface.database.pool.connections) {
 		log_critical("A required MySQL connection parameter is missing or invalid.");
 		return false;
 	}
@@ -345,8 +420,8 @@ bool_t sql_start(void) {
 		return false;
 	}
 
-	// Loop through and open the required number of connections.
-	for (uint32_t i = 0; i < magma.iface.database.pool.connections; i++) {
+	// Loop through and open the minimum number of connections. The rest are opened on demand by sql_pull().
+	for (uint32_t i = 0; i < magma.iface.database.pool.minimum; i++) {
 		if (!(con = sql_open(false))) {
 			sql_stop();
 			return false;
@@ -355,6 +430,8 @@ bool_t sql_start(void) {
 		pool_set_obj(sql_pool, i, con);
 	}
 
+	sql.reaped = time(NULL);
+
 	if (!stmt_start()) {
 		sql_stop();
 		return false;
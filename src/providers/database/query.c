@@ -43,12 +43,12 @@ int64_t sql_query(stringer_t *query) {
 	uint32_t connection;
 
 	// QUESTION: Perhaps this -1 return should be differentiated from the "non-zero" error return of mysql_real_query_d()
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 			log_info("Unable to get an available connection for the query.");
 			return -1;
 		}
 
 	result = sql_query_conn(query, connection);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 	return result;
 }
@@ -75,8 +75,13 @@ void stmt_close(MYSQL_STMT *local) {
 	uint_t err;
 	MYSQL *con = NULL;
 
+	// Statements which were never prepared, or were cleared when their connection was reaped, are skipped.
+	if (!local) {
+		return;
+	}
+
 	// Store the database connection handle.
-	if (local && local->mysql) {
+	if (local->mysql) {
 		con = local->mysql;
 	}
 
@@ -167,7 +172,8 @@ bool_t stmt_start(void) {
 
 		*((MYSQL_STMT **)&(stmts.select_domains) + i) = (MYSQL_STMT *)local;
 
-		for (uint32_t j = 0; j < magma.iface.database.pool.connections; j++) {
+		// Connections which haven't been opened yet get their statements when sql_pull() opens them.
+		for (uint32_t j = 0; j < magma.iface.database.pool.connections && pool_get_obj(sql_pool, j); j++) {
 
 			if (!(*(local + j) = stmt_open(pool_get_obj(sql_pool, j)))) {
 				log_critical("Unable to create the prepared statement structure.");
@@ -219,6 +225,25 @@ bool_t stmt_rebuild(uint32_t connection) {
 	return true;
 }
 
+/*
+ * @brief	Close all prepared mysql statements associated with a specified mysql connection.
+ * @param	connection	the target mysql connection identifier.
+ * @return	This function returns no value.
+ */
+void stmt_clear(uint32_t connection) {
+
+	MYSQL_STMT **local;
+
+	for (uint32_t i = 0; i < sizeof(queries) / sizeof(chr_t *); i++) {
+		if ((local = ((MYSQL_STMT **)*((MYSQL_STMT **)&(stmts.select_domains) + i))) && *(local + connection)) {
+			stmt_close(*(local + connection));
+			*(local + connection) = NULL;
+		}
+	}
+
+	return;
+}
+
 /*
  * @brief	Reset the prepared statement on client and server.
  * @param	group		the target prepare mysql statement.
@@ -315,13 +340,13 @@ bool_t stmt_exec(MYSQL_STMT **group, MYSQL_BIND *parameters) {
 	uint32_t connection;
 
 	// QUESTION: Why aren't we checking for PL_AVAILABLE?
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 			log_info("Unable to get an available connection for the query.");
 			return 0;
 		}
 
 	result = stmt_exec_conn(group, parameters, connection);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 	return result;
 }
 
@@ -365,13 +390,110 @@ table_t * stmt_get_result(MYSQL_STMT **group, MYSQL_BIND *parameters) {
 	void *result;
 	uint32_t connection;
 
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 		log_info("Unable to get an available connection for the query.");
 		return NULL;
 	}
 
 	result = stmt_get_result_conn(group, parameters, connection);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
+	return result;
+}
+
+/**
+ * @brief	Execute a prepared mysql statement on a specified connection and stream the result rows to a callback.
+ * @note	The rows are fetched from the server one at a time and decoded straight into the caller's result bindings, so the result
+ * 			set is never copied into a table. The callback is invoked once per row, and may abort the fetch by returning false.
+ * @param	group		the prepared mysql statement to be executed.
+ * @param	parameters	the parameters to be passed with the query.
+ * @param	results		the result bindings, which must describe a buffer for every field in the result set.
+ * @param	callback	the function which will process each row after it has been fetched into the result bindings.
+ * @param	state		an opaque pointer passed to the callback.
+ * @param	connection	the mysql connection identifier.
+ * @return	-1 on failure, or the number of rows processed.
+ */
+int64_t stmt_stream_conn(MYSQL_STMT **group, MYSQL_BIND *parameters, MYSQL_BIND *results, bool_t (*callback)(void *state), void *state,
+	uint32_t connection) {
+
+	int_t ret;
+	int64_t rows = 0;
+	MYSQL_STMT *local;
+
+	if (!results || !callback) {
+		log_pedantic("Invalid parameters passed to the streaming statement.");
+		return -1;
+	}
+	else if (!(local = stmt_reset(group, connection))) {
+		log_info("Unable to reset the prepared statement.");
+		return -1;
+	}
+
+	if (stmt_bind_param(local, parameters) == false) {
+		log_info("Unable to bind the parameters to the prepared statement.");
+		return -1;
+	}
+
+	if (mysql_stmt_execute_d(local)) {
+		log_info("An error occurred while executing a prepared statement. { error = %s }", stmt_error(local));
+		return -1;
+	}
+
+	if (mysql_stmt_bind_result_d(local, results)) {
+		log_info("Error binding result. %s", mysql_stmt_error_d(local));
+		mysql_stmt_free_result_d(local);
+		return -1;
+	}
+
+	// Without a call to mysql_stmt_store_result() the rows stay on the server until they are fetched.
+	while (!(ret = mysql_stmt_fetch_d(local))) {
+
+		if (!callback(state)) {
+			mysql_stmt_free_result_d(local);
+			return -1;
+		}
+
+		rows++;
+	}
+
+	if (ret != MYSQL_NO_DATA) {
+
+		if (ret == MYSQL_DATA_TRUNCATED) {
+			log_info("Fetching the result failed because the data would need to be truncated in order to fit within the bound buffer.");
+		}
+		else {
+			log_info("Error fetching result. %s", mysql_stmt_error_d(local));
+		}
+
+		mysql_stmt_free_result_d(local);
+		return -1;
+	}
+
+	mysql_stmt_free_result_d(local);
+	return rows;
+}
+
+/**
+ * @brief	Execute a prepared mysql statement and stream the result rows to a callback.
+ * @see		stmt_stream_conn()
+ * @param	group		the prepared mysql statement to be executed.
+ * @param	parameters	the parameters to be passed with the query.
+ * @param	results		the result bindings, which must describe a buffer for every field in the result set.
+ * @param	callback	the function which will process each row after it has been fetched into the result bindings.
+ * @param	state		an opaque pointer passed to the callback.
+ * @return	-1 on failure, or the number of rows processed.
+ */
+int64_t stmt_stream(MYSQL_STMT **group, MYSQL_BIND *parameters, MYSQL_BIND *results, bool_t (*callback)(void *state), void *state) {
+
+	int64_t result;
+	uint32_t connection;
+
+	if (sql_pull(&connection) != PL_RESERVED) {
+		log_info("Unable to get an available connection for the query.");
+		return -1;
+	}
+
+	result = stmt_stream_conn(group, parameters, results, callback, state, connection);
+	sql_release(connection);
 	return result;
 }
 
@@ -417,13 +539,13 @@ uint64_t stmt_insert(MYSQL_STMT **group, MYSQL_BIND *parameters) {
 	uint64_t result;
 	uint32_t connection;
 
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 			log_info("Unable to get an available connection for the query.");
 			return 0;
 		}
 
 	result = stmt_insert_conn(group, parameters, connection);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 	return result;
 }
 
@@ -475,12 +597,12 @@ uint64_t stmt_exec_affected(MYSQL_STMT **group, MYSQL_BIND *parameters) {
 	uint64_t result;
 	uint32_t connection;
 
-	if (pool_pull(sql_pool, &connection) != PL_RESERVED) {
+	if (sql_pull(&connection) != PL_RESERVED) {
 			log_info("Unable to get an available connection for the query.");
 			return 0;
 		}
 
 	result = stmt_exec_affected_conn(group, parameters, connection);
-	pool_release(sql_pool, connection);
+	sql_release(connection);
 	return result;
 }
@@ -34,14 +34,14 @@ int64_t tran_start(void) {
 	uint32_t transaction;
 
 	// QUESTION: Why aren't we using sql_query() for this whole process?
-	if (pool_pull(sql_pool, &transaction) != PL_RESERVED) {
+	if (sql_pull(&transaction) != PL_RESERVED) {
 		log_info("Unable to get an available connection for the query.");
 		return -1;
 	}
 
 	if ((result = sql_query_conn(PLACER(tran_commands[0].command, tran_commands[0].length), transaction))) {
 		log_info("An error occurred while starting a transaction. { mysql_real_query = %li / error = %s}", result, sql_error(pool_get_obj(sql_pool, transaction)));
-		pool_release(sql_pool, transaction);
+		sql_release(transaction);
 		return -1;
 	}
 
@@ -60,11 +60,11 @@ int64_t tran_rollback(int64_t transaction)  {
 
 	if ((result = sql_query_conn(PLACER(tran_commands[1].command, tran_commands[1].length), transaction))) {
 		log_info("An error occurred while committing the transaction. { mysql_real_query = %li / error = %s }", result, sql_error(pool_get_obj(sql_pool, transaction)));
-		pool_release(sql_pool, transaction);
+		sql_release(transaction);
 		return result;
 	}
 
-	pool_release(sql_pool, transaction);
+	sql_release(transaction);
 	return result;
 }
 
@@ -80,11 +80,11 @@ int64_t tran_commit(int64_t transaction)  {
 
 	if ((result = sql_query_conn(PLACER(tran_commands[2].command, tran_commands[2].length), transaction))) {
 		log_info("An error occurred while committing the transaction. { mysql_real_query = %li / error = %s }", result, sql_error(pool_get_obj(sql_pool, transaction)));
-		pool_release(sql_pool, transaction);
+		sql_release(transaction);
 		return result;
 	}
 
-	pool_release(sql_pool, transaction);
+	sql_release(transaction);
 	return result;
 }
 
@@ -0,0 +1,522 @@
+
+/**
+ * @file /magma/providers/storage/fulltext.c
+ *
+ * @brief The full text search index, which maps the words found inside a user's messages to the messages which contain them.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+/**
+ * The index is stored inside a Tokyo Cabinet hash database using three kinds of records. Each message that has been indexed has a
+ * record listing the terms it contributed, and each term has a record holding the list of message numbers which contain it. Terms
+ * are prefixed with the letter 'h' if the word was found in the message header, and 'b' if it was found in the message body.
+ *
+ *	fulltext.USER.m.MESSAGE = "h.word\0b.word\0..."
+ *	fulltext.USER.h.WORD = { uint64_t messagenum, ... }
+ *	fulltext.USER.b.WORD = { uint64_t messagenum, ... }
+ *
+ * Updates to the records belonging to a user are serialized using a striped set of locks.
+ */
+struct {
+	TCHDB *ctx;
+	pthread_mutex_t locks[MAGMA_FULLTEXT_LOCKS];
+} fulltext = {
+	.ctx = NULL
+};
+
+/**
+ * @brief	Determine whether the full text search index is available.
+ * @return	true if the index was opened at startup, or false if full text searches need to scan the message content.
+ */
+bool_t fulltext_enabled(void) {
+	return fulltext.ctx != NULL;
+}
+
+static pthread_mutex_t * fulltext_lock(uint64_t usernum) {
+	return &(fulltext.locks[usernum % MAGMA_FULLTEXT_LOCKS]);
+}
+
+// Words are made up of letters, digits and any byte belonging to a multibyte UTF-8 sequence.
+static inline bool_t fulltext_word_char(uchr_t c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+static int fulltext_compare_terms(const void *a, const void *b) {
+	return strcmp(*(chr_t **)a, *(chr_t **)b);
+}
+
+static int fulltext_compare_numbers(const void *a, const void *b) {
+	return *(uint64_t *)a < *(uint64_t *)b ? -1 : *(uint64_t *)a > *(uint64_t *)b ? 1 : 0;
+}
+
+/**
+ * @brief	Split a block of text into lower case words, and append them to a list of terms using the given prefix.
+ * @note	Words longer than MAGMA_FULLTEXT_WORD are skipped, so they never appear in the index and can't be used to narrow a query.
+ * @param	block		a pointer to the text being split.
+ * @param	length		the length, in bytes, of the text.
+ * @param	prefix		the character identifying the part of the message the text was taken from.
+ * @param	bounded		if true, only words with a non-word character on both sides inside the block are kept. Words touching either end
+ * 						of a query may only be part of a longer word in the message, so they can't be looked up in the index.
+ * @param	terms		the array of terms, which will be appended to. Each term is a null-terminated string allocated by this function.
+ * @param	count		a pointer to the number of terms in the array, which will be updated.
+ * @param	limit		the maximum number of terms the array can hold.
+ * @return	true on success, or false if the term limit was reached or a memory allocation failed.
+ */
+static bool_t fulltext_split(uchr_t *block, size_t length, chr_t prefix, bool_t bounded, chr_t **terms, size_t *count, size_t limit) {
+
+	chr_t *term;
+	size_t start, word;
+
+	for (size_t i = 0; i < length;) {
+
+		// Skip ahead to the start of the next word.
+		while (i < length && !fulltext_word_char(block[i])) i++;
+		for (start = i; i < length && fulltext_word_char(block[i]); i++);
+
+		// Words longer than the limit are almost always encoded data, so they aren't worth indexing.
+		if (!(word = i - start) || word > MAGMA_FULLTEXT_WORD || (bounded && (!start || i == length))) {
+			continue;
+		}
+		else if (*count >= limit || !(term = mm_alloc(word + 3))) {
+			return false;
+		}
+
+		term[0] = prefix;
+		term[1] = '.';
+
+		for (size_t j = 0; j < word; j++) {
+			term[j + 2] = lower_chr(block[start + j]);
+		}
+
+		terms[(*count)++] = term;
+	}
+
+	return true;
+}
+
+// Sort the list of terms and release any duplicates. Returns the number of unique terms left at the front of the array.
+static size_t fulltext_unique(chr_t **terms, size_t count) {
+
+	size_t unique = 0;
+
+	qsort(terms, count, sizeof(chr_t *), &fulltext_compare_terms);
+
+	for (size_t i = 0; i < count; i++) {
+		if (unique && !strcmp(terms[unique - 1], terms[i])) {
+			mm_free(terms[i]);
+		}
+		else {
+			terms[unique++] = terms[i];
+		}
+	}
+
+	return unique;
+}
+
+/**
+ * @brief	Add a message number to the posting list for each of the supplied terms, and record the terms under the message.
+ * @note	The caller must be holding the lock for the user.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message.
+ * @param	terms		a block of null-terminated terms, packed end to end.
+ * @param	length		the length, in bytes, of the block of terms.
+ * @return	true on success, or false on failure.
+ */
+static bool_t fulltext_store(uint64_t usernum, uint64_t messagenum, chr_t *terms, size_t length) {
+
+	int_t key_len;
+	chr_t key[MAGMA_FULLTEXT_WORD + 64];
+
+	for (size_t position = 0; position < length; position += ns_length_get(terms + position) + 1) {
+
+		if ((key_len = snprintf(key, sizeof(key), "fulltext.%lu.%s", usernum, terms + position)) <= 0 || key_len >= sizeof(key) ||
+			!tchdbputcat_d(fulltext.ctx, key, key_len, &messagenum, sizeof(uint64_t))) {
+			log_error("Unable to update the full text search index. {tchdbputcat = %s / key = %s}", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)), key);
+			return false;
+		}
+
+	}
+
+	// The message record is written last, so messages are never treated as indexed unless every term was stored.
+	if ((key_len = snprintf(key, sizeof(key), "fulltext.%lu.m.%lu", usernum, messagenum)) <= 0 ||
+		!tchdbputasync_d(fulltext.ctx, key, key_len, terms, length)) {
+		log_error("Unable to store the full text search record for a message. {tchdbputasync = %s / key = %s}", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)), key);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Add a message to the full text search index.
+ * @note	The words found in the header and the body are indexed separately, so body only searches can be answered.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message.
+ * @param	message		a managed string holding the raw message.
+ * @return	true if the message was indexed, or false if the message will need to be scanned by full text searches.
+ */
+bool_t fulltext_index(uint64_t usernum, uint64_t messagenum, stringer_t *message) {
+
+	bool_t result;
+	chr_t **terms, *block;
+	size_t header, count = 0, length = 0;
+
+	if (!fulltext.ctx || !usernum || !messagenum || st_empty(message)) {
+		return false;
+	}
+	else if (!(terms = mm_alloc(sizeof(chr_t *) * MAGMA_FULLTEXT_TERMS))) {
+		log_pedantic("Unable to allocate the full text search term list.");
+		return false;
+	}
+
+	header = mail_header_end(message);
+
+	if (!(result = fulltext_split(st_data_get(message), header, 'h', false, terms, &count, MAGMA_FULLTEXT_TERMS) &&
+		fulltext_split(st_data_get(message) + header, st_length_get(message) - header, 'b', false, terms, &count, MAGMA_FULLTEXT_TERMS))) {
+		log_pedantic("Skipping the full text search index for a message with too many terms. {message = %lu}", messagenum);
+	}
+
+	// Pack the unique terms into a single block, which is also used as the message record.
+	if (result) {
+
+		count = fulltext_unique(terms, count);
+
+		for (size_t i = 0; i < count; i++) {
+			length += ns_length_get(terms[i]) + 1;
+		}
+
+		if ((result = (block = mm_alloc(length + 1)) != NULL)) {
+
+			for (size_t i = 0, position = 0; i < count; i++) {
+				mm_copy(block + position, terms[i], ns_length_get(terms[i]) + 1);
+				position += ns_length_get(terms[i]) + 1;
+			}
+
+			mutex_lock(fulltext_lock(usernum));
+			result = fulltext_store(usernum, messagenum, block, length);
+			mutex_unlock(fulltext_lock(usernum));
+
+			mm_free(block);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		mm_free(terms[i]);
+	}
+
+	mm_free(terms);
+	return result;
+}
+
+/**
+ * @brief	Add the copy of a message to the full text search index, using the terms recorded for the original.
+ * @param	usernum		the numerical id of the user who owns the messages.
+ * @param	original	the numerical id of the message that was copied.
+ * @param	messagenum	the numerical id of the new message.
+ * @return	true if the copy was indexed, or false if the original wasn't indexed or an error occurred.
+ */
+bool_t fulltext_copy(uint64_t usernum, uint64_t original, uint64_t messagenum) {
+
+	int_t key_len, length;
+	bool_t result = false;
+	chr_t key[128], *terms;
+
+	if (!fulltext.ctx || (key_len = snprintf(key, sizeof(key), "fulltext.%lu.m.%lu", usernum, original)) <= 0) {
+		return false;
+	}
+
+	mutex_lock(fulltext_lock(usernum));
+
+	if ((terms = tchdbget_d(fulltext.ctx, key, key_len, &length))) {
+		result = fulltext_store(usernum, messagenum, terms, length);
+		tcfree_d(terms);
+	}
+
+	mutex_unlock(fulltext_lock(usernum));
+
+	return result;
+}
+
+/**
+ * @brief	Remove a message from the full text search index.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message being removed.
+ * @return	This function returns no value.
+ */
+void fulltext_remove(uint64_t usernum, uint64_t messagenum) {
+
+	uint64_t *list;
+	chr_t key[MAGMA_FULLTEXT_WORD + 64], *terms;
+	int_t key_len, record_len, terms_len, length, count;
+
+	if (!fulltext.ctx || (record_len = snprintf(key, sizeof(key), "fulltext.%lu.m.%lu", usernum, messagenum)) <= 0) {
+		return;
+	}
+
+	mutex_lock(fulltext_lock(usernum));
+
+	if (!(terms = tchdbget_d(fulltext.ctx, key, record_len, &terms_len))) {
+		mutex_unlock(fulltext_lock(usernum));
+		return;
+	}
+
+	// Remove the message record first, so searches stop relying on the index for this message.
+	tchdbout_d(fulltext.ctx, key, record_len);
+
+	for (int_t position = 0; position < terms_len; position += ns_length_get(terms + position) + 1) {
+
+		if ((key_len = snprintf(key, sizeof(key), "fulltext.%lu.%s", usernum, terms + position)) <= 0 || key_len >= sizeof(key) ||
+			!(list = tchdbget_d(fulltext.ctx, key, key_len, &length))) {
+			continue;
+		}
+
+		count = length / sizeof(uint64_t);
+
+		// Compact the posting list in place, and drop the record entirely if this was the only message using the term.
+		for (int_t i = 0, j = 0; i < (length / sizeof(uint64_t)); i++) {
+			if (list[i] == messagenum) count--;
+			else list[j++] = list[i];
+		}
+
+		if (!count) {
+			tchdbout_d(fulltext.ctx, key, key_len);
+		}
+		else if (count != length / sizeof(uint64_t) && !tchdbputasync_d(fulltext.ctx, key, key_len, list, count * sizeof(uint64_t))) {
+			log_pedantic("Unable to update the full text search index. {tchdbputasync = %s / key = %s}", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)), key);
+		}
+
+		tcfree_d(list);
+	}
+
+	mutex_unlock(fulltext_lock(usernum));
+
+	tcfree_d(terms);
+	return;
+}
+
+/**
+ * @brief	Determine whether a message has been added to the full text search index.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message.
+ * @return	true if searches can rely on the index for this message, or false if the content needs to be scanned.
+ */
+bool_t fulltext_indexed(uint64_t usernum, uint64_t messagenum) {
+
+	int_t key_len;
+	chr_t key[128];
+
+	if (!fulltext.ctx || (key_len = snprintf(key, sizeof(key), "fulltext.%lu.m.%lu", usernum, messagenum)) <= 0) {
+		return false;
+	}
+
+	return tchdbvsiz_d(fulltext.ctx, key, key_len) >= 0;
+}
+
+/**
+ * @brief	Free a full text search result.
+ * @param	result	the full text search result to be freed.
+ * @return	This function returns no value.
+ */
+void fulltext_result_free(fulltext_result_t *result) {
+
+	if (result) {
+		if (result->messages) mm_free(result->messages);
+		mm_free(result);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a message is a candidate in a full text search result.
+ * @note	Only a message that isn't a candidate can be ruled out. Candidates still need to be scanned for the search string.
+ * @param	result		the full text search result.
+ * @param	messagenum	the numerical id of the message.
+ * @return	true if the message might match the query, or false if it can't.
+ */
+bool_t fulltext_result_contains(fulltext_result_t *result, uint64_t messagenum) {
+
+	return result && result->count && bsearch(&messagenum, result->messages, result->count, sizeof(uint64_t), &fulltext_compare_numbers);
+}
+
+// Load the posting list for a term, and append it to the end of the supplied array.
+static bool_t fulltext_postings(uint64_t usernum, chr_t *term, uint64_t **messages, uint64_t *count) {
+
+	void *list;
+	int_t key_len, length;
+	uint64_t *expanded;
+	chr_t key[MAGMA_FULLTEXT_WORD + 64];
+
+	if ((key_len = snprintf(key, sizeof(key), "fulltext.%lu.%s", usernum, term)) <= 0 || key_len >= sizeof(key)) {
+		return false;
+	}
+	else if (!(list = tchdbget_d(fulltext.ctx, key, key_len, &length))) {
+		return true;
+	}
+	else if (!(expanded = mm_alloc(sizeof(uint64_t) * (*count + (length / sizeof(uint64_t)) + 1)))) {
+		tcfree_d(list);
+		return false;
+	}
+
+	if (*messages) {
+		mm_copy(expanded, *messages, sizeof(uint64_t) * *count);
+		mm_free(*messages);
+	}
+
+	mm_copy(expanded + *count, list, (length / sizeof(uint64_t)) * sizeof(uint64_t));
+	*count += length / sizeof(uint64_t);
+	*messages = expanded;
+
+	tcfree_d(list);
+	return true;
+}
+
+/**
+ * @brief	Find the indexed messages which could contain a query string.
+ * @note	Searches are case insensitive substring matches, so only the query words with a separator on both sides are guaranteed to
+ * 			appear as complete words in a matching message. The result is the set of indexed messages holding all of those words, which
+ * 			is a superset of the real matches. Callers use it to skip the indexed messages which can't match, and must still scan the
+ * 			content of the candidates.
+ * @param	usernum		the numerical id of the user who owns the messages.
+ * @param	query		the text being searched for.
+ * @param	headers		if true, words found in the message header also count as matches.
+ * @return	NULL if the index is unavailable or the query can't be narrowed using the index, otherwise the sorted list of candidate messages.
+ */
+fulltext_result_t * fulltext_query(uint64_t usernum, stringer_t *query, bool_t headers) {
+
+	chr_t **terms;
+	size_t total = 0;
+	bool_t failed = false;
+	fulltext_result_t *result = NULL;
+	uint64_t *messages, count, kept;
+
+	if (!fulltext.ctx || st_empty(query) || !(terms = mm_alloc(sizeof(chr_t *) * MAGMA_FULLTEXT_QUERY))) {
+		return NULL;
+	}
+
+	// A query without any complete words, like "meet" or "bar.co", can't be narrowed using the index.
+	if (fulltext_split(st_data_get(query), st_length_get(query), 'b', true, terms, &total, MAGMA_FULLTEXT_QUERY) && total &&
+		(total = fulltext_unique(terms, total)) && (result = mm_alloc(sizeof(fulltext_result_t)))) {
+
+		for (size_t i = 0; i < total; i++) {
+
+			messages = NULL;
+			count = 0;
+
+			// Collect the body postings for the word, and if requested, the header postings as well.
+			if (!(failed = !fulltext_postings(usernum, terms[i], &messages, &count)) && headers) {
+				terms[i][0] = 'h';
+				failed = !fulltext_postings(usernum, terms[i], &messages, &count);
+			}
+
+			if (failed) {
+				if (messages) mm_free(messages);
+				break;
+			}
+
+			qsort(messages, count, sizeof(uint64_t), &fulltext_compare_numbers);
+
+			// The first word seeds the result, and each word after that removes the messages it wasn't found in.
+			if (!i) {
+				result->messages = messages;
+				result->count = count;
+				messages = NULL;
+			}
+			else {
+
+				for (kept = 0, count = (messages ? count : 0); result->count && kept < result->count;) {
+					if (count && bsearch(&(result->messages[kept]), messages, count, sizeof(uint64_t), &fulltext_compare_numbers)) {
+						kept++;
+					}
+					else {
+						result->messages[kept] = result->messages[--result->count];
+					}
+				}
+
+				qsort(result->messages, result->count, sizeof(uint64_t), &fulltext_compare_numbers);
+			}
+
+			if (messages) mm_free(messages);
+
+			// Once the result is empty, the remaining words can't change the outcome.
+			if (!result->count) {
+				break;
+			}
+		}
+
+		// Remove any duplicates, which occur when a word appears in both the header and the body.
+		for (count = kept = 0; kept < result->count; kept++) {
+			if (!count || result->messages[kept] != result->messages[count - 1]) {
+				result->messages[count++] = result->messages[kept];
+			}
+		}
+
+		result->count = count;
+	}
+
+	// If a posting list couldn't be loaded, the content will need to be scanned instead.
+	if (failed) {
+		fulltext_result_free(result);
+		result = NULL;
+	}
+
+	for (size_t i = 0; i < total; i++) {
+		mm_free(terms[i]);
+	}
+
+	mm_free(terms);
+	return result;
+}
+
+/**
+ * @brief	Open the full text search index.
+ * @note	The index is optional, and is only opened if a location was provided by the configuration.
+ * @return	true on success, or false on failure.
+ */
+bool_t fulltext_start(void) {
+
+	if (!magma.storage.fulltext) {
+		return true;
+	}
+
+	for (int_t i = 0; i < MAGMA_FULLTEXT_LOCKS; i++) {
+		if (mutex_init(&(fulltext.locks[i]), NULL)) {
+			log_critical("Unable to initialize the full text search index locks.");
+			return false;
+		}
+	}
+
+	if (!(fulltext.ctx = tank_open(magma.storage.fulltext))) {
+		log_critical("Unable to open the full text search index. {location = %s}", magma.storage.fulltext);
+		for (int_t i = 0; i < MAGMA_FULLTEXT_LOCKS; i++) {
+			mutex_destroy(&(fulltext.locks[i]));
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Flush and close the full text search index.
+ * @return	This function returns no value.
+ */
+void fulltext_stop(void) {
+
+	if (fulltext.ctx) {
+		tank_close(fulltext.ctx);
+		fulltext.ctx = NULL;
+
+		for (int_t i = 0; i < MAGMA_FULLTEXT_LOCKS; i++) {
+			mutex_destroy(&(fulltext.locks[i]));
+		}
+	}
+
+	return;
+}
@@ -23,6 +23,14 @@
 #define TANK_ENTRY_VERSION 100
 #define TANK_RECORD_VERSION 100
 
+// The longest word added to the full text search index, and the most unique terms indexed for a single message or query.
+#define MAGMA_FULLTEXT_WORD 64
+#define MAGMA_FULLTEXT_TERMS 65536
+#define MAGMA_FULLTEXT_QUERY 64
+
+// The number of locks used to serialize updates to the full text search index.
+#define MAGMA_FULLTEXT_LOCKS 64
+
 enum {
 	TANK_COMPRESS_LZO = 1,
 	TANK_COMPRESS_ZLIB = 2,
@@ -72,6 +80,11 @@ typedef struct {
 
 } __attribute__ ((packed)) entry_t;
 
+typedef struct {
+	uint64_t count; /*!< The number of candidate messages. */
+	uint64_t *messages; /*!< The sorted list of indexed messages which could match the query. */
+} fulltext_result_t;
+
 
 bool_t lib_load_tokyo(void);
 const chr_t * lib_version_tokyo(void);
@@ -83,6 +96,8 @@ inx_t * tree_alloc(uint64_t options, void *data_free);
 //! Startup and shutdown.
 void tank_stop(void);
 bool_t tank_start(void);
+TCHDB * tank_open(char *location);
+void tank_close(TCHDB *ctx);
 
 //! Info functions.
 uint64_t tank_size(void);
@@ -101,5 +116,17 @@ uint64_t tank_store(uint64_t hnum, uint64_t tnum, uint64_t unum, stringer_t *dat
 bool_t tank_delete_object(int64_t transaction, uint64_t hnum, uint64_t tnum, uint64_t unum, uint64_t onum);
 uint64_t tank_insert_object(int64_t transaction, uint64_t hnum, uint64_t tnum, uint64_t unum, uint64_t size, uint64_t flags);
 
+//! Full text search index.
+void fulltext_stop(void);
+bool_t fulltext_start(void);
+bool_t fulltext_enabled(void);
+bool_t fulltext_index(uint64_t usernum, uint64_t messagenum, stringer_t *message);
+bool_t fulltext_copy(uint64_t usernum, uint64_t original, uint64_t messagenum);
+void fulltext_remove(uint64_t usernum, uint64_t messagenum);
+bool_t fulltext_indexed(uint64_t usernum, uint64_t messagenum);
+fulltext_result_t * fulltext_query(uint64_t usernum, stringer_t *query, bool_t headers);
+bool_t fulltext_result_contains(fulltext_result_t *result, uint64_t messagenum);
+void fulltext_result_free(fulltext_result_t *result);
+
 #endif
 
@@ -62,6 +62,9 @@ int (*cl_engine_set_num_d)(struct cl_engine *engine, enum cl_engine_field field,
 int (*cl_engine_set_str_d)(struct cl_engine *engine, enum cl_engine_field field, const char *str) __attribute__ ((common)) = NULL;
 int (*cl_load_d)(const char *path, struct cl_engine *engine, unsigned int *signo, unsigned int dboptions) __attribute__ ((common)) = NULL;
 int (*cl_scandesc_d)(int desc, const char **virname, unsigned long int *scanned, const struct cl_engine *engine, unsigned int scanoptions) __attribute__ ((common)) = NULL;
+void (*cl_fmap_close_d)(cl_fmap_t *map) __attribute__ ((common)) = NULL;
+cl_fmap_t * (*cl_fmap_open_memory_d)(const void *start, size_t len) __attribute__ ((common)) = NULL;
+int (*cl_scanmap_callback_d)(cl_fmap_t *map, const char **virname, unsigned long int *scanned, const struct cl_engine *engine, unsigned int scanoptions, void *context) __attribute__ ((common)) = NULL;
 
 //! DSPAM
 const char * (*dspam_version_d)(void) __attribute__ ((common)) = NULL;
@@ -220,6 +223,7 @@ int (*EC_KEY_check_key_d)(const EC_KEY *key) __attribute__ ((common)) = NULL;
 int (*EVP_MD_CTX_cleanup_d)(EVP_MD_CTX *ctx) __attribute__ ((common)) = NULL;
 void (*ERR_remove_state_d)(unsigned long pid) __attribute__ ((common)) = NULL;
 int 	(*SSL_peek_d)(SSL *ssl,void *buf,int num) __attribute__ ((common)) = NULL;
+int (*SSL_pending_d)(const SSL *ssl) __attribute__ ((common)) = NULL;
 X509_NAME *	(*X509_get_subject_name_d)(X509 *a) __attribute__ ((common)) = NULL;
 EC_KEY * (*EC_KEY_new_by_curve_name_d)(int nid) __attribute__ ((common)) = NULL;
 int (*BN_hex2bn_d)(BIGNUM **a, const char *str) __attribute__ ((common)) = NULL;
@@ -357,6 +361,8 @@ bool (*tchdbtune_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t
 bool (*tchdboptimize_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts) __attribute__ ((common)) = NULL;
 bool (*tcndbputkeep_d)(TCNDB *ndb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) __attribute__ ((common)) = NULL;
 bool (*tchdbputasync_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) __attribute__ ((common)) = NULL;
+bool (*tchdbputcat_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) __attribute__ ((common)) = NULL;
+int (*tchdbvsiz_d)(TCHDB *hdb, const void *kbuf, int ksiz) __attribute__ ((common)) = NULL;
 bool (*tcndbgetboth_d)(TCNDB *ndb, const void *kbuf, int ksiz, void **rkbuf, int *rksiz, void **rvbuf, int *rvsiz) __attribute__ ((common)) = NULL;
 
 //! Jansson
@@ -66,6 +66,12 @@
 #define INSERT_MESSAGE_DUPLICATE "INSERT INTO Messages (usernum, foldernum, server, status, size, signum, sigkey, created) VALUES (?, ?, ?, ?, ?, ?, ?, FROM_UNIXTIME(?))"
 #define DELETE_MESSAGE "DELETE FROM Messages WHERE messagenum = ? AND usernum = ?"
 
+// Message Changes table
+#define SELECT_MESSAGE_CHANGES "SELECT Message_Changes.messagenum, Messages.foldernum, Messages.server, Messages.status, Messages.size, Messages.signum, Messages.sigkey, UNIX_TIMESTAMP(Messages.created), Messages.visible, Message_Changes.changenum FROM Message_Changes LEFT JOIN Messages ON Message_Changes.messagenum = Messages.messagenum WHERE Message_Changes.usernum = ? AND (Message_Changes.changenum > ? OR Message_Changes.timestamp >= FROM_UNIXTIME(?)) ORDER BY Message_Changes.changenum ASC"
+#define SELECT_MESSAGE_CHANGES_CHECKPOINT "SELECT IFNULL(MAX(changenum), 0) FROM Message_Changes WHERE usernum = ?"
+#define INSERT_MESSAGE_CHANGE "INSERT INTO Message_Changes (usernum, messagenum, timestamp) SELECT usernum, messagenum, NOW() FROM Messages WHERE messagenum = ?"
+#define INSERT_MESSAGE_CHANGES_SIGNATURE "INSERT INTO Message_Changes (usernum, messagenum, timestamp) SELECT usernum, messagenum, NOW() FROM Messages WHERE usernum = ? AND signum = ?"
+
 // Message Tags table
 #define SELECT_ALL_MESSAGE_TAGS "SELECT DISTINCT tag from Message_Tags LEFT JOIN Messages ON Message_Tags.messagenum = Messages.messagenum"
 #define DELETE_MESSAGE_TAGS "DELETE FROM Message_Tags WHERE messagenum = ?"
@@ -113,6 +119,7 @@
 
 // Message Folders
 #define SELECT_MESSAGE_FOLDER "SELECT messagenum, UNIX_TIMESTAMP(created), signum, sigkey, status, server, size FROM Messages WHERE usernum = ? AND foldernum = ? AND visible = 1 ORDER BY messagenum ASC"
+#define SELECT_MESSAGE_FOLDERS "SELECT foldernum, messagenum, UNIX_TIMESTAMP(created), signum, sigkey, status, server, size FROM Messages WHERE usernum = ? AND visible = 1 ORDER BY messagenum ASC"
 
 // User Config
 #define UPSERT_USER_CONFIG "INSERT INTO `User_Config` (`usernum`, `key`, `value`, `flags`, `timestamp`) VALUES (?, ?, ?, ?, NOW()) ON DUPLICATE KEY UPDATE `value` = VALUES(`value`), `flags` = VALUES(`flags`)"
@@ -192,6 +199,10 @@
 											INSERT_MESSAGE, \
 											INSERT_MESSAGE_DUPLICATE, \
 											DELETE_MESSAGE, \
+											SELECT_MESSAGE_CHANGES, \
+											SELECT_MESSAGE_CHANGES_CHECKPOINT, \
+											INSERT_MESSAGE_CHANGE, \
+											INSERT_MESSAGE_CHANGES_SIGNATURE, \
 											SELECT_ALL_MESSAGE_TAGS, \
 											DELETE_MESSAGE_TAGS, \
 											SELECT_MESSAGE_TAGS, \
@@ -222,6 +233,7 @@
 											SELECT_CONTACT_DETAILS, \
 											DELETE_CONTACT_DETAILS, \
 											SELECT_MESSAGE_FOLDER, \
+											SELECT_MESSAGE_FOLDERS, \
 											UPSERT_USER_CONFIG, \
 											SELECT_USER_CONFIG, \
 											DELETE_USER_CONFIG, \
@@ -284,6 +296,10 @@
 											**insert_message, \
 											**insert_message_duplicate, \
 											**delete_message, \
+											**select_message_changes, \
+											**select_message_changes_checkpoint, \
+											**insert_message_change, \
+											**insert_message_changes_signature, \
 											**select_all_message_tags, \
 											**delete_message_tags, \
 											**select_message_tags, \
@@ -314,6 +330,7 @@
 											**select_contact_details, \
 											**delete_contact_details, \
 											**select_message_folder, \
+											**select_message_folders, \
 											**upsert_user_config, \
 											**select_user_config, \
 											**delete_user_config, \
@@ -35,6 +35,8 @@ void http_free_content(http_content_t *page) {
 		st_cleanup(page->location);
 		st_cleanup(page->resource);
 		st_cleanup(page->type);
+		st_cleanup(page->gzip);
+		http_template_free(page->compiled);
 		mm_free(page);
 	}
 
@@ -47,18 +49,24 @@ void http_free_content(http_content_t *page) {
  */
 void http_page_free(http_page_t *page) {
 
+	http_property_t *property;
+
 	if (page) {
 
-		if (page->xpath_ctx) {
-			xml_free_xpath_ctx(page->xpath_ctx);
-		}
-		if (page->doc_obj) {
-			xml_free_doc(page->doc_obj);
-		}
-		if (page->doc_ctx) {
-			xml_free_parser_ctx(page->doc_ctx);
+		for (uint32_t i = 0; page->changes && i < page->content->compiled->count; i++) {
+
+			st_cleanup(page->changes[i].content);
+			st_cleanup(page->changes[i].sibling);
+
+			while ((property = page->changes[i].properties)) {
+				page->changes[i].properties = (http_property_t *)property->next;
+				st_cleanup(property->name);
+				st_cleanup(property->value);
+				mm_free(property);
+			}
 		}
 
+		mm_cleanup(page->changes);
 		mm_free(page);
 	}
 	return;
@@ -97,8 +105,8 @@ http_content_t * http_get_template(chr_t *location) {
 }
 
 /**
- * @brief	Get a template page and prepare its xml document root for use.
- * @note	Each page is affixed with an xpath with a namespace after passing through the xml parser.
+ * @brief	Get a template page that can be modified and rendered for a single request.
+ * @note	The page shares the compiled template, and only records the changes made to it, so no parsing happens here.
  * @param	location	a pointer to a null-terminated string with the pathname of the template to be returned.
  * @return	NULL on failure, or a pointer to the http page object of the requested template.
  */
@@ -114,31 +122,40 @@ http_page_t * http_page_get(chr_t *location) {
 		http_page_free(page);
 		return NULL;
 	}
-	else if ((page->doc_ctx = xml_create_parser_ctx()) == NULL) {
-		log_pedantic("Could not create the parser context.");
+	else if (!page->content->compiled) {
+		log_pedantic("The requested template was not compiled. {location = %s}", location);
 		http_page_free(page);
 		return NULL;
 	}
-	// Build the document object.
-	else if ((page->doc_obj = xml_create_doc(page->doc_ctx, st_char_get(page->content->resource), st_length_get(page->content->resource), NULL, NULL,
-		XML_PARSE_RECOVER + XML_PARSE_NOERROR + XML_PARSE_NOWARNING)) == NULL) {
-		log_pedantic("Could not load the XML document. {location = %s}", location);
-		http_page_free(page);
-		return NULL;
+
+	return page;
+}
+
+/**
+ * @brief	Prepare the entity tag and the precompressed variant used to serve a static resource.
+ * @note	Only text resources are compressed, and the gzip variant is discarded unless it saves at least a tenth of the original size.
+ * 			A resource without a variant is simply always sent uncompressed.
+ * @param	resource	a pointer to the static resource.
+ * @return	This function returns no value.
+ */
+void http_content_variants(http_content_t *resource) {
+
+	resource->hash = hash_murmur64(st_data_get(resource->resource), st_length_get(resource->resource));
+
+	if (st_cmp_ci_starts(resource->type, PLACER("text/", 5)) && st_cmp_ci_eq(resource->type, PLACER("application/json", 16)) &&
+		st_cmp_ci_eq(resource->type, PLACER("application/x-javascript", 24))) {
+		return;
 	}
-	else if ((page->xpath_ctx = xml_create_xpath_ctx(page->doc_obj)) == NULL) {
-		log_pedantic("Could not create the XPATH context.");
-		http_page_free(page);
-		return NULL;
+	else if (!(resource->gzip = compress_gzip(resource->resource))) {
+		log_pedantic("Unable to compress a static resource. { location = %.*s }", st_length_int(resource->location), st_char_get(resource->location));
+		return;
 	}
-	// We need to set the default namespace or our Xpath queries won't work.
-	else if (xml_xpath_set_namespace(page->xpath_ctx, (uchr_t *)"xhtml", (uchr_t *)"http://www.w3.org/1999/xhtml") != 0) {
-		log_pedantic("Could not create the XPATH context.");
-		http_page_free(page);
-		return NULL;
+	else if (st_length_get(resource->gzip) * 10 > st_length_get(resource->resource) * 9) {
+		st_free(resource->gzip);
+		resource->gzip = NULL;
 	}
 
-	return page;
+	return;
 }
 
 /**
@@ -261,11 +278,23 @@ bool_t http_load_file(int_t template, chr_t *filename) {
 		return false;
 	}
 
+	// Templates are compiled as they're loaded, so pages can be rendered without parsing them again.
+	if (template == 1 && !(resource->compiled = http_template_compile(resource->resource))) {
+		log_pedantic("Unable to compile the template. { file = %s }", filename);
+		http_free_content(resource);
+		return false;
+	}
+
 	// Trim the extension off the static HTML files and web application templates.
 	if (template == 1 && !st_cmp_ci_ends(NULLER(filename), PLACER(".template", 9))) {
 		st_length_set(resource->location, st_length_get(resource->location) - 9);
 	}
 
+	// Static resources are served straight from the repository, so their validators and compressed variants are prepared up front.
+	if (template == 0) {
+		http_content_variants(resource);
+	}
+
 	// Catch index pages.
 	if (template == 0 && !st_cmp_ci_ends(NULLER(filename), PLACER("/index.html", 11))) {
 
@@ -279,6 +308,7 @@ bool_t http_load_file(int_t template, chr_t *filename) {
 
 		// Trim the index.html from the location.
 		st_length_set(index->location, st_length_get(index->location) - 10);
+		http_content_variants(index);
 
 		// Insert the page into the content cache.
 		if (!(key.val.st = index->location) || inx_insert(content.pages, key, index) != 1) {
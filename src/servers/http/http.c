@@ -40,8 +40,13 @@ void http_requeue(connection_t *con) {
 	else if (con->http.mode == HTTP_PARSE_PAIRS) {
 		requeue(&http_parse_pairs, &http_requeue, con);
 	}
+	// Keep-alive connections are parked until the next request arrives, unless the client already pipelined it, in which case the
+	// parking function hands the connection straight back to the processor. Idle keep-alive connections are dropped once the keep-alive
+	// timeout expires.
 	else if (con->http.mode == HTTP_COMPLETE) {
-		requeue(&http_session_reset, &http_process, con);
+		http_session_reset(con);
+		con->network.park.timeout = magma.http.keepalive_timeout;
+		con_park(con, &http_process);
 	}
 	else if (con->http.mode == HTTP_ERROR_501) {
 		requeue(&http_print_501, &http_close, con);
@@ -78,7 +83,8 @@ void http_requeue(connection_t *con) {
 void http_body(connection_t *con) {
 
 	http_data_t *data;
-	size_t read, length;
+	int64_t read;
+	size_t length, remaining;
 
 	// Get the content length.
 	if (!(data = http_data_get(con, HTTP_DATA_HEADER, "Content-Length")) || size_conv_bl(st_data_get(data->value),
@@ -102,9 +108,13 @@ void http_body(connection_t *con) {
 		con->http.body = st_alloc_opts(MAPPED_T | HEAP | JOINTED, length);
 	}
 
-	// There should be more data for us to read.
+	// There should be more data for us to read. Only the bytes belonging to this body are consumed, and the line marker is pointed at them so
+	// anything following, like a pipelined request, is preserved for the next read.
 	if (length && (!con->http.body || st_length_get(con->http.body) < length) && (read = con_read(con)) > 0) {
-		con->http.body = st_append_opts(32768, con->http.body, con->network.buffer);
+		remaining = length - (con->http.body ? st_length_get(con->http.body) : 0);
+		read = (size_t)read > remaining ? remaining : (size_t)read;
+		con->http.body = st_append_opts(32768, con->http.body, PLACER(st_data_get(con->network.buffer), read));
+		con->network.line = pl_init(st_data_get(con->network.buffer), read);
 	}
 
 	// When were done reading the body reset the mode to respond and the requeue function will route accordingly.
@@ -140,8 +150,10 @@ void http_process(connection_t *con) {
 		enqueue(&http_close, con);
 		return;
 	}
+	// Between requests the keep-alive timeout applies, while a client in the middle of sending a request gets the server timeout.
 	else if (pl_empty(con->network.line)) {
-		enqueue(&http_process, con);
+		con->network.park.timeout = con->http.mode == HTTP_READY ? magma.http.keepalive_timeout : 0;
+		con_park(con, &http_process);
 		return;
 	}
 
@@ -55,6 +55,7 @@ bool_t            http_content_load_fonts(void);
 bool_t            http_content_refresh(void);
 bool_t            http_content_start(void);
 void              http_content_stop(void);
+void              http_content_variants(http_content_t *resource);
 void              http_free_content(http_content_t *page);
 http_content_t *  http_get_static(stringer_t *location);
 http_content_t *  http_get_template(chr_t *location);
@@ -100,15 +101,36 @@ bool_t	 multipart_get_boundary(connection_t *con, placer_t *output);
 
 /// response.c
 void          http_response(connection_t *con);
+bool_t        http_response_accepts(connection_t *con, chr_t *coding);
 stringer_t *  http_response_allow_cross(connection_t *con);
 stringer_t *  http_response_connection(connection_t *con, int_t force);
 stringer_t *  http_response_cookie(connection_t *con);
 void          http_response_header(connection_t *con, int_t status, stringer_t *type, size_t len);
+void          http_response_header_opts(connection_t *con, int_t status, stringer_t *type, size_t len, stringer_t *extra);
+bool_t        http_response_matches(connection_t *con, stringer_t *etag);
 void          http_response_options(connection_t *con);
+void          http_response_static(connection_t *con, http_content_t *content);
 chr_t *       http_response_status(int_t status);
 
 /// sessions.c
 void   http_session_destroy(connection_t *con);
 void   http_session_reset(connection_t *con);
 
+/// templates.c
+bool_t               http_page_add_sibling(http_page_t *page, chr_t *id, chr_t *element, chr_t *sibling, chr_t *content);
+int64_t              http_page_change(http_page_t *page, chr_t *id);
+stringer_t *         http_page_escape(chr_t *value);
+stringer_t *         http_page_render(http_page_t *page);
+bool_t               http_page_render_copy(stringer_t *output, void *data, size_t length);
+bool_t               http_page_render_range(http_page_t *page, stringer_t *output, size_t from, size_t to, uint32_t first, uint32_t last);
+bool_t               http_page_render_tag(stringer_t *output, chr_t *text, http_slot_t *slot, http_change_t *change);
+bool_t               http_page_set_content(http_page_t *page, chr_t *id, chr_t *value);
+bool_t               http_page_set_property(http_page_t *page, chr_t *id, chr_t *name, chr_t *value);
+bool_t               http_page_set_uint64(http_page_t *page, chr_t *id, uint64_t value);
+bool_t               http_template_attribute(chr_t *tag, size_t length, size_t *offset, placer_t *name, placer_t *value);
+http_template_t *    http_template_compile(stringer_t *text);
+int64_t              http_template_find(http_template_t *compiled, chr_t *id);
+void                 http_template_free(http_template_t *compiled);
+int64_t              http_template_scan(chr_t *text, size_t length, http_slot_t *slots, uint32_t *stack);
+
 #endif
@@ -367,6 +367,21 @@ void http_response_options(connection_t *con) {
  * @return	This function returns no value.
  */
 void http_response_header(connection_t *con, int_t status, stringer_t *type, size_t len) {
+	http_response_header_opts(con, status, type, len, NULL);
+	return;
+}
+
+/**
+ * @brief	Send a full set of http response headers to the remote client, along with any additional caller supplied header fields.
+ * @note	If the mode is HTTP_RESPOND it will be changed to HTTP_COMPLETE, to tell the http requeue function to reset the context and enqueue request processor.
+ * @param	con		a pointer to the connection object across which the response will be sent.
+ * @param	status	an integer containing the http status code for the response.
+ * @param	type	a managed string containing the value of the Content-Type header.
+ * @param	len		the value of the Content-Length header.
+ * @param	extra	an optional managed string holding complete header lines, each terminated by a CRLF, to be included in the response.
+ * @return	This function returns no value.
+ */
+void http_response_header_opts(connection_t *con, int_t status, stringer_t *type, size_t len, stringer_t *extra) {
 
 	stringer_t *cookie = NULL, *allow = NULL, *connection = NULL;
 
@@ -395,6 +410,7 @@ void http_response_header(connection_t *con, int_t status, stringer_t *type, siz
 		"Content-Type: %.*s\r\n" \
 		"Content-Length: %zu\r\n" \
 		"%.*s" \
+		"%.*s" \
 		"\r\n",
 		status, http_response_status(status),
 		st_char_get(time_print_gmt(MANAGEDBUF(128), "%a, %d %b %Y %T %Z", time(NULL))),
@@ -402,6 +418,7 @@ void http_response_header(connection_t *con, int_t status, stringer_t *type, siz
 		(cookie ? st_length_int(cookie) : 0), (cookie ? st_char_get(cookie) : NULL),
 		st_length_int(type), st_char_get(type),
 		len,
+		(extra ? st_length_int(extra) : 0), (extra ? st_char_get(extra) : NULL),
 		(connection ? st_length_int(connection) : 0),	(connection ? st_char_get(connection) : NULL));
 
 	st_cleanup(allow);
@@ -411,6 +428,131 @@ void http_response_header(connection_t *con, int_t status, stringer_t *type, siz
 	return;
 }
 
+/**
+ * @brief	Determine whether the client will accept a response using the specified content coding.
+ * @note	The Accept-Encoding header is a comma separated list of codings, each with an optional quality value. A coding listed with a
+ * 			quality of zero is explicitly refused, and the "*" wildcard applies to any coding not listed by name.
+ * @param	con		the client connection which made the request.
+ * @param	coding	a null-terminated string holding the name of the content coding, like "gzip".
+ * @return	true if the client indicated the coding is acceptable, or false if it wasn't mentioned or was refused.
+ */
+bool_t http_response_accepts(connection_t *con, chr_t *coding) {
+
+	http_data_t *field;
+	chr_t *cursor, *end, *token, *params;
+	int_t named = -1, wildcard = -1, quality;
+
+	if (!(field = http_data_get(con, HTTP_DATA_HEADER, "Accept-Encoding")) || st_empty(field->value)) {
+		return false;
+	}
+
+	cursor = st_char_get(field->value);
+	end = cursor + st_length_get(field->value);
+
+	while (cursor < end) {
+
+		// Isolate the next list element, and skip any leading whitespace.
+		for (token = cursor; cursor < end && *cursor != ','; cursor++);
+		for (; token < cursor && chr_whitespace(*token); token++);
+
+		// Split off the parameters. The quality value defaults to one, and any value which is all zeros, like "0" or "0.000", is a refusal.
+		for (params = token; params < cursor && *params != ';' && !chr_whitespace(*params); params++);
+
+		quality = 1;
+		for (chr_t *q = params; q < cursor; q++) {
+			if ((*q == 'q' || *q == 'Q') && q + 1 < cursor && *(q + 1) == '=') {
+				for (q += 2; q < cursor && (*q == '0' || *q == '.'); q++);
+				quality = (q < cursor && *q >= '1' && *q <= '9') ? 1 : 0;
+				break;
+			}
+		}
+
+		if (params - token == ns_length_get(coding) && !st_cmp_ci_eq(PLACER(token, params - token), NULLER(coding))) {
+			named = quality;
+		}
+		else if (params - token == 1 && *token == '*') {
+			wildcard = quality;
+		}
+
+		cursor++;
+	}
+
+	return named != -1 ? (named == 1) : (wildcard == 1);
+}
+
+/**
+ * @brief	Determine whether any of the entity tags in the If-None-Match request header matches the current representation.
+ * @note	Weak comparison is used, as the specification requires for If-None-Match, so a "W/" prefix on a client supplied tag is ignored.
+ * @param	con		the client connection which made the request.
+ * @param	etag	a managed string holding the quoted entity tag of the representation which would be sent.
+ * @return	true if the client already holds the representation, or false if it must be sent.
+ */
+bool_t http_response_matches(connection_t *con, stringer_t *etag) {
+
+	http_data_t *field;
+	chr_t *cursor, *end, *token, *stop;
+
+	if (!(field = http_data_get(con, HTTP_DATA_HEADER, "If-None-Match")) || st_empty(field->value)) {
+		return false;
+	}
+
+	cursor = st_char_get(field->value);
+	end = cursor + st_length_get(field->value);
+
+	while (cursor < end) {
+
+		for (token = cursor; cursor < end && *cursor != ','; cursor++);
+		for (; token < cursor && chr_whitespace(*token); token++);
+		for (stop = cursor; stop > token && chr_whitespace(*(stop - 1)); stop--);
+
+		if (stop - token >= 2 && (*token == 'W' || *token == 'w') && *(token + 1) == '/') {
+			token += 2;
+		}
+
+		if ((stop - token == 1 && *token == '*') || !st_cmp_cs_eq(PLACER(token, stop - token), etag)) {
+			return true;
+		}
+
+		cursor++;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Send a static resource from the content repository.
+ * @note	The precompressed gzip variant is sent whenever the client accepts it. Each variant has its own strong entity tag, and a client
+ * 			which already holds the selected variant is sent a 304 without a body.
+ * @param	con			the client connection which requested the resource.
+ * @param	content		the static resource being requested.
+ * @return	This function returns no value.
+ */
+void http_response_static(connection_t *con, http_content_t *content) {
+
+	stringer_t *body = content->resource, *etag, *extra;
+	bool_t gzip = content->gzip && http_response_accepts(con, "gzip");
+
+	if (gzip) {
+		body = content->gzip;
+	}
+
+	etag = st_quick(MANAGEDBUF(64), "\"%016lx%s\"", content->hash, gzip ? "-gzip" : "");
+
+	// Only resources with a compressed variant depend on the Accept-Encoding header, so only they need the Vary header.
+	extra = st_quick(MANAGEDBUF(256), "ETag: %.*s\r\n%s%s", st_length_int(etag), st_char_get(etag),
+		content->gzip ? "Vary: Accept-Encoding\r\n" : "", gzip ? "Content-Encoding: gzip\r\n" : "");
+
+	if (http_response_matches(con, etag)) {
+		http_response_header_opts(con, 304, content->type, st_length_get(body), extra);
+	}
+	else {
+		http_response_header_opts(con, 200, content->type, st_length_get(body), extra);
+		con_write_st(con, body);
+	}
+
+	return;
+}
+
 /**
  * @brief	Make a response to an http client request.
  * @note	The following http methods aren't supported: PUT, DELETE, HEAD, TRACE, and CONNECT.
@@ -448,8 +590,7 @@ void http_response(connection_t *con) {
 
 	// We check this list first so that static resources take precedence. This allows for static content to be served using dynamic application paths.
 	else if ((content = http_get_static(con->http.location))) {
-		http_response_header(con, 200, content->type, st_length_get(content->resource));
-		con_write_st(con, content->resource);
+		http_response_static(con, content);
 	}
 	// A special case: upload through the portal.
 	else if (!st_cmp_cs_starts(con->http.location, NULLER("/portal/camel/attach/"))) {
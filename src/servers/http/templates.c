@@ -0,0 +1,571 @@
+/**
+ * @file /magma/servers/http/templates.c
+ *
+ * @brief	Functions used to compile the web application templates, and to render pages from them without an XML parser.
+ *
+ * @note	Templates are compiled once, when the web content is loaded, into their original text and a list of slots, one for each
+ * 			element with an id attribute. A page only records the changes made to those slots, and rendering it copies the text
+ * 			between the slots verbatim while substituting the changes. The shared template is never modified.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Read the next attribute from an element's start tag.
+ * @param	tag		a pointer to the start tag.
+ * @param	length	the length, in bytes, of the start tag.
+ * @param	offset	a pointer to the current position inside the tag, which will be advanced past the attribute.
+ * @param	name	a pointer to a placer that will receive the attribute name.
+ * @param	value	a pointer to a placer that will receive the attribute value, without its quotes.
+ * @return	true if an attribute was found, or false if the end of the tag was reached.
+ */
+bool_t http_template_attribute(chr_t *tag, size_t length, size_t *offset, placer_t *name, placer_t *value) {
+
+	chr_t quote;
+	size_t start, pos = *offset;
+
+	while (pos < length && chr_whitespace(tag[pos])) {
+		pos++;
+	}
+
+	if (pos >= length || tag[pos] == '>' || tag[pos] == '/') {
+		*offset = pos;
+		return false;
+	}
+
+	for (start = pos; pos < length && tag[pos] != '=' && tag[pos] != '>' && tag[pos] != '/' && !chr_whitespace(tag[pos]); pos++);
+	*name = pl_init(tag + start, pos - start);
+	*offset = pos;
+
+	while (pos < length && chr_whitespace(tag[pos])) {
+		pos++;
+	}
+
+	// XHTML requires attribute values, but a bare name is treated as an empty value instead of an error. The offset is left at the
+	// end of the name, so the whitespace following it isn't considered part of the attribute.
+	if (pos >= length || tag[pos] != '=') {
+		*value = pl_init(tag + *offset, 0);
+		return true;
+	}
+
+	for (pos++; pos < length && chr_whitespace(tag[pos]); pos++);
+
+	if (pos < length && (tag[pos] == '"' || tag[pos] == '\'')) {
+		quote = tag[pos++];
+		for (start = pos; pos < length && tag[pos] != quote; pos++);
+		*value = pl_init(tag + start, pos - start);
+		*offset = pos < length ? pos + 1 : pos;
+	}
+	else {
+		for (start = pos; pos < length && tag[pos] != '>' && !chr_whitespace(tag[pos]); pos++);
+		*value = pl_init(tag + start, pos - start);
+		*offset = pos;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Scan the text of a template for elements with an id attribute.
+ * @note	The scan is performed twice, first without any output buffers to count the slots, and then again to record them.
+ * @param	text	a pointer to the template text.
+ * @param	length	the length, in bytes, of the template text.
+ * @param	slots	a pointer to an array that will receive the slots, or NULL to only count them.
+ * @param	stack	a pointer to a scratch array, with one entry per slot, used to track the open slots, or NULL to only count them.
+ * @return	-1 if the template isn't well formed, or the number of slots found.
+ */
+int64_t http_template_scan(chr_t *text, size_t length, http_slot_t *slots, uint32_t *stack) {
+
+	chr_t *found;
+	int64_t count = 0;
+	placer_t id, name, value;
+	uint32_t depth = 0, open = 0;
+	size_t pos = 0, tag, offset, close;
+
+	while (pos < length && (found = memchr(text + pos, '<', length - pos))) {
+
+		tag = found - text;
+
+		// Comments, character data, processing instructions and the document type are copied verbatim.
+		if (length - tag >= 4 && !mm_cmp_cs_eq(found, "<!--", 4)) {
+			if (!(found = memmem(text + tag + 4, length - tag - 4, "-->", 3))) return -1;
+			pos = (found - text) + 3;
+		}
+		else if (length - tag >= 9 && !mm_cmp_cs_eq(found, "<![CDATA[", 9)) {
+			if (!(found = memmem(text + tag + 9, length - tag - 9, "]]>", 3))) return -1;
+			pos = (found - text) + 3;
+		}
+		else if (length - tag >= 2 && !mm_cmp_cs_eq(found, "<?", 2)) {
+			if (!(found = memmem(text + tag + 2, length - tag - 2, "?>", 2))) return -1;
+			pos = (found - text) + 2;
+		}
+		else if (length - tag >= 2 && !mm_cmp_cs_eq(found, "<!", 2)) {
+			if (!(found = memchr(text + tag + 2, '>', length - tag - 2))) return -1;
+			pos = (found - text) + 1;
+		}
+		// An end tag, which also closes the innermost slot if that slot was opened at this depth.
+		else if (length - tag >= 2 && text[tag + 1] == '/') {
+
+			if (!depth-- || !(found = memchr(text + tag + 2, '>', length - tag - 2))) return -1;
+			pos = (found - text) + 1;
+
+			if (open && slots[stack[open - 1]].depth == depth) {
+				open--;
+				slots[stack[open]].close = tag;
+				slots[stack[open]].end = pos;
+				slots[stack[open]].skip = count;
+			}
+		}
+		// A start tag, which is scanned one attribute at a time so quoted angle brackets don't end it early.
+		else {
+
+			for (offset = tag + 1; offset < length && text[offset] != '>' && text[offset] != '/' && !chr_whitespace(text[offset]); offset++);
+			close = offset - tag - 1;
+			id = pl_init(NULL, 0);
+
+			while (http_template_attribute(text, length, &offset, &name, &value)) {
+				if (pl_length_get(name) == 2 && !mm_cmp_cs_eq(pl_char_get(name), "id", 2)) {
+					id = value;
+				}
+			}
+
+			if (offset >= length || !close) return -1;
+			else if (text[offset] == '/' && (offset + 1 >= length || text[offset + 1] != '>')) return -1;
+
+			pos = offset + (text[offset] == '/' ? 2 : 1);
+
+			if (pl_length_get(id) && slots) {
+				slots[count].name = close;
+				slots[count].start = tag;
+				slots[count].open = pos;
+				slots[count].depth = depth;
+				slots[count].id = id;
+			}
+
+			if (text[offset] == '/') {
+				if (pl_length_get(id) && slots) {
+					slots[count].close = slots[count].end = pos;
+					slots[count].skip = count + 1;
+				}
+			}
+			else {
+				if (pl_length_get(id) && slots) {
+					stack[open++] = count;
+				}
+				depth++;
+			}
+
+			if (pl_length_get(id)) {
+				count++;
+			}
+		}
+	}
+
+	if (depth || open) {
+		return -1;
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Free a compiled template.
+ * @param	compiled	a pointer to the compiled template to be freed.
+ * @return	This function returns no value.
+ */
+void http_template_free(http_template_t *compiled) {
+
+	if (compiled) {
+		mm_cleanup(compiled->slots);
+		mm_free(compiled);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Compile a template into the list of slots used to render pages from it.
+ * @note	The slot ids point into the template text, so the text must outlive the compiled template.
+ * @param	text	a managed string containing the template text.
+ * @return	NULL on failure, or a pointer to the compiled template on success.
+ */
+http_template_t * http_template_compile(stringer_t *text) {
+
+	int64_t count;
+	uint32_t *stack = NULL;
+	http_template_t *compiled;
+
+	if ((count = http_template_scan(st_char_get(text), st_length_get(text), NULL, NULL)) < 0) {
+		log_pedantic("The template is not well formed.");
+		return NULL;
+	}
+	else if (!(compiled = mm_alloc(sizeof(http_template_t))) || (count && (!(compiled->slots = mm_alloc(sizeof(http_slot_t) * count)) ||
+		!(stack = mm_alloc(sizeof(uint32_t) * count))))) {
+		log_pedantic("Unable to allocate memory for the compiled template. {slots = %li}", count);
+		http_template_free(compiled);
+		return NULL;
+	}
+
+	compiled->count = http_template_scan(st_char_get(text), st_length_get(text), compiled->slots, stack);
+	mm_cleanup(stack);
+
+	return compiled;
+}
+
+/**
+ * @brief	Find the slot for an element in a compiled template.
+ * @param	compiled	a pointer to the compiled template.
+ * @param	id			a null-terminated string containing the id of the element.
+ * @return	-1 if the element wasn't found, or the index of its slot.
+ */
+int64_t http_template_find(http_template_t *compiled, chr_t *id) {
+
+	size_t length = ns_length_get(id);
+
+	for (uint32_t i = 0; compiled && i < compiled->count; i++) {
+		if (pl_length_get(compiled->slots[i].id) == length && !mm_cmp_cs_eq(pl_char_get(compiled->slots[i].id), id, length)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief	Escape a string so it can be used as the content or an attribute value of an element.
+ * @param	value	a null-terminated string containing the value to be escaped.
+ * @return	NULL on failure, or a managed string containing the escaped value on success.
+ */
+stringer_t * http_page_escape(chr_t *value) {
+
+	chr_t *output;
+	stringer_t *result;
+	size_t length = 0, original = ns_length_get(value);
+
+	for (size_t i = 0; i < original; i++) {
+		switch (value[i]) {
+			case ('&'): length += 5; break;
+			case ('<'): case ('>'): length += 4; break;
+			case ('"'): case ('\''): length += 6; break;
+			default: length++; break;
+		}
+	}
+
+	if (!(result = st_alloc(length + 1))) {
+		log_pedantic("Unable to allocate memory for the escaped value. {length = %zu}", length);
+		return NULL;
+	}
+
+	output = st_char_get(result);
+
+	for (size_t i = 0; i < original; i++) {
+		switch (value[i]) {
+			case ('&'): mm_copy(output, "&amp;", 5); output += 5; break;
+			case ('<'): mm_copy(output, "&lt;", 4); output += 4; break;
+			case ('>'): mm_copy(output, "&gt;", 4); output += 4; break;
+			case ('"'): mm_copy(output, "&quot;", 6); output += 6; break;
+			case ('\''): mm_copy(output, "&#039;", 6); output += 6; break;
+			default: *output++ = value[i]; break;
+		}
+	}
+
+	st_length_set(result, length);
+
+	return result;
+}
+
+/**
+ * @brief	Find the change record for an element, allocating the page's change records if this is the first change.
+ * @param	page	a pointer to the page being modified.
+ * @param	id		a null-terminated string containing the id of the element.
+ * @return	-1 on failure, or the index of the element's slot on success.
+ */
+int64_t http_page_change(http_page_t *page, chr_t *id) {
+
+	int64_t slot;
+
+	if (!page || (slot = http_template_find(page->content->compiled, id)) < 0) {
+		log_pedantic("Unable to find the requested element. {id = %s}", id);
+		return -1;
+	}
+	// The change records are only allocated once a page is modified, so an unmodified page is a straight copy of the template.
+	else if (!page->changes && !(page->changes = mm_alloc(sizeof(http_change_t) * page->content->compiled->count))) {
+		log_pedantic("Unable to allocate memory for the page changes.");
+		return -1;
+	}
+
+	return slot;
+}
+
+/**
+ * @brief	Replace the content of an element.
+ * @param	page	a pointer to the page being modified.
+ * @param	id		a null-terminated string containing the id of the element.
+ * @param	value	a null-terminated string containing the new content, which will be escaped.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_set_content(http_page_t *page, chr_t *id, chr_t *value) {
+
+	int64_t slot;
+	stringer_t *escaped;
+
+	if ((slot = http_page_change(page, id)) < 0 || !(escaped = http_page_escape(value))) {
+		return false;
+	}
+
+	st_cleanup(page->changes[slot].content);
+	page->changes[slot].content = escaped;
+
+	// Empty elements are rendered with a separate end tag once they have content.
+	page->length += st_length_get(escaped) + page->content->compiled->slots[slot].name + 3;
+
+	return true;
+}
+
+/**
+ * @brief	Replace the content of an element with a number.
+ * @param	page	a pointer to the page being modified.
+ * @param	id		a null-terminated string containing the id of the element.
+ * @param	value	the number to be displayed.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_set_uint64(http_page_t *page, chr_t *id, uint64_t value) {
+
+	chr_t buffer[32];
+
+	if (snprintf(buffer, 32, "%lu", value) <= 0) {
+		return false;
+	}
+
+	return http_page_set_content(page, id, buffer);
+}
+
+/**
+ * @brief	Set the value of an element's attribute, replacing the value from the template if there is one.
+ * @param	page	a pointer to the page being modified.
+ * @param	id		a null-terminated string containing the id of the element.
+ * @param	name	a null-terminated string containing the name of the attribute.
+ * @param	value	a null-terminated string containing the attribute value, which will be escaped.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_set_property(http_page_t *page, chr_t *id, chr_t *name, chr_t *value) {
+
+	int64_t slot;
+	stringer_t *escaped;
+	http_property_t *property, *last = NULL;
+
+	if ((slot = http_page_change(page, id)) < 0 || !(escaped = http_page_escape(value))) {
+		return false;
+	}
+
+	for (property = page->changes[slot].properties; property && st_cmp_cs_eq(property->name, NULLER(name)); property = (http_property_t *)property->next) {
+		last = property;
+	}
+
+	if (!property && (!(property = mm_alloc(sizeof(http_property_t))) || !(property->name = st_import(name, ns_length_get(name))))) {
+		log_pedantic("Unable to allocate memory for the page property.");
+		if (property) mm_free(property);
+		st_free(escaped);
+		return false;
+	}
+	else if (!property->value) {
+		if (last) last->next = (struct http_property_t *)property;
+		else page->changes[slot].properties = property;
+	}
+
+	st_cleanup(property->value);
+	property->value = escaped;
+	page->length += st_length_get(property->name) + st_length_get(escaped) + 4;
+
+	return true;
+}
+
+/**
+ * @brief	Insert a new element, with an id and text content, immediately after an existing element.
+ * @param	page	a pointer to the page being modified.
+ * @param	id		a null-terminated string containing the id of the existing element.
+ * @param	element	a null-terminated string containing the name of the new element.
+ * @param	sibling	a null-terminated string containing the id of the new element.
+ * @param	content	a null-terminated string containing the content of the new element, which will be escaped.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_add_sibling(http_page_t *page, chr_t *id, chr_t *element, chr_t *sibling, chr_t *content) {
+
+	int64_t slot;
+	stringer_t *escaped, *markup;
+
+	if ((slot = http_page_change(page, id)) < 0 || !(escaped = http_page_escape(content))) {
+		return false;
+	}
+	else if (!(markup = st_merge("snnnnnsnnn", page->changes[slot].sibling, "<", element, " id=\"", sibling, "\">", escaped, "</", element, ">"))) {
+		log_pedantic("Unable to build the sibling element.");
+		st_free(escaped);
+		return false;
+	}
+
+	st_cleanup(page->changes[slot].sibling);
+	page->changes[slot].sibling = markup;
+	page->length += st_length_get(markup);
+	st_free(escaped);
+
+	return true;
+}
+
+/**
+ * @brief	Append a block of data to a rendered page.
+ * @note	The output buffer is sized from the page length estimate before rendering begins, and is never grown, so an append that
+ * 			wouldn't fit means the estimate was wrong and the render is abandoned.
+ * @param	output	a managed string containing the page rendered so far.
+ * @param	data	a pointer to the data to be appended.
+ * @param	length	the length, in bytes, of the data.
+ * @return	true on success or false if the data wouldn't fit in the output buffer.
+ */
+bool_t http_page_render_copy(stringer_t *output, void *data, size_t length) {
+
+	if (length > st_avail_get(output) - st_length_get(output)) {
+		log_pedantic("The rendered page would overflow its output buffer. {avail = %zu / length = %zu / append = %zu}",
+			st_avail_get(output), st_length_get(output), length);
+		return false;
+	}
+
+	mm_copy(st_char_get(output) + st_length_get(output), data, length);
+	st_length_set(output, st_length_get(output) + length);
+
+	return true;
+}
+
+/**
+ * @brief	Render the start tag of an element whose attributes were changed, or an empty element that was given content.
+ * @param	output	a managed string containing the page rendered so far.
+ * @param	text	a pointer to the template text.
+ * @param	slot	a pointer to the slot for the element.
+ * @param	change	a pointer to the changes made to the element.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_render_tag(stringer_t *output, chr_t *text, http_slot_t *slot, http_change_t *change) {
+
+	placer_t name, value;
+	size_t offset = slot->start + slot->name + 1;
+	http_property_t *property;
+
+	if (!http_page_render_copy(output, text + slot->start, slot->name + 1)) {
+		return false;
+	}
+
+	// Attributes from the template are copied verbatim, unless the page replaced them.
+	while (http_template_attribute(text, slot->open, &offset, &name, &value)) {
+
+		for (property = change->properties; property && st_cmp_cs_eq(property->name, &name); property = (http_property_t *)property->next);
+
+		if (!property && (!http_page_render_copy(output, " ", 1) ||
+			!http_page_render_copy(output, pl_char_get(name), offset - (pl_char_get(name) - text)))) {
+			return false;
+		}
+	}
+
+	for (property = change->properties; property; property = (http_property_t *)property->next) {
+		if (!http_page_render_copy(output, " ", 1) || !http_page_render_copy(output, st_char_get(property->name), st_length_get(property->name)) ||
+			!http_page_render_copy(output, "=\"", 2) || !http_page_render_copy(output, st_char_get(property->value), st_length_get(property->value)) ||
+			!http_page_render_copy(output, "\"", 1)) {
+			return false;
+		}
+	}
+
+	if (slot->open == slot->end && !change->content) {
+		return http_page_render_copy(output, "/>", 2);
+	}
+
+	return http_page_render_copy(output, ">", 1);
+}
+
+/**
+ * @brief	Render part of a page, substituting the changes made to any slots inside it.
+ * @param	page	a pointer to the page being rendered.
+ * @param	output	a managed string containing the page rendered so far.
+ * @param	from	the offset in the template text where the range starts.
+ * @param	to		the offset in the template text where the range ends.
+ * @param	first	the index of the first slot inside the range.
+ * @param	last	the index following the last slot inside the range.
+ * @return	true on success or false on failure.
+ */
+bool_t http_page_render_range(http_page_t *page, stringer_t *output, size_t from, size_t to, uint32_t first, uint32_t last) {
+
+	http_slot_t *slot;
+	http_change_t *change;
+	chr_t *text = st_char_get(page->content->resource);
+
+	for (uint32_t i = first; i < last; i = slot->skip) {
+
+		slot = &(page->content->compiled->slots[i]);
+		change = &(page->changes[i]);
+
+		if (!http_page_render_copy(output, text + from, slot->start - from)) {
+			return false;
+		}
+
+		if (change->properties || (change->content && slot->open == slot->end)) {
+			if (!http_page_render_tag(output, text, slot, change)) return false;
+		}
+		else if (!http_page_render_copy(output, text + slot->start, slot->open - slot->start)) {
+			return false;
+		}
+
+		// Replacing the content of an element also replaces any slots nested inside it.
+		if (change->content) {
+			if (!http_page_render_copy(output, st_char_get(change->content), st_length_get(change->content))) return false;
+		}
+		else if (!http_page_render_range(page, output, slot->open, slot->close, i + 1, slot->skip)) {
+			return false;
+		}
+
+		if (change->content && slot->open == slot->end) {
+			if (!http_page_render_copy(output, "</", 2) || !http_page_render_copy(output, text + slot->start + 1, slot->name) ||
+				!http_page_render_copy(output, ">", 1)) {
+				return false;
+			}
+		}
+		else if (!http_page_render_copy(output, text + slot->close, slot->end - slot->close)) {
+			return false;
+		}
+
+		if (change->sibling && !http_page_render_copy(output, st_char_get(change->sibling), st_length_get(change->sibling))) {
+			return false;
+		}
+
+		from = slot->end;
+	}
+
+	return http_page_render_copy(output, text + from, to - from);
+}
+
+/**
+ * @brief	Render a page, applying its changes to the compiled template.
+ * @param	page	a pointer to the page to be rendered.
+ * @return	NULL on failure, or a managed string containing the rendered page on success.
+ */
+stringer_t * http_page_render(http_page_t *page) {
+
+	stringer_t *output;
+
+	if (!page || !page->content || !page->content->compiled) {
+		return NULL;
+	}
+	else if (!(output = st_alloc(st_length_get(page->content->resource) + page->length + 1))) {
+		log_pedantic("Unable to allocate memory for the rendered page. {length = %zu}", st_length_get(page->content->resource) + page->length);
+		return NULL;
+	}
+
+	if (!page->changes ? !http_page_render_copy(output, st_char_get(page->content->resource), st_length_get(page->content->resource)) :
+		!http_page_render_range(page, output, 0, st_length_get(page->content->resource), 0, page->content->compiled->count)) {
+		log_pedantic("Unable to render the page. {location = %.*s}", st_length_int(page->content->location), st_char_get(page->content->location));
+		st_free(output);
+		return NULL;
+	}
+
+	return output;
+}
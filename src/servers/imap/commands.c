@@ -51,7 +51,7 @@ void imap_requeue(connection_t *con) {
 		enqueue(&imap_logout, con);
 	}
 	else {
-		enqueue(&imap_process, con);
+		con_park(con, &imap_process);
 	}
 
 	return;
@@ -81,7 +81,7 @@ void imap_process(connection_t *con) {
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&imap_process, con);
+		con_park(con, &imap_process);
 		return;
 	}
 
@@ -108,7 +108,7 @@ void imap_process(connection_t *con) {
 
 		// Requeue and hope the next line of data is useful.
 		con->command = NULL;
-		enqueue(&imap_process, con);
+		con_park(con, &imap_process);
 		return;
 
 	}
@@ -1012,10 +1012,8 @@ imap_fetch_response_t * imap_fetch_body(array_t *outer, array_t *partial, connec
 				}
 
 				// Build the value, and add it to the output.
-				if (value_len != 0 && snprintf(buffer, 128, "{%zu}\r\n", value_len) > 0) {
-					value_pl = pl_init(stream, value_len);
-					item = st_merge("ns", buffer, &value_pl);
-					output = imap_fetch_response_add(output, !complete ? tag : complete, item);
+				if (value_len != 0) {
+					output = imap_fetch_response_literal(output, !complete ? tag : complete, *message, pl_init(stream, value_len));
 				}
 				else if ((item = st_import("NIL", 3)) != NULL) {
 					output = imap_fetch_response_add(output, !complete ? tag : complete, item);
@@ -1025,8 +1023,8 @@ imap_fetch_response_t * imap_fetch_body(array_t *outer, array_t *partial, connec
 				st_cleanup(complete);
 			}
 			// Otherwise output the whole thing.
-			else if (!pl_empty(value_pl) && snprintf(buffer, 128, "{%zu}\r\n", pl_length_get(value_pl)) > 0 && (item = st_merge("ns", buffer, &value_pl)) != NULL) {
-				output = imap_fetch_response_add(output, tag, item);
+			else if (!pl_empty(value_pl)) {
+				output = imap_fetch_response_literal(output, tag, *message, value_pl);
 			}
 			else if (value_st != NULL && snprintf(buffer, 128, "{%zu}\r\n", st_length_get(value_st)) > 0 && (item = st_merge("ns", buffer, value_st)) != NULL) {
 				output = imap_fetch_response_add(output, tag, item);
@@ -1103,13 +1101,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 			imap_fetch_response_free(output);
 			return NULL;
 		}
-		else if (snprintf(buffer, 128, "{%zu}\r\n", st_length_get(&(message->mime->body))) <= 0 || (value = st_merge("ns", buffer, &(message->mime->body))) == NULL) {
-			mail_destroy(message);
-			mail_destroy_header(header);
-			imap_fetch_response_free(output);
-			return NULL;
-		}
-		output = imap_fetch_response_add(output, PLACER("RFC822.TEXT", 11), value);
+		output = imap_fetch_response_literal(output, PLACER("RFC822.TEXT", 11), message, message->mime->body);
 	}
 
 	// Process the entire RFC822 message.
@@ -1121,14 +1113,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 			imap_fetch_response_free(output);
 			return NULL;
 		}
-		else if (snprintf(buffer, 128, "{%zu}\r\n", st_length_get(message->text)) <= 0 || (value = st_merge("ns", buffer, message->text))
-			== NULL) {
-			mail_destroy(message);
-			mail_destroy_header(header);
-			imap_fetch_response_free(output);
-			return NULL;
-		}
-		output = imap_fetch_response_add(output, PLACER("RFC822", 6), value);
+		output = imap_fetch_response_literal(output, PLACER("RFC822", 6), message, pl_init(st_char_get(message->text), st_length_get(message->text)));
 	}
 
 	// Process the body.
@@ -1284,6 +1269,7 @@ inx_t * imap_duplicate_messages(inx_t *messages) {
 inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *range, int_t uid) {
 
 	int_t asterisk;
+	bool_t ordered, highest = false;
 	inx_t *output = NULL;
 	inx_cursor_t *cursor;
 	uint32_t commas, parts;
@@ -1302,23 +1288,8 @@ inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *ran
 		return NULL;
 	}
 
-	// Find the highest message number.
-	if ((cursor = inx_cursor_alloc(messages))) {
-
-		while ((active = inx_cursor_value_next(cursor))) {
-
-			if (active->foldernum == selected && active->messagenum > highest_uid) {
-				highest_uid = active->messagenum;
-			}
-
-			if (active->foldernum == selected && active->sequencenum > highest_seq) {
-				highest_seq = active->sequencenum;
-			}
-
-		}
-
-		inx_cursor_free(cursor);
-	}
+	// When the messages are held in a B+tree they're sorted by UID, so UID ranges can seek directly to their first message.
+	ordered = (inx_options(messages) & M_INX_BPLUS) == M_INX_BPLUS;
 
 	// Count the commas.
 	commas = tok_get_count_st(range, ',');
@@ -1387,6 +1358,25 @@ inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *ran
 			end = number;
 		}
 
+		// Find the highest message number, which is only needed when a range includes an asterisk.
+		if (asterisk == 1 && !highest && (cursor = inx_cursor_alloc(messages))) {
+
+			while ((active = inx_cursor_value_next(cursor))) {
+
+				if (active->foldernum == selected && active->messagenum > highest_uid) {
+					highest_uid = active->messagenum;
+				}
+
+				if (active->foldernum == selected && active->sequencenum > highest_seq) {
+					highest_seq = active->sequencenum;
+				}
+
+			}
+
+			inx_cursor_free(cursor);
+			highest = true;
+		}
+
 		// If either value is higher than any valid message value, and we have an asterisk, include the highest numbered message. Observed behavior.
 		if (uid == 0 && asterisk == 1 && start > highest_seq) {
 			start = highest_seq;
@@ -1402,8 +1392,19 @@ inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *ran
 
 		if ((cursor = inx_cursor_alloc(messages))) {
 
+			if (uid == 1 && ordered) {
+				key.val.u64 = start;
+				inx_cursor_seek(cursor, key);
+			}
+
 			while ((active = inx_cursor_value_next(cursor))) {
 
+				// Sequence numbers are assigned in the order the messages are held, so we can stop once we're past the end of the range.
+				// The same goes for UIDs, as long as the messages are sorted.
+				if (asterisk == 0 && ((uid == 0 && number >= end) || (uid == 1 && ordered && active->messagenum > end))) {
+					break;
+				}
+
 				if (active->foldernum == selected && ((uid == 0 && ++number >= start && (asterisk == 1 || number <= end)) ||
 					(uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)))) {
 					key.val.u64 = active->messagenum;
@@ -19,6 +19,7 @@ void imap_fetch_response_free(imap_fetch_response_t *response) {
 	while (response) {
 		st_cleanup(response->key);
 		st_cleanup(response->value);
+		mail_cache_release(response->cache);
 		holder = response;
 		response = (imap_fetch_response_t *)response->next;
 		mm_free(holder);
@@ -27,9 +28,36 @@ void imap_fetch_response_free(imap_fetch_response_t *response) {
 	return;
 }
 
+/**
+ * @brief	Append an item to the end of a fetch response.
+ * @param	response	the fetch response being built, or NULL if the item is the first.
+ * @param	output		the item to be appended.
+ * @return	the head of the fetch response.
+ */
+static imap_fetch_response_t * imap_fetch_response_append(imap_fetch_response_t *response, imap_fetch_response_t *output) {
+
+	imap_fetch_response_t *holder;
+
+	// If this is the first element.
+	if (!response) {
+		return output;
+	}
+
+	// Otherwise iterate to the end and append.
+	holder = response;
+
+	while (holder->next) {
+		holder = (imap_fetch_response_t *)holder->next;
+	}
+
+	holder->next = (struct imap_fetch_response_t *)output;
+
+	return response;
+}
+
 imap_fetch_response_t * imap_fetch_response_add(imap_fetch_response_t *response, stringer_t *key, stringer_t *value) {
 
-	imap_fetch_response_t *output, *holder;
+	imap_fetch_response_t *output;
 
 	// Sanity
 	if (!key || !value) {
@@ -52,19 +80,48 @@ imap_fetch_response_t * imap_fetch_response_add(imap_fetch_response_t *response,
 
 	output->value = value;
 
-	// If this is the first element.
-	if (!response) {
-		return output;
+	return imap_fetch_response_append(response, output);
+}
+
+/**
+ * @brief	Add a literal taken from the text of a message to a fetch response.
+ * @note	If the literal lies inside text shared with the message cache, the response only holds the literal prefix and a reference to the
+ * 			cache entry, so the data can be written straight from the cache instead of being copied into the response.
+ * @param	response	the fetch response being built.
+ * @param	key			the name of the fetch item.
+ * @param	message		the mail message object the literal was taken from, or NULL.
+ * @param	data		a placer pointing to the literal data.
+ * @return	the head of the fetch response.
+ */
+imap_fetch_response_t * imap_fetch_response_literal(imap_fetch_response_t *response, stringer_t *key, mail_message_t *message, placer_t data) {
+
+	chr_t buffer[128];
+	stringer_t *value;
+	imap_fetch_response_t *output;
+
+	if (snprintf(buffer, 128, "{%zu}\r\n", pl_length_get(data)) <= 0) {
+		return response;
 	}
 
-	// Otherwise iterate to the end and append.
-	holder = response;
+	// Literals that don't come from the cached text are copied into the response.
+	if (!key || !message || !message->cache || pl_char_get(data) < st_char_get(message->cache->text) ||
+		pl_char_get(data) + pl_length_get(data) > st_char_get(message->cache->text) + st_length_get(message->cache->text)) {
+		return (value = st_merge("ns", buffer, &data)) ? imap_fetch_response_add(response, key, value) : response;
+	}
 
-	while (holder->next) {
-		holder = (imap_fetch_response_t *)holder->next;
+	if (!(output = mm_alloc(sizeof(imap_fetch_response_t)))) {
+		return response;
+	}
+	else if (!(output->key = st_dupe_opts(MANAGED_T | HEAP | CONTIGUOUS, key)) || !(output->value = st_import(buffer, ns_length_get(buffer)))) {
+		st_cleanup(output->key);
+		mm_free(output);
+		return response;
 	}
 
-	holder->next = (struct imap_fetch_response_t *)output;
+	mail_cache_retain(message->cache);
+	output->cache = message->cache;
+	output->offset = pl_char_get(data) - st_char_get(message->cache->text);
+	output->length = pl_length_get(data);
 
-	return response;
+	return imap_fetch_response_append(response, output);
 }
@@ -39,6 +39,9 @@ void imap_starttls(connection_t *con) {
 	// Tell the user that we are ready to start the negotiation.
 	con_print(con, "%.*s OK Ready to start TLS negotiation.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
 
+	// The acknowledgement must leave in plain text, before the handshake takes over the socket.
+	con_flush(con);
+
 	if (!(con->network.ssl = ssl_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
 		con_print(con, "%.*s NO SSL Connection attempt failed.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
 		log_pedantic("The SSL connection attempt failed.");
@@ -46,7 +49,7 @@ void imap_starttls(connection_t *con) {
 	}
 
 	// Clear the input buffer. A shorthand session reset.
-	stats_increment_by_name("imap.connections.secure");
+	stats_increment_by_num(STATS_IMAP_CONNECTIONS_SECURE);
 	st_length_set(con->network.buffer, 0);
 	con->network.line = pl_null();
 	con->network.status = 1;
@@ -1628,6 +1631,11 @@ void imap_fetch(connection_t *con) {
 					con_write_st(con, iterate->key);
 					con_write_bl(con, " ", 1);
 					con_write_st(con, iterate->value);
+
+					// Literals borrowed from the message cache follow their prefix.
+					if (iterate->cache) {
+						mail_cache_write(con, iterate->cache, iterate->offset, iterate->length);
+					}
 				}
 				iterate = (imap_fetch_response_t *)iterate->next;
 			}
@@ -33,6 +33,27 @@
 #define IMAP_FETCH_BODY_MIME 5
 #define IMAP_FETCH_BODY_PART 6
 
+// IMAP Search plan nodes.
+#define IMAP_SEARCH_NONE 0
+#define IMAP_SEARCH_ALL 1
+#define IMAP_SEARCH_AND 2
+#define IMAP_SEARCH_OR 3
+#define IMAP_SEARCH_NOT 4
+#define IMAP_SEARCH_FLAGS 5
+#define IMAP_SEARCH_LARGER 6
+#define IMAP_SEARCH_SMALLER 7
+#define IMAP_SEARCH_SEQUENCE 8
+#define IMAP_SEARCH_UID 9
+#define IMAP_SEARCH_BEFORE 10
+#define IMAP_SEARCH_ON 11
+#define IMAP_SEARCH_SINCE 12
+#define IMAP_SEARCH_SENTBEFORE 13
+#define IMAP_SEARCH_SENTON 14
+#define IMAP_SEARCH_SENTSINCE 15
+#define IMAP_SEARCH_HEADER 16
+#define IMAP_SEARCH_BODY 17
+#define IMAP_SEARCH_TEXT 18
+
 // IMAP Flags actions.
 #define IMAP_FLAG_SILENT 1
 #define IMAP_FLAG_ADD 2
@@ -48,6 +69,7 @@ void    imap_sort(void);
 /// fetch_response.c
 imap_fetch_response_t *  imap_fetch_response_add(imap_fetch_response_t *response, stringer_t *key, stringer_t *value);
 void                     imap_fetch_response_free(imap_fetch_response_t *response);
+imap_fetch_response_t *  imap_fetch_response_literal(imap_fetch_response_t *response, stringer_t *key, mail_message_t *message, placer_t data);
 
 /// fetch.c
 inx_t *                   imap_duplicate_messages(inx_t *messages);
@@ -149,16 +171,14 @@ int_t               imap_parse_qstring(stringer_t **output, chr_t **start, size_
 stringer_t *  imap_range_build(size_t length, uint64_t *numbers);
 
 /// search.c
-int_t    imap_search_flag(uint32_t status, uint32_t flag, int_t has);
-inx_t *  imap_search_messages(connection_t *con);
-int_t    imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
-int_t    imap_search_messages_date(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *date, int_t internal, int_t expected);
-int_t    imap_search_messages_date_compare(stringer_t *one, stringer_t *two);
-int_t    imap_search_messages_header(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *field, stringer_t *value);
-int_t    imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion);
-int_t    imap_search_messages_range(meta_message_t *active, stringer_t *range, int_t uid);
-int_t    imap_search_messages_size(meta_message_t *active, stringer_t *value, int_t expected);
-int_t    imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
+imap_search_node_t *  imap_search_compile(imap_arguments_t *array, unsigned recursion);
+uint32_t              imap_search_day(stringer_t *date);
+void                  imap_search_free(imap_search_node_t *node);
+inx_t *               imap_search_messages(connection_t *con);
+int_t                 imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
+int_t                 imap_search_messages_header(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *field, stringer_t *value);
+uint32_t              imap_search_messages_sent(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active);
+int_t                 imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
 
 /// sessions.c
 void    imap_session_destroy(connection_t *con);
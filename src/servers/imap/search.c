@@ -14,152 +14,146 @@
 
 chr_t *MONTH_LOOKUP[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
 
-int_t imap_search_messages_date_compare(stringer_t *one, stringer_t *two) {
-
-	uint32_t numone, numtwo;
-	placer_t partone, parttwo;
-
-	if (one == NULL || two == NULL || tok_get_count_st(one, '-') != 3 || tok_get_count_st(two, '-') != 3) {
-		return -1;
-	}
+/**
+ * The metadata for the messages in the selected folder, packed into parallel columns so the cheap search terms can be evaluated
+ * without touching the message index. Each search term produces a bitmap with one bit per row, and rows are ordered by UID.
+ */
+typedef struct {
+	meta_user_t *user;
+	uint64_t selected, rows, words, uid_max, sequence_max;
+	uint64_t *uids, *sequences, *sizes, *created;
+	uint32_t *status, *days;
+} imap_search_rows_t;
+
+static const struct {
+	chr_t *name;
+	uint32_t mask, flags;
+} imap_search_flags[] = {
+	{ "ANSWERED", MAIL_STATUS_ANSWERED, MAIL_STATUS_ANSWERED },
+	{ "DELETED", MAIL_STATUS_DELETED, MAIL_STATUS_DELETED },
+	{ "DRAFT", MAIL_STATUS_DRAFT, MAIL_STATUS_DRAFT },
+	{ "FLAGGED", MAIL_STATUS_FLAGGED, MAIL_STATUS_FLAGGED },
+	{ "RECENT", MAIL_STATUS_RECENT, MAIL_STATUS_RECENT },
+	{ "SEEN", MAIL_STATUS_SEEN, MAIL_STATUS_SEEN },
+	{ "NEW", MAIL_STATUS_RECENT | MAIL_STATUS_SEEN, MAIL_STATUS_RECENT },
+	{ "OLD", MAIL_STATUS_RECENT, 0 },
+	{ "UNANSWERED", MAIL_STATUS_ANSWERED, 0 },
+	{ "UNDELETED", MAIL_STATUS_DELETED, 0 },
+	{ "UNDRAFT", MAIL_STATUS_DRAFT, 0 },
+	{ "UNFLAGGED", MAIL_STATUS_FLAGGED, 0 },
+	{ "UNSEEN", MAIL_STATUS_SEEN, 0 }
+};
+
+// The search terms which take a single argument.
+static const struct {
+	chr_t *name;
+	int_t type;
+} imap_search_terms[] = {
+	{ "BEFORE", IMAP_SEARCH_BEFORE },
+	{ "ON", IMAP_SEARCH_ON },
+	{ "SINCE", IMAP_SEARCH_SINCE },
+	{ "SENTBEFORE", IMAP_SEARCH_SENTBEFORE },
+	{ "SENTON", IMAP_SEARCH_SENTON },
+	{ "SENTSINCE", IMAP_SEARCH_SENTSINCE },
+	{ "BCC", IMAP_SEARCH_HEADER },
+	{ "CC", IMAP_SEARCH_HEADER },
+	{ "FROM", IMAP_SEARCH_HEADER },
+	{ "TO", IMAP_SEARCH_HEADER },
+	{ "SUBJECT", IMAP_SEARCH_HEADER },
+	{ "BODY", IMAP_SEARCH_BODY },
+	{ "TEXT", IMAP_SEARCH_TEXT },
+	{ "LARGER", IMAP_SEARCH_LARGER },
+	{ "SMALLER", IMAP_SEARCH_SMALLER },
+	{ "UID", IMAP_SEARCH_UID },
+	// We don't support keywords, so no message will ever have one.
+	{ "KEYWORD", IMAP_SEARCH_NONE },
+	{ "UNKEYWORD", IMAP_SEARCH_ALL },
+	// We don't support searches that are aware of character set translations.
+	{ "CHARSET", IMAP_SEARCH_ALL }
+};
 
-	// Year
-	if (tok_get_st(one, '-', 2, &partone) < 0 || tok_get_st(two, '-', 2, &parttwo) < 0) {
-		return -1;
-	}
+/**
+ * @brief	Convert a date into a calendar day number.
+ * @param	date	a date string formatted as DD-Mon-YYYY.
+ * @return	the day formatted as the number YYYYMMDD, or 0 if the date couldn't be parsed.
+ */
+uint32_t imap_search_day(stringer_t *date) {
 
-	if (uint32_conv_st(&partone, &numone) != true || uint32_conv_st(&parttwo, &numtwo) != true) {
-		return -1;
-	}
+	placer_t part;
+	uint32_t year, month = 0, day;
 
-	if (numone < numtwo) {
+	if (st_empty(date) || tok_get_count_st(date, '-') != 3) {
 		return 0;
 	}
-	else if (numone > numtwo) {
-		return 2;
-	}
-
-	// Month
-	if (tok_get_st(one, '-', 1, &partone) < 0 || tok_get_st(two, '-', 1, &parttwo) < 0) {
-		return -1;
-	}
-
-	numtwo = numone = 0;
-	for (int_t i = 0; i < 12 && (numone == 0 || numtwo == 0); i++) {
-		if (!st_cmp_ci_eq(&partone, PLACER(MONTH_LOOKUP[i], 3))) {
-			numone = i + 1;
-		}
-		if (!st_cmp_ci_eq(&parttwo, PLACER(MONTH_LOOKUP[i], 3))) {
-			numtwo = i + 1;
-		}
-	}
 
-	if (numone == 0 || numtwo == 0) {
-		return -1;
-	}
-
-	if (numone < numtwo) {
+	if (tok_get_st(date, '-', 2, &part) < 0 || !uint32_conv_st(&part, &year) || year > 9999) {
 		return 0;
 	}
-	else if (numone > numtwo) {
-		return 2;
-	}
 
-	// Day
-	if (tok_get_st(one, '-', 0, &partone) < 0 || tok_get_st(two, '-', 0, &parttwo) < 0) {
-		return -1;
+	if (tok_get_st(date, '-', 1, &part) < 0) {
+		return 0;
 	}
 
-	if (uint32_conv_st(&partone, &numone) != true || uint32_conv_st(&parttwo, &numtwo) != true) {
-		return -1;
+	for (uint32_t i = 0; i < 12 && !month; i++) {
+		if (!st_cmp_ci_eq(&part, PLACER(MONTH_LOOKUP[i], 3))) {
+			month = i + 1;
+		}
 	}
 
-	if (numone < numtwo) {
+	if (!month || tok_get_st(date, '-', 0, &part) < 0 || !uint32_conv_st(&part, &day) || !day || day > 31) {
 		return 0;
 	}
-	else if (numone > numtwo) {
-		return 2;
-	}
 
-	return 1;
+	return (year * 10000) + (month * 100) + day;
 }
 
-int_t imap_search_messages_date(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *date, int_t internal, int_t expected) {
+/**
+ * @brief	Get the calendar day a message was sent, using the Date line of the message header.
+ * @param	user	the user who owns the message.
+ * @param	data	a pointer to the message, if it has already been loaded.
+ * @param	header	a pointer to the message header, which is loaded if necessary.
+ * @param	active	the message being examined.
+ * @return	the day formatted as the number YYYYMMDD, or 0 on failure.
+ */
+uint32_t imap_search_messages_sent(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active) {
 
-	time_t utime;
-	struct tm ltime;
-	int_t compare = -1;
-	chr_t date_string[40];
+	uint32_t result = 0;
 	placer_t area = pl_null(), front, mid, end;
 	stringer_t *current = NULL, *line = NULL;
 
-	// Use the internal date.
-	if (internal == 1) {
-
-		// Build a string with the current date.
-		if ((utime = active->created) == 0 || localtime_r(&utime, &ltime) == NULL || strftime(date_string, 40, "%d-%b-%Y", &ltime) <= 0) {
-			compare = -1;
-		}
-		else if ((current = st_import(date_string, ns_length_get(date_string))) == NULL) {
-			compare = -1;
-		}
-
-		// Compare
-		else {
-			compare = imap_search_messages_date_compare(current, date);
-		}
+	// Load the message, if necessary.
+	if (*data != NULL) {
+		area = pl_init(st_char_get((*data)->text), (*data)->header_length);
+	}
+	else if (*header != NULL) {
+		area = pl_init(st_char_get(*header), st_length_get(*header));
+	}
+	else if ((*header = mail_load_header(active, user)) != NULL){
+		area = pl_init(st_char_get(*header), st_length_get(*header));
 	}
-	// Use the date field from the message header.
-	else {
-
-		// Load the message, if necessary.
-		if (*data != NULL) {
-			area = pl_init(st_char_get((*data)->text), (*data)->header_length);
-		}
-		else if (*header != NULL) {
-			area = pl_init(st_char_get(*header), st_length_get(*header));
-		}
-		else if ((*header = mail_load_header(active, user)) != NULL){
-			area = pl_init(st_char_get(*header), st_length_get(*header));
-		}
-
-		// Get the DATE line of the header.
-		if (pl_empty(area) || (line = mail_header_fetch_cleaned(&area, PLACER("Date", 4))) == NULL) {
-			compare = -1;
-		}
-
-		// Build the date string.
-		else if (tok_get_count_st(line, ',') > 1 && tok_get_count_st(line, ' ') > 4 &&
-			(tok_get_st(line, ' ', 1, &front) < 0 || tok_get_st(line, ' ', 2, &mid) < 0 || tok_get_st(line, ' ', 3, &end) < 0 ||
-			!(current = st_merge("snsns", &front, "-", &mid, "-",	&end)))) {
-			compare = -1;
-		}
-		else if (tok_get_count_st(line, ',') == 1 && tok_get_count_st(line, ' ') > 3 &&
-			(tok_get_st(line, ' ', 0, &front) < 0 || tok_get_st(line, ' ', 1, &mid) < 0 || tok_get_st(line, ' ', 2, &end) < 0 ||
-			!(current = st_merge("snsns", &front, "-", &mid, "-", &end)))) {
-			compare = -1;
-		}
 
-		// Compare
-		else {
-			compare = imap_search_messages_date_compare(current, date);
-		}
+	// Get the DATE line of the header.
+	if (pl_empty(area) || (line = mail_header_fetch_cleaned(&area, PLACER("Date", 4))) == NULL) {
+		return 0;
 	}
 
-	// Cleanup
-	if (line != NULL) {
-		st_free(line);
+	// Build the date string, skipping the day of the week if its present.
+	if (tok_get_count_st(line, ',') > 1 && tok_get_count_st(line, ' ') > 4 &&	tok_get_st(line, ' ', 1, &front) >= 0 &&
+		tok_get_st(line, ' ', 2, &mid) >= 0 && tok_get_st(line, ' ', 3, &end) >= 0) {
+		current = st_merge("snsns", &front, "-", &mid, "-",	&end);
 	}
-	if (current != NULL) {
-		st_free(current);
+	else if (tok_get_count_st(line, ',') == 1 && tok_get_count_st(line, ' ') > 3 && tok_get_st(line, ' ', 0, &front) >= 0 &&
+		tok_get_st(line, ' ', 1, &mid) >= 0 && tok_get_st(line, ' ', 2, &end) >= 0) {
+		current = st_merge("snsns", &front, "-", &mid, "-", &end);
 	}
 
-	// Did we get the expected value.
-	if (compare == expected) {
-		return 1;
+	if (current) {
+		result = imap_search_day(current);
+		st_free(current);
 	}
 
-	return -1;
+	st_free(line);
+	return result;
 }
 
 // Search the header.
@@ -247,383 +241,626 @@ int_t imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_m
 	return compare;
 }
 
-int_t imap_search_messages_size(meta_message_t *active, stringer_t *value, int_t expected) {
 
-	uint64_t size;
+/**
+ * @brief	Free a compiled search plan.
+ * @param	node	the root of the search plan to be freed.
+ * @return	This function returns no value.
+ */
+void imap_search_free(imap_search_node_t *node) {
 
-	if (active == NULL) {
-		return -1;
-	}
+	imap_search_node_t *next;
 
-	if (uint64_conv_st(value, &size) != true) {
-		return -1;
-	}
-	else if (expected == 0 && active->size < size) {
-		return 1;
-	}
-	else if (expected == 1 && active->size > size) {
-		return 1;
+	while (node) {
+		next = node->next;
+		imap_search_free(node->children);
+		if (node->ranges) mm_free(node->ranges);
+		if (node->matches) fulltext_result_free(node->matches);
+		mm_free(node);
+		node = next;
 	}
 
-	return -1;
+	return;
 }
 
-int_t imap_search_flag(uint32_t status, uint32_t flag, int_t has) {
-	if (has == 1 && (status & flag) == flag) {
-		return 1;
+static imap_search_node_t * imap_search_node(int_t type) {
+
+	imap_search_node_t *node;
+
+	if (!(node = mm_alloc(sizeof(imap_search_node_t)))) {
+		log_pedantic("Unable to allocate a search plan node.");
+		return NULL;
 	}
-	else if (has == 0 && (status & flag) != flag) {
-		return 1;
+
+	node->type = type;
+	node->content = (type == IMAP_SEARCH_HEADER || type == IMAP_SEARCH_BODY || type == IMAP_SEARCH_TEXT || type == IMAP_SEARCH_SENTBEFORE ||
+		type == IMAP_SEARCH_SENTON || type == IMAP_SEARCH_SENTSINCE);
+
+	return node;
+}
+
+// Return the next argument if its a string, and advance the position.
+static stringer_t * imap_search_argument(imap_arguments_t *array, size_t *position) {
+
+	if (*position >= ar_length_get(array) || imap_get_type_ar(array, *position) == IMAP_ARGUMENT_TYPE_ARRAY) {
+		return NULL;
 	}
-	return -1;
+
+	return imap_get_st_ar(array, (*position)++);
 }
 
-int_t imap_search_messages_range(meta_message_t *active, stringer_t *range, int_t uid) {
+/**
+ * @brief	Parse a sequence set into pairs of inclusive bounds.
+ * @note	The asterisk is stored as UINT64_MAX and replaced with the largest value in the mailbox when the plan is evaluated.
+ * @param	node	the search plan node which will hold the ranges.
+ * @param	set		the sequence set to be parsed.
+ * @return	true if the set was parsed successfully, or false on failure.
+ */
+static bool_t imap_search_ranges(imap_search_node_t *node, stringer_t *set) {
 
-	int_t asterisk;
-	uint64_t start, end, number;
-	uint32_t commas, parts;
+	uint64_t start, end;
+	uint32_t commas;
 	placer_t sequence, start_token, end_token;
 
-	if (!active || !range) {
-		return -1;
-	}
-
 	// Count the commas.
-	commas = tok_get_count_st(range, ',');
+	commas = tok_get_count_st(set, ',');
+
+	if (!(node->ranges = mm_alloc(sizeof(uint64_t) * 2 * (commas + 1)))) {
+		log_pedantic("Unable to allocate the search ranges.");
+		return false;
+	}
 
 	// Break apart each sequence section.
-	for (uint32_t i = 0; i <= commas && tok_get_st(range, ',', i, &sequence) >= 0; i++) {
+	for (uint32_t i = 0; i <= commas && tok_get_st(set, ',', i, &sequence) >= 0; i++) {
 
-		start = end = asterisk = 0;
 		start_token = end_token = pl_null();
-		parts = tok_get_count_st(&sequence, ':');
 		tok_get_st(&sequence, ':', 0, &start_token);
 
-		if (parts > 1) {
+		if (tok_get_count_st(&sequence, ':') > 1) {
 			tok_get_st(&sequence, ':', 1, &end_token);
 		}
 
 		// Parse the start.
 		if (pl_empty(start_token)) {
-			return -1;
-		} else if (*(pl_char_get(start_token)) == '*') {
-			asterisk = 1;
-		} else if (!uint64_conv_st(&start_token, &start)) {
-				return -1;
+			return false;
 		}
-
-		// Parse the end.
-		if (!pl_empty(end_token) && *(pl_char_get(end_token)) == '*') {
-			asterisk = 1;
+		else if (*(pl_char_get(start_token)) == '*') {
+			start = UINT64_MAX;
 		}
-		else if (pl_empty(end_token)) {
-			end = start;
-		} else {
-
-			if (!uint64_conv_st(&end_token, &end)) {
-				return -1;
-			}
-
+		else if (!uint64_conv_st(&start_token, &start)) {
+			return false;
 		}
 
-		// If necessary, swap the values.
-		if (asterisk == 1 && end != 0) {
-			start = end;
-		}
-		else if (asterisk == 0 && start > end) {
-			number = start;
-			start = end;
-			end = number;
+		// Parse the end.
+		if (pl_empty(end_token)) {
+			end = start;
 		}
-
-		// Loop through and collect the messages.
-		if (uid == 0 && active->sequencenum >= start && (asterisk == 1 || active->sequencenum <= end)) {
-			return 1;
+		else if (*(pl_char_get(end_token)) == '*') {
+			end = UINT64_MAX;
 		}
-		else if (uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)) {
-			return 1;
+		else if (!uint64_conv_st(&end_token, &end)) {
+			return false;
 		}
 
+		// The bounds may be given in either order.
+		node->ranges[node->count * 2] = start < end ? start : end;
+		node->ranges[(node->count * 2) + 1] = start < end ? end : start;
+		node->count++;
 	}
 
-	return -1;
+	return true;
 }
 
-int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion) {
+/**
+ * @brief	Compile a single search key, and any arguments it consumes, into a search plan node.
+ * @param	array		the array of search arguments.
+ * @param	position	a pointer to the position of the search key, which is advanced past everything consumed.
+ * @param	recursion	the current nesting depth.
+ * @return	NULL on failure, or a pointer to the compiled search plan node.
+ */
+static imap_search_node_t * imap_search_compile_key(imap_arguments_t *array, size_t *position, unsigned recursion) {
 
-	stringer_t *item;
-	unsigned number, increment = 0;
-	int_t eval = 0, output = 0, not = 0, or = 0;
+	int_t type = -1;
+	stringer_t *item, *value;
+	imap_search_node_t *node, *child;
 
-	// Recursion limiter.
-	if (recursion >= IMAP_SEARCH_RECURSION_LIMIT) {
-		log_pedantic("Recursion limit hit.");
-		return 0;
+	// Terms which are missing, like the operand of a trailing NOT, don't match anything.
+	if (*position >= ar_length_get(array)) {
+		return imap_search_node(IMAP_SEARCH_NONE);
 	}
 
-	// NULL arrays don't remove any messages.
-	if (array == NULL || (number = ar_length_get(array)) == 0) {
-		return 1;
+	// Handle nested arrays.
+	if (imap_get_type_ar(array, *position) == IMAP_ARGUMENT_TYPE_ARRAY) {
+		return imap_search_compile(imap_get_ar_ar(array, (*position)++), recursion + 1);
+	}
+	else if (!(item = imap_get_st_ar(array, (*position)++))) {
+		return imap_search_node(IMAP_SEARCH_NONE);
 	}
 
-	while (increment < number && current != NULL && output != -1) {
+	// Flag checks.
+	for (size_t i = 0; i < sizeof(imap_search_flags) / sizeof(*imap_search_flags); i++) {
+		if (!st_cmp_ci_eq(item, NULLER(imap_search_flags[i].name))) {
 
-		// Handle nested arrays.
-		if (imap_get_type_ar(array, increment) == IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_inner(user, message, header, current, imap_get_ar_ar(array, increment++), recursion + 1);
-		}
-		else if ((item = imap_get_st_ar(array, increment++)) == NULL) {
-			eval = -1;
-		}
+			if ((node = imap_search_node(IMAP_SEARCH_FLAGS))) {
+				node->mask = imap_search_flags[i].mask;
+				node->flags = imap_search_flags[i].flags;
+			}
 
-		// Flag checks.
-		else if (!st_cmp_ci_eq(item, PLACER("ANSWERED", 8))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_ANSWERED, 1);
-		}
-		else if (!st_cmp_ci_eq(item, PLACER("DELETED", 7))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_DELETED, 1);
-		}
-		else if (!st_cmp_ci_eq(item, PLACER("DRAFT", 5))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_DRAFT, 1);
-		}
-		else if (!st_cmp_ci_eq(item, PLACER("FLAGGED", 7))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_FLAGGED, 1);
+			return node;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("RECENT", 6))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_RECENT, 1);
+	}
+
+	// All messages matches everything.
+	if (!st_cmp_ci_eq(item, PLACER("ALL", 3))) {
+		return imap_search_node(IMAP_SEARCH_ALL);
+	}
+
+	// Handle negation, and the ors.
+	else if (!st_cmp_ci_eq(item, PLACER("NOT", 3)) || !st_cmp_ci_eq(item, PLACER("OR", 2))) {
+
+		if (recursion >= IMAP_SEARCH_RECURSION_LIMIT) {
+			log_pedantic("Recursion limit hit.");
+			return imap_search_node(IMAP_SEARCH_NONE);
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("SEEN", 4))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_SEEN, 1);
+
+		if (!(node = imap_search_node(st_length_get(item) == 3 ? IMAP_SEARCH_NOT : IMAP_SEARCH_OR))) {
+			return NULL;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("OLD", 3))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_RECENT, 0);
+
+		for (int_t i = (node->type == IMAP_SEARCH_NOT ? 1 : 2); i > 0; i--) {
+
+			if (!(child = imap_search_compile_key(array, position, recursion + 1))) {
+				imap_search_free(node);
+				return NULL;
+			}
+
+			child->next = node->children;
+			node->children = child;
+			node->content |= child->content;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("UNANSWERED", 10))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_ANSWERED, 0);
+
+		return node;
+	}
+
+	// This search term takes two parameters.
+	else if (!st_cmp_ci_eq(item, PLACER("HEADER", 6))) {
+
+		if (!(item = imap_search_argument(array, position)) || !(value = imap_search_argument(array, position))) {
+			return imap_search_node(IMAP_SEARCH_NONE);
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("UNDELETED", 9))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_DELETED, 0);
+		else if ((node = imap_search_node(IMAP_SEARCH_HEADER))) {
+			node->field = item;
+			node->value = value;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("UNDRAFT", 7))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_DRAFT, 0);
+
+		return node;
+	}
+
+	for (size_t i = 0; type == -1 && i < sizeof(imap_search_terms) / sizeof(*imap_search_terms); i++) {
+		if (!st_cmp_ci_eq(item, NULLER(imap_search_terms[i].name))) {
+			type = imap_search_terms[i].type;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("UNFLAGGED", 9))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_FLAGGED, 0);
+	}
+
+	// If the characters make up a valid sequence, try parsing it.
+	if (type == -1) {
+
+		if (imap_valid_sequence(item) != 1) {
+			//log_pedantic("Unrecognized search keyword %.*s.", st_length_int(item), st_char_get(item));
+			return imap_search_node(IMAP_SEARCH_NONE);
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("UNSEEN", 6))) {
-			eval = imap_search_flag(current->status, MAIL_STATUS_SEEN, 0);
+		else if ((node = imap_search_node(IMAP_SEARCH_SEQUENCE)) && !imap_search_ranges(node, item)) {
+			node->type = IMAP_SEARCH_NONE;
 		}
-		else if (!st_cmp_ci_eq(item, PLACER("NEW", 3))) {
-			if (imap_search_flag(current->status, MAIL_STATUS_RECENT, 1) == 1 && imap_search_flag(current->status, MAIL_STATUS_SEEN, 0) == 1) {
-				eval = 1;
+
+		return node;
+	}
+
+	// Everything else requires a single parameter.
+	if (!(value = imap_search_argument(array, position)) || !(node = imap_search_node(type))) {
+		return imap_search_node(IMAP_SEARCH_NONE);
+	}
+
+	switch (type) {
+		case (IMAP_SEARCH_BEFORE):
+		case (IMAP_SEARCH_ON):
+		case (IMAP_SEARCH_SINCE):
+		case (IMAP_SEARCH_SENTBEFORE):
+		case (IMAP_SEARCH_SENTON):
+		case (IMAP_SEARCH_SENTSINCE):
+			if (!(node->number = imap_search_day(value))) {
+				node->type = IMAP_SEARCH_NONE;
+				node->content = false;
 			}
-			else {
-				eval = -1;
+			break;
+		case (IMAP_SEARCH_LARGER):
+		case (IMAP_SEARCH_SMALLER):
+			if (!uint64_conv_st(value, &(node->number))) {
+				node->type = IMAP_SEARCH_NONE;
 			}
-		}
+			break;
+		case (IMAP_SEARCH_UID):
+			if (imap_valid_sequence(value) != 1 || !imap_search_ranges(node, value)) {
+				node->type = IMAP_SEARCH_NONE;
+			}
+			break;
+		case (IMAP_SEARCH_HEADER):
+			node->field = item;
+			node->value = value;
+			break;
+		case (IMAP_SEARCH_BODY):
+		case (IMAP_SEARCH_TEXT):
+			node->value = value;
+			break;
+	}
 
-		// Date checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("BEFORE", 6)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 1, 0);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("ON", 2)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 1, 1);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SINCE", 5)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 1, 2);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SENTBEFORE", 10)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 0, 0);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SENTON", 6)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 0, 1);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SENTSINCE", 9)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_date(user, message, header, current, imap_get_st_ar(array, increment++), 0, 2);
-		}
+	return node;
+}
 
-		// Header checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("BCC", 3)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, item, imap_get_st_ar(array, increment++));
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("CC", 2)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, item, imap_get_st_ar(array, increment++));
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("FROM", 4)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, item, imap_get_st_ar(array, increment++));
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("TO", 2)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, item, imap_get_st_ar(array, increment++));
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SUBJECT", 7)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, item, imap_get_st_ar(array, increment++));
-		}
-		// This search term takes two parameters.
-		else if (increment + 1 < number && !st_cmp_ci_eq(item, PLACER("HEADER", 6)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY &&
-			imap_get_type_ar(array, increment + 1) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_header(user, message, header, current, imap_get_st_ar(array, increment), imap_get_st_ar(array, increment + 1));
-			increment += 2;
-		}
+/**
+ * @brief	Compile a list of search keys into a search plan.
+ * @note	The keys in a list are implicitly and'ed together, and an empty list matches every message.
+ * @param	array		the array of search arguments.
+ * @param	recursion	the current nesting depth.
+ * @return	NULL on failure, or a pointer to the root of the compiled search plan.
+ */
+imap_search_node_t * imap_search_compile(imap_arguments_t *array, unsigned recursion) {
 
-		// Body checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("BODY", 4)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_body(user, message, current, imap_get_st_ar(array, increment++));
-		}
+	size_t position = 0;
+	imap_search_node_t *node, *child, *last = NULL;
 
-		// Full message checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("TEXT", 4)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_text(user, message, current, imap_get_st_ar(array, increment++));
-		}
+	if (!(node = imap_search_node(IMAP_SEARCH_AND))) {
+		return NULL;
+	}
 
-		// Size checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("LARGER", 6)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_size(current, imap_get_st_ar(array, increment++), 1);
-		}
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("SMALLER", 7)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_size(current, imap_get_st_ar(array, increment++), 0);
-		}
+	// Recursion limiter.
+	if (recursion >= IMAP_SEARCH_RECURSION_LIMIT) {
+		log_pedantic("Recursion limit hit.");
+		node->type = IMAP_SEARCH_NONE;
+		return node;
+	}
 
-		// Range checks.
-		else if (increment < number && !st_cmp_ci_eq(item, PLACER("UID", 3)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY
-			&& imap_valid_sequence(imap_get_st_ar(array, increment)) == 1) {
-			eval = imap_search_messages_range(current, imap_get_st_ar(array, increment++), 1);
-		}
-		// If the characters make up a valid sequence, try parsing it.
-		else if (imap_valid_sequence(item) == 1) {
-			eval = imap_search_messages_range(current, item, 0);
-		}
+	while (array && position < ar_length_get(array)) {
 
-		// All messages matches everything.
-		else if (!st_cmp_ci_eq(item, PLACER("ALL", 3))) {
-			eval = 1;
+		if (!(child = imap_search_compile_key(array, &position, recursion))) {
+			imap_search_free(node);
+			return NULL;
 		}
 
-		// Handle negation.
-		else if (not == 0 && !st_cmp_ci_eq(item, PLACER("NOT", 3))) {
-			not = 2;
-		}
+		if (last) last->next = child;
+		else node->children = child;
 
-		// Handle the ors.
-		else if (or == 0 && !st_cmp_ci_eq(item, PLACER("OR", 2))) {
-			or = 3;
-		}
+		node->content |= child->content;
+		last = child;
+	}
 
-		// We don't support KEYWORD, so just skip over its parameter, and since no messages will ever contain it, return an empty set.
-		else if (!st_cmp_ci_eq(item, PLACER("KEYWORD", 7))) {
-			eval = -1;
-		}
-		// We don't support UNKEYWORD, so just skip over its parameter.
-		else if (!st_cmp_ci_eq(item, PLACER("UNKEYWORD", 9))) {
-			eval = 1;
+	return node;
+}
+
+/**
+ * @brief	Free the packed message metadata used to evaluate a search plan.
+ * @param	rows	the packed message metadata to be freed.
+ * @return	This function returns no value.
+ */
+static void imap_search_rows_free(imap_search_rows_t *rows) {
+
+	if (rows->uids) mm_free(rows->uids);
+	if (rows->sequences) mm_free(rows->sequences);
+	if (rows->sizes) mm_free(rows->sizes);
+	if (rows->created) mm_free(rows->created);
+	if (rows->status) mm_free(rows->status);
+	if (rows->days) mm_free(rows->days);
+
+	mm_wipe(rows, sizeof(imap_search_rows_t));
+	return;
+}
+
+/**
+ * @brief	Copy the metadata for the messages in the selected folder into parallel columns.
+ * @param	con		the connection which issued the search.
+ * @param	rows	the structure which will hold the packed message metadata.
+ * @return	true on success, or false on failure.
+ */
+static bool_t imap_search_rows_load(connection_t *con, imap_search_rows_t *rows) {
+
+	uint64_t count = 0;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+
+	mm_wipe(rows, sizeof(imap_search_rows_t));
+	rows->user = con->imap.user;
+	rows->selected = con->imap.selected;
+
+	meta_user_rlock(rows->user);
+
+	if (!rows->user->messages || !(cursor = inx_cursor_alloc(rows->user->messages))) {
+		meta_user_unlock(rows->user);
+		return false;
+	}
+
+	while ((active = inx_cursor_value_next(cursor))) {
+		if (active->foldernum == rows->selected) count++;
+	}
+
+	// Allocate at least one word so an empty folder doesn't need to be special cased.
+	rows->words = (count + 63) / 64;
+	if (!rows->words) rows->words = 1;
+
+	if (!(rows->uids = mm_alloc(sizeof(uint64_t) * rows->words * 64)) || !(rows->sequences = mm_alloc(sizeof(uint64_t) * rows->words * 64)) ||
+		!(rows->sizes = mm_alloc(sizeof(uint64_t) * rows->words * 64)) || !(rows->created = mm_alloc(sizeof(uint64_t) * rows->words * 64)) ||
+		!(rows->status = mm_alloc(sizeof(uint32_t) * rows->words * 64))) {
+		log_pedantic("Unable to allocate the search columns. {rows = %lu}", count);
+		meta_user_unlock(rows->user);
+		inx_cursor_free(cursor);
+		imap_search_rows_free(rows);
+		return false;
+	}
+
+	inx_cursor_reset(cursor);
+
+	// The message index is ordered by UID, so the columns will be as well.
+	while (rows->rows < count && (active = inx_cursor_value_next(cursor))) {
+		if (active->foldernum == rows->selected) {
+			rows->uids[rows->rows] = active->messagenum;
+			rows->sequences[rows->rows] = active->sequencenum;
+			rows->sizes[rows->rows] = active->size;
+			rows->created[rows->rows] = active->created;
+			rows->status[rows->rows] = active->status;
+
+			if (active->messagenum > rows->uid_max) rows->uid_max = active->messagenum;
+			if (active->sequencenum > rows->sequence_max) rows->sequence_max = active->sequencenum;
+			rows->rows++;
 		}
-		// We don't support searches that are aware of character set translations..
-		else if (!st_cmp_ci_eq(item, PLACER("CHARSET", 7))) {
-			increment++;
+	}
+
+	meta_user_unlock(rows->user);
+	inx_cursor_free(cursor);
+	return true;
+}
+
+/**
+ * @brief	Convert the internal date of every row into a calendar day number.
+ * @note	The conversion is only performed the first time a plan needs it.
+ * @param	rows	the packed message metadata.
+ * @return	true on success, or false on failure.
+ */
+static bool_t imap_search_rows_days(imap_search_rows_t *rows) {
+
+	time_t utime;
+	struct tm ltime;
+
+	if (rows->days) {
+		return true;
+	}
+	else if (!(rows->days = mm_alloc(sizeof(uint32_t) * rows->words * 64))) {
+		log_pedantic("Unable to allocate the search date column.");
+		return false;
+	}
+
+	for (uint64_t i = 0; i < rows->rows; i++) {
+		if ((utime = rows->created[i]) && localtime_r(&utime, &ltime)) {
+			rows->days[i] = ((ltime.tm_year + 1900) * 10000) + ((ltime.tm_mon + 1) * 100) + ltime.tm_mday;
 		}
-		// Unrecognized search parameter.
-		else {
-			//log_pedantic("Unrecognized search keyword %.*s.", st_length_get(item), st_char_get(item));
-			eval = -1;
+	}
+
+	return true;
+}
+
+// Find the row holding a UID, using a binary search.
+static bool_t imap_search_rows_find(imap_search_rows_t *rows, uint64_t uid, uint64_t *row) {
+
+	uint64_t low = 0, high = rows->rows, middle;
+
+	while (low < high) {
+		middle = low + ((high - low) / 2);
+
+		if (rows->uids[middle] < uid) low = middle + 1;
+		else high = middle;
+	}
+
+	if (low < rows->rows && rows->uids[low] == uid) {
+		*row = low;
+		return true;
+	}
+
+	return false;
+}
+
+// Check whether a value falls inside any of the ranges attached to a node.
+static bool_t imap_search_ranges_match(imap_search_node_t *node, uint64_t value, uint64_t max) {
+
+	uint64_t start, end, swap;
+
+	for (uint64_t i = 0; i < node->count; i++) {
+		start = node->ranges[i * 2] == UINT64_MAX ? max : node->ranges[i * 2];
+		end = node->ranges[(i * 2) + 1] == UINT64_MAX ? max : node->ranges[(i * 2) + 1];
+
+		// Resolving the asterisk can leave the bounds out of order.
+		if (start > end) {
+			swap = start;
+			start = end;
+			end = swap;
 		}
 
-		// Change the value if not is enabled.
-		if (not == 2) {
-			not = 1;
+		if (value >= start && value <= end) {
+			return true;
 		}
-		else if (not == 1) {
-			not = 0;
-			if (eval == 1) {
-				eval = -1;
+	}
+
+	return false;
+}
+
+// Compare a calendar day using the BEFORE (0), ON (1) or SINCE (2) semantics. Messages without a valid date never match.
+static inline bool_t imap_search_date(int_t comparison, uint32_t day, uint64_t number) {
+
+	if (!day) {
+		return false;
+	}
+	else if (comparison == 0) {
+		return day < number;
+	}
+	else if (comparison == 1) {
+		return day == number;
+	}
+
+	return day >= number;
+}
+
+/**
+ * @brief	Evaluate a search plan against a single message.
+ * @param	rows	the packed message metadata.
+ * @param	node	the search plan node to be evaluated.
+ * @param	row		the row holding the message metadata.
+ * @param	active	the message being examined.
+ * @param	message	a pointer to the message, which is loaded if necessary.
+ * @param	header	a pointer to the message header, which is loaded if necessary.
+ * @return	true if the message matches, or false if it doesn't.
+ */
+static bool_t imap_search_row(imap_search_rows_t *rows, imap_search_node_t *node, uint64_t row, meta_message_t *active, mail_message_t **message,
+	stringer_t **header) {
+
+	imap_search_node_t *child;
+
+	switch (node->type) {
+		case (IMAP_SEARCH_ALL):
+			return true;
+		case (IMAP_SEARCH_AND):
+			// Check the metadata before loading the message content.
+			for (int_t pass = 0; pass < 2; pass++) {
+				for (child = node->children; child; child = child->next) {
+					if ((child->content ? 1 : 0) == pass && !imap_search_row(rows, child, row, active, message, header)) {
+						return false;
+					}
+				}
 			}
-			else {
-				eval = 1;
+			return true;
+		case (IMAP_SEARCH_OR):
+			for (child = node->children; child; child = child->next) {
+				if (imap_search_row(rows, child, row, active, message, header)) {
+					return true;
+				}
 			}
-		}
-
-		// Handle the or'ing.
-		if (or == 3) {
-			or = 2;
-			output = 0;
-		}
-		else if (or == 2) {
-			if (eval == 1) {
-				output = 1;
+			return false;
+		case (IMAP_SEARCH_NOT):
+			return !imap_search_row(rows, node->children, row, active, message, header);
+		case (IMAP_SEARCH_FLAGS):
+			return (rows->status[row] & node->mask) == node->flags;
+		case (IMAP_SEARCH_LARGER):
+			return rows->sizes[row] > node->number;
+		case (IMAP_SEARCH_SMALLER):
+			return rows->sizes[row] < node->number;
+		case (IMAP_SEARCH_SEQUENCE):
+			return imap_search_ranges_match(node, rows->sequences[row], rows->sequence_max);
+		case (IMAP_SEARCH_UID):
+			return imap_search_ranges_match(node, rows->uids[row], rows->uid_max);
+		case (IMAP_SEARCH_BEFORE):
+		case (IMAP_SEARCH_ON):
+		case (IMAP_SEARCH_SINCE):
+			return imap_search_rows_days(rows) && imap_search_date(node->type - IMAP_SEARCH_BEFORE, rows->days[row], node->number);
+		case (IMAP_SEARCH_SENTBEFORE):
+		case (IMAP_SEARCH_SENTON):
+		case (IMAP_SEARCH_SENTSINCE):
+			return imap_search_date(node->type - IMAP_SEARCH_SENTBEFORE, imap_search_messages_sent(rows->user, message, header, active), node->number);
+		case (IMAP_SEARCH_HEADER):
+			return imap_search_messages_header(rows->user, message, header, active, node->field, node->value) == 1;
+		case (IMAP_SEARCH_BODY):
+			// The index can only rule messages out, so the candidates are still scanned for the search string.
+			if (node->matches && !fulltext_result_contains(node->matches, active->messagenum) && fulltext_indexed(rows->user->usernum, active->messagenum)) {
+				return false;
 			}
-			or--;
-		}
-		else if (or == 1) {
-			if (output != 1 && eval == 1) {
-				output = 1;
+			return imap_search_messages_body(rows->user, message, active, node->value) == 1;
+		case (IMAP_SEARCH_TEXT):
+			if (node->matches && !fulltext_result_contains(node->matches, active->messagenum) && fulltext_indexed(rows->user->usernum, active->messagenum)) {
+				return false;
 			}
-			or--;
-		}
-		else {
-			output = eval;
+			return imap_search_messages_text(rows->user, message, active, node->value) == 1;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Look up the body and text search strings in the full text search index.
+ * @note	The index is used to rule out the indexed messages which can't contain a search string. If the index is disabled, or a search
+ * 			string can't be narrowed using the index, the node is left alone and the content of every candidate message will be scanned.
+ * @param	user	the user who owns the messages being searched.
+ * @param	node	the search plan node to be prepared.
+ * @return	This function returns no value.
+ */
+static void imap_search_prepare(meta_user_t *user, imap_search_node_t *node) {
+
+	for (; node; node = node->next) {
+
+		if ((node->type == IMAP_SEARCH_BODY || node->type == IMAP_SEARCH_TEXT) && fulltext_enabled()) {
+			node->matches = fulltext_query(user->usernum, node->value, node->type == IMAP_SEARCH_TEXT);
 		}
+
+		imap_search_prepare(user, node->children);
 	}
 
-	return output;
+	return;
 }
 
-inx_t * imap_search_messages(connection_t *con) {
+/**
+ * @brief	Evaluate a search plan one message at a time, clearing the bits of the messages which don't match.
+ * @note	This is only used for plans which need the message content, and only the messages still set in the bitmap are loaded. To
+ * 			avoid starving other threads, the user lock is released and the walk deferred for a moment after each second of work.
+ * @param	rows	the packed message metadata.
+ * @param	node	the search plan node to be evaluated.
+ * @param	bitmap	the candidate messages, which is updated to hold the matching messages.
+ * @return	true on success, or false if the walk was interrupted.
+ */
+static bool_t imap_search_walk(imap_search_rows_t *rows, imap_search_node_t *node, uint64_t *bitmap) {
 
 	time_t start;
-	inx_t *output;
+	uint64_t row, uid = 0;
+	bool_t finished = false;
 	inx_cursor_t *cursor = NULL;
 	stringer_t *header = NULL;
 	mail_message_t *message = NULL;
-	uint64_t finished = 0, uid = 0, count = 0;
-	meta_message_t *duplicate, *active = NULL;
-	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
-
-	if (!con || !(output = inx_alloc(M_INX_LINKED, &meta_message_free))) {
-		return NULL;
-	}
+	meta_message_t *active = NULL;
 
 	while (status() && !finished) {
 
-		/// LOW: Is a read lock necessary now that were using index reference counters and thread safe iteration cursors?
-		meta_user_rlock(con->imap.user);
+		meta_user_rlock(rows->user);
 		start = time(NULL);
+		active = NULL;
 
-		if (con->imap.user && con->imap.user->messages && (cursor = inx_cursor_alloc(con->imap.user->messages))) {
-			while (uid && (active = inx_cursor_value_next(cursor)) && active->messagenum <= uid);
-		} else {
-			finished = 1;
-		}
+		if (rows->user->messages && (cursor = inx_cursor_alloc(rows->user->messages))) {
 
-		while (!finished && time(NULL) != (start + 1) && (active = inx_cursor_value_next(cursor))) {
+			// Skip the messages examined before the lock was released.
+			while ((active = inx_cursor_value_next(cursor)) && active->messagenum <= uid);
 
-			// Check for a match.
-			if (active->foldernum == con->imap.selected &&
-					imap_search_messages_inner(con->imap.user, &message, &header, active, con->imap.arguments, 0) == 1 &&
-					(key.val.u64 = active->messagenum) && (duplicate = meta_message_dupe(active)) &&
-					inx_insert(output, key, duplicate) != true) {
-				meta_message_free(duplicate);
-			}
+			while (active && time(NULL) < (start + 1)) {
 
-			// Cleanup, if needed.
-			if (message != NULL) {
-				mail_destroy(message);
-				message = NULL;
-			}
-			// Cleanup, if needed.
-			if (header != NULL) {
-				mail_destroy_header(header);
-				header = NULL;
+				if (active->foldernum == rows->selected && imap_search_rows_find(rows, active->messagenum, &row) &&
+					(bitmap[row / 64] & ((uint64_t)1 << (row % 64))) && !imap_search_row(rows, node, row, active, &message, &header)) {
+					bitmap[row / 64] &= ~((uint64_t)1 << (row % 64));
+				}
+
+				// Cleanup, if needed.
+				if (message != NULL) {
+					mail_destroy(message);
+					message = NULL;
+				}
+				// Cleanup, if needed.
+				if (header != NULL) {
+					mail_destroy_header(header);
+					header = NULL;
+				}
+
+				uid = active->messagenum;
+				active = inx_cursor_value_next(cursor);
 			}
 
-			uid = active->messagenum;
-			count++;
+			inx_cursor_free(cursor);
 		}
 
-		meta_user_unlock(con->imap.user);
-		inx_cursor_free(cursor);
+		meta_user_unlock(rows->user);
 
-		// If the search is defers it should also sleep to allowing other threads access.
+		// If the search is deferred it should also sleep to allowing other threads access.
 		if (!active) {
-			finished = 1;
+			finished = true;
 		}
 		else {
 			usleep(10000);
@@ -631,28 +868,217 @@ inx_t * imap_search_messages(connection_t *con) {
 
 	}
 
-	// We need to update the sequence numbers.
-	if (!finished && con->imap.uid != 1 && con->imap.messages_checkpoint != con->imap.user->serials.messages && (cursor = inx_cursor_alloc(output))) {
-		meta_user_rlock(con->imap.user);
+	return finished;
+}
+
+/**
+ * @brief	Evaluate a search plan against the packed message metadata.
+ * @note	Metadata terms are evaluated a word at a time over the columns, and narrow the candidates seen by any terms which need the
+ * 			message content.
+ * @param	rows		the packed message metadata.
+ * @param	node		the search plan node to be evaluated.
+ * @param	candidates	a bitmap of the messages which could still match.
+ * @param	result		a bitmap which will hold the matching messages.
+ * @return	true on success, or false on failure.
+ */
+static bool_t imap_search_evaluate(imap_search_rows_t *rows, imap_search_node_t *node, uint64_t *candidates, uint64_t *result) {
+
+	uint64_t bits, row;
+	bool_t outcome = true;
+	imap_search_node_t *child;
+	size_t length = sizeof(uint64_t) * rows->words;
+	uint64_t *scratch = NULL, *remaining = NULL;
+
+	// Subtrees which need the message content are evaluated one message at a time.
+	if (node->content && node->type != IMAP_SEARCH_AND) {
+		mm_copy(result, candidates, length);
+		return imap_search_walk(rows, node, result);
+	}
+
+	switch (node->type) {
+		case (IMAP_SEARCH_NONE):
+			mm_wipe(result, length);
+			break;
+		case (IMAP_SEARCH_ALL):
+			mm_copy(result, candidates, length);
+			break;
+		case (IMAP_SEARCH_AND):
+			mm_copy(result, candidates, length);
+
+			if (!(scratch = mm_alloc(length))) {
+				return false;
+			}
+
+			for (child = node->children; outcome && child; child = child->next) {
+				if (!child->content && (outcome = imap_search_evaluate(rows, child, result, scratch))) {
+					mm_copy(result, scratch, length);
+				}
+			}
 
-		while ((active = inx_cursor_value_next(cursor)) && con->imap.user && con->imap.user->messages) {
+			// The content terms only see the messages which survived the metadata terms.
+			if (outcome && node->content) {
+				outcome = imap_search_walk(rows, node, result);
+			}
+
+			mm_free(scratch);
+			break;
+		case (IMAP_SEARCH_OR):
+			mm_wipe(result, length);
+
+			if (!(scratch = mm_alloc(length)) || !(remaining = mm_dupe(candidates, length))) {
+				if (scratch) mm_free(scratch);
+				return false;
+			}
+
+			// Messages matched by an earlier term don't need to be checked by the later ones.
+			for (child = node->children; outcome && child; child = child->next) {
+				if ((outcome = imap_search_evaluate(rows, child, remaining, scratch))) {
+					for (uint64_t w = 0; w < rows->words; w++) {
+						result[w] |= scratch[w];
+						remaining[w] &= ~scratch[w];
+					}
+				}
+			}
+
+			mm_free(remaining);
+			mm_free(scratch);
+			break;
+		case (IMAP_SEARCH_NOT):
+			if (!(scratch = mm_alloc(length))) {
+				return false;
+			}
+			else if ((outcome = imap_search_evaluate(rows, node->children, candidates, scratch))) {
+				for (uint64_t w = 0; w < rows->words; w++) {
+					result[w] = candidates[w] & ~scratch[w];
+				}
+			}
 
-			key = inx_cursor_key_active(cursor);
-			duplicate = inx_find(con->imap.user->messages, key);
+			mm_free(scratch);
+			break;
+		case (IMAP_SEARCH_FLAGS):
+			for (uint64_t w = 0; w < rows->words; w++) {
+				for (bits = 0, row = 0; row < 64; row++) {
+					bits |= (uint64_t)((rows->status[(w * 64) + row] & node->mask) == node->flags) << row;
+				}
+				result[w] = candidates[w] & bits;
+			}
+			break;
+		case (IMAP_SEARCH_LARGER):
+			for (uint64_t w = 0; w < rows->words; w++) {
+				for (bits = 0, row = 0; row < 64; row++) {
+					bits |= (uint64_t)(rows->sizes[(w * 64) + row] > node->number) << row;
+				}
+				result[w] = candidates[w] & bits;
+			}
+			break;
+		case (IMAP_SEARCH_SMALLER):
+			for (uint64_t w = 0; w < rows->words; w++) {
+				for (bits = 0, row = 0; row < 64; row++) {
+					bits |= (uint64_t)(rows->sizes[(w * 64) + row] < node->number) << row;
+				}
+				result[w] = candidates[w] & bits;
+			}
+			break;
+		case (IMAP_SEARCH_BEFORE):
+		case (IMAP_SEARCH_ON):
+		case (IMAP_SEARCH_SINCE):
+			if (!imap_search_rows_days(rows)) {
+				return false;
+			}
 
-			// If the message wasn't found, set the sequence number to zero so its not included in the output.
-			if (!duplicate || active->messagenum != duplicate->messagenum) {
-				active->sequencenum = 0;
+			for (uint64_t w = 0; w < rows->words; w++) {
+				for (bits = 0, row = 0; row < 64; row++) {
+					bits |= (uint64_t)imap_search_date(node->type - IMAP_SEARCH_BEFORE, rows->days[(w * 64) + row], node->number) << row;
+				}
+				result[w] = candidates[w] & bits;
 			}
-			else {
-				active->sequencenum = duplicate->sequencenum;
+			break;
+		case (IMAP_SEARCH_SEQUENCE):
+		case (IMAP_SEARCH_UID):
+			mm_wipe(result, length);
+
+			for (row = 0; row < rows->rows; row++) {
+				if ((candidates[row / 64] & ((uint64_t)1 << (row % 64))) && imap_search_ranges_match(node, node->type == IMAP_SEARCH_UID ?
+					rows->uids[row] : rows->sequences[row], node->type == IMAP_SEARCH_UID ? rows->uid_max : rows->sequence_max)) {
+					result[row / 64] |= ((uint64_t)1 << (row % 64));
+				}
 			}
+			break;
+		default:
+			mm_wipe(result, length);
+			break;
+	}
+
+	return outcome;
+}
+
+/**
+ * @brief	Find the messages in the selected folder which match the search criteria supplied by the client.
+ * @note	The criteria are compiled into a plan once, and then evaluated against a packed copy of the folder metadata. Only the
+ * 			messages which survive the metadata terms are loaded to check any header, body or text terms, and body or text terms are
+ * 			answered using the full text search index when the message has been indexed.
+ * @param	con		the connection which issued the search.
+ * @return	NULL on failure, or an index of the matching messages, keyed by UID.
+ */
+inx_t * imap_search_messages(connection_t *con) {
+
+	inx_t *output;
+	uint64_t row;
+	inx_cursor_t *cursor;
+	imap_search_rows_t rows;
+	imap_search_node_t *plan;
+	meta_message_t *duplicate, *active;
+	uint64_t *candidates = NULL, *matches = NULL;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	if (!con || !con->imap.user || !(output = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+		return NULL;
+	}
+	else if (!(plan = imap_search_compile(con->imap.arguments, 0))) {
+		return output;
+	}
+	else if (!imap_search_rows_load(con, &rows)) {
+		imap_search_free(plan);
+		return output;
+	}
+
+	if ((candidates = mm_alloc(sizeof(uint64_t) * rows.words)) && (matches = mm_alloc(sizeof(uint64_t) * rows.words))) {
+
+		for (row = 0; row < rows.rows; row++) {
+			candidates[row / 64] |= ((uint64_t)1 << (row % 64));
 		}
 
-		meta_user_unlock(con->imap.user);
-		inx_cursor_free(cursor);
+		if (plan->content) {
+			imap_search_prepare(con->imap.user, plan);
+		}
+
+		// Copy the matching messages, so the sequence numbers reflect the current state of the folder.
+		if (imap_search_evaluate(&rows, plan, candidates, matches)) {
+
+			meta_user_rlock(con->imap.user);
+
+			if (con->imap.user->messages && (cursor = inx_cursor_alloc(con->imap.user->messages))) {
+
+				while ((active = inx_cursor_value_next(cursor))) {
+					if (active->foldernum == rows.selected && imap_search_rows_find(&rows, active->messagenum, &row) &&
+						(matches[row / 64] & ((uint64_t)1 << (row % 64))) && (key.val.u64 = active->messagenum) &&
+						(duplicate = meta_message_dupe(active)) && inx_insert(output, key, duplicate) != true) {
+						meta_message_free(duplicate);
+					}
+				}
+
+				inx_cursor_free(cursor);
+			}
+
+			meta_user_unlock(con->imap.user);
+		}
 	}
 
+	if (candidates) mm_free(candidates);
+	if (matches) mm_free(matches);
+	imap_search_rows_free(&rows);
+	imap_search_free(plan);
+
 	return output;
 }
 
@@ -136,7 +136,5 @@ void imap_session_destroy(connection_t *con) {
 		ar_free(con->imap.arguments);
 	}
 
-	mail_cache_reset();
-
 	return;
 }
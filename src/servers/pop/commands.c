@@ -39,7 +39,7 @@ void pop_requeue(connection_t *con) {
 		enqueue(&pop_quit, con);
 	}
 	else {
-		enqueue(&pop_process, con);
+		con_park(con, &pop_process);
 	}
 
 	return;
@@ -61,7 +61,7 @@ void pop_process(connection_t *con) {
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&pop_process, con);
+		con_park(con, &pop_process);
 		return;
 	}
 
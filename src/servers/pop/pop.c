@@ -38,13 +38,16 @@ void pop_starttls(connection_t *con) {
 	// Tell the user that we are ready to start the negotiation.
 	con_write_bl(con, "+OK Ready to start TLS negotiation.\r\n", 37);
 
+	// Make sure the reply is sent in the clear before the handshake begins.
+	con_flush(con);
+
 	if (!(con->network.ssl = ssl_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
 		con_write_bl(con, "-ERR STARTTLS FAILED\r\n", 22);
 		log_pedantic("The SSL connection attempt failed.");
 		return;
 	}
 
-	stats_increment_by_name("pop.connections.secure");
+	stats_increment_by_num(STATS_POP_CONNECTIONS_SECURE);
 	st_length_set(con->network.buffer, 0);
 	con->network.line = pl_null();
 	con->network.status = 1;
@@ -534,6 +537,57 @@ void pop_uidl(connection_t *con) {
 	return;
 }
 
+/**
+ * @brief	Write the beginning of a message to a POP3 client, dot stuffing it along the way.
+ * @note	Rather than building a dot stuffed copy of the message, the text is written in segments which end at every line that begins
+ * 			with a period, and the extra period is written between them. Cached messages are written using the message cache, which allows
+ * 			large messages to be handed to the kernel without being copied.
+ * @param	con		the POP3 client connection the message is being sent to.
+ * @param	message	the mail message object to be written.
+ * @param	length	the number of bytes of message text to be written.
+ * @return	This function returns no value.
+ */
+static void pop_write_message(connection_t *con, mail_message_t *message, size_t length) {
+
+	chr_t *text, *hit;
+	size_t position = 0, segment;
+
+	text = st_char_get(message->text);
+
+	// Tell the client to prepare for a message. The size is strictly informational.
+	con_print(con, "+OK %zu characters follow.\r\n", length);
+
+	while (position < length) {
+
+		// The segment includes the line break, so the period which begins the next line is preceded by the stuffing period.
+		if ((hit = memmem(text + position, length - position, "\n.", 2))) {
+			segment = hit - (text + position) + 1;
+		}
+		else {
+			segment = length - position;
+		}
+
+		if ((message->cache ? mail_cache_write(con, message->cache, position, segment) : con_write_bl(con, text + position, segment)) != segment) {
+			return;
+		}
+		else if (hit && con_write_bl(con, ".", 1) != 1) {
+			return;
+		}
+
+		position += segment;
+	}
+
+	// If the message didn't end with a line break, spit two.
+	if (length && *(text + length - 1) == '\n') {
+		con_write_bl(con, ".\r\n", 3);
+	}
+	else {
+		con_write_bl(con, "\r\n.\r\n", 5);
+	}
+
+	return;
+}
+
 /**
  * @brief	Get the top lines of a message or collection of messages, in response to a POP3 TOP command.
  * @note	This function will fail if a deleted message was specified by the user.
@@ -573,8 +627,8 @@ void pop_top(connection_t *con) {
 		return;
 	}
 
-	// Load the message and spit back the right number of lines.
-	if (!(message = mail_load_message_top(meta, con->pop.user, con->server, lines, true))) {
+	// Load the message, the number of lines we spit back is determined below.
+	if (!(message = mail_load_message(meta, con->pop.user, con->server, 1))) {
 		meta_user_unlock(con->pop.user);
 		con_write_bl(con, "-ERR The message you requested could not be loaded into memory. It has either been deleted "
 			"by another connection or is corrupted.\r\n", 131);
@@ -583,23 +637,7 @@ void pop_top(connection_t *con) {
 
 	meta_user_unlock(con->pop.user);
 
-	// Dot stuff the message.
-	st_replace(&(message->text), PLACER("\n.", 2), PLACER("\n..", 3));
-
-	// Tell the client to prepare for a message. The size is strictly informational.
-	con_print(con, "+OK %u characters follow.\r\n", st_length_get(message->text));
-
-	// We use raw socket IO because it is much faster when writing large amounts of data.
-	con_write_st(con, message->text);
-
-	// If the message didn't end with a line break, spit two.
-	if (*(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
-		con_write_bl(con, ".\r\n", 3);
-	}
-	else {
-		con_write_bl(con, "\r\n.\r\n", 5);
-	}
-
+	pop_write_message(con, message, mail_message_top_length(message->text, lines));
 	mail_destroy(message);
 
 	return;
@@ -644,7 +682,7 @@ void pop_retr(connection_t *con) {
 		return;
 	}
 
-	// Load the message and spit back the right number of lines.
+	// Load the message. The text is dot stuffed as it's written, so it can be shared with the message cache.
 	if (!(message = mail_load_message(meta, con->pop.user, con->server, 1))) {
 		meta_user_unlock(con->pop.user);
 		con_write_bl(con, "-ERR The message you requested could not be loaded into memory. It has either been "
@@ -654,23 +692,7 @@ void pop_retr(connection_t *con) {
 
 	meta_user_unlock(con->pop.user);
 
-	// Dot stuff the message.
-	st_replace(&(message->text), PLACER("\n.", 2), PLACER("\n..", 3));
-
-	// Tell the client to prepare for a message. The size is strictly informational.
-	con_print(con, "+OK %u characters follow.\r\n", st_length_get(message->text));
-
-	// We use raw socket IO because it is much faster when writing large amounts of data.
-	con_write_st(con, message->text);
-
-	// If the message didn't end with a line break, spit two.
-	if (*(st_char_get(message->text) + st_length_get(message->text) - 1) == '\n') {
-		con_write_bl(con, ".\r\n", 3);
-	}
-	else {
-		con_write_bl(con, "\r\n.\r\n", 5);
-	}
-
+	pop_write_message(con, message, st_length_get(message->text));
 	mail_destroy(message);
 
 	return;
@@ -99,7 +99,6 @@ void pop_session_destroy(connection_t *con) {
 	}
 
 	st_cleanup(con->pop.username);
-	mail_cache_reset();
 
 	return;
 }
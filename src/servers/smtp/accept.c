@@ -202,6 +202,7 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 	int_t state;
 	stringer_t *local;
+	struct timespec start, finish;
 
 	if (con == NULL || prefs == NULL) {
 		log_pedantic("Sanity check failed.");
@@ -246,7 +247,7 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 		// The message hasn't been scanned, or encountered an error during the last attempt, so rescan it now.
 		if (con->smtp.checked.virus == 0 || con->smtp.checked.virus == -1) {
-			con->smtp.checked.virus = state = virus_check(con->smtp.message->text);
+			con->smtp.checked.virus = state = smtp_pipeline_check(con, SMTP_CHECK_VIRUS);
 		}
 		else {
 			state = con->smtp.checked.virus;
@@ -314,7 +315,7 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
 		// This message hasn't been checked yet.
 		if (con->smtp.checked.dkim == 0) {
-			con->smtp.checked.dkim = dkim_check(con->smtp.message->id, con->smtp.message->text);
+			con->smtp.checked.dkim = smtp_pipeline_check(con, SMTP_CHECK_DKIM);
 		}
 
 		// What action.
@@ -361,7 +362,14 @@ int_t smtp_accept_message(connection_t *con, smtp_inbound_prefs_t *prefs) {
 	}
 
 	if (!con->smtp.bypass && (prefs->mark == SMTP_MARK_NONE) && (prefs->spam == 1)) {
-		if ((prefs->spam_checked = dspam_check(prefs->usernum, local, &(prefs->spamsig))) == -1) {
+
+		// The statistical filter depends on the recipient, so it can't join the other checks in the pipeline, but its latency is tracked alongside them.
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		prefs->spam_checked = dspam_check(prefs->usernum, local, &(prefs->spamsig));
+		clock_gettime(CLOCK_MONOTONIC, &finish);
+		stats_adjust_by_num(STATS_SMTP_CHECKS_DSPAM_TIME, smtp_pipeline_elapsed(&start, &finish));
+
+		if (prefs->spam_checked == -1) {
 			st_free(local);
 			return SMTP_OUTCOME_TEMP_SERVER;
 		}
@@ -17,27 +17,24 @@
  * @note	The greylist is configured in the Dispatch table and specifies the minimum time, in minutes, that a transmitting smtp
  * 			relay server must wait in order to be able to send more messages to the same recipient address again.
  *
- *
- *
- *
+ * 			The stamps are checked against the local tally store, which only consults the distributed cache the first time it sees a
+ * 			key, so a sender retrying through another host, or after a restart, isn't greylisted again. The tally store syncs its stamps
+ * 			with the other hosts in the background.
  * @param	con		the connection to have its remote address checked against the user's greylist.
  * @param	prefs	the smtp inbound preferences of the user
  * @return -1 on general error, -2 if the check failed, and 1 if the check was passed.
  */
 int_t smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs) {
 
-	int_t result = -2;
-	uint64_t now, stamp, updated;
-	stringer_t *value = NULL, *addr = MANAGEDBUF(128), *key = MANAGEDBUF(256);
+	int_t state;
+	time_t first;
+	stringer_t *addr = MANAGEDBUF(128), *key = MANAGEDBUF(256);
 
 	// Being on the bypass list skips all of this
 	if (con->smtp.bypass) {
 		return 1;
 	}
 
-	// Store the time.
-	now = time(NULL);
-
 	if (!(addr = con_addr_reversed(con, addr))) {
 		log_pedantic("Address string creation failed.");
 		return -1;
@@ -49,89 +46,71 @@ int_t smtp_check_greylist(connection_t *con, smtp_inbound_prefs_t *prefs) {
 		return -1;
 	}
 
-	// Pull the cache value and see if its old enough.
-	if ((value = cache_get(key)) && st_length_get(value) == 16) {
-		stamp = *((uint64_t *)st_data_get(value));
-		updated = *(((uint64_t *)st_data_get(value)) + 1);
-
-		// If the different between now and the stamp is converted to minutes and greater than greytime, let the message through.
-		if (((stamp - now) / 60) > prefs->greytime) {
-			result = 1;
-		}
-		else {
-			result = -2;
-		}
-
-		// QUESTION: This logic seems off.
-		// If the updated time is more than 1 day old, set the value in cache again so it won't be expired.
-		if ((now - 86400) > updated) {
-			*(((uint64_t *)st_data_get(value)) + 1) = now;
-			cache_set(key, value, 2592000);
-		}
-	}
-	// If no value was found in the database, store the current time. Errors result in a neutral return code.
-	else if (!(value = st_alloc_opts(BLOCK_T | CONTIGUOUS | HEAP, 16)) || (*((uint64_t *)st_data_get(value)) = now) ||
-		(*(((uint64_t *)st_data_get(value)) + 1) = now) || cache_set(key, value, 2592000) != 1) {
+	// Stamps are kept for thirty days after the last attempt.
+	if ((state = tally_stamp(key, 2592000, &first)) < 0) {
 		log_pedantic("Unable to set greylist attempt record.");
-		result = -1;
+		return -1;
 	}
-
-	// If no value was found in the cache, and it was created successfully, we'll end up here, so make the sender wait and retry.
-	else {
-		result = -2;
+	// This is the first attempt, so make the sender wait and retry.
+	else if (!state) {
+		return -2;
 	}
 
-	st_cleanup(value);
-
-	return result;
+	// If the time since the first attempt, converted to minutes, has reached the greytime, let the message through.
+	return ((time(NULL) - first) / 60) >= prefs->greytime ? 1 : -2;
 }
 
 /**
  * @brief	Check the SMTP connection's remote address against a collection of real-time blacklists.
- * @note	The connection's IP address will be checked against each of the servers configured in magma.smtp.blacklists.domain.
+ * @note	The connection's IP address will be checked against each of the servers configured in magma.smtp.blacklists.domain. The
+ * 			queries are all sent at once, so the check takes as long as the slowest blacklist rather than the sum of them.
  * @param	con		the connection to have its address examined against the RBLs.
  * @return	-1 on general error, -2 if the address was blacklisted, or 1 if it passed the check.
  */
 int_t smtp_check_rbl(connection_t *con) {
 
-	int_t ret, result = -1;
-	chr_t query[NI_MAXHOST];
-	struct addrinfo *lookup, hints;
+	int_t result = -1;
 	stringer_t *addr = MANAGEDBUF(128);
-
-	mm_wipe(&hints, sizeof(struct addrinfo));
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = 0;
-	hints.ai_flags = 0;
-	hints.ai_protocol = 0;
+	chr_t queries[MAGMA_BLACKLIST_INSTANCES][NI_MAXHOST], *names[MAGMA_BLACKLIST_INSTANCES];
+	dns_answer_t answers[MAGMA_BLACKLIST_INSTANCES];
+	uint32_t count = 0;
 
 	if (!(addr = con_addr_reversed(con, addr))) {
 		log_pedantic("Address string creation failed.");
 		return result;
 	}
 
-	for (uint32_t i = 0; i < magma.smtp.blacklists.count; i++) {
+	for (uint32_t i = 0; i < magma.smtp.blacklists.count && i < MAGMA_BLACKLIST_INSTANCES; i++) {
 
 		// Build the DNS query.
-		if ((snprintf(query, NI_MAXHOST, "%.*s.%*s", st_length_int(addr), st_char_get(addr),
-			st_length_int(magma.smtp.blacklists.domain[i]),	st_char_get(magma.smtp.blacklists.domain[i]))) == 0) {
-				log_pedantic("Address string creation failed.");
+		if ((snprintf(queries[count], NI_MAXHOST, "%.*s.%.*s", st_length_int(addr), st_char_get(addr),
+			st_length_int(magma.smtp.blacklists.domain[i]),	st_char_get(magma.smtp.blacklists.domain[i]))) <= 0) {
+			log_pedantic("Address string creation failed.");
+		}
+		else {
+			names[count] = queries[count];
+			count++;
 		}
 
-		// A zero means we found a blacklist entry, so we need to free the entry.
-		else if (!(ret = getaddrinfo(query, NULL, &hints, &lookup))) {
-			freeaddrinfo(lookup);
-			return -2;
+	}
+
+	dns_resolve(count, names, ns_t_a, answers);
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		// Any address record means we found a blacklist entry.
+		if (answers[i].status == DNS_SUCCESS) {
+			result = -2;
 		}
-		// If the return code code indicates an error, rather than simply not finding a matching entry.
-		// Do we also want to exclude EAI_ADDRFAMILY or EAI_NODATA
-		else if (ret != EAI_NONAME) {
-			log_pedantic("Blacklist DNS attempt resulted in an error. {getaddrinfo = %s}", gai_strerror(ret));
+		// If the lookup resulted in an error, rather than simply not finding a matching entry.
+		else if (answers[i].status == DNS_ERROR) {
+			log_pedantic("Blacklist DNS attempt resulted in an error. {query = %s}", names[i]);
 		}
-		else {
+		else if (result != -2) {
 			result = 1;
 		}
 
+		dns_answer_clear(&answers[i]);
 	}
 
 	return result;
@@ -264,32 +243,20 @@ int_t smtp_check_filters(smtp_inbound_prefs_t *prefs, stringer_t **local) {
  */
 bool_t smtp_add_bypass_entry(stringer_t *subnet) {
 
-	subnet_t *sn;
-	multi_t key;
-	static size_t kval = 1;
+	subnet_t sn;
 
-	if (!magma.smtp.bypass_subnets && !(magma.smtp.bypass_subnets = inx_alloc(M_INX_LINKED, &mm_free))) {
+	if (!magma.smtp.bypass_subnets && !(magma.smtp.bypass_subnets = ip_list_alloc())) {
 		log_pedantic("Could not allocate space for smtp bypass list.");
 		return false;
 	}
 
-	if (!(sn = mm_alloc(sizeof(subnet_t)))) {
-		log_error("Could not allocate space for smtp bypass entry.");
-		return false;
-	}
-
-	if (!ip_str_subnet(st_char_get(subnet), sn)) {
+	if (!ip_str_subnet(st_char_get(subnet), &sn)) {
 		log_pedantic("SMTP bypass subnet was invalid { subnet = %s }", st_char_get(subnet));
-		mm_free(sn);
 		return false;
 	}
 
-	key.type = M_TYPE_UINT64;
-	key.val.u64 = kval++;
-
-	if (!inx_insert(magma.smtp.bypass_subnets, key, sn)) {
+	if (!ip_list_add(magma.smtp.bypass_subnets, &sn)) {
 		log_pedantic("Unable to create smtp bypass entry.");
-		mm_free(sn);
 		return false;
 	}
 
@@ -304,29 +271,11 @@ bool_t smtp_add_bypass_entry(stringer_t *subnet) {
  */
 bool_t smtp_bypass_check(connection_t *con) {
 
-	inx_cursor_t *cursor;
-	subnet_t *subnet;
 	ip_t remote;
-	bool_t result = false;
 
 	if (!magma.smtp.bypass_subnets || !con_addr(con, &remote)) {
 		return false;
 	}
 
-	if (!(cursor = inx_cursor_alloc(magma.smtp.bypass_subnets))) {
-		return false;
-	}
-
-	while ((subnet = inx_cursor_value_next(cursor))) {
-
-		if (ip_matches_subnet (subnet, &remote)) {
-			result = true;
-			break;
-		}
-
-	}
-
-	inx_cursor_free(cursor);
-
-	return result;
+	return ip_list_match(magma.smtp.bypass_subnets, &remote);
 }
@@ -39,7 +39,7 @@ void smtp_requeue(connection_t *con) {
 		enqueue(&smtp_quit, con);
 	}
 	else {
-		enqueue(&smtp_process, con);
+		con_park(con, &smtp_process);
 	}
 
 	return;
@@ -67,7 +67,7 @@ void smtp_process(connection_t *con) {
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&smtp_process, con);
+		con_park(con, &smtp_process);
 		return;
 	}
 
@@ -0,0 +1,330 @@
+/**
+ * @file /magma/servers/smtp/pipeline.c
+ *
+ * @brief	Functions used to run the independent checks performed on inbound messages concurrently.
+ *
+ * @note	The RBL, SPF, DKIM and virus checks only depend on the connection and the message, so a message that needs several of them
+ * 			hands all but one to a dedicated set of filter threads and runs the last on the connection's own thread. The connection waits
+ * 			for the batch to finish, so its latency is bound by the slowest check instead of their sum. Filter threads are kept separate
+ * 			from the worker pool because the workers are the ones waiting on them.
+ *
+ * $Author$
+ * $Date$
+ * $Revision$
+ *
+ */
+
+#include "magma.h"
+
+typedef struct {
+	uint32_t pending;
+	pthread_cond_t done;
+	pthread_mutex_t lock;
+} smtp_batch_t;
+
+typedef struct {
+	int_t type, result;
+	connection_t *con;
+	smtp_batch_t *batch;
+	struct smtp_check_t *next;
+} smtp_check_t;
+
+struct {
+	bool_t running;
+	pthread_t *threads;
+	pthread_cond_t ready;
+	pthread_mutex_t lock;
+	smtp_check_t *head, *tail;
+	uint32_t count;
+} pipeline = {
+		.running = false,
+		.threads = NULL,
+		.ready = PTHREAD_COND_INITIALIZER,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.head = NULL,
+		.tail = NULL,
+		.count = 0
+};
+
+/**
+ * @brief	Calculate the number of microseconds between two monotonic clock readings.
+ * @param	start	the earlier clock reading.
+ * @param	finish	the later clock reading.
+ * @return	the elapsed time in microseconds.
+ */
+int32_t smtp_pipeline_elapsed(struct timespec *start, struct timespec *finish) {
+	return ((finish->tv_sec - start->tv_sec) * 1000000) + ((finish->tv_nsec - start->tv_nsec) / 1000);
+}
+
+/**
+ * @brief	Build the cache key used to store the result of an RBL or SPF check.
+ * @note	SPF results depend on the sending address and the HELO domain, so both are folded into the key with a hash.
+ * @param	con		the connection being checked.
+ * @param	type	the type of check, either SMTP_CHECK_RBL or SMTP_CHECK_SPF.
+ * @param	output	a managed string that will receive the key.
+ * @return	NULL on failure, or a pointer to the output string on success.
+ */
+stringer_t * smtp_pipeline_key(connection_t *con, int_t type, stringer_t *output) {
+
+	uint64_t hash;
+	stringer_t *addr = MANAGEDBUF(128);
+
+	if (!(addr = con_addr_reversed(con, addr))) {
+		return NULL;
+	}
+	else if (type == SMTP_CHECK_RBL && st_sprint(output, "magma.rbl.%.*s", st_length_int(addr), st_char_get(addr)) > 0) {
+		return output;
+	}
+	else if (type != SMTP_CHECK_SPF) {
+		return NULL;
+	}
+
+	hash = hash_murmur64(st_data_get(con->smtp.mailfrom), st_length_get(con->smtp.mailfrom));
+	hash ^= con->smtp.helo ? hash_murmur64(st_data_get(con->smtp.helo), st_length_get(con->smtp.helo)) : 0;
+
+	if (st_sprint(output, "magma.spf.%.*s.%lx", st_length_int(addr), st_char_get(addr), hash) <= 0) {
+		return NULL;
+	}
+
+	return output;
+}
+
+/**
+ * @brief	Execute a single inbound message check and record how long it took.
+ * @note	Conclusive RBL and SPF results are cached for magma.smtp.pipeline.cache seconds, so repeat deliveries from the same
+ * 			server can skip the DNS queries. Errors are never cached.
+ * @param	con		the connection being checked.
+ * @param	type	the check to be performed.
+ * @return	the result code returned by the underlying check function.
+ */
+int_t smtp_pipeline_check(connection_t *con, int_t type) {
+
+	uint64_t cached;
+	int_t result = -1;
+	struct timespec start, finish;
+	stringer_t *key = MANAGEDBUF(256);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// The cached values are offset by two so a missing key, which is returned as zero, can't be confused with a result.
+	if ((type == SMTP_CHECK_RBL || type == SMTP_CHECK_SPF) && magma.smtp.pipeline.cache && (key = smtp_pipeline_key(con, type, key)) &&
+		(cached = cache_get_u64(key))) {
+		stats_increment_by_num(STATS_SMTP_CHECKS_CACHED);
+		return (int_t)cached - 2;
+	}
+
+	switch (type) {
+		case (SMTP_CHECK_RBL):
+			result = smtp_check_rbl(con);
+			break;
+		case (SMTP_CHECK_SPF):
+			result = spf_check(con_addr(con, MEMORYBUF(sizeof(ip_t))), con->smtp.helo, con->smtp.mailfrom);
+			break;
+		case (SMTP_CHECK_DKIM):
+			result = dkim_check(con->smtp.message->id, con->smtp.message->text);
+			break;
+		case (SMTP_CHECK_VIRUS):
+			result = virus_check(con->smtp.message->text);
+			break;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	switch (type) {
+		case (SMTP_CHECK_RBL):
+			stats_adjust_by_num(STATS_SMTP_CHECKS_RBL_TIME, smtp_pipeline_elapsed(&start, &finish));
+			break;
+		case (SMTP_CHECK_SPF):
+			stats_adjust_by_num(STATS_SMTP_CHECKS_SPF_TIME, smtp_pipeline_elapsed(&start, &finish));
+			break;
+		case (SMTP_CHECK_DKIM):
+			stats_adjust_by_num(STATS_SMTP_CHECKS_DKIM_TIME, smtp_pipeline_elapsed(&start, &finish));
+			break;
+		case (SMTP_CHECK_VIRUS):
+			stats_adjust_by_num(STATS_SMTP_CHECKS_VIRUS_TIME, smtp_pipeline_elapsed(&start, &finish));
+			break;
+	}
+
+	if ((type == SMTP_CHECK_RBL || type == SMTP_CHECK_SPF) && magma.smtp.pipeline.cache && key && (result == 1 || result == -2)) {
+		cache_set_u64(key, result + 2, magma.smtp.pipeline.cache);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	The main loop for the filter threads, which execute the checks handed to them by smtp_pipeline_run().
+ * @return	This function returns no value.
+ */
+void smtp_pipeline_thread(void) {
+
+	smtp_check_t *check;
+
+	while (true) {
+
+		mutex_lock(&pipeline.lock);
+
+		while (pipeline.running && !pipeline.head) {
+			pthread_cond_wait(&pipeline.ready, &pipeline.lock);
+		}
+
+		// Any checks still queued when the pipeline stops are drained before the thread exits, so no connection is left waiting.
+		if (!(check = pipeline.head)) {
+			mutex_unlock(&pipeline.lock);
+			break;
+		}
+		else if (!(pipeline.head = (smtp_check_t *)check->next)) {
+			pipeline.tail = NULL;
+		}
+
+		mutex_unlock(&pipeline.lock);
+
+		check->result = smtp_pipeline_check(check->con, check->type);
+
+		mutex_lock(&(check->batch->lock));
+		if (!--check->batch->pending) {
+			pthread_cond_signal(&(check->batch->done));
+		}
+		mutex_unlock(&(check->batch->lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Run a set of inbound message checks concurrently, and store the results inside the connection.
+ * @note	Checks that can't be handed to a filter thread are run on the calling thread, so the results are always complete when this function returns.
+ * @param	con		the connection being checked.
+ * @param	checks	a bitmask of SMTP_CHECK_* values indicating which checks to perform.
+ * @return	This function returns no value.
+ */
+void smtp_pipeline_run(connection_t *con, int_t checks) {
+
+	int_t last = 0;
+	uint32_t queued = 0;
+	smtp_batch_t batch;
+	smtp_check_t slots[4];
+	int_t *results[4] = { &(con->smtp.checked.rbl), &(con->smtp.checked.spf), &(con->smtp.checked.dkim), &(con->smtp.checked.virus) };
+
+	// The check performed on the calling thread is the last one requested, which is the virus scan when it's needed, since that tends to be the slowest.
+	for (int_t i = 0; i < 4; i++) {
+		if (checks & (1 << i)) last = i;
+	}
+
+	mm_wipe(&batch, sizeof(smtp_batch_t));
+	mm_wipe(slots, sizeof(slots));
+
+	mutex_init(&(batch.lock), NULL);
+	pthread_cond_init(&(batch.done), NULL);
+
+	mutex_lock(&pipeline.lock);
+
+	for (int_t i = 0; pipeline.running && i < last; i++) {
+		if (checks & (1 << i)) {
+
+			slots[i].con = con;
+			slots[i].type = 1 << i;
+			slots[i].batch = &batch;
+
+			if (pipeline.tail) {
+				pipeline.tail->next = (struct smtp_check_t *)&slots[i];
+			}
+			else {
+				pipeline.head = &slots[i];
+			}
+
+			pipeline.tail = &slots[i];
+			checks &= ~(1 << i);
+			queued++;
+		}
+	}
+
+	// The pending count is set before the lock is released, so the filter threads can't finish the batch before every check is counted.
+	batch.pending = queued;
+
+	if (queued) {
+		pthread_cond_broadcast(&pipeline.ready);
+	}
+
+	mutex_unlock(&pipeline.lock);
+
+	// Whatever wasn't handed off, either the final check or everything if the filter threads aren't running, is performed here.
+	for (int_t i = 0; i < 4; i++) {
+		if (checks & (1 << i)) {
+			*results[i] = smtp_pipeline_check(con, 1 << i);
+		}
+	}
+
+	mutex_lock(&(batch.lock));
+	while (batch.pending) {
+		pthread_cond_wait(&(batch.done), &(batch.lock));
+	}
+	mutex_unlock(&(batch.lock));
+
+	for (int_t i = 0; i < 4; i++) {
+		if (slots[i].batch) {
+			*results[i] = slots[i].result;
+		}
+	}
+
+	pthread_cond_destroy(&(batch.done));
+	mutex_destroy(&(batch.lock));
+
+	return;
+}
+
+/**
+ * @brief	Launch the filter threads used to check inbound messages concurrently.
+ * @note	If magma.smtp.pipeline.threads is zero, no threads are launched and every check runs on the connection's own thread.
+ * @return	true on success or false on failure.
+ */
+bool_t smtp_pipeline_start(void) {
+
+	if (!magma.smtp.pipeline.threads) {
+		return true;
+	}
+	else if (!(pipeline.threads = mm_alloc(sizeof(pthread_t) * magma.smtp.pipeline.threads))) {
+		log_critical("Unable to allocate memory for the SMTP filter threads.");
+		return false;
+	}
+
+	pipeline.running = true;
+
+	for (uint32_t i = 0; i < magma.smtp.pipeline.threads; i++) {
+		if (thread_launch(pipeline.threads + i, &smtp_pipeline_thread, NULL)) {
+			log_critical("Unable to launch an SMTP filter thread. {launched = %u / requested = %u}", i, magma.smtp.pipeline.threads);
+			pipeline.count = i;
+			smtp_pipeline_stop();
+			return false;
+		}
+	}
+
+	pipeline.count = magma.smtp.pipeline.threads;
+
+	return true;
+}
+
+/**
+ * @brief	Stop the filter threads, after any checks they've already been handed have finished.
+ * @return	This function returns no value.
+ */
+void smtp_pipeline_stop(void) {
+
+	mutex_lock(&pipeline.lock);
+	pipeline.running = false;
+	pthread_cond_broadcast(&pipeline.ready);
+	mutex_unlock(&pipeline.lock);
+
+	for (uint32_t i = 0; pipeline.threads && i < pipeline.count; i++) {
+		thread_join(pipeline.threads[i]);
+	}
+
+	if (pipeline.threads) {
+		mm_free(pipeline.threads);
+		pipeline.threads = NULL;
+	}
+
+	pipeline.count = 0;
+
+	return;
+}
@@ -34,13 +34,16 @@ void smtp_starttls(connection_t *con) {
 
 	con_write_bl(con, "220 READY\r\n", 11);
 
+	// Push the 220 out before the socket is wrapped.
+	con_flush(con);
+
 	if (!(con->network.ssl = ssl_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
 		con_write_bl(con, "454 STARTTLS FAILED\r\n", 21);
 		log_pedantic("The SSL connection attempt failed.");
 		return;
 	}
 
-	stats_increment_by_name("smtp.connections.secure");
+	stats_increment_by_num(STATS_SMTP_CONNECTIONS_SECURE);
 	st_length_set(con->network.buffer, 0);
 	con->network.line = pl_null();
 	con->network.status = 1;
@@ -631,14 +634,15 @@ void smtp_rcpt_to(connection_t *con) {
 		return;
 	}
 
+	// The RBL and SPF checks both wait on DNS, so if this recipient needs either result, and it hasn't been computed yet, look them up concurrently.
+	if ((result->rbl == 1 && con->smtp.checked.rbl == 0) || (result->spf == 1 && con->smtp.checked.spf == 0)) {
+		smtp_pipeline_run(con, (result->rbl == 1 && con->smtp.checked.rbl == 0 ? SMTP_CHECK_RBL : 0) |
+			(result->spf == 1 && con->smtp.checked.spf == 0 ? SMTP_CHECK_SPF : 0));
+	}
+
 	// Check the connecting server against several RBL databases.
 	if (result->rbl == 1) {
 
-		// Perform the check.
-		if (con->smtp.checked.rbl == 0) {
-			con->smtp.checked.rbl = smtp_check_rbl(con);
-		}
-
 		// If the user has elected to reject these messages.
 		if (con->smtp.checked.rbl == -2 && result->rblaction == SMTP_ACTION_REJECT) {
 
@@ -689,10 +693,6 @@ void smtp_rcpt_to(connection_t *con) {
 
 	// If this user is enforcing SPF.
 	if (result->spf == 1) {
-		// Perform the SPF check.
-		if (con->smtp.checked.spf == 0) {
-			con->smtp.checked.spf = spf_check(con_addr(con, MEMORYBUF(sizeof(ip_t))), con->smtp.helo, con->smtp.mailfrom);
-		}
 
 		/// BUG: Detect messages 'from' a local user/domain and tell them to authenticate first.
 		if (con->smtp.checked.spf == -2 && result->spfaction == SMTP_ACTION_REJECT) {
@@ -720,7 +720,7 @@ void smtp_rcpt_to(connection_t *con) {
 
 void smtp_data_finish(connection_t *con, size_t read, int_t checker) {
 
-	chr_t *stream;
+	chr_t *stream, *next;
 	int_t increment;
 
 	// In case we exit early.
@@ -736,6 +736,13 @@ void smtp_data_finish(connection_t *con, size_t read, int_t checker) {
 		stream = st_data_get(con->network.buffer);
 
 		for (increment = 0; increment < read && checker != 4; increment++) {
+
+			// Skip to the end of the current line, since nothing in the middle of a line can complete the terminator.
+			if (checker == 0 && *stream != '\n' && (next = memchr(stream, '\n', read - increment))) {
+				increment += next - stream;
+				stream = next;
+			}
+
 			if (checker == 0 && *stream == '\n') {
 				checker++;
 			}
@@ -776,23 +783,24 @@ void smtp_data_finish(connection_t *con, size_t read, int_t checker) {
 
 int_t smtp_data_read(connection_t *con, stringer_t **message) {
 
-	chr_t *stream, *buffer;
+	chr_t *stream, *buffer, *next;
 	stringer_t *result, *holder;
 	int_t read = 0, increment;
-	size_t used = 0, size = 128 * 1024;
+	size_t used = 0, span, size = 128 * 1024;
 	int_t header = 1, checker = 1, carriage = 0;
 
 	// In case we end early.
 	*message = NULL;
 	stream = st_data_get(con->network.buffer);
 
-	// Expand the stringer in 128 KB chunks.
-	if (!(result = st_alloc_opts(MAPPED_T | JOINTED | HEAP, size))) {
+	// The message is written into a spool file as it arrives, and the mapping is expanded in 128 KB chunks.
+	if (!(result = spool_mapped(MAGMA_SPOOL_DATA, "smtp", size))) {
 		smtp_data_finish(con, 0, checker);
 		return -1;
 	}
 
 	// Setup the pointer into the stringer.
+	size = st_avail_get(result);
 	buffer = st_char_get(result);
 	read = con_read(con);
 
@@ -810,7 +818,37 @@ int_t smtp_data_read(connection_t *con, stringer_t **message) {
 		}
 
 		// Read in the new data.
-		for (increment = 0; checker != 4 && increment < read; increment++) {
+		increment = 0;
+
+		while (checker != 4 && increment < read) {
+
+			// Once we're past the header, the characters in the middle of a line can't affect the state machines below, so the rest of
+			// the line is located using memchr(), which scans a vector at a time, and copied as a block.
+			if (header == 3 && checker == 0 && *stream != '\n') {
+
+				span = (next = memchr(stream, '\n', read - increment)) ? next - stream : (size_t)(read - increment);
+
+				if (used + span + 32 > size) {
+					if (!(holder = st_realloc(result, used + span + (128 * 1024)))) {
+						log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Returning an error to the client.", used + span + (128 * 1024));
+						smtp_data_finish(con, read, checker);
+						st_free(result);
+						return -1;
+					}
+
+					size = st_avail_get(holder);
+					result = holder;
+					buffer = st_char_get(result) + used;
+				}
+
+				mm_copy(buffer, stream, span);
+				carriage = *(stream + span - 1) == '\r' ? 1 : 0;
+				buffer += span;
+				stream += span;
+				used += span;
+				increment += span;
+				continue;
+			}
 
 			// Logic for detecting header mode.
 			if (header != 3) {
@@ -887,11 +925,12 @@ int_t smtp_data_read(connection_t *con, stringer_t **message) {
 				}
 
 				// Setup the pointers again.
-				size += 128 * 1024;
+				size = st_avail_get(holder);
 				result = holder;
 				buffer = st_char_get(result) + used;
 			}
 
+			increment++;
 			stream++;
 		}
 
@@ -1018,9 +1057,26 @@ void smtp_data_outbound(connection_t *con) {
 
 void smtp_data_inbound(connection_t *con) {
 
+	int_t checks = 0;
 	smtp_inbound_prefs_t *current;
 	uint32_t perm_errors = 0, temp_errors = 0, delivered = 0, bounces = 0;
 
+	// Collect the message checks needed by any of the recipients, so they can run concurrently instead of one after another.
+	for (current = con->smtp.in_prefs; current != NULL; current = (smtp_inbound_prefs_t *) current->next) {
+
+		if ((current->virus == 1 || current->phish == 1) && (con->smtp.checked.virus == 0 || con->smtp.checked.virus == -1)) {
+			checks |= SMTP_CHECK_VIRUS;
+		}
+
+		if (!con->smtp.bypass && current->dkim == 1 && con->smtp.checked.dkim == 0) {
+			checks |= SMTP_CHECK_DKIM;
+		}
+	}
+
+	if (checks) {
+		smtp_pipeline_run(con, checks);
+	}
+
 	current = con->smtp.in_prefs;
 	while (current != NULL) {
 
@@ -1176,10 +1232,18 @@ void smtp_data(connection_t *con) {
  */
 void smtp_init(connection_t *con) {
 
+	ip_t remote;
+
 	// Does this connection come from a trusted IP?
 	if (smtp_bypass_check(con)) {
 		con->smtp.bypass = 1;
 	}
+	// Turn away addresses which have opened too many connections over the past minute.
+	else if (magma.smtp.throttle && con_addr(con, &remote) && tally_connection(&remote) > magma.smtp.throttle) {
+		con_write_bl(con, "421 TOO MANY CONNECTIONS - PLEASE TRY AGAIN LATER\r\n", 51);
+		con_destroy(con);
+		return;
+	}
 
 	// Queue a reverse lookup.
 	con_reverse_enqueue(con);
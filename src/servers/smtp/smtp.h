@@ -69,6 +69,15 @@ stringer_t *  smtp_parse_helo_domain(connection_t *con);
 stringer_t *  smtp_parse_mail_from_path(connection_t *con);
 stringer_t *  smtp_parse_rcpt_to(connection_t *con);
 
+/// pipeline.c
+int_t         smtp_pipeline_check(connection_t *con, int_t type);
+int32_t       smtp_pipeline_elapsed(struct timespec *start, struct timespec *finish);
+stringer_t *  smtp_pipeline_key(connection_t *con, int_t type, stringer_t *output);
+void          smtp_pipeline_run(connection_t *con, int_t checks);
+bool_t        smtp_pipeline_start(void);
+void          smtp_pipeline_stop(void);
+void          smtp_pipeline_thread(void);
+
 /// relay.c
 void        smtp_client_close(client_t *client);
 client_t *  smtp_client_connect(int_t premium);
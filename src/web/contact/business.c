@@ -15,16 +15,14 @@
 /**
  * @brief	Return the contact/abuse page with a marked error indicator for the user in the event of a user submission error.
  * @param	branch		a null-terminated string containing the source  of the error: "Abuse" or "Contact"
- * @param	xpath		a null-terminated string containing the xpath of the element in the returned page that should be colored red.
+ * @param	field		a null-terminated string containing the id of the element in the returned page that should be colored red.
  * @param	id			a null-terminated string containing the id of the error text <span> element to be added to the document.
  * @param	message		a null-terminated string containing the actual error message text to be displayed to the user.
  * @return	NULL on failure, or a pointer to the processed contact page with error message on success.
  */
-http_page_t * contact_business_add_error(chr_t *branch, uchr_t *xpath, uchr_t *id, uchr_t *message) {
+http_page_t * contact_business_add_error(chr_t *branch, chr_t *field, chr_t *id, chr_t *message) {
 
 	http_page_t *page = NULL;
-	xmlNodePtr node, error;
-	xmlXPathObjectPtr xpath_obj;
 
 	// We are here either for the contact or abuse page.
 	if (!st_cmp_cs_eq(NULLER(branch), PLACER("Abuse", 5)) && !((page = http_page_get("contact/abuse")))) {
@@ -34,24 +32,9 @@ http_page_t * contact_business_add_error(chr_t *branch, uchr_t *xpath, uchr_t *i
 		return NULL;
 	}
 
-	if ((xpath_obj = xml_xpath_eval(xpath, page->xpath_ctx)) && xpath_obj->nodesetval &&
-		xpath_obj->nodesetval->nodeNr && xpath_obj->nodesetval->nodeTab[0]) {
-
-		node = (xmlNodePtr)xpath_obj->nodesetval->nodeTab[0];
-
-		// Make the field red.
-		xml_node_set_property(node, (uchr_t *)"class", (uchr_t *)"red");
-
-		// Add the error message.
-		if ((error = xml_node_new((uchr_t *)"span"))) {
-			xml_node_set_property(error, (uchr_t *)"id", id);
-			xml_node_set_content(error, message);
-
-			if (!(xml_node_add_sibling(node, error))) {
-				xml_node_free(error);
-			}
-
-		}
+	// Make the field red and add the error message.
+	if (http_page_set_property(page, field, "class", "red")) {
+		http_page_add_sibling(page, field, "span", id, message);
 	}
 
 	return page;
@@ -158,15 +141,15 @@ void contact_business(connection_t *con, chr_t *branch) {
 
 	// If either the name, email, or message fields are omitted from the post, spit out an error message.
 	if (!(name = http_data_get(con, HTTP_DATA_POST, "your_name")) || !name->value) {
-		contact_print_form(con, branch, contact_business_add_error(branch, (uchr_t *)"//xhtml:input[@id='your_name']", (uchr_t *)"your_name_msg", (uchr_t *)"Please enter your name."));
+		contact_print_form(con, branch, contact_business_add_error(branch, "your_name", "your_name_msg", "Please enter your name."));
 		return;
 	}
 	else if (!(email = http_data_get(con, HTTP_DATA_POST, "your_email")) || !email->value || !contact_business_valid_email(email->value)) {
-		contact_print_form(con, branch, contact_business_add_error(branch,  (uchr_t *)"//xhtml:input[@id='your_email']",  (uchr_t *)"your_email_msg",  (uchr_t *)"A valid e-mail address is required."));
+		contact_print_form(con, branch, contact_business_add_error(branch, "your_email", "your_email_msg", "A valid e-mail address is required."));
 		return;
 	}
 	else if (!(message = http_data_get(con, HTTP_DATA_POST, "your_message")) || !message->value) {
-		contact_print_form(con, branch, contact_business_add_error(branch,  (uchr_t *)"//xhtml:textarea[@id='your_message']",  (uchr_t *)"your_message_msg",  (uchr_t *)"Please enter your message."));
+		contact_print_form(con, branch, contact_business_add_error(branch, "your_message", "your_message_msg", "Please enter your message."));
 		return;
 	}
 
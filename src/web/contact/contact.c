@@ -33,26 +33,26 @@ void contact_print_message(connection_t *con, chr_t *branch, chr_t *message) {
 	// For contact page submissions.
 	if (!st_cmp_cs_eq(NULLER(branch), PLACER("Contact", 7))) {
 		// Update the title.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:title", (uchr_t *)"Lavabit ..::.. Contact");
+		http_page_set_content(page, "title", "Lavabit ..::.. Contact");
 		// Set the proper active indicators.
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:a[@id='nav_contact']", (uchr_t *)"class", (uchr_t *)"active");
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:a[text()='Contact Lavabit']", (uchr_t *)"class", (uchr_t *)"active");
+		http_page_set_property(page, "nav_contact", "class", "active");
+		http_page_set_property(page, "link_contact", "class", "active");
 	}
 
 	// For abuse page submissions.
 	if (!st_cmp_cs_eq(NULLER(branch), PLACER("Abuse", 5))) {
 		// Update the title.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:title", (uchr_t *)"Lavabit ..::.. Report Abuse");
+		http_page_set_content(page, "title", "Lavabit ..::.. Report Abuse");
 		// Set the proper active indicators.
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:div[@id='secondary']//xhtml:a[text()='Report Abuse']", (uchr_t *)"class", (uchr_t *)"active");
+		http_page_set_property(page, "link_abuse", "class", "active");
 	}
 
 	// Set the message.
 	if (message) {
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='message']", (uchr_t *)message);
+		http_page_set_content(page, "message", message);
 	}
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_page_render(page))) {
 		http_print_500_log(con, "Contact page could not be generated.");
 		http_page_free(page);
 		return;
@@ -77,7 +77,6 @@ void contact_print_form(connection_t *con, chr_t *branch, http_page_t *page) {
 
 	stringer_t *raw;
 	http_data_t *data;
-	xmlChar *escaped = NULL;
 
 	if (!page && !st_cmp_cs_eq(NULLER(branch), PLACER("Abuse", 5)) && !(page = http_page_get("contact/abuse"))) {
 		contact_print_message(con, branch, "An error occurred while trying to process your request. Please try again in a few minutes.");
@@ -90,22 +89,20 @@ void contact_print_form(connection_t *con, chr_t *branch, http_page_t *page) {
 
 	// Update the name field.
 	if ((data = http_data_get(con, HTTP_DATA_POST, "your_name")) && data->value) {
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *) "//xhtml:input[@id='your_name']", (uchr_t *)"value", (uchr_t *)st_char_get(data->value));
+		http_page_set_property(page, "your_name", "value", st_char_get(data->value));
 	}
 
 	// Update the email field.
 	if ((data = http_data_get(con, HTTP_DATA_POST, "your_email")) && data->value) {
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *) "//xhtml:input[@id='your_email']", (uchr_t *)"value", (uchr_t *)st_char_get(data->value));
+		http_page_set_property(page, "your_email", "value", st_char_get(data->value));
 	}
 
 	// Update the message field.
-	if ((data = http_data_get(con, HTTP_DATA_POST, "your_message")) && data->value && (escaped = xml_encode(page->doc_obj, data->value))) {
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *) "//xhtml:textarea[@id='your_message']", escaped);
+	if ((data = http_data_get(con, HTTP_DATA_POST, "your_message")) && data->value) {
+		http_page_set_content(page, "your_message", st_char_get(data->value));
 	}
 
-	mm_cleanup(escaped);
-
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_page_render(page))) {
 		contact_print_message(con, "Contact", "An error occurred while trying to process your request. Please try again in a few minutes.");
 		http_page_free(page);
 		return;
@@ -19,7 +19,7 @@ void    contact_abuse_increment_history(connection_t *con);
 
 /// business.c
 void           contact_business(connection_t *con, chr_t *branch);
-http_page_t *  contact_business_add_error(chr_t *branch, uchr_t *xpath, uchr_t *id, uchr_t *message);
+http_page_t *  contact_business_add_error(chr_t *branch, chr_t *field, chr_t *id, chr_t *message);
 bool_t         contact_business_valid_email(stringer_t *email);
 
 /// contact.c
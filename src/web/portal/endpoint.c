@@ -2771,20 +2771,109 @@ void portal_endpoint_ad(connection_t *con) {
 	return;
 }
 
+/**
+ * @brief	Find the messages in a folder which contain a search string, in response to a json-rpc "search" portal request.
+ * @note	The full text search index is used to rule out the indexed messages which can't match, and the remaining messages are copied
+ * 			while the user is locked, and then loaded and scanned after the lock has been released.
+ * @param	con		a pointer to the connection object across which the json-rpc response will be sent.
+ * @return	This function returns no value.
+ */
 void portal_endpoint_search(connection_t *con) {
 
-	stringer_t *response;
+	multi_t key;
+	json_t *list;
+	chr_t *query;
+	size_t location;
+	inx_t *pending;
+	json_error_t err;
+	uint64_t foldernum;
+	inx_cursor_t *cursor;
+	mail_message_t *message;
+	fulltext_result_t *matches;
+	meta_message_t *active, *copy;
 
-	if ((response = st_aprint("{\"jsonrpc\": \"2.0\", \"error\": {\"code\": %i, \"message\": \"%s%s%s\"}, \"id\": %lu}\r\n",
-		PORTAL_ENDPOINT_ERROR_SEARCH, "Method (", __FUNCTION__, ") is under construction.", con->http.portal.id))) {
-		http_response_header(con, 200, PLACER("application/json; charset=utf-8", 31), st_length_get(response));
-		con_write_st(con, response);
-		st_free(response);
+	// Check the session state. Method has 2 parameters.
+	if (!portal_validate_request (con, PORTAL_ENDPOINT_ERROR_SEARCH, "search", true, 2)) {
+		return;
 	}
-	else {
-		con->http.mode = HTTP_ERROR_500;
+	// Validate the request format and extract the submitted values.
+	else if (json_unpack_ex_d(con->http.portal.params, &err, JSON_STRICT, "{s:I, s:s}", "folderID", &foldernum, "query", &query) || !ns_length_get(query)) {
+		log_pedantic("Received invalid portal search request parameters { user = %.*s, errmsg = %s }",
+			(int)st_length_get(con->http.session->user->username), st_char_get(con->http.session->user->username), err.text);
+		portal_endpoint_error(con, 400, JSON_RPC_2_ERROR_SERVER_METHOD_PARAMS, "Invalid method parameters.");
+		return;
+	}
+
+	if (!(list = json_array_d())) {
+		portal_endpoint_error(con, 500, JSON_RPC_2_ERROR_SERVER_INTERNAL, "Internal server error.");
+		return;
+	}
+	else if (!(pending = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+		json_decref_d(list);
+		portal_endpoint_error(con, 500, JSON_RPC_2_ERROR_SERVER_INTERNAL, "Internal server error.");
+		return;
+	}
+
+	matches = fulltext_query(con->http.session->user->usernum, NULLER(query), true);
+	meta_user_rlock(con->http.session->user);
+
+	if (!meta_folders_by_number(con->http.session->user->folders, foldernum)) {
+		meta_user_unlock(con->http.session->user);
+		fulltext_result_free(matches);
+		inx_free(pending);
+		json_decref_d(list);
+		portal_endpoint_error(con, 400, PORTAL_ENDPOINT_ERROR_REFERENCE | PORTAL_ENDPOINT_ERROR_SEARCH, "Invalid folder reference.");
+		return;
+	}
+
+	key.type = M_TYPE_UINT64;
+
+	// Copy the messages which need to be scanned, so they can be loaded without holding the user lock.
+	if ((cursor = inx_cursor_alloc(con->http.session->user->messages))) {
+
+		while ((active = inx_cursor_value_next(cursor))) {
+
+			if (active->foldernum != foldernum || (matches && !fulltext_result_contains(matches, active->messagenum) &&
+				fulltext_indexed(con->http.session->user->usernum, active->messagenum))) {
+				continue;
+			}
+
+			key.val.u64 = active->messagenum;
+
+			if (!(copy = meta_message_dupe(active)) || !inx_insert(pending, key, copy)) {
+				log_pedantic("Unable to queue a message for the search scan. {messagenum = %lu}", active->messagenum);
+				meta_message_free(copy);
+			}
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	meta_user_unlock(con->http.session->user);
+	fulltext_result_free(matches);
+
+	if ((cursor = inx_cursor_alloc(pending))) {
+
+		while ((active = inx_cursor_value_next(cursor))) {
+
+			if (!(message = mail_load_message(active, con->http.session->user, NULL, 0))) {
+				continue;
+			}
+
+			if (st_search_ci(message->text, NULLER(query), &location) == 1 && json_array_append_new_d(list, json_integer_d(active->messagenum))) {
+				log_pedantic("The message number could not be appended to the search result list.");
+			}
+
+			mail_destroy(message);
+		}
+
+		inx_cursor_free(cursor);
 	}
 
+	inx_free(pending);
+
+	portal_endpoint_response(con, "{s:s, s:o, s:I}", "jsonrpc", "2.0", "result", list, "id", con->http.portal.id);
+
 	return;
 }
 
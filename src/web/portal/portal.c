@@ -22,10 +22,8 @@
  */
 void portal_print_login(connection_t *con, chr_t *message) {
 
-	xmlNodePtr node;
 	stringer_t *raw;
 	http_page_t *page;
-	xmlXPathObjectPtr xpath_obj = NULL;
 
 	if ((page = http_page_get("portal/login")) == NULL) {
 		http_print_500(con);
@@ -33,13 +31,11 @@ void portal_print_login(connection_t *con, chr_t *message) {
 	}
 
 	// Set the message.
-	if (message != NULL && (xpath_obj = xml_xpath_eval((uchr_t *)"//xhtml:p[@id='message']", page->xpath_ctx)) != NULL && xpath_obj->nodesetval != NULL &&
-		xpath_obj->nodesetval->nodeNr != 0 && xpath_obj->nodesetval->nodeTab[0] != NULL) {
-		node = (xmlNodePtr)xpath_obj->nodesetval->nodeTab[0];
-		xml_node_set_content(node, (uchr_t *)message);
+	if (message != NULL) {
+		http_page_set_content(page, "message", message);
 	}
 
-	if ((raw = xml_dump_doc(page->doc_obj)) == NULL) {
+	if ((raw = http_page_render(page)) == NULL) {
 		http_print_500(con);
 		http_page_free(page);
 		return;
@@ -86,7 +86,7 @@ bool_t register_abuse_check_blocklist(connection_t *con) {
 	rwlock_unlock(&register_blocklist_lock);
 
 	if (ret) {
-		stats_increment_by_name("web.register.blocked");
+		stats_increment_by_num(STATS_WEB_REGISTER_BLOCKED);
 	}
 
 	return ret;
@@ -41,22 +41,22 @@ void statistics_process(connection_t *con) {
 	}
 	else {
 		// Update the time.
-		xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='time']", (uchr_t *)buffer);
+		http_page_set_content(page, "time", buffer);
 	}
 
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='total_users']", portal_stats[portal_stat_total_users].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='checked_email_today']", portal_stats[portal_stat_users_checked_email_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='checked_email_week']", portal_stats[portal_stat_users_checked_email_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='sent_email_today']", portal_stats[portal_stat_users_sent_email_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='sent_email_week']", portal_stats[portal_stat_users_sent_email_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_received_today']", portal_stats[portal_stat_emails_received_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_received_week']", portal_stats[portal_stat_emails_received_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_sent_today']", portal_stats[portal_stat_emails_sent_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='emails_sent_week']", portal_stats[portal_stat_emails_sent_week].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_today']", portal_stats[portal_stat_users_registered_today].val);
-	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_week']", portal_stats[portal_stat_users_registered_week].val);
+	http_page_set_uint64(page, "total_users", portal_stats[portal_stat_total_users].val);
+	http_page_set_uint64(page, "checked_email_today", portal_stats[portal_stat_users_checked_email_today].val);
+	http_page_set_uint64(page, "checked_email_week", portal_stats[portal_stat_users_checked_email_week].val);
+	http_page_set_uint64(page, "sent_email_today", portal_stats[portal_stat_users_sent_email_today].val);
+	http_page_set_uint64(page, "sent_email_week", portal_stats[portal_stat_users_sent_email_week].val);
+	http_page_set_uint64(page, "emails_received_today", portal_stats[portal_stat_emails_received_today].val);
+	http_page_set_uint64(page, "emails_received_week", portal_stats[portal_stat_emails_received_week].val);
+	http_page_set_uint64(page, "emails_sent_today", portal_stats[portal_stat_emails_sent_today].val);
+	http_page_set_uint64(page, "emails_sent_week", portal_stats[portal_stat_emails_sent_week].val);
+	http_page_set_uint64(page, "users_registered_today", portal_stats[portal_stat_users_registered_today].val);
+	http_page_set_uint64(page, "users_registered_week", portal_stats[portal_stat_users_registered_week].val);
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_page_render(page))) {
 		http_print_500(con);
 		http_page_free(page);
 		return;
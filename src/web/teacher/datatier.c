@@ -109,6 +109,24 @@ void teacher_data_delete(teacher_data_t *teach) {
 	// Reset the statement parameters.
 	mm_wipe(parameters, sizeof(parameters));
 
+	// Usernum
+	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[0].buffer_length = sizeof(uint64_t);
+	parameters[0].buffer = &(teach->usernum);
+	parameters[0].is_unsigned = true;
+
+	// Signature
+	parameters[1].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[1].buffer_length = sizeof(uint64_t);
+	parameters[1].buffer = &(teach->signum);
+	parameters[1].is_unsigned = true;
+
+	// Record the flag change for every message carrying the signature.
+	stmt_exec(stmts.insert_message_changes_signature, parameters);
+
+	// Reset the statement parameters.
+	mm_wipe(parameters, sizeof(parameters));
+
 	// Signum
 	parameters[0].buffer_type = MYSQL_TYPE_LONGLONG;
 	parameters[0].buffer_length = sizeof(uint64_t);
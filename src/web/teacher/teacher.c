@@ -30,9 +30,9 @@ void teacher_print_message(connection_t *con, chr_t *message) {
 	}
 
 	// Set the message.
-	xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:p[@id='message']", (uchr_t *)message);
+	http_page_set_content(page, "message", message);
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_page_render(page))) {
 		http_print_500(con);
 		http_page_free(page);
 		return;
@@ -75,20 +75,20 @@ void teacher_print_form(connection_t *con, http_page_t *page, teacher_data_t *te
 		return;
 	}
 
-	xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:strong[@id='current']", (uchr_t *)(teach->disposition == 1 ? "spam" : "innocent"));
-	xml_set_xpath_ns(page->xpath_ctx, (xmlChar *)"//xhtml:strong[@id='new']", (uchr_t *)(teach->disposition == 1 ? "innocent" : "spam"));
+	http_page_set_content(page, "current", teach->disposition == 1 ? "spam" : "innocent");
+	http_page_set_content(page, "new", teach->disposition == 1 ? "innocent" : "spam");
 
 	// Set the signature number.
 	if (snprintf(buffer, 64, "%lu", teach->signum) > 0) {
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:input[@id='sig']", (uchr_t *)"value", (uchr_t *)buffer);
+		http_page_set_property(page, "sig", "value", buffer);
 	}
 
 	// Set the key number.
 	if (snprintf(buffer, 64, "%lu", teach->keynum) > 0) {
-		xml_set_xpath_property(page->xpath_ctx, (xmlChar *)"//xhtml:input[@id='key']", (uchr_t *)"value", (uchr_t *)buffer);
+		http_page_set_property(page, "key", "value", buffer);
 	}
 
-	if (!(raw = xml_dump_doc(page->doc_obj))) {
+	if (!(raw = http_page_render(page))) {
 		http_print_500(con);
 		http_page_free(page);
 		return;
@@ -104,39 +104,22 @@ void teacher_print_form(connection_t *con, http_page_t *page, teacher_data_t *te
 
 /**
   * @brief	Get the teacher/teacher template and add an error message to it.
-  * @param	xpath	a null-terminated string containing the xpath of the node in the template to be marked with the error message.
-  * @param	id		a null-terminated string containing the id of the error message node to be added as the sibling of the node in the specified xpath.
+  * @param	field	a null-terminated string containing the id of the element in the template to be marked with the error message.
+  * @param	id		a null-terminated string containing the id of the error message element to be added after the marked element.
   * @param	message	a null-terminated string containing the error message to be displayed to the user.
   * @param	NULL on failure, or a pointer to the modified teacher/teacher template page on success.
  */
-http_page_t * teacher_add_error(chr_t *xpath, chr_t *id, chr_t *message) {
+http_page_t * teacher_add_error(chr_t *field, chr_t *id, chr_t *message) {
 
 	http_page_t *page = NULL;
-	xmlNodePtr node, error;
-	xmlXPathObjectPtr xpath_obj;
 
 	if (!(page = http_page_get("teacher/teacher"))) {
 		return NULL;
 	}
 
-	if ((xpath_obj = xml_xpath_eval((uchr_t *)xpath, page->xpath_ctx)) && xpath_obj->nodesetval &&
-		xpath_obj->nodesetval->nodeNr && xpath_obj->nodesetval->nodeTab[0]) {
-
-		node = (xmlNodePtr)xpath_obj->nodesetval->nodeTab[0];
-
-		// Make the field red.
-		xml_node_set_property(node, (uchr_t *)"class", (uchr_t *)"red");
-
-		// Add the error message.
-		if ((error = xml_node_new((uchr_t *)"div"))) {
-			xml_node_set_property(error, (uchr_t *)"id", (uchr_t *)id);
-			xml_node_set_content(error, (uchr_t *)message);
-
-			if (!(xml_node_add_sibling(node, error))) {
-				xml_node_free(error);
-			}
-
-		}
+	// Make the field red and add the error message.
+	if (http_page_set_property(page, field, "class", "red")) {
+		http_page_add_sibling(page, field, "div", id, message);
 	}
 
 	return page;
@@ -285,7 +268,7 @@ void teacher_process(connection_t *con) {
 
 		if (!(pass = http_data_get(con, HTTP_DATA_POST, "password")) || !pass->value || !(credential = credential_alloc_auth(teach->username, pass->value)) ||
 			st_cmp_cs_eq(teach->password, credential->auth.password)) {
-			teacher_print_form(con, teacher_add_error("//xhtml:input[@id='password']", "password_msg", "An invalid password was provided. Please try again."), teach);
+			teacher_print_form(con, teacher_add_error("password", "password_msg", "An invalid password was provided. Please try again."), teach);
 		}
 		else {
 
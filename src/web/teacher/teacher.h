@@ -30,7 +30,7 @@ void              teacher_data_save(teacher_data_t *teach);
 
 /// teacher.c
 void           teacher_add_cookie(connection_t *con, teacher_data_t *teach);
-http_page_t *  teacher_add_error(chr_t *xpath, chr_t *id, chr_t *message);
+http_page_t *  teacher_add_error(chr_t *field, chr_t *id, chr_t *message);
 void           teacher_print_form(connection_t *con, http_page_t *page, teacher_data_t *teach);
 void           teacher_print_message(connection_t *con, chr_t *message);
 void           teacher_process(connection_t *con);